@@ -34,7 +34,12 @@ Quark CurrentState::getQuark(const std::string& subpath) const
     return _sink->getQuark(subpath);
 }
 
-const std::string& CurrentState::getString(Quark quark) const
+Quark CurrentState::getQuark(const char* subpath) const
+{
+    return _sink->getQuark(subpath);
+}
+
+const char* CurrentState::getString(Quark quark) const
 {
     return _sink->getString(quark);
 }
@@ -54,5 +59,10 @@ StateNode& CurrentState::getRoot()
     return _sink->getRoot();
 }
 
+StatePathHandle CurrentState::compilePath(const std::string& pathTemplate)
+{
+    return StatePathHandle {*this, pathTemplate};
+}
+
 }
 }
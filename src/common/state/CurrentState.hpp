@@ -24,6 +24,7 @@
 
 #include <common/state/AbstractStateValue.hpp>
 #include <common/state/Quark.hpp>
+#include <common/state/StatePathHandle.hpp>
 #include <common/BasicTypes.hpp>
 
 
@@ -57,10 +58,15 @@ public:
      */
     Quark getQuark(const std::string& subpath) const;
 
+    /**
+     * @see StateHistorySink::getQuark()
+     */
+    Quark getQuark(const char* subpath) const;
+
     /**
      * @see StateHistorySink::getString()
      */
-    const std::string& getString(Quark quark) const;
+    const char* getString(Quark quark) const;
 
     /**
      * @see StateHistorySink::getStateChangesCount()
@@ -77,6 +83,17 @@ public:
      */
     StateNode& getRoot();
 
+    /**
+     * Compiles the state path template \p pathTemplate into a state
+     * path handle.
+     *
+     * @see StatePathHandle
+     *
+     * @param pathTemplate Path template, e.g. "linux/threads/{int}/status"
+     * @returns            State path handle
+     */
+    StatePathHandle compilePath(const std::string& pathTemplate);
+
 private:
     // only StateHistorySink may build a CurrentState object
     CurrentState(StateHistorySink* sink);
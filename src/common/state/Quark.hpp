@@ -39,10 +39,24 @@ namespace common
  * existence. Having a Quark class also forces the user to acknowledge
  * the semantic meaning of a quark parameter.
  *
+ * The quark space is split in two: quarks with their most significant
+ * bit cleared are associated with strings, whereas quarks with this
+ * bit set directly carry a small non-negative integer (see fromInt()).
+ * Integer quarks are only used as state node child keys, so that
+ * indexing a state node by number (thread ID, CPU number, IRQ) needs
+ * no string conversion nor string database lookup.
+ *
  * @author Philippe Proulx
  */
 class Quark
 {
+public:
+    /// Tag of integer quarks
+    static const quark_t INT_TAG = 0x80000000;
+
+    /// Largest integer an integer quark can carry
+    static const std::int64_t MAX_INT = 0x7ffffffe;
+
 public:
     /**
      * Builds an empty quark with value 0.
@@ -62,6 +76,30 @@ public:
     {
     }
 
+    /**
+     * Returns whether or not the integer \p value can be carried by
+     * an integer quark.
+     *
+     * @param value Integer to check
+     * @returns     True if \p value fits an integer quark
+     */
+    static bool canHoldInt(std::int64_t value)
+    {
+        return value >= 0 && value <= MAX_INT;
+    }
+
+    /**
+     * Builds an integer quark carrying \p value, which must satisfy
+     * canHoldInt().
+     *
+     * @param value Integer to carry
+     * @returns     Integer quark
+     */
+    static Quark fromInt(std::int64_t value)
+    {
+        return Quark {static_cast<quark_t>(value) | INT_TAG};
+    }
+
     /**
      * Returns the underlying quark integer.
      */
@@ -70,6 +108,26 @@ public:
         return _quark;
     }
 
+    /**
+     * Returns whether or not this is an integer quark.
+     *
+     * @returns True if this is an integer quark
+     */
+    bool isInt() const
+    {
+        return (_quark & INT_TAG) != 0;
+    }
+
+    /**
+     * Returns the integer carried by this integer quark.
+     *
+     * @returns Carried integer
+     */
+    std::int64_t getInt() const
+    {
+        return _quark & ~INT_TAG;
+    }
+
     bool operator<(const Quark& q)
     {
         return _quark < q._quark;
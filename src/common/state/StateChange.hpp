@@ -0,0 +1,58 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATECHANGE_HPP
+#define _TIBEE_COMMON_STATECHANGE_HPP
+
+#include <cstdint>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * On-disk record of a state change.
+ *
+ * The state change log is a plain array of such records, in the order
+ * state nodes were assigned, hence in ascending timestamp order. A
+ * state change begins the interval of the new value of the node and
+ * ends the interval of its previous value (null values included).
+ *
+ * All fields are in native byte order.
+ *
+ * @author Philippe Proulx
+ */
+struct StateChange
+{
+    // change timestamp
+    std::uint64_t ts;
+
+    // node ID
+    std::uint32_t id;
+
+    // StateValueType of new value
+    std::uint32_t type;
+
+    // raw new value (see StateValue::getRaw())
+    std::uint64_t value;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATECHANGE_HPP
@@ -0,0 +1,94 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+
+#include <common/state/StateChangeWriter.hpp>
+#include <common/ex/StateHistory.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+StateChangeWriter::StateChangeWriter() :
+    _count {0},
+    _open {false}
+{
+    _changes.reserve(StateChangeWriter::BUFFER_SIZE);
+}
+
+void StateChangeWriter::open(const bfs::path& path)
+{
+    this->close();
+
+    _output.open(path, std::ios::binary | std::ios::trunc);
+    _count = 0;
+    _open = true;
+}
+
+void StateChangeWriter::reopen(const bfs::path& path, std::size_t count)
+{
+    this->close();
+
+    // appending always writes at the end of the file, wherever it is
+    _output.open(path, std::ios::binary | std::ios::app);
+
+    if (bfs::file_size(path) / sizeof(StateChange) < count) {
+        _output.close();
+
+        throw ex::StateHistory {
+            "state change log \"" + path.string() + "\" is missing changes"
+        };
+    }
+
+    bfs::resize_file(path, count * sizeof(StateChange));
+    _count = count;
+    _open = true;
+}
+
+void StateChangeWriter::close()
+{
+    // silently ignore if already closed
+    if (!_open) {
+        return;
+    }
+
+    _open = false;
+    this->flush();
+    _output.close();
+}
+
+void StateChangeWriter::flush()
+{
+    if (_changes.empty()) {
+        return;
+    }
+
+    _output.write(reinterpret_cast<const char*>(_changes.data()),
+                  _changes.size() * sizeof(StateChange));
+    _changes.clear();
+
+    if (!_output) {
+        throw ex::StateHistory {"cannot write state change log"};
+    }
+}
+
+}
+}
@@ -0,0 +1,145 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATECHANGEWRITER_HPP
+#define _TIBEE_COMMON_STATECHANGEWRITER_HPP
+
+#include <cstddef>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/state/StateChange.hpp>
+#include <common/state/StateValue.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * State change log writer.
+ *
+ * Appends StateChange records to a state change log file. Records are
+ * buffered in memory and written by large chunks.
+ *
+ * @author Philippe Proulx
+ */
+class StateChangeWriter :
+    boost::noncopyable
+{
+public:
+    /**
+     * Builds a closed state change log writer.
+     */
+    StateChangeWriter();
+
+    /**
+     * Creates state change log file \p path, overwriting it if it
+     * exists.
+     *
+     * @param path Path to state change log file
+     */
+    void open(const boost::filesystem::path& path);
+
+    /**
+     * Opens existing state change log file \p path to append changes
+     * to it, first removing all the changes following the first
+     * \p count ones (and any partial record).
+     *
+     * A missing file is created. Throws ex::StateHistory if the file
+     * holds less than \p count changes.
+     *
+     * @param path  Path to state change log file
+     * @param count Number of changes to keep
+     */
+    void reopen(const boost::filesystem::path& path, std::size_t count);
+
+    /**
+     * Writes all buffered changes and closes the file.
+     */
+    void close();
+
+    /**
+     * Returns whether or not this writer is open.
+     *
+     * @returns True if this writer is open
+     */
+    bool isOpen() const
+    {
+        return _open;
+    }
+
+    /**
+     * Returns the number of changes of the log file, including the
+     * buffered ones.
+     *
+     * @returns Number of changes
+     */
+    std::size_t getCount() const
+    {
+        return _count;
+    }
+
+    /**
+     * Appends a state change.
+     *
+     * @param ts    Change timestamp
+     * @param id    Node ID
+     * @param value New node value
+     */
+    void write(timestamp_t ts, state_node_id_t id, const StateValue& value)
+    {
+        _changes.push_back({
+            static_cast<std::uint64_t>(ts),
+            static_cast<std::uint32_t>(id),
+            static_cast<std::uint32_t>(value.getType()),
+            value.getRaw()
+        });
+        _count++;
+
+        if (_changes.size() == StateChangeWriter::BUFFER_SIZE) {
+            this->flush();
+        }
+    }
+
+private:
+    // number of buffered records
+    static const std::size_t BUFFER_SIZE = 65536;
+
+private:
+    void flush();
+
+private:
+    boost::filesystem::ofstream _output;
+
+    // buffered changes
+    std::vector<StateChange> _changes;
+
+    // number of changes of the log file (including buffered ones)
+    std::size_t _count;
+
+    // open state
+    bool _open;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATECHANGEWRITER_HPP
@@ -0,0 +1,79 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATECHECKPOINT_HPP
+#define _TIBEE_COMMON_STATECHECKPOINT_HPP
+
+#include <cstdint>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * On-disk layout of state checkpoints.
+ *
+ * A state checkpoint is a snapshot of the whole current state at a
+ * given timestamp: the value and begin timestamp of each non-null state
+ * node. Checkpoints are written in two files:
+ *
+ *   - a data file: for each checkpoint, one Node record per non-null
+ *     state node, in node ID order;
+ *   - an index file: one IndexEntry record per checkpoint, in
+ *     ascending timestamp order.
+ *
+ * All fields are in native byte order.
+ *
+ * @author Philippe Proulx
+ */
+struct StateCheckpoint
+{
+    // state of a node within a checkpoint
+    struct Node
+    {
+        // begin timestamp of the node's current interval
+        std::uint64_t beginTs;
+
+        // node ID
+        std::uint32_t id;
+
+        // StateValueType of value
+        std::uint32_t type;
+
+        // raw value (see StateValue::getRaw())
+        std::uint64_t value;
+    };
+
+    // index entry of a checkpoint
+    struct IndexEntry
+    {
+        // checkpoint timestamp
+        std::uint64_t ts;
+
+        // offset of the checkpoint's first Node record within data file (records)
+        std::uint64_t offset;
+
+        // number of Node records of this checkpoint
+        std::uint64_t count;
+    };
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATECHECKPOINT_HPP
@@ -0,0 +1,160 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include <common/state/StateCheckpointReader.hpp>
+#include <common/state/StateValueType.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+StateCheckpointReader::StateCheckpointReader(const bfs::path& dataPath,
+                                             const bfs::path& indexPath) :
+    _dataFile {new MappedFile {dataPath}},
+    _indexFile {new MappedFile {indexPath}},
+    _nodes {reinterpret_cast<const StateCheckpoint::Node*>(_dataFile->getData())},
+    _entries {reinterpret_cast<const StateCheckpoint::IndexEntry*>(_indexFile->getData())},
+    _count {0}
+{
+    if (!_entries) {
+        return;
+    }
+
+    /* Only keep the valid checkpoints: a partial last checkpoint (build
+     * killed while writing it) or anything corrupted ends the list.
+     */
+    auto entriesCount = _indexFile->getSize() / sizeof(StateCheckpoint::IndexEntry);
+    auto nodesCount = _dataFile->getSize() / sizeof(StateCheckpoint::Node);
+    auto typesCount = static_cast<std::uint32_t>(StateValueType::NUL);
+
+    for (std::size_t x = 0; x < entriesCount; ++x) {
+        const auto& entry = _entries[x];
+
+        if (x > 0 && entry.ts < _entries[x - 1].ts) {
+            break;
+        }
+
+        if (entry.offset > nodesCount || entry.count > nodesCount - entry.offset) {
+            break;
+        }
+
+        // known types, strictly ascending node IDs
+        bool nodesOk = true;
+
+        for (std::uint64_t n = 0; n < entry.count; ++n) {
+            const auto& node = _nodes[entry.offset + n];
+
+            if (node.type >= typesCount ||
+                    (n > 0 && node.id <= _nodes[entry.offset + n - 1].id)) {
+                nodesOk = false;
+                break;
+            }
+        }
+
+        if (!nodesOk) {
+            break;
+        }
+
+        _count++;
+    }
+}
+
+bool StateCheckpointReader::findNearest(timestamp_t ts, std::size_t& index) const
+{
+    // first checkpoint after ts
+    auto it = std::upper_bound(_entries, _entries + _count, ts,
+                               [] (timestamp_t ts, const StateCheckpoint::IndexEntry& entry) {
+        return static_cast<std::uint64_t>(ts) < entry.ts;
+    });
+
+    if (it == _entries) {
+        return false;
+    }
+
+    index = static_cast<std::size_t>(it - _entries) - 1;
+
+    return true;
+}
+
+void StateCheckpointReader::getState(std::size_t index, State& state) const
+{
+    const auto& entry = _entries[index];
+    auto begin = _nodes + entry.offset;
+    auto end = begin + entry.count;
+
+    state.clear();
+
+    // nodes are in ascending node ID order
+    if (entry.count > 0) {
+        state.resize(static_cast<std::size_t>(end[-1].id) + 1, NodeState {0, StateValue {}});
+    }
+
+    for (auto node = begin; node != end; ++node) {
+        auto& nodeState = state[node->id];
+
+        nodeState.beginTs = static_cast<timestamp_t>(node->beginTs);
+        nodeState.value = StateValue::fromRaw(static_cast<StateValueType>(node->type),
+                                              node->value);
+    }
+}
+
+bool StateCheckpointReader::findNode(std::size_t index, state_node_id_t id,
+                                     NodeState& nodeState) const
+{
+    const auto& entry = _entries[index];
+    auto begin = _nodes + entry.offset;
+    auto end = begin + entry.count;
+
+    // nodes are in ascending node ID order
+    auto it = std::lower_bound(begin, end, id,
+                               [] (const StateCheckpoint::Node& node, state_node_id_t id) {
+        return node.id < static_cast<std::uint32_t>(id);
+    });
+
+    if (it == end || it->id != static_cast<std::uint32_t>(id)) {
+        return false;
+    }
+
+    nodeState.beginTs = static_cast<timestamp_t>(it->beginTs);
+    nodeState.value = StateValue::fromRaw(static_cast<StateValueType>(it->type),
+                                          it->value);
+
+    return true;
+}
+
+bool StateCheckpointReader::getStateAt(timestamp_t ts, State& state,
+                                       timestamp_t& checkpointTs) const
+{
+    std::size_t index;
+
+    if (!this->findNearest(ts, index)) {
+        return false;
+    }
+
+    this->getState(index, state);
+    checkpointTs = this->getTimestamp(index);
+
+    return true;
+}
+
+}
+}
@@ -0,0 +1,165 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATECHECKPOINTREADER_HPP
+#define _TIBEE_COMMON_STATECHECKPOINTREADER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/state/StateCheckpoint.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/utils/MappedFile.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * State checkpoints reader.
+ *
+ * Maps checkpoint files written by StateCheckpointWriter and rebuilds
+ * the full state at any checkpoint. To get the full state at an
+ * arbitrary timestamp \a t, start from the state of the nearest
+ * checkpoint at or before \a t (see getStateAt()), then only apply the
+ * intervals beginning after this checkpoint and at or before \a t,
+ * instead of scanning the intervals of every node.
+ *
+ * Missing or corrupted checkpoint files are considered empty: readers
+ * then need to fall back to scanning intervals.
+ *
+ * @author Philippe Proulx
+ */
+class StateCheckpointReader :
+    boost::noncopyable
+{
+public:
+    // state of a node (null value if the node does not exist or is null)
+    struct NodeState
+    {
+        timestamp_t beginTs;
+        StateValue value;
+    };
+
+    // full state, indexed by node ID
+    typedef std::vector<NodeState> State;
+
+public:
+    /**
+     * Maps checkpoint files \p dataPath and \p indexPath.
+     *
+     * @param dataPath  Path to checkpoint data file
+     * @param indexPath Path to checkpoint index file
+     */
+    StateCheckpointReader(const boost::filesystem::path& dataPath,
+                          const boost::filesystem::path& indexPath);
+
+    /**
+     * Returns the number of available checkpoints.
+     *
+     * @returns Number of checkpoints
+     */
+    std::size_t getCount() const
+    {
+        return _count;
+    }
+
+    /**
+     * Returns the timestamp of checkpoint \p index.
+     *
+     * @param index Checkpoint index (less than getCount())
+     * @returns     Checkpoint timestamp
+     */
+    timestamp_t getTimestamp(std::size_t index) const
+    {
+        return static_cast<timestamp_t>(_entries[index].ts);
+    }
+
+    /**
+     * Returns the offset, within the data file, of the Node record
+     * following the last one of checkpoint \p index (records).
+     *
+     * @param index Checkpoint index (less than getCount())
+     * @returns     End offset of checkpoint's Node records
+     */
+    std::uint64_t getNodesEnd(std::size_t index) const
+    {
+        return _entries[index].offset + _entries[index].count;
+    }
+
+    /**
+     * Finds the last checkpoint at or before timestamp \p ts.
+     *
+     * @param ts    Timestamp
+     * @param index Index of found checkpoint (set if found)
+     * @returns     True if such a checkpoint exists
+     */
+    bool findNearest(timestamp_t ts, std::size_t& index) const;
+
+    /**
+     * Rebuilds the full state of checkpoint \p index into \p state.
+     *
+     * \p state is resized to hold all the node IDs of the checkpoint;
+     * nodes which are null at this checkpoint get a null value.
+     *
+     * @param index Checkpoint index (less than getCount())
+     * @param state Full state (indexed by node ID)
+     */
+    void getState(std::size_t index, State& state) const;
+
+    /**
+     * Finds the state of node \p id at checkpoint \p index.
+     *
+     * @param index     Checkpoint index (less than getCount())
+     * @param id        Node ID
+     * @param nodeState Node state (set if found)
+     * @returns         True if node \p id is not null at this checkpoint
+     */
+    bool findNode(std::size_t index, state_node_id_t id,
+                  NodeState& nodeState) const;
+
+    /**
+     * Rebuilds the full state of the last checkpoint at or before
+     * timestamp \p ts into \p state.
+     *
+     * @param ts           Timestamp
+     * @param state        Full state (indexed by node ID)
+     * @param checkpointTs Timestamp of the used checkpoint (set if found)
+     * @returns            True if such a checkpoint exists
+     */
+    bool getStateAt(timestamp_t ts, State& state,
+                    timestamp_t& checkpointTs) const;
+
+private:
+    std::unique_ptr<MappedFile> _dataFile;
+    std::unique_ptr<MappedFile> _indexFile;
+    const StateCheckpoint::Node* _nodes;
+    const StateCheckpoint::IndexEntry* _entries;
+
+    // number of valid checkpoints
+    std::size_t _count;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATECHECKPOINTREADER_HPP
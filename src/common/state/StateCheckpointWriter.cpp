@@ -0,0 +1,122 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+
+#include <common/state/StateCheckpointWriter.hpp>
+#include <common/state/StateCheckpointReader.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+StateCheckpointWriter::StateCheckpointWriter() :
+    _offset {0},
+    _count {0},
+    _open {false}
+{
+}
+
+void StateCheckpointWriter::open(const bfs::path& dataPath,
+                                 const bfs::path& indexPath)
+{
+    this->close();
+
+    _data.open(dataPath, std::ios::binary | std::ios::trunc);
+    _index.open(indexPath, std::ios::binary | std::ios::trunc);
+    _nodes.clear();
+    _offset = 0;
+    _count = 0;
+    _open = true;
+}
+
+void StateCheckpointWriter::reopen(const bfs::path& dataPath,
+                                   const bfs::path& indexPath,
+                                   timestamp_t lastTs)
+{
+    this->close();
+
+    // find the valid checkpoints to keep
+    std::size_t count = 0;
+    std::uint64_t offset = 0;
+
+    {
+        StateCheckpointReader reader {dataPath, indexPath};
+        std::size_t index;
+
+        if (reader.findNearest(lastTs, index)) {
+            count = index + 1;
+            offset = reader.getNodesEnd(index);
+        }
+    }
+
+    /* Create missing files, then remove the other checkpoints (the
+     * reader must be gone first). Appending always writes at the end
+     * of the file, wherever it is.
+     */
+    _data.open(dataPath, std::ios::binary | std::ios::app);
+    _index.open(indexPath, std::ios::binary | std::ios::app);
+    bfs::resize_file(dataPath, offset * sizeof(StateCheckpoint::Node));
+    bfs::resize_file(indexPath, count * sizeof(StateCheckpoint::IndexEntry));
+
+    _nodes.clear();
+    _offset = offset;
+    _count = count;
+    _open = true;
+}
+
+void StateCheckpointWriter::close()
+{
+    // silently ignore if already closed
+    if (!_open) {
+        return;
+    }
+
+    _data.close();
+    _index.close();
+    _nodes.clear();
+    _open = false;
+}
+
+void StateCheckpointWriter::commit(timestamp_t ts)
+{
+    StateCheckpoint::IndexEntry entry {
+        static_cast<std::uint64_t>(ts),
+        _offset,
+        static_cast<std::uint64_t>(_nodes.size())
+    };
+
+    // nodes first, so that an index entry never refers to missing nodes
+    if (!_nodes.empty()) {
+        _data.write(reinterpret_cast<const char*>(_nodes.data()),
+                    _nodes.size() * sizeof(StateCheckpoint::Node));
+    }
+
+    _data.flush();
+    _index.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+    _index.flush();
+
+    _offset += _nodes.size();
+    _count++;
+    _nodes.clear();
+}
+
+}
+}
@@ -0,0 +1,153 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATECHECKPOINTWRITER_HPP
+#define _TIBEE_COMMON_STATECHECKPOINTWRITER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/state/StateCheckpoint.hpp>
+#include <common/state/StateValue.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * State checkpoints writer.
+ *
+ * Appends full state snapshots to checkpoint files (see
+ * StateCheckpoint). The nodes of a checkpoint are added one by one
+ * with addNode(), then the checkpoint is written with commit().
+ *
+ * @author Philippe Proulx
+ */
+class StateCheckpointWriter :
+    boost::noncopyable
+{
+public:
+    /**
+     * Builds a closed state checkpoints writer.
+     */
+    StateCheckpointWriter();
+
+    /**
+     * Creates checkpoint files \p dataPath and \p indexPath,
+     * overwriting them if they exist.
+     *
+     * @param dataPath  Path to checkpoint data file
+     * @param indexPath Path to checkpoint index file
+     */
+    void open(const boost::filesystem::path& dataPath,
+              const boost::filesystem::path& indexPath);
+
+    /**
+     * Opens existing checkpoint files \p dataPath and \p indexPath
+     * to append checkpoints to them, first removing all the checkpoints
+     * after timestamp \p lastTs (and any partial checkpoint).
+     *
+     * Missing files are created.
+     *
+     * @param dataPath  Path to checkpoint data file
+     * @param indexPath Path to checkpoint index file
+     * @param lastTs    Timestamp of the last checkpoint to keep
+     */
+    void reopen(const boost::filesystem::path& dataPath,
+                const boost::filesystem::path& indexPath,
+                timestamp_t lastTs);
+
+    /**
+     * Closes the checkpoint files.
+     */
+    void close();
+
+    /**
+     * Returns whether or not this writer is open.
+     *
+     * @returns True if this writer is open
+     */
+    bool isOpen() const
+    {
+        return _open;
+    }
+
+    /**
+     * Adds the state of a node to the next checkpoint.
+     *
+     * Nodes must be added in ascending node ID order.
+     *
+     * @param beginTs Begin timestamp of the node's current interval
+     * @param id      Node ID
+     * @param value   Current node value (not null)
+     */
+    void addNode(timestamp_t beginTs, state_node_id_t id,
+                 const StateValue& value)
+    {
+        _nodes.push_back({
+            static_cast<std::uint64_t>(beginTs),
+            static_cast<std::uint32_t>(id),
+            static_cast<std::uint32_t>(value.getType()),
+            value.getRaw()
+        });
+    }
+
+    /**
+     * Writes all the nodes added since the last checkpoint as a
+     * checkpoint at timestamp \p ts.
+     *
+     * @param ts Checkpoint timestamp
+     */
+    void commit(timestamp_t ts);
+
+    /**
+     * Returns the number of checkpoints written so far.
+     *
+     * @returns Number of checkpoints
+     */
+    std::size_t getCount() const
+    {
+        return _count;
+    }
+
+private:
+    boost::filesystem::ofstream _data;
+    boost::filesystem::ofstream _index;
+
+    // nodes of the next checkpoint
+    std::vector<StateCheckpoint::Node> _nodes;
+
+    // number of Node records written so far
+    std::uint64_t _offset;
+
+    // number of checkpoints written so far
+    std::size_t _count;
+
+    // open state
+    bool _open;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATECHECKPOINTWRITER_HPP
@@ -0,0 +1,663 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <boost/filesystem.hpp>
+#include <yajl_parse.h>
+
+#include <common/state/StateHistory.hpp>
+#include <common/ex/StateHistory.hpp>
+#include <common/ex/WrongQuark.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+/**
+ * Parser of the map of state node IDs to paths written by
+ * StateHistorySink (YAJL callbacks context).
+ *
+ * Each node is a map with an "id" field and optional "children" and
+ * "int-children" fields, maps of string and integer subpaths to node.
+ */
+class NodesMapParser
+{
+public:
+    // node as found in the map, before knowing all node IDs
+    struct RawNode
+    {
+        std::int64_t id;
+        std::size_t parent;
+        std::string key;
+        bool isIntKey;
+    };
+
+public:
+    static const std::size_t NO_PARENT = std::numeric_limits<std::size_t>::max();
+
+public:
+    bool parse(const char* json, std::size_t len)
+    {
+        static const ::yajl_callbacks callbacks = {
+            nullptr,
+            nullptr,
+            processIntegerCb,
+            nullptr,
+            nullptr,
+            nullptr,
+            processStartMapCb,
+            processMapKeyCb,
+            processEndMapCb,
+            nullptr,
+            nullptr,
+        };
+
+        auto yajlHandle = ::yajl_alloc(std::addressof(callbacks), nullptr,
+                                       static_cast<void*>(this));
+
+        if (!yajlHandle) {
+            return false;
+        }
+
+        auto ret = ::yajl_parse(yajlHandle,
+                                reinterpret_cast<const unsigned char*>(json),
+                                len);
+
+        if (ret == ::yajl_status_ok) {
+            ret = ::yajl_complete_parse(yajlHandle);
+        }
+
+        ::yajl_free(yajlHandle);
+
+        return ret == ::yajl_status_ok;
+    }
+
+    const std::vector<RawNode>& getNodes() const
+    {
+        return _nodes;
+    }
+
+private:
+    // a node map or a children map (string or integer keys)
+    struct Frame
+    {
+        bool isChildren;
+        bool isIntChildren;
+        std::size_t node;
+    };
+
+private:
+    static int processIntegerCb(void* ctx, long long value)
+    {
+        auto parser = static_cast<NodesMapParser*>(ctx);
+
+        if (parser->_stack.empty() || parser->_stack.back().isChildren ||
+                parser->_key != "id") {
+            return 0;
+        }
+
+        parser->_nodes[parser->_stack.back().node].id = value;
+
+        return 1;
+    }
+
+    static int processStartMapCb(void* ctx)
+    {
+        auto parser = static_cast<NodesMapParser*>(ctx);
+        auto& stack = parser->_stack;
+
+        if (!stack.empty() && !stack.back().isChildren) {
+            // children of the current node
+            bool isIntChildren = parser->_key == "int-children";
+
+            if (parser->_key != "children" && !isIntChildren) {
+                return 0;
+            }
+
+            stack.push_back({true, isIntChildren, stack.back().node});
+
+            return 1;
+        }
+
+        // root node or child node
+        auto parent = stack.empty() ? NO_PARENT : stack.back().node;
+
+        if (stack.empty() && !parser->_nodes.empty()) {
+            return 0;
+        }
+
+        bool isIntKey = !stack.empty() && stack.back().isIntChildren;
+
+        parser->_nodes.push_back({-1, parent, parser->_key, isIntKey});
+        stack.push_back({false, false, parser->_nodes.size() - 1});
+
+        return 1;
+    }
+
+    static int processMapKeyCb(void* ctx, const unsigned char* key,
+                               std::size_t len)
+    {
+        auto parser = static_cast<NodesMapParser*>(ctx);
+
+        parser->_key.assign(reinterpret_cast<const char*>(key), len);
+
+        return 1;
+    }
+
+    static int processEndMapCb(void* ctx)
+    {
+        auto parser = static_cast<NodesMapParser*>(ctx);
+
+        parser->_stack.pop_back();
+
+        return 1;
+    }
+
+private:
+    std::vector<RawNode> _nodes;
+    std::vector<Frame> _stack;
+
+    // last map key
+    std::string _key;
+};
+
+const std::size_t NodesMapParser::NO_PARENT;
+
+/**
+ * Parses the integer key \p str (decimal digits only) to \p key.
+ */
+bool parseIntKey(const std::string& str, std::int64_t& key)
+{
+    if (str.empty() || str.size() > 18 ||
+            str.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+
+    key = std::stoll(str);
+
+    return true;
+}
+
+}
+
+StateHistory::StateHistory(const bfs::path& dbDir) :
+    _changes {nullptr},
+    _changesEnd {nullptr}
+{
+    this->loadStringDb(dbDir / "state-strings.db");
+    this->loadNodesMap(dbDir / "state-nodes.json");
+
+    // state change log
+    auto changesPath = dbDir / "state-changes.dat";
+
+    if (!bfs::exists(changesPath)) {
+        throw ex::StateHistory {
+            "cannot find state change log \"" + changesPath.string() + "\"" +
+            " (build the database with tibeebuild -q)"
+        };
+    }
+
+    _changesFile = std::unique_ptr<MappedFile> {new MappedFile {changesPath}};
+    _changes = reinterpret_cast<const StateChange*>(_changesFile->getData());
+
+    // ignore any partial last record
+    if (_changes) {
+        _changesEnd = _changes + _changesFile->getSize() / sizeof(StateChange);
+    }
+
+    // missing checkpoints only make queries slower
+    _checkpoints = std::unique_ptr<StateCheckpointReader> {
+        new StateCheckpointReader {
+            dbDir / "state-checkpoints.dat",
+            dbDir / "state-checkpoints.idx"
+        }
+    };
+}
+
+void StateHistory::loadStringDb(const bfs::path& path)
+{
+    if (!bfs::exists(path)) {
+        throw ex::StateHistory {
+            "cannot find string database \"" + path.string() + "\""
+        };
+    }
+
+    MappedFile file {path};
+    auto data = file.getData();
+    std::size_t offset = 0;
+
+    // string, NUL, padding to 4 bytes, quark: see StateHistorySink
+    while (offset < file.getSize()) {
+        auto string = data + offset;
+        auto end = static_cast<const char*>(std::memchr(string, '\0',
+                                                        file.getSize() - offset));
+
+        if (!end) {
+            throw ex::StateHistory {"corrupted string database"};
+        }
+
+        offset += end - string + 1;
+        offset = (offset + sizeof(quark_t) - 1) & ~(sizeof(quark_t) - 1);
+
+        if (file.getSize() - offset < sizeof(quark_t)) {
+            throw ex::StateHistory {"corrupted string database"};
+        }
+
+        quark_t quark;
+
+        std::memcpy(&quark, data + offset, sizeof(quark));
+        offset += sizeof(quark);
+
+        if (quark >= _strings.size()) {
+            _strings.resize(static_cast<std::size_t>(quark) + 1);
+        }
+
+        _strings[quark].assign(string, end);
+    }
+}
+
+void StateHistory::loadNodesMap(const bfs::path& path)
+{
+    if (!bfs::exists(path)) {
+        throw ex::StateHistory {
+            "cannot find state nodes map \"" + path.string() + "\""
+        };
+    }
+
+    MappedFile file {path};
+    NodesMapParser parser;
+
+    if (!file.getData() || !parser.parse(file.getData(), file.getSize())) {
+        throw ex::StateHistory {"corrupted state nodes map"};
+    }
+
+    const auto& rawNodes = parser.getNodes();
+
+    // place nodes by ID
+    _nodes.resize(rawNodes.size());
+
+    for (const auto& rawNode : rawNodes) {
+        if (rawNode.id < 0 || static_cast<std::size_t>(rawNode.id) >= _nodes.size()) {
+            throw ex::StateHistory {"corrupted state nodes map"};
+        }
+    }
+
+    for (const auto& rawNode : rawNodes) {
+        auto id = static_cast<state_node_id_t>(rawNode.id);
+        auto& node = _nodes[id];
+
+        node.key = rawNode.key;
+        node.parentId = id;
+
+        if (rawNode.parent == NodesMapParser::NO_PARENT) {
+            continue;
+        }
+
+        auto parentId = static_cast<state_node_id_t>(rawNodes[rawNode.parent].id);
+
+        node.parentId = parentId;
+
+        if (rawNode.isIntKey) {
+            std::int64_t intKey;
+
+            if (!parseIntKey(rawNode.key, intKey)) {
+                throw ex::StateHistory {"corrupted state nodes map"};
+            }
+
+            _nodes[parentId].intChildren[intKey] = id;
+        } else {
+            _nodes[parentId].children[rawNode.key] = id;
+        }
+    }
+}
+
+timestamp_t StateHistory::getEnd() const
+{
+    if (_changes == _changesEnd) {
+        return 0;
+    }
+
+    return static_cast<timestamp_t>(_changesEnd[-1].ts);
+}
+
+bool StateHistory::getNodeId(const std::string& path, state_node_id_t& id) const
+{
+    state_node_id_t curId = 0;
+    std::string::size_type begin = 0;
+
+    if (_nodes.empty()) {
+        return false;
+    }
+
+    while (begin < path.size()) {
+        auto end = path.find('/', begin);
+
+        if (end == std::string::npos) {
+            end = path.size();
+        }
+
+        // ignore empty subpaths (leading, trailing and double slashes)
+        if (end > begin) {
+            auto key = path.substr(begin, end - begin);
+            std::int64_t intKey;
+
+            // an integer key has priority over the same string key
+            if (!(parseIntKey(key, intKey) &&
+                    this->getChildId(curId, intKey, curId)) &&
+                    !this->getChildId(curId, key, curId)) {
+                return false;
+            }
+        }
+
+        begin = end + 1;
+    }
+
+    id = curId;
+
+    return true;
+}
+
+bool StateHistory::getChildId(state_node_id_t parentId,
+                              const std::string& key,
+                              state_node_id_t& id) const
+{
+    this->checkNodeId(parentId);
+
+    const auto& children = _nodes[parentId].children;
+    auto it = children.find(key);
+
+    if (it == children.end()) {
+        return false;
+    }
+
+    id = it->second;
+
+    return true;
+}
+
+bool StateHistory::getChildId(state_node_id_t parentId, std::int64_t key,
+                              state_node_id_t& id) const
+{
+    this->checkNodeId(parentId);
+
+    const auto& children = _nodes[parentId].intChildren;
+    auto it = children.find(key);
+
+    if (it == children.end()) {
+        return false;
+    }
+
+    id = it->second;
+
+    return true;
+}
+
+std::string StateHistory::getNodePath(state_node_id_t id) const
+{
+    this->checkNodeId(id);
+
+    std::string path;
+
+    while (id != 0 && _nodes[id].parentId != id) {
+        path = "/" + _nodes[id].key + path;
+        id = _nodes[id].parentId;
+    }
+
+    return path.empty() ? "/" : path;
+}
+
+const std::string& StateHistory::getString(Quark quark) const
+{
+    if (quark.get() >= _strings.size()) {
+        throw ex::WrongQuark {quark.get()};
+    }
+
+    return _strings[quark.get()];
+}
+
+void StateHistory::checkNodeId(state_node_id_t id) const
+{
+    if (id >= _nodes.size()) {
+        throw ex::StateHistory {"no state node with ID " + std::to_string(id)};
+    }
+}
+
+const StateChange* StateHistory::findChange(timestamp_t ts) const
+{
+    return std::lower_bound(_changes, _changesEnd, ts,
+                            [] (const StateChange& change, timestamp_t ts) {
+        return change.ts < static_cast<std::uint64_t>(ts);
+    });
+}
+
+const StateChange* StateHistory::getCheckpointValue(state_node_id_t id,
+                                                    timestamp_t ts,
+                                                    StateValue& value,
+                                                    timestamp_t& beginTs) const
+{
+    std::size_t index;
+
+    // null value since the beginning, unless found below
+    value = StateValue {};
+    beginTs = 0;
+
+    if (!_checkpoints->findNearest(ts, index)) {
+        return _changes;
+    }
+
+    StateCheckpointReader::NodeState nodeState;
+
+    if (_checkpoints->findNode(index, id, nodeState)) {
+        value = nodeState.value;
+        beginTs = nodeState.beginTs;
+    }
+
+    /* Changes at the checkpoint timestamp may come after the
+     * checkpoint: applying them again is harmless.
+     */
+    return this->findChange(_checkpoints->getTimestamp(index));
+}
+
+StateValue StateHistory::getValue(state_node_id_t id, timestamp_t ts,
+                                  timestamp_t& beginTs) const
+{
+    this->checkNodeId(id);
+
+    StateValue value;
+    auto it = this->getCheckpointValue(id, ts, value, beginTs);
+
+    for (; it != _changesEnd && it->ts <= ts; ++it) {
+        if (it->id == id) {
+            value = StateValue::fromRaw(static_cast<StateValueType>(it->type),
+                                        it->value);
+            beginTs = static_cast<timestamp_t>(it->ts);
+        }
+    }
+
+    return value;
+}
+
+void StateHistory::getSubtree(state_node_id_t id, timestamp_t ts,
+                              std::vector<NodeValue>& values) const
+{
+    this->checkNodeId(id);
+
+    // node IDs of the subtree
+    std::vector<bool> inSubtree;
+    std::vector<state_node_id_t> toVisit {id};
+
+    inSubtree.resize(_nodes.size(), false);
+
+    while (!toVisit.empty()) {
+        auto curId = toVisit.back();
+
+        toVisit.pop_back();
+        inSubtree[curId] = true;
+
+        for (const auto& child : _nodes[curId].children) {
+            toVisit.push_back(child.second);
+        }
+
+        for (const auto& child : _nodes[curId].intChildren) {
+            toVisit.push_back(child.second);
+        }
+    }
+
+    // start from the nearest checkpoint
+    StateCheckpointReader::State state;
+    std::size_t index;
+    auto it = _changes;
+
+    if (_checkpoints->findNearest(ts, index)) {
+        _checkpoints->getState(index, state);
+        it = this->findChange(_checkpoints->getTimestamp(index));
+    }
+
+    state.resize(_nodes.size(), StateCheckpointReader::NodeState {0, StateValue {}});
+
+    for (; it != _changesEnd && it->ts <= ts; ++it) {
+        if (it->id < inSubtree.size() && inSubtree[it->id]) {
+            auto& nodeState = state[it->id];
+
+            nodeState.beginTs = static_cast<timestamp_t>(it->ts);
+            nodeState.value = StateValue::fromRaw(static_cast<StateValueType>(it->type),
+                                                  it->value);
+        }
+    }
+
+    for (state_node_id_t nodeId = 0; nodeId < _nodes.size(); ++nodeId) {
+        if (inSubtree[nodeId] && state[nodeId].value) {
+            values.push_back({nodeId, state[nodeId].beginTs, state[nodeId].value});
+        }
+    }
+}
+
+const StateChange* StateHistory::findNextChange(state_node_id_t id,
+                                                const StateChange* it,
+                                                timestamp_t maxTs) const
+{
+    while (it != _changesEnd && it->ts <= maxTs) {
+        std::size_t index;
+        auto hasCheckpoint = _checkpoints->findNearest(it->ts, index);
+
+        // changes at the checkpoint timestamp may precede or follow it
+        if (hasCheckpoint && it->ts == _checkpoints->getTimestamp(index)) {
+            for (auto ts = it->ts; it != _changesEnd && it->ts == ts; ++it) {
+                if (it->id == id) {
+                    return it;
+                }
+            }
+
+            continue;
+        }
+
+        // changes up to the next checkpoint
+        auto next = hasCheckpoint ? index + 1 : 0;
+        auto chunkEnd = _changesEnd;
+
+        if (next < _checkpoints->getCount()) {
+            chunkEnd = this->findChange(_checkpoints->getTimestamp(next));
+
+            /* Same non-null state at both checkpoints: the node did not
+             * change in between (a change would update its begin
+             * timestamp).
+             */
+            StateCheckpointReader::NodeState prevState;
+            StateCheckpointReader::NodeState nextState;
+
+            if (hasCheckpoint &&
+                    _checkpoints->findNode(index, id, prevState) &&
+                    _checkpoints->findNode(next, id, nextState) &&
+                    prevState.beginTs == nextState.beginTs &&
+                    prevState.value == nextState.value) {
+                it = chunkEnd;
+                continue;
+            }
+        }
+
+        for (; it != chunkEnd && it->ts <= maxTs; ++it) {
+            if (it->id == id) {
+                return it;
+            }
+        }
+    }
+
+    return _changesEnd;
+}
+
+void StateHistory::getIntervals(state_node_id_t id, timestamp_t beginTs,
+                                timestamp_t endTs,
+                                std::vector<Interval>& intervals) const
+{
+    this->checkNodeId(id);
+
+    // value at the range begin
+    StateValue value;
+    timestamp_t valueBeginTs = 0;
+    auto it = this->getCheckpointValue(id, beginTs, value, valueBeginTs);
+
+    for (; it != _changesEnd && it->ts <= beginTs; ++it) {
+        if (it->id == id) {
+            value = StateValue::fromRaw(static_cast<StateValueType>(it->type),
+                                        it->value);
+            valueBeginTs = static_cast<timestamp_t>(it->ts);
+        }
+    }
+
+    while (true) {
+        /* The end of a null value is only needed while it's within
+         * the range.
+         */
+        auto maxTs = value ? std::numeric_limits<timestamp_t>::max() : endTs;
+        auto change = this->findNextChange(id, it, maxTs);
+
+        if (change == _changesEnd) {
+            if (value && this->getEnd() > valueBeginTs) {
+                intervals.push_back({valueBeginTs, this->getEnd(), id, value});
+            }
+
+            break;
+        }
+
+        auto changeTs = static_cast<timestamp_t>(change->ts);
+
+        // forget zero-length intervals
+        if (value && changeTs > valueBeginTs) {
+            intervals.push_back({valueBeginTs, changeTs, id, value});
+        }
+
+        if (changeTs > endTs) {
+            break;
+        }
+
+        value = StateValue::fromRaw(static_cast<StateValueType>(change->type),
+                                    change->value);
+        valueBeginTs = changeTs;
+        it = change + 1;
+    }
+}
+
+}
+}
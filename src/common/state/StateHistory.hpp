@@ -0,0 +1,258 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATEHISTORY_HPP
+#define _TIBEE_COMMON_STATEHISTORY_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/state/Quark.hpp>
+#include <common/state/StateChange.hpp>
+#include <common/state/StateCheckpointReader.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/utils/MappedFile.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * State history reader.
+ *
+ * Opens the state history of a database directory written by
+ * tibeebuild (string database, map of state node IDs to paths, state
+ * change log and checkpoints) and answers queries about it: the value
+ * of a node or of a whole subtree at a given time, and the intervals
+ * of a node within a time range.
+ *
+ * Point-in-time queries start from the nearest checkpoint, so they
+ * only scan the state changes following it.
+ *
+ * Throws ex::StateHistory on error.
+ *
+ * @author Philippe Proulx
+ */
+class StateHistory :
+    boost::noncopyable
+{
+public:
+    // value of a node at some time
+    struct NodeValue
+    {
+        state_node_id_t id;
+        timestamp_t beginTs;
+        StateValue value;
+    };
+
+    // state interval of a node
+    struct Interval
+    {
+        timestamp_t beginTs;
+        timestamp_t endTs;
+        state_node_id_t id;
+        StateValue value;
+    };
+
+public:
+    /**
+     * Opens the state history of database directory \p dbDir.
+     *
+     * @param dbDir Database directory
+     */
+    explicit StateHistory(const boost::filesystem::path& dbDir);
+
+    /**
+     * Returns the number of state nodes, including the root node.
+     *
+     * @returns Number of state nodes
+     */
+    std::size_t getNodesCount() const
+    {
+        return _nodes.size();
+    }
+
+    /**
+     * Returns the timestamp of the last state change.
+     *
+     * @returns Timestamp of last state change (0 if none)
+     */
+    timestamp_t getEnd() const;
+
+    /**
+     * Resolves the ID of the node at path \p path, a list of subpaths
+     * separated by <code>/</code> (empty path for root node).
+     *
+     * A subpath made of decimal digits designates the child with this
+     * integer key if it exists, and the child with this string key
+     * otherwise (see getChildId() to choose).
+     *
+     * @param path Node path
+     * @param id   Node ID (set if found)
+     * @returns    True if node exists
+     */
+    bool getNodeId(const std::string& path, state_node_id_t& id) const;
+
+    /**
+     * Resolves the ID of the child of node \p parentId with string
+     * key \p key.
+     *
+     * @param parentId Parent node ID
+     * @param key      String key of child
+     * @param id       Child node ID (set if found)
+     * @returns        True if child node exists
+     */
+    bool getChildId(state_node_id_t parentId, const std::string& key,
+                    state_node_id_t& id) const;
+
+    /**
+     * Resolves the ID of the child of node \p parentId with integer
+     * key \p key (see StateNode::operator[](std::int64_t)).
+     *
+     * @param parentId Parent node ID
+     * @param key      Integer key of child
+     * @param id       Child node ID (set if found)
+     * @returns        True if child node exists
+     */
+    bool getChildId(state_node_id_t parentId, std::int64_t key,
+                    state_node_id_t& id) const;
+
+    /**
+     * Returns the path of node \p id (see getNodeId()).
+     *
+     * @param id Node ID
+     * @returns  Node path
+     */
+    std::string getNodePath(state_node_id_t id) const;
+
+    /**
+     * Returns the string associated with quark \p quark or
+     * throws ex::WrongQuark if no such string exists.
+     *
+     * @param quark Quark
+     * @returns     String associated with quark \p quark
+     */
+    const std::string& getString(Quark quark) const;
+
+    /**
+     * Returns the value of node \p id at timestamp \p ts, that is,
+     * the value of its last change at or before \p ts.
+     *
+     * @param id      Node ID
+     * @param ts      Timestamp
+     * @param beginTs Begin timestamp of value (0 if null since the beginning)
+     * @returns       Node value (null if none)
+     */
+    StateValue getValue(state_node_id_t id, timestamp_t ts,
+                        timestamp_t& beginTs) const;
+
+    /**
+     * Appends the values of all the non-null nodes of the subtree of
+     * node \p id (node \p id included), at timestamp \p ts, to
+     * \p values, in node ID order.
+     *
+     * @param id     Subtree root node ID
+     * @param ts     Timestamp
+     * @param values Node values
+     */
+    void getSubtree(state_node_id_t id, timestamp_t ts,
+                    std::vector<NodeValue>& values) const;
+
+    /**
+     * Appends all the non-null intervals of node \p id intersecting
+     * [\p beginTs, \p endTs] to \p intervals, in time order.
+     *
+     * An interval of which the value is still current at the end of
+     * the history ends at getEnd().
+     *
+     * @param id        Node ID
+     * @param beginTs   Range begin timestamp
+     * @param endTs     Range end timestamp
+     * @param intervals Intervals
+     */
+    void getIntervals(state_node_id_t id, timestamp_t beginTs,
+                      timestamp_t endTs,
+                      std::vector<Interval>& intervals) const;
+
+private:
+    // node of the state tree
+    struct Node
+    {
+        state_node_id_t parentId;
+        std::string key;
+        std::map<std::string, state_node_id_t> children;
+        std::map<std::int64_t, state_node_id_t> intChildren;
+    };
+
+private:
+    void loadStringDb(const boost::filesystem::path& path);
+    void loadNodesMap(const boost::filesystem::path& path);
+    void checkNodeId(state_node_id_t id) const;
+
+    /**
+     * Returns the first state change at or after timestamp \p ts.
+     */
+    const StateChange* findChange(timestamp_t ts) const;
+
+    /**
+     * Returns the first change of node \p id from \p it, with a
+     * timestamp not after \p maxTs, or the end of the log if none.
+     *
+     * Runs of changes between two checkpoints which see the same
+     * non-null state for this node are skipped.
+     */
+    const StateChange* findNextChange(state_node_id_t id,
+                                      const StateChange* it,
+                                      timestamp_t maxTs) const;
+
+    /**
+     * Sets \p value and \p beginTs to the state of node \p id at the
+     * nearest checkpoint at or before \p ts, and returns the first
+     * state change to apply to get its state at \p ts.
+     */
+    const StateChange* getCheckpointValue(state_node_id_t id, timestamp_t ts,
+                                          StateValue& value,
+                                          timestamp_t& beginTs) const;
+
+private:
+    // strings, indexed by quark
+    std::vector<std::string> _strings;
+
+    // state tree, indexed by node ID
+    std::vector<Node> _nodes;
+
+    // state change log
+    std::unique_ptr<MappedFile> _changesFile;
+    const StateChange* _changes;
+    const StateChange* _changesEnd;
+
+    // checkpoints
+    std::unique_ptr<StateCheckpointReader> _checkpoints;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATEHISTORY_HPP
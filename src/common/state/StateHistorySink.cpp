@@ -17,23 +17,17 @@
  */
 #include <cassert>
 #include <cstdint>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <vector>
 #include <boost/filesystem/path.hpp>
 #include <fstream>
 #include <yajl_gen.h>
-#include <delorean/BasicTypes.hpp>
-#include <delorean/interval/AbstractInterval.hpp>
-#include <delorean/interval/Int32Interval.hpp>
-#include <delorean/interval/Uint32Interval.hpp>
-#include <delorean/interval/Int64Interval.hpp>
-#include <delorean/interval/Uint64Interval.hpp>
-#include <delorean/interval/Float32Interval.hpp>
-#include <delorean/interval/QuarkInterval.hpp>
-#include <delorean/interval/NullInterval.hpp>
-#include <delorean/HistoryFileSink.hpp>
 
 #include <common/state/AbstractStateNodeVisitor.hpp>
 #include <common/state/StateValueType.hpp>
-#include <common/state/AbstractStateValue.hpp>
+#include <common/state/StateValue.hpp>
 #include <common/state/StateHistorySink.hpp>
 #include <common/state/CurrentState.hpp>
 #include <common/state/QuarkStateValue.hpp>
@@ -82,11 +76,17 @@ private:
  * representing the state tree it visits.
  *
  * Each node in the tree has the the "id" field, which is its numeric,
- * unique node ID, and an optional field "children", which is a
- * dictionary of subpath to node.
+ * unique node ID, an optional field "children", which is a dictionary
+ * of string subpath to node, and an optional field "int-children",
+ * which is a dictionary of integer subpath (see Quark::fromInt()),
+ * written as a decimal string, to node. Integer and string keys are
+ * distinct, so that both children 23 and "23" of a node are written.
  *
  * The root of this tree is always considered to have no name.
  *
+ * Since children of both kinds are visited in any order, the visited
+ * tree is first collected, and then written by write().
+ *
  * @author Philippe Proulx
  */
 class TreeToJsonStateNodeVisitor :
@@ -109,46 +109,106 @@ public:
     {
     }
 
+    /**
+     * Writes the visited tree with the YAJL generator.
+     */
+    void write()
+    {
+        if (!_nodes.empty()) {
+            this->writeNode(0);
+        }
+    }
+
+private:
+    // visited node
+    struct Node
+    {
+        quark_t quark;
+        state_node_id_t id;
+        std::vector<std::size_t> children;
+    };
+
 private:
     void visitReadEnterImpl(quark_t quark, const StateNode& node)
     {
-        if (quark != 0xffffffff) {
-            // not root: output child node subpath
-            const auto& subpath = _stateHistorySink->getString(Quark(quark));
+        auto index = _nodes.size();
 
-            ::yajl_gen_string(_yajlGen,
-                              reinterpret_cast<const unsigned char*>(subpath.c_str()),
-                              subpath.length());
+        if (!_stack.empty()) {
+            _nodes[_stack.back()].children.push_back(index);
         }
 
-        // open map for this node
-        ::yajl_gen_map_open(_yajlGen);
+        _nodes.push_back({quark, node.getId(), {}});
+        _stack.push_back(index);
+    }
 
-        // write node ID
-        static const std::string KEY_ID {"id"};
+    void visitReadLeaveImpl(quark_t quark, const StateNode& node)
+    {
+        _stack.pop_back();
+    }
 
+    void writeString(const char* str, std::size_t len)
+    {
         ::yajl_gen_string(_yajlGen,
-                          reinterpret_cast<const unsigned char*>(KEY_ID.c_str()),
-                          KEY_ID.length());
-        ::yajl_gen_integer(_yajlGen, node.getId());
-
-        // open node children map (if it has any)
-        if (node.getAllChildrenCount() > 0) {
-            static const std::string KEY_CHILDREN {"children"};
-
-            ::yajl_gen_string(_yajlGen,
-                              reinterpret_cast<const unsigned char*>(KEY_CHILDREN.c_str()),
-                              KEY_CHILDREN.length());
-            ::yajl_gen_map_open(_yajlGen);
-        }
+                          reinterpret_cast<const unsigned char*>(str),
+                          len);
     }
 
-    void visitReadLeaveImpl(quark_t quark, const StateNode& node)
+    void writeChildren(const Node& node, bool intKeys)
     {
-        // close children map (if it has any)
-        if (node.getAllChildrenCount() > 0) {
+        static const std::string KEY_CHILDREN {"children"};
+        static const std::string KEY_INT_CHILDREN {"int-children"};
+        bool open = false;
+
+        for (auto childIndex : node.children) {
+            Quark subpathQuark {_nodes[childIndex].quark};
+
+            if (subpathQuark.isInt() != intKeys) {
+                continue;
+            }
+
+            // open children map on first child
+            if (!open) {
+                const auto& key = intKeys ? KEY_INT_CHILDREN : KEY_CHILDREN;
+
+                this->writeString(key.c_str(), key.size());
+                ::yajl_gen_map_open(_yajlGen);
+                open = true;
+            }
+
+            // output child node subpath
+            if (intKeys) {
+                auto subpath = std::to_string(subpathQuark.getInt());
+
+                this->writeString(subpath.c_str(), subpath.size());
+            } else {
+                auto subpath = _stateHistorySink->getString(subpathQuark);
+
+                this->writeString(subpath, std::strlen(subpath));
+            }
+
+            this->writeNode(childIndex);
+        }
+
+        if (open) {
             ::yajl_gen_map_close(_yajlGen);
         }
+    }
+
+    void writeNode(std::size_t index)
+    {
+        static const std::string KEY_ID {"id"};
+        const auto& node = _nodes[index];
+
+        // open map for this node
+        ::yajl_gen_map_open(_yajlGen);
+
+        // write node ID
+        this->writeString(KEY_ID.c_str(), KEY_ID.size());
+        ::yajl_gen_integer(_yajlGen, node.id);
+
+        // write children maps (if it has any)
+        this->writeChildren(node, false);
+        this->writeChildren(node, true);
 
         // close node map
         ::yajl_gen_map_close(_yajlGen);
@@ -160,6 +220,12 @@ private:
 
     // associated state history sink
     const StateHistorySink* _stateHistorySink;
+
+    // visited nodes (in visiting order, root first)
+    std::vector<Node> _nodes;
+
+    // indexes of nodes being visited
+    std::vector<std::size_t> _stack;
 };
 
 /**
@@ -186,158 +252,159 @@ private:
 StateHistorySink::StateHistorySink(const bfs::path& stringDbPath,
                                    const boost::filesystem::path& nodesMapPath,
                                    const bfs::path& historyPath,
-                                   timestamp_t beginTs) :
+                                   timestamp_t beginTs,
+                                   const StateResumePoint* resumePoint) :
     _stringDbPath {stringDbPath},
     _nodesMapPath {nodesMapPath},
     _historyPath {historyPath},
     _beginTs {beginTs},
     _ts {beginTs},
     _open {false},
-    _nextPathQuark {0},
-    _nextStrValueQuark {0},
+    _resumed {false},
+    _resumedChangesCount {0},
+    _segment {0},
+    _coalescing {true},
     _nextNodeId {0},
     _currentState {this},
-    _stateChangesCount {0}
+    _stateChangesCount {0},
+    _checkpointEventsPeriod {0},
+    _checkpointTsPeriod {0}
 {
-    _intervalFileSink = std::unique_ptr<delo::HistoryFileSink> {
-        new delo::HistoryFileSink
-    };
-
-    _null = NullStateValue::UP {new NullStateValue};
-
-    this->initTranslators();
-    this->open();
+    this->open(resumePoint);
 }
 
 StateHistorySink::~StateHistorySink()
 {
-    this->close();
+    try {
+        this->close();
+    } catch (...) {
+        // too late to report anything
+    }
 }
 
-void StateHistorySink::initTranslators()
+void StateHistorySink::open(const StateResumePoint* resumePoint)
 {
-    auto unknownTranslator = [] (const StateNode&)
-    {
-        return nullptr;
-    };
+    // reset stuff
+    _ts = _beginTs;
+    _stringDb.clear();
+    _stateChangesCount = 0;
+    _nodeChunks.clear();
+    _nextNodeId = 0;
+    _eventsUntilCheckpoint = std::numeric_limits<std::size_t>::max();
+    _nextCheckpointTs = std::numeric_limits<timestamp_t>::max();
 
-    auto nullTranslator = [this] (const StateNode& node)
-    {
-        return new delo::NullInterval {
-            static_cast<delo::timestamp_t>(node.getBeginTs()),
-            static_cast<delo::timestamp_t>(_ts),
-            static_cast<delo::interval_key_t>(node.getId())
-        };
-    };
+    // create root node
+    this->buildStateNode();
 
-    auto sint32Translator = [this] (const StateNode& node)
-    {
-        auto interval = new delo::Int32Interval {
-            static_cast<delo::timestamp_t>(node.getBeginTs()),
-            static_cast<delo::timestamp_t>(_ts),
-            static_cast<delo::interval_key_t>(node.getId())
-        };
+    // go on from resume point
+    _resumed = false;
+    _resumedChangesCount = 0;
+    _segment = 0;
 
-        interval->setValue(node.getValue().asSint32());
+    if (resumePoint) {
+        this->restore(*resumePoint);
+    }
 
-        return interval;
-    };
+    // open history file (starts the interval writer thread)
+    _intervalWriter.open(StateHistorySink::getHistorySegmentPath(_historyPath,
+                                                                 _segment));
 
-    auto uint32Translator = [this] (const StateNode& node)
-    {
-        auto interval = new delo::Uint32Interval {
-            static_cast<delo::timestamp_t>(node.getBeginTs()),
-            static_cast<delo::timestamp_t>(_ts),
-            static_cast<delo::interval_key_t>(node.getId())
-        };
+    _open = true;
+}
 
-        interval->setValue(node.getValue().asUint32());
+void StateHistorySink::restore(const StateResumePoint& resumePoint)
+{
+    // same strings, same quarks
+    for (const auto& string : resumePoint.getStrings()) {
+        _stringDb.intern(string.c_str(), string.size());
+    }
 
-        return interval;
-    };
+    // rebuild state tree (parents always come before their children)
+    const auto& nodes = resumePoint.getNodes();
 
-    auto sint64Translator = [this] (const StateNode& node)
-    {
-        auto interval = new delo::Int64Interval {
-            static_cast<delo::timestamp_t>(node.getBeginTs()),
-            static_cast<delo::timestamp_t>(_ts),
-            static_cast<delo::interval_key_t>(node.getId())
-        };
+    _ts = resumePoint.getTimestamp();
 
-        interval->setValue(node.getValue().asSint64());
+    for (std::size_t id = 0; id < nodes.size(); ++id) {
+        const auto& resumedNode = nodes[id];
+        auto& node = (id == 0) ? this->getRoot() : this->buildStateNode();
 
-        return interval;
-    };
+        // current intervals are still open
+        node._value = resumedNode.value;
+        node._beginTs = resumedNode.beginTs;
 
-    auto uint64Translator = [this] (const StateNode& node)
-    {
-        auto interval = new delo::Uint64Interval {
-            static_cast<delo::timestamp_t>(node.getBeginTs()),
-            static_cast<delo::timestamp_t>(_ts),
-            static_cast<delo::interval_key_t>(node.getId())
-        };
+        if (id > 0) {
+            this->getNode(resumedNode.parentId)._children.insert(resumedNode.key,
+                                                                 node.getId());
+        }
+    }
 
-        interval->setValue(node.getValue().asUint64());
+    _segment = resumePoint.getSegment();
+    _resumedChangesCount = resumePoint.getChangesCount();
+    _resumed = true;
+}
 
-        return interval;
+void StateHistorySink::saveResumePoint(const bfs::path& path,
+                                       std::uint64_t fingerprint)
+{
+    // start next segment (waits for the current one to be complete)
+    _intervalWriter.close();
+    _segment++;
+    _intervalWriter.open(StateHistorySink::getHistorySegmentPath(_historyPath,
+                                                                 _segment));
+
+    // strings, in quark order
+    StateResumePoint resumePoint {
+        _ts,
+        _segment,
+        _intervalWriter.getChangesCount(),
+        fingerprint
     };
 
-    auto float32Translator = [this] (const StateNode& node)
-    {
-        auto interval = new delo::Float32Interval {
-            static_cast<delo::timestamp_t>(node.getBeginTs()),
-            static_cast<delo::timestamp_t>(_ts),
-            static_cast<delo::interval_key_t>(node.getId())
-        };
+    for (quark_t quark = 0; quark < _stringDb.size(); ++quark) {
+        resumePoint.addString(_stringDb.getString(quark),
+                              _stringDb.getLength(quark));
+    }
 
-        interval->setValue(node.getValue().asFloat32());
+    // parent, key and open interval of each node
+    std::vector<StateResumePoint::Node> nodes;
 
-        return interval;
-    };
+    nodes.resize(_nextNodeId);
+    nodes[0].parentId = StateResumePoint::NO_PARENT;
+    nodes[0].key = 0;
 
-    auto quarkTranslator = [this] (const StateNode& node)
-    {
-        auto interval = new delo::QuarkInterval {
-            static_cast<delo::timestamp_t>(node.getBeginTs()),
-            static_cast<delo::timestamp_t>(_ts),
-            static_cast<delo::interval_key_t>(node.getId())
-        };
+    for (state_node_id_t id = 0; id < _nextNodeId; ++id) {
+        const auto& node = this->getNode(id);
 
-        interval->setValue(node.getValue().asQuark().get());
+        nodes[id].value = node.getValue();
+        nodes[id].beginTs = node.getBeginTs();
 
-        return interval;
-    };
+        for (const auto& child : node._children) {
+            if (child.id != StateNodeChildren::NO_NODE) {
+                nodes[child.id].parentId = id;
+                nodes[child.id].key = child.quark;
+            }
+        }
+    }
 
-    // fill translators
-    for (auto& translator : _translators) {
-        translator = unknownTranslator;
+    for (const auto& node : nodes) {
+        resumePoint.addNode(node.parentId, node.key, node.value,
+                            node.beginTs);
     }
 
-    _translators[static_cast<std::size_t>(StateValueType::SINT32)] = sint32Translator;
-    _translators[static_cast<std::size_t>(StateValueType::UINT32)] = uint32Translator;
-    _translators[static_cast<std::size_t>(StateValueType::SINT64)] = sint64Translator;
-    _translators[static_cast<std::size_t>(StateValueType::UINT64)] = uint64Translator;
-    _translators[static_cast<std::size_t>(StateValueType::FLOAT32)] = float32Translator;
-    _translators[static_cast<std::size_t>(StateValueType::QUARK)] = quarkTranslator;
-    _translators[static_cast<std::size_t>(StateValueType::NUL)] = nullTranslator;
+    resumePoint.save(path);
 }
 
-void StateHistorySink::open()
+bfs::path StateHistorySink::getHistorySegmentPath(const bfs::path& historyPath,
+                                                  std::size_t segment)
 {
-    // open history sink
-    _intervalFileSink->open(_historyPath);
-
-    // reset stuff
-    _ts = _beginTs;
-    _stringDb.clear();
-    _nextPathQuark = 0;
-    _nextStrValueQuark = 0;
-    _stateChangesCount = 0;
+    if (segment == 0) {
+        return historyPath;
+    }
 
-    // create root node
-    _root = this->buildStateNode();
+    auto filename = historyPath.stem().string() + "." + std::to_string(segment) +
+                    historyPath.extension().string();
 
-    _open = true;
+    return historyPath.parent_path() / filename;
 }
 
 void StateHistorySink::close()
@@ -350,8 +417,10 @@ void StateHistorySink::close()
     // write all remaining state values as intervals
     this->nullifyAllNodes();
 
-    // write files
-    _intervalFileSink->close();
+    // write files (waits for all pending intervals to be written)
+    _intervalWriter.close();
+    _intervalWriter.closeChangeLog();
+    _checkpointWriter.close();
     this->writeStringDb(_stringDb, _stringDbPath);
     this->writeNodesMap();
 
@@ -362,43 +431,13 @@ void StateHistorySink::close()
     _open = false;
 }
 
-quark_t StateHistorySink::getQuark(StringDb& stringDb, const std::string& value,
-                                   quark_t& nextQuark)
-{
-    // find in map
-    auto it = stringDb.left.find(value);
-
-    if (it == stringDb.left.end()) {
-        // not found: insert it and return new quark
-        stringDb.insert(StringDb::value_type {value, nextQuark});
-        nextQuark++;
-
-        return nextQuark - 1;
-    } else {
-        return it->second;
-    }
-}
-
-const std::string& StateHistorySink::getQuarkString(const StringDb& stringDb,
-                                                    quark_t quark)
+const char* StateHistorySink::getString(Quark quark) const
 {
-    auto it = stringDb.right.find(quark);
-
-    if (it == stringDb.right.end()) {
-        throw ex::WrongQuark {quark};
+    if (!_stringDb.hasQuark(quark.get())) {
+        throw ex::WrongQuark {quark.get()};
     }
 
-    return it->second;
-}
-
-Quark StateHistorySink::getQuark(const std::string& subpath)
-{
-    return Quark(this->getQuark(_stringDb, subpath, _nextPathQuark));
-}
-
-const std::string& StateHistorySink::getString(Quark quark) const
-{
-    return StateHistorySink::getQuarkString(_stringDb, quark.get());
+    return _stringDb.getString(quark.get());
 }
 
 void StateHistorySink::writeInterval(const StateNode& node)
@@ -416,23 +455,77 @@ void StateHistorySink::writeInterval(const StateNode& node)
         return;
     }
 
-    // translate from state value to interval
-    auto type = static_cast<std::size_t>(stateValue.getType());
-    auto interval = _translators[type](node);
+    // queue interval (translated and written by the writer thread)
+    _intervalWriter.write(node.getBeginTs(), _ts, node.getId(), stateValue);
 
-    // ignore if unknown state value
-    if (!interval) {
-        return;
+    // update internal statistics
+    _stateChangesCount++;
+}
+
+void StateHistorySink::enableChangeLog(const bfs::path& path)
+{
+    /* Keep the changes logged before the resume point, if any: the
+     * following ones (including the nullification of a closed build)
+     * are logged again by this build.
+     */
+    _intervalWriter.openChangeLog(path, _resumedChangesCount);
+}
+
+void StateHistorySink::enableCheckpoints(const bfs::path& dataPath,
+                                         const bfs::path& indexPath,
+                                         std::size_t eventsPeriod,
+                                         timestamp_t tsPeriod)
+{
+    // keep the checkpoints written before the resume point
+    if (_resumed) {
+        _checkpointWriter.reopen(dataPath, indexPath, _ts);
+    } else {
+        _checkpointWriter.open(dataPath, indexPath);
     }
 
-    // add to interval history
-    _intervalFileSink->addInterval(delo::AbstractInterval::UP {interval});
+    _checkpointEventsPeriod = eventsPeriod;
+    _checkpointTsPeriod = tsPeriod;
+    this->restartCheckpointCountdowns();
+}
 
-    // update internal statistics
-    _stateChangesCount++;
+void StateHistorySink::writeCheckpoint()
+{
+    if (_checkpointWriter.isOpen()) {
+        // the node arena is already in node ID order
+        for (state_node_id_t id = 0; id < _nextNodeId; ++id) {
+            const auto& node = this->getNode(id);
+
+            if (node.getValue()) {
+                _checkpointWriter.addNode(node.getBeginTs(), id,
+                                          node.getValue());
+            }
+        }
+
+        _checkpointWriter.commit(_ts);
+    }
+
+    this->restartCheckpointCountdowns();
+}
+
+void StateHistorySink::restartCheckpointCountdowns()
+{
+    // forever if disabled
+    _eventsUntilCheckpoint = std::numeric_limits<std::size_t>::max();
+    _nextCheckpointTs = std::numeric_limits<timestamp_t>::max();
+
+    if (_checkpointWriter.isOpen()) {
+        if (_checkpointEventsPeriod > 0) {
+            _eventsUntilCheckpoint = _checkpointEventsPeriod;
+        }
+
+        if (_checkpointTsPeriod > 0 &&
+                _ts <= std::numeric_limits<timestamp_t>::max() - _checkpointTsPeriod) {
+            _nextCheckpointTs = _ts + _checkpointTsPeriod;
+        }
+    }
 }
 
-void StateHistorySink::writeStringDb(const StringDb& stringDb,
+void StateHistorySink::writeStringDb(const StringInterner& stringDb,
                                      const boost::filesystem::path& path)
 {
     // open output file for writing
@@ -441,12 +534,9 @@ void StateHistorySink::writeStringDb(const StringDb& stringDb,
     output.open(path, std::ios::binary);
 
     // write all string/quark pairs
-    for (const auto& stringQuarkPair : stringDb.left) {
-        const auto& string = stringQuarkPair.first;
-        auto quark = stringQuarkPair.second;
-
+    for (quark_t quark = 0; quark < stringDb.size(); ++quark) {
         // write string part
-        output.write(string.c_str(), string.size() + 1);
+        output.write(stringDb.getString(quark), stringDb.getLength(quark) + 1);
 
         // align for quark
         output.seekp((output.tellp() + static_cast<long>(sizeof(quark) - 1)) & ~(sizeof(quark) - 1));
@@ -459,10 +549,19 @@ void StateHistorySink::writeStringDb(const StringDb& stringDb,
     output.close();
 }
 
-StateNode::UP StateHistorySink::buildStateNode()
+StateNode& StateHistorySink::buildStateNode()
 {
-    // build node
-    StateNode::UP node {new StateNode {_nextNodeId, this, _beginTs}};
+    // new chunk needed?
+    if ((_nextNodeId >> NODE_CHUNK_BITS) == _nodeChunks.size()) {
+        _nodeChunks.push_back(NodeChunk {
+            new StateNode[1 << NODE_CHUNK_BITS]
+        });
+    }
+
+    // initialize next unused node
+    auto& node = this->getNode(_nextNodeId);
+
+    node.init(_nextNodeId, this, _beginTs);
 
     // update next node ID
     _nextNodeId++;
@@ -481,7 +580,7 @@ std::size_t StateHistorySink::getNodesCount() const
         new StateNodeCounterVisitor
     };
 
-    _root->acceptRead(*visitor, 0xffffffff);
+    this->getNode(0).acceptRead(*visitor, 0xffffffff);
 
     return visitor->getCount();
 }
@@ -495,7 +594,8 @@ void StateHistorySink::writeNodesMap() const
         new TreeToJsonStateNodeVisitor {yajlGen, this}
     };
 
-    _root->acceptRead(*visitor, 0xffffffff);
+    this->getNode(0).acceptRead(*visitor, 0xffffffff);
+    visitor->write();
 
     // write this JSON string to a file
     const unsigned char* buf;
@@ -524,7 +624,7 @@ void StateHistorySink::nullifyAllNodes()
         new StateNodeNullifierVisitor
     };
 
-    _root->acceptUpdate(*visitor, 0xffffffff);
+    this->getRoot().acceptUpdate(*visitor, 0xffffffff);
 }
 
 }
@@ -21,23 +21,21 @@
 #include <cassert>
 #include <memory>
 #include <cstdint>
-#include <array>
-#include <functional>
-#include <unordered_map>
+#include <vector>
 #include <boost/utility.hpp>
+#include <cstring>
+#include <limits>
+#include <string>
 #include <boost/filesystem/path.hpp>
-#include <boost/bimap.hpp>
-#include <boost/bimap/unordered_set_of.hpp>
-#include <delorean/HistoryFileSink.hpp>
-#include <delorean/interval/AbstractInterval.hpp>
 
 #include <common/BasicTypes.hpp>
-#include <common/state/AbstractStateValue.hpp>
-#include <common/state/NullStateValue.hpp>
 #include <common/state/CurrentState.hpp>
 #include <common/state/StateNode.hpp>
-#include <common/state/AbstractStateValue.hpp>
+#include <common/state/StateIntervalWriter.hpp>
+#include <common/state/StateCheckpointWriter.hpp>
+#include <common/state/StateResumePoint.hpp>
 #include <common/state/Quark.hpp>
+#include <common/state/StringInterner.hpp>
 
 namespace tibee
 {
@@ -62,27 +60,42 @@ class StateHistorySink :
     // mutual friendship FTW
     friend StateNode;
 
+    // iterators need to resolve node IDs
+    friend StateNodeIterator;
+
 public:
     /**
      * Builds a state history sink.
      *
      * The current history timestamp is initialized with 0.
      *
+     * If \p resumePoint is not \a nullptr, the string database and
+     * the state tree are restored from it, the current history
+     * timestamp is the resume point timestamp, and intervals are
+     * written to the history segment following the ones written
+     * before the resume point (see getHistorySegmentPath()).
+     *
      * @param stringDbPath  Path to string database file (to be created)
      * @param nodesMapPath   Path to map of state nodes IDs to paths (to be created)
      * @param historyPath    Path to history file (to be created)
      * @param beginTs        Begin timestamp to use
+     * @param resumePoint    Resume point to start from, or \a nullptr
      */
     StateHistorySink(const boost::filesystem::path& stringDbPath,
                      const boost::filesystem::path& nodesMapPath,
                      const boost::filesystem::path& historyPath,
-                     timestamp_t beginTs);
+                     timestamp_t beginTs,
+                     const StateResumePoint* resumePoint = nullptr);
 
     ~StateHistorySink();
 
     /**
      * Sets the history current timestamp. Timestamps should be set
-     * in ascending order.
+     * in ascending order, once per event.
+     *
+     * If checkpoints are enabled and one is due, a checkpoint of the
+     * current state is written at the previous current timestamp
+     * before updating it.
      *
      * @param ts Current timestamp
      */
@@ -90,9 +103,119 @@ public:
     {
         assert(ts >= _ts);
 
+        if (ts >= _nextCheckpointTs || --_eventsUntilCheckpoint == 0) {
+            this->writeCheckpoint();
+        }
+
         _ts = ts;
     }
 
+    /**
+     * Enables periodic checkpoints of the whole current state (see
+     * StateCheckpoint), written to files \p dataPath and
+     * \p indexPath.
+     *
+     * A checkpoint is written every \p eventsPeriod events
+     * (calls to setCurrentTimestamp()) or as soon as \p tsPeriod
+     * nanoseconds passed since the last checkpoint, whichever comes
+     * first. A period of 0 disables the corresponding condition.
+     *
+     * @param dataPath     Path to checkpoint data file (to be created)
+     * @param indexPath    Path to checkpoint index file (to be created)
+     * @param eventsPeriod Maximum number of events between checkpoints
+     * @param tsPeriod     Maximum time between checkpoints (ns)
+     */
+    void enableCheckpoints(const boost::filesystem::path& dataPath,
+                           const boost::filesystem::path& indexPath,
+                           std::size_t eventsPeriod, timestamp_t tsPeriod);
+
+    /**
+     * Enables the state change log (see StateChange), written to file
+     * \p path.
+     *
+     * Each effective state node assignment is appended to this log,
+     * which, along with checkpoints, lets readers answer point-in-time
+     * and interval queries without scanning the whole history. Changes
+     * are queued with intervals and written by the interval writer
+     * thread (see StateIntervalWriter). The change log is disabled by
+     * default.
+     *
+     * When resuming, the changes logged after the resume point are
+     * removed.
+     *
+     * @param path Path to state change log file
+     */
+    void enableChangeLog(const boost::filesystem::path& path);
+
+    /**
+     * Saves a resume point of this sink to file \p path.
+     *
+     * The current intervals remain open: they are saved with their
+     * begin timestamp. The following intervals, including the current
+     * ones once they end, are written to a new history segment, so
+     * that all the history segments written so far are complete and
+     * never written again by a build resuming from this point.
+     *
+     * Call this between two timestamps: all the events of the current
+     * timestamp must already be processed. Throws ex::ResumePoint on
+     * error.
+     *
+     * @param path        Path of resume point file
+     * @param fingerprint Fingerprint of the build configuration
+     */
+    void saveResumePoint(const boost::filesystem::path& path,
+                         std::uint64_t fingerprint);
+
+    /**
+     * Returns the path of history segment \p segment.
+     *
+     * Segment 0 is \p historyPath itself; segment \a n is
+     * \p historyPath with <code>.n</code> inserted before its
+     * extension. Each segment holds the intervals ending between two
+     * resume points.
+     *
+     * @param historyPath Path of history file
+     * @param segment     History segment index
+     * @returns           Path of history segment
+     */
+    static boost::filesystem::path getHistorySegmentPath(const boost::filesystem::path& historyPath,
+                                                         std::size_t segment);
+
+    /**
+     * Returns the number of checkpoints written so far.
+     *
+     * @returns Number of checkpoints
+     */
+    std::size_t getCheckpointsCount() const
+    {
+        return _checkpointWriter.getCount();
+    }
+
+    /**
+     * Enables or disables the coalescing of same-value assignments
+     * (enabled by default).
+     *
+     * When enabled, assigning a state node its current value does
+     * not end its current interval. When disabled, every assignment
+     * ends the current interval of the node and starts a new one.
+     *
+     * @param coalescing True to coalesce same-value assignments
+     */
+    void setCoalescing(bool coalescing)
+    {
+        _coalescing = coalescing;
+    }
+
+    /**
+     * Returns whether or not same-value assignments are coalesced.
+     *
+     * @returns True if same-value assignments are coalesced
+     */
+    bool isCoalescing() const
+    {
+        return _coalescing;
+    }
+
     /**
      * Returns the current history timestamp.
      *
@@ -119,17 +242,39 @@ public:
      * The quark will always be the same for the same string.
      *
      * @param string String for which to get the quark
+     * @param length Length of \p string, in bytes
      * @returns      Quark for given string
      */
-    Quark getQuark(const std::string& string);
+    Quark getQuark(const char* string, std::size_t length)
+    {
+        return Quark {_stringDb.intern(string, length)};
+    }
+
+    /**
+     * @see getQuark(const char*, std::size_t)
+     */
+    Quark getQuark(const char* string)
+    {
+        return this->getQuark(string, std::strlen(string));
+    }
+
+    /**
+     * @see getQuark(const char*, std::size_t)
+     */
+    Quark getQuark(const std::string& string)
+    {
+        return this->getQuark(string.c_str(), string.size());
+    }
 
     /**
      * Returns the string associated with quark \p quark or
      * throws ex::WrongQuark if no such string exists.
      *
+     * The returned string remains valid as long as this sink is open.
+     *
      * @returns String associated with quark \p quark
      */
-    const std::string& getString(Quark quark) const;
+    const char* getString(Quark quark) const;
 
     /**
      * Returns a reference to the "current state", which is an adapter
@@ -170,39 +315,22 @@ public:
      */
     StateNode& getRoot()
     {
-        return *_root;
-    }
-
-    /**
-     * Returns a null state value.
-     *
-     * @returns Null state value
-     */
-    const NullStateValue& getNull() const
-    {
-        return *_null;
+        return this->getNode(0);
     }
 
 private:
-    // a string database
-    typedef boost::bimaps::bimap<
-        boost::bimaps::unordered_set_of<std::string>,
-        boost::bimaps::unordered_set_of<quark_t>
-    > StringDb;
+    // a chunk of state nodes
+    typedef std::unique_ptr<StateNode[]> NodeChunk;
 
-    // a (state node -> delorean interval) translator
-    typedef std::function<delo::AbstractInterval* (const StateNode&)> Translator;
+private:
+    // node ID bits giving the index of a node within its chunk
+    static const unsigned int NODE_CHUNK_BITS = 12;
 
 private:
-    void initTranslators();
-    void open();
-    void writeStringDb(const StringDb& stringDb,
+    void open(const StateResumePoint* resumePoint);
+    void restore(const StateResumePoint& resumePoint);
+    void writeStringDb(const StringInterner& stringDb,
                        const boost::filesystem::path& path);
-    quark_t getQuark(StringDb& stringDb, const std::string& value,
-                     quark_t& nextQuark);
-
-    static const std::string& getQuarkString(const StringDb& stringDb,
-                                             quark_t quark);
 
     /**
      * Writes the map of state node IDs to paths to a file.
@@ -214,22 +342,70 @@ private:
      *
      * @returns Fresh state node
      */
-    StateNode::UP buildStateNode();
+    StateNode& buildStateNode();
+
+    /**
+     * Returns the state node with ID \p id, which must exist.
+     *
+     * @param id Node ID
+     * @returns  State node with ID \p id
+     */
+    StateNode& getNode(state_node_id_t id)
+    {
+        return _nodeChunks[id >> NODE_CHUNK_BITS][id & ((1 << NODE_CHUNK_BITS) - 1)];
+    }
+
+    /**
+     * @see getNode(state_node_id_t)
+     */
+    const StateNode& getNode(state_node_id_t id) const
+    {
+        return _nodeChunks[id >> NODE_CHUNK_BITS][id & ((1 << NODE_CHUNK_BITS) - 1)];
+    }
 
     /**
      * Called by state nodes when an interval needs to be written.
      *
      * If the node has no current state value, no interval is written.
+     * Otherwise, the interval is queued and actually written later by
+     * the interval writer thread.
      *
      * @param node Node for which an interval needs to be created
      */
     void writeInterval(const StateNode& node);
 
+    /**
+     * Called by state nodes when they are assigned a new value.
+     *
+     * Appends the new value of \p node, at the current timestamp, to
+     * the state change log, if enabled.
+     *
+     * @param node Node which was assigned a new value
+     */
+    void writeChange(const StateNode& node)
+    {
+        if (_intervalWriter.isChangeLogOpen()) {
+            _intervalWriter.writeChange(_ts, node.getId(), node.getValue());
+        }
+    }
+
     /**
      * Nullifies all nodes of the state tree.
      */
     void nullifyAllNodes();
 
+    /**
+     * Writes a checkpoint of all non-null nodes at the current
+     * timestamp (if checkpoints are enabled) and restarts the
+     * checkpoint countdowns.
+     */
+    void writeCheckpoint();
+
+    /**
+     * Restarts the checkpoint countdowns from the current timestamp.
+     */
+    void restartCheckpointCountdowns();
+
 private:
     // paths to files to create
     boost::filesystem::path _stringDbPath;
@@ -245,35 +421,48 @@ private:
     // open state
     bool _open;
 
-    // string database for state paths
-    StringDb _stringDb;
+    // true if restored from a resume point
+    bool _resumed;
 
-    // current state path quark
-    quark_t _nextPathQuark;
+    // number of state changes logged before the resume point
+    std::size_t _resumedChangesCount;
 
-    // current state value quark
-    quark_t _nextStrValueQuark;
+    // index of current history segment
+    std::size_t _segment;
+
+    // coalesce same-value assignments
+    bool _coalescing;
+
+    // string database for state paths and values
+    StringInterner _stringDb;
 
     // next state node unique ID to assign
     state_node_id_t _nextNodeId;
 
-    // root state node
-    StateNode::UP _root;
-
-    // (state value -> delorean interval) translators
-    std::array<Translator, 16> _translators;
+    // state nodes, by chunks of 2^NODE_CHUNK_BITS (root has ID 0)
+    std::vector<NodeChunk> _nodeChunks;
 
     // current state adapter for state providers
     CurrentState _currentState;
 
-    // interval history sink
-    std::unique_ptr<delo::HistoryFileSink> _intervalFileSink;
+    // asynchronous interval history writer
+    StateIntervalWriter _intervalWriter;
 
     // count of state changes so far
     std::size_t _stateChangesCount;
 
-    // Null state value
-    NullStateValue::UP _null;
+    // checkpoints writer
+    StateCheckpointWriter _checkpointWriter;
+
+    // checkpoint periods (0 if disabled)
+    std::size_t _checkpointEventsPeriod;
+    timestamp_t _checkpointTsPeriod;
+
+    // number of events until next checkpoint
+    std::size_t _eventsUntilCheckpoint;
+
+    // timestamp at or after which the next checkpoint is due
+    timestamp_t _nextCheckpointTs;
 };
 
 }
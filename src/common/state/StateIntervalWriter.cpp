@@ -0,0 +1,339 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <string>
+#include <utility>
+#include <delorean/BasicTypes.hpp>
+#include <delorean/interval/Int32Interval.hpp>
+#include <delorean/interval/Uint32Interval.hpp>
+#include <delorean/interval/Int64Interval.hpp>
+#include <delorean/interval/Uint64Interval.hpp>
+#include <delorean/interval/Float32Interval.hpp>
+#include <delorean/interval/QuarkInterval.hpp>
+#include <delorean/interval/NullInterval.hpp>
+
+#include <common/state/StateIntervalWriter.hpp>
+#include <common/state/StateValueType.hpp>
+#include <common/ex/StateHistory.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+template<typename IntervalT, typename ValueT>
+delo::AbstractInterval* buildInterval(timestamp_t beginTs, timestamp_t endTs,
+                                      state_node_id_t id, ValueT value)
+{
+    auto interval = new IntervalT {
+        static_cast<delo::timestamp_t>(beginTs),
+        static_cast<delo::timestamp_t>(endTs),
+        static_cast<delo::interval_key_t>(id)
+    };
+
+    interval->setValue(value);
+
+    return interval;
+}
+
+}
+
+const std::size_t StateIntervalWriter::BUFFER_SIZE;
+
+StateIntervalWriter::StateIntervalWriter() :
+    _fileSink {new delo::HistoryFileSink},
+    _changeLogOpen {false},
+    _changesCount {0},
+    _fillIndex {0},
+    _fillCount {0},
+    _drainIndex {-1},
+    _drainCount {0},
+    _stopping {false},
+    _open {false}
+{
+    for (auto& buffer : _buffers) {
+        buffer.resize(StateIntervalWriter::BUFFER_SIZE);
+    }
+}
+
+StateIntervalWriter::~StateIntervalWriter()
+{
+    try {
+        this->close();
+    } catch (...) {
+        // too late to report anything
+    }
+}
+
+void StateIntervalWriter::open(const bfs::path& path)
+{
+    _fileSink->open(path);
+
+    // reset stuff
+    _fillIndex = 0;
+    _fillCount = 0;
+    _drainIndex = -1;
+    _drainCount = 0;
+    _stopping = false;
+    _exception = nullptr;
+
+    // go!
+    _thread = std::thread {&StateIntervalWriter::run, this};
+    _open = true;
+}
+
+void StateIntervalWriter::openChangeLog(const bfs::path& path,
+                                        std::size_t count)
+{
+    // the writer thread must not be appending to the previous log
+    this->waitIdle();
+
+    _changeLogOpen = false;
+    _changeWriter.reopen(path, count);
+    _changeLogOpen = true;
+    _changesCount = count;
+}
+
+void StateIntervalWriter::closeChangeLog()
+{
+    this->waitIdle();
+
+    _changeWriter.close();
+    _changeLogOpen = false;
+}
+
+void StateIntervalWriter::waitIdle()
+{
+    /* Only flush() hands over buffers: once the writer thread is done
+     * with the last one, it doesn't touch anything until the next one.
+     */
+    std::unique_lock<std::mutex> lock {_mutex};
+
+    _cond.wait(lock, [this] () {
+        return _drainIndex < 0;
+    });
+}
+
+void StateIntervalWriter::close()
+{
+    // silently ignore if already closed
+    if (!_open) {
+        return;
+    }
+
+    _open = false;
+
+    /* Hand over what's left. flush() hands over the buffer before
+     * reporting the failure of a previous one: keep this failure to
+     * report it once the writer thread is stopped.
+     */
+    std::exception_ptr exception;
+
+    if (_fillCount > 0) {
+        try {
+            this->flush();
+        } catch (...) {
+            exception = std::current_exception();
+        }
+    }
+
+    // stop writer thread once it's done
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        _stopping = true;
+        _cond.notify_all();
+    }
+
+    _thread.join();
+
+    try {
+        _fileSink->close();
+    } catch (...) {
+        if (!exception) {
+            exception = std::current_exception();
+        }
+    }
+
+    // first failure
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+
+    this->rethrowException();
+}
+
+void StateIntervalWriter::flush()
+{
+    std::exception_ptr exception;
+
+    {
+        std::unique_lock<std::mutex> lock {_mutex};
+
+        // wait for the writer thread to be done with the other buffer
+        _cond.wait(lock, [this] () {
+            return _drainIndex < 0;
+        });
+
+        // failure of a previous buffer to report
+        std::swap(exception, _exception);
+
+        _drainIndex = static_cast<int>(_fillIndex);
+        _drainCount = _fillCount;
+        _cond.notify_all();
+    }
+
+    // keep on filling the other buffer
+    _fillIndex = 1 - _fillIndex;
+    _fillCount = 0;
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void StateIntervalWriter::rethrowException()
+{
+    std::exception_ptr exception;
+
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        std::swap(exception, _exception);
+    }
+
+    if (exception) {
+        std::rethrow_exception(exception);
+    }
+}
+
+void StateIntervalWriter::run()
+{
+    // a previous write failed: drain buffers without writing them
+    bool failed = false;
+
+    while (true) {
+        std::size_t index;
+        std::size_t count;
+
+        // wait for a buffer to drain
+        {
+            std::unique_lock<std::mutex> lock {_mutex};
+
+            _cond.wait(lock, [this] () {
+                return _drainIndex >= 0 || _stopping;
+            });
+
+            if (_drainIndex < 0) {
+                break;
+            }
+
+            index = static_cast<std::size_t>(_drainIndex);
+            count = _drainCount;
+        }
+
+        // translate and write (unless a previous write failed)
+        std::exception_ptr exception;
+
+        if (!failed) {
+            try {
+                const auto& buffer = _buffers[index];
+
+                for (std::size_t x = 0; x < count; ++x) {
+                    const auto& record = buffer[x];
+
+                    if (record.isChange) {
+                        _changeWriter.write(record.beginTs, record.id,
+                                            record.value);
+                    } else {
+                        _fileSink->addInterval(delo::AbstractInterval::UP {
+                            StateIntervalWriter::translate(record)
+                        });
+                    }
+                }
+            } catch (...) {
+                exception = std::current_exception();
+                failed = true;
+            }
+        }
+
+        // buffer is free again
+        {
+            std::lock_guard<std::mutex> lock {_mutex};
+
+            if (exception) {
+                _exception = exception;
+            }
+
+            _drainIndex = -1;
+            _cond.notify_all();
+        }
+    }
+}
+
+delo::AbstractInterval* StateIntervalWriter::translate(const Record& record)
+{
+    const auto& value = record.value;
+
+    if (record.endTs < record.beginTs) {
+        throw ex::StateHistory {
+            "state interval of node " + std::to_string(record.id) +
+            " ends before it begins"
+        };
+    }
+
+    switch (value.getType()) {
+    case StateValueType::SINT32:
+        return buildInterval<delo::Int32Interval>(record.beginTs, record.endTs,
+                                                  record.id, value.asSint32());
+
+    case StateValueType::UINT32:
+        return buildInterval<delo::Uint32Interval>(record.beginTs, record.endTs,
+                                                   record.id, value.asUint32());
+
+    case StateValueType::SINT64:
+        return buildInterval<delo::Int64Interval>(record.beginTs, record.endTs,
+                                                  record.id, value.asSint64());
+
+    case StateValueType::UINT64:
+        return buildInterval<delo::Uint64Interval>(record.beginTs, record.endTs,
+                                                   record.id, value.asUint64());
+
+    case StateValueType::FLOAT32:
+        return buildInterval<delo::Float32Interval>(record.beginTs, record.endTs,
+                                                    record.id, value.asFloat32());
+
+    case StateValueType::QUARK:
+        return buildInterval<delo::QuarkInterval>(record.beginTs, record.endTs,
+                                                  record.id, value.asQuark().get());
+
+    default:
+        return new delo::NullInterval {
+            static_cast<delo::timestamp_t>(record.beginTs),
+            static_cast<delo::timestamp_t>(record.endTs),
+            static_cast<delo::interval_key_t>(record.id)
+        };
+    }
+}
+
+}
+}
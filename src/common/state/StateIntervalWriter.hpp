@@ -0,0 +1,259 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATEINTERVALWRITER_HPP
+#define _TIBEE_COMMON_STATEINTERVALWRITER_HPP
+
+#include <array>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <boost/utility.hpp>
+#include <boost/filesystem/path.hpp>
+#include <delorean/HistoryFileSink.hpp>
+#include <delorean/interval/AbstractInterval.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/state/StateChangeWriter.hpp>
+#include <common/state/StateValue.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Asynchronous state interval writer.
+ *
+ * Intervals are first appended as plain records to a fill buffer. When
+ * this buffer is full, it's handed over to a dedicated writer thread
+ * which translates its records to delorean intervals and adds them to
+ * a delorean history file sink, while the caller keeps on filling the
+ * other buffer.
+ *
+ * The caller only blocks if the writer thread is still busy with the
+ * previous buffer when the current one is full.
+ *
+ * When the state change log is open, state changes go through the same
+ * buffers and are appended to it by the writer thread too, so that
+ * the caller never writes any file itself.
+ *
+ * The first error of the writer thread stops it from writing anything
+ * else and is rethrown to the caller by the buffer handover following
+ * the one of the failed buffer (write()) or by close(), whichever
+ * comes first, and only once.
+ *
+ * @author Philippe Proulx
+ */
+class StateIntervalWriter :
+    boost::noncopyable
+{
+public:
+    /// Number of records in each buffer
+    static const std::size_t BUFFER_SIZE = 16384;
+
+public:
+    /**
+     * Builds a closed state interval writer.
+     */
+    StateIntervalWriter();
+
+    /**
+     * Closes this writer if it's open.
+     */
+    ~StateIntervalWriter();
+
+    /**
+     * Opens the history file \p path and starts the writer thread.
+     *
+     * @param path Path to history file (to be created)
+     */
+    void open(const boost::filesystem::path& path);
+
+    /**
+     * Writes all pending intervals, stops the writer thread and closes
+     * the history file.
+     *
+     * Any exception thrown by the writer thread and not already
+     * rethrown by write() is rethrown here.
+     */
+    void close();
+
+    /**
+     * Opens the state change log file \p path, first keeping only its
+     * first \p count changes (see StateChangeWriter::reopen()). The
+     * change log remains open through close() and open() of the
+     * history file.
+     *
+     * Throws ex::StateHistory if the file holds less than \p count
+     * changes.
+     *
+     * @param path  Path to state change log file
+     * @param count Number of changes to keep (0 for a new log)
+     */
+    void openChangeLog(const boost::filesystem::path& path, std::size_t count);
+
+    /**
+     * Closes the state change log. Call close() first so that all
+     * pending changes are written.
+     */
+    void closeChangeLog();
+
+    /**
+     * Returns whether or not the state change log is open.
+     *
+     * @returns True if the state change log is open
+     */
+    bool isChangeLogOpen() const
+    {
+        return _changeLogOpen;
+    }
+
+    /**
+     * Returns the number of changes of the state change log, including
+     * the queued ones.
+     *
+     * @returns Number of changes
+     */
+    std::size_t getChangesCount() const
+    {
+        return _changesCount;
+    }
+
+    /**
+     * Queues an interval to be written.
+     *
+     * If this fills the current buffer, it's handed over to the
+     * writer thread, and any exception thrown by the writer thread
+     * while writing the previous buffers is rethrown.
+     *
+     * @param beginTs Interval begin timestamp
+     * @param endTs   Interval end timestamp
+     * @param id      State node ID (interval key)
+     * @param value   Interval value (not null)
+     */
+    void write(timestamp_t beginTs, timestamp_t endTs, state_node_id_t id,
+               const StateValue& value)
+    {
+        auto& record = _buffers[_fillIndex][_fillCount];
+
+        record.isChange = false;
+        record.beginTs = beginTs;
+        record.endTs = endTs;
+        record.id = id;
+        record.value = value;
+        _fillCount++;
+
+        if (_fillCount == StateIntervalWriter::BUFFER_SIZE) {
+            this->flush();
+        }
+    }
+
+    /**
+     * Queues a state change to be appended to the state change log,
+     * which must be open.
+     *
+     * @see write()
+     *
+     * @param ts    Change timestamp
+     * @param id    State node ID
+     * @param value New node value
+     */
+    void writeChange(timestamp_t ts, state_node_id_t id,
+                     const StateValue& value)
+    {
+        auto& record = _buffers[_fillIndex][_fillCount];
+
+        record.isChange = true;
+        record.beginTs = ts;
+        record.id = id;
+        record.value = value;
+        _fillCount++;
+        _changesCount++;
+
+        if (_fillCount == StateIntervalWriter::BUFFER_SIZE) {
+            this->flush();
+        }
+    }
+
+private:
+    // a pending interval or state change (at beginTs)
+    struct Record
+    {
+        bool isChange;
+        timestamp_t beginTs;
+        timestamp_t endTs;
+        state_node_id_t id;
+        StateValue value;
+    };
+
+    typedef std::vector<Record> Buffer;
+
+private:
+    void flush();
+    void waitIdle();
+    void run();
+    void rethrowException();
+    static delo::AbstractInterval* translate(const Record& record);
+
+private:
+    // interval history file sink (only used by the writer thread while open)
+    std::unique_ptr<delo::HistoryFileSink> _fileSink;
+
+    // state change log writer (only used by the writer thread while open)
+    StateChangeWriter _changeWriter;
+
+    // state change log open state and number of changes (incl. queued ones)
+    bool _changeLogOpen;
+    std::size_t _changesCount;
+
+    // double buffer
+    std::array<Buffer, 2> _buffers;
+
+    // index and number of records of the buffer being filled
+    std::size_t _fillIndex;
+    std::size_t _fillCount;
+
+    // index and number of records of the buffer to drain (-1 if none)
+    int _drainIndex;
+    std::size_t _drainCount;
+
+    // writer thread should stop once the drain buffer is done
+    bool _stopping;
+
+    // first exception thrown by the writer thread, not rethrown yet
+    std::exception_ptr _exception;
+
+    // open state
+    bool _open;
+
+    // protects _drainIndex, _drainCount, _stopping and _exception
+    std::mutex _mutex;
+    std::condition_variable _cond;
+
+    // writer thread
+    std::thread _thread;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATEINTERVALWRITER_HPP
@@ -16,7 +16,7 @@
  * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
  */
 #include <common/state/StateNode.hpp>
-#include <common/state/NullStateValue.hpp>
+#include <common/state/StateValue.hpp>
 #include <common/state/Sint32StateValue.hpp>
 #include <common/state/Uint32StateValue.hpp>
 #include <common/state/Sint64StateValue.hpp>
@@ -30,41 +30,39 @@ namespace tibee
 namespace common
 {
 
-StateNode::StateNode(state_node_id_t id, StateHistorySink* stateHistorySink,
-                     timestamp_t beginTs) :
-    _id {id},
-    _beginTs {beginTs},
-    _stateHistorySink {stateHistorySink}
+StateNode::StateNode() :
+    _id {0},
+    _beginTs {0},
+    _stateHistorySink {nullptr}
 {
-    // initial state value (null)
-    _stateValue = AbstractStateValue::UP {new NullStateValue};
 }
 
-StateNode::~StateNode()
+void StateNode::init(state_node_id_t id, StateHistorySink* stateHistorySink,
+                     timestamp_t beginTs)
 {
+    _id = id;
+    _beginTs = beginTs;
+    _stateHistorySink = stateHistorySink;
 }
 
-const AbstractStateValue& StateNode::getValue() const
+StateNode::~StateNode()
 {
-    if (_stateValue) {
-        return *_stateValue;
-    } else {
-        return _stateHistorySink->getNull();
-    }
 }
 
 StateNode& StateNode::operator[](Quark quark)
 {
     // child exists?
-    if (this->childExists(quark.get())) {
-        return *_children[quark.get()];
+    auto childId = _children.find(quark.get());
+
+    if (childId != StateNodeChildren::NO_NODE) {
+        return _stateHistorySink->getNode(childId);
     }
 
-    auto newNode = _stateHistorySink->buildStateNode();
+    auto& newNode = _stateHistorySink->buildStateNode();
 
-    _children[quark.get()] = std::move(newNode);
+    _children.insert(quark.get(), newNode.getId());
 
-    return *_children[quark.get()];
+    return newNode;
 }
 
 StateNode& StateNode::operator[](const std::string& key)
@@ -78,27 +76,27 @@ StateNode& StateNode::operator[](const std::string& key)
 
 StateNode& StateNode::operator[](const char* key)
 {
-    return this->operator[](std::string(key));
+    return this->operator[](_stateHistorySink->getQuark(key));
 }
 
 StateNode& StateNode::operator[](std::int64_t key)
 {
-    return this->operator[](std::to_string(key));
+    return this->operator[](this->getIntKeyQuark(key));
 }
 
 StateNode& StateNode::operator[](std::uint64_t key)
 {
-    return this->operator[](std::to_string(key));
+    return this->operator[](this->getIntKeyQuark(key));
 }
 
 StateNode& StateNode::operator[](std::int32_t key)
 {
-    return this->operator[](std::to_string(key));
+    return this->operator[](static_cast<std::int64_t>(key));
 }
 
 StateNode& StateNode::operator[](std::uint32_t key)
 {
-    return this->operator[](std::to_string(key));
+    return this->operator[](static_cast<std::int64_t>(key));
 }
 
 StateNode& StateNode::operator[](float key)
@@ -161,21 +159,16 @@ StateNode& StateNode::operator[](const Float32StateValue& value)
 
 StateNode& StateNode::operator[](const QuarkStateValue& value)
 {
-    // get string value for this string value quark
-    const auto& str = _stateHistorySink->getString(value.getValue());
-
-    // get subpath quark for this string
-    auto subpathQuark = _stateHistorySink->getQuark(str);
-
-    // delegate
-    return this->operator[](subpathQuark);
+    // paths and string values share the same string database
+    return this->operator[](value.getValue());
 }
 
 StateNode::Iterator StateNode::begin()
 {
     return StateNode::Iterator {
         _children.begin(),
-        _children.end()
+        _children.end(),
+        _stateHistorySink
     };
 }
 
@@ -183,21 +176,40 @@ StateNode::Iterator StateNode::end()
 {
     return StateNode::Iterator {
         _children.end(),
-        _children.end()
+        _children.end(),
+        _stateHistorySink
     };
 }
 
 bool StateNode::hasChild(Quark quark) const
 {
-    // does the child event exists?
-    if (this->childExists(quark.get())) {
+    // does the child node exist?
+    auto childId = _children.find(quark.get());
+
+    if (childId != StateNodeChildren::NO_NODE) {
         // get it and check if it's not marked as removed
-        return !_children.at(quark.get())->isNull();
+        return !_stateHistorySink->getNode(childId).isNull();
     }
 
     return false;
 }
 
+StateNode* StateNode::getChild(Quark quark)
+{
+    auto childId = _children.find(quark.get());
+
+    if (childId == StateNodeChildren::NO_NODE) {
+        return nullptr;
+    }
+
+    return &_stateHistorySink->getNode(childId);
+}
+
+StateNode* StateNode::getChild(std::int64_t key)
+{
+    return this->getChild(this->getIntKeyQuark(key));
+}
+
 bool StateNode::hasChild(const std::string& key) const
 {
     // get quark for this subpath
@@ -209,17 +221,17 @@ bool StateNode::hasChild(const std::string& key) const
 
 bool StateNode::hasChild(const char* key) const
 {
-    return this->hasChild(std::string(key));
+    return this->hasChild(_stateHistorySink->getQuark(key));
 }
 
 bool StateNode::hasChild(std::int64_t key) const
 {
-    return this->hasChild(std::to_string(key));
+    return this->hasChild(this->getIntKeyQuark(key));
 }
 
 bool StateNode::hasChild(std::uint64_t key) const
 {
-    return this->hasChild(std::to_string(key));
+    return this->hasChild(this->getIntKeyQuark(key));
 }
 
 bool StateNode::hasChild(const SintEventValue& key) const
@@ -255,8 +267,9 @@ std::size_t StateNode::getChildrenCount() const
     std::size_t count = 0;
 
     // TODO: cache this count in an attribute of this node
-    for (const auto& quarkNodePair : _children) {
-        if (*quarkNodePair.second) {
+    for (const auto& child : _children) {
+        if (child.id != StateNodeChildren::NO_NODE &&
+                _stateHistorySink->getNode(child.id)) {
             count++;
         }
     }
@@ -269,24 +282,29 @@ std::size_t StateNode::getAllChildrenCount() const
     return _children.size();
 }
 
-StateNode& StateNode::operator=(const AbstractStateValue& value)
+StateNode& StateNode::operator=(const StateValue& value)
 {
-    // TODO: use a LUT here
-    if (value.isSint32()) {
-        return (*this = value.asSint32Value());
-    } else if (value.isUint32()) {
-        return (*this = value.asUint32Value());
-    } else if (value.isSint64()) {
-        return (*this = value.asSint64Value());
-    } else if (value.isUint64()) {
-        return (*this = value.asUint64Value());
-    } else if (value.isFloat32()) {
-        return (*this = value.asFloat32Value());
-    } else if (value.isQuark()) {
-        return (*this = value.asQuarkValue());
+    // same value: extend the current interval instead of cutting it
+    if (value == _value && _stateHistorySink->isCoalescing()) {
+        return *this;
     }
 
-    return (*this = _stateHistorySink->getNull());
+    // write current state as an interval
+    this->writeInterval();
+
+    // update current begin timestamp
+    _beginTs = this->getCurrentSinkTimestamp();
+
+    // assign new value
+    _value = value;
+    _stateHistorySink->writeChange(*this);
+
+    return *this;
+}
+
+StateNode& StateNode::operator=(const AbstractStateValue& value)
+{
+    return (*this = StateValue {value});
 }
 
 StateNode& StateNode::operator=(const StateNode& node)
@@ -296,7 +314,7 @@ StateNode& StateNode::operator=(const StateNode& node)
 
 StateNode& StateNode::operator=(Quark quark)
 {
-    return (*this = QuarkStateValue {quark});
+    return (*this = StateValue {quark});
 }
 
 StateNode& StateNode::operator=(const std::string& value)
@@ -310,47 +328,47 @@ StateNode& StateNode::operator=(const std::string& value)
 
 StateNode& StateNode::operator=(const char* value)
 {
-    return (*this = std::string(value));
+    return (*this = _stateHistorySink->getQuark(value));
 }
 
 StateNode& StateNode::operator=(std::int32_t value)
 {
-    return (*this = Sint32StateValue {value});
+    return (*this = StateValue {value});
 }
 
 StateNode& StateNode::operator=(std::uint32_t value)
 {
-    return (*this = Uint32StateValue {value});
+    return (*this = StateValue {value});
 }
 
 StateNode& StateNode::operator=(std::int64_t value)
 {
-    return (*this = Sint64StateValue {value});
+    return (*this = StateValue {value});
 }
 
 StateNode& StateNode::operator=(std::uint64_t value)
 {
-    return (*this = Uint64StateValue {value});
+    return (*this = StateValue {value});
 }
 
 StateNode& StateNode::operator=(float value)
 {
-    return (*this = Float32StateValue {value});
+    return (*this = StateValue {value});
 }
 
 StateNode& StateNode::operator=(const SintEventValue& value)
 {
-    return (*this = Sint64StateValue {value.getValue()});
+    return (*this = StateValue {value.getValue()});
 }
 
 StateNode& StateNode::operator=(const UintEventValue& value)
 {
-    return (*this = Uint64StateValue {value.getValue()});
+    return (*this = StateValue {value.getValue()});
 }
 
 StateNode& StateNode::operator=(const FloatEventValue& value)
 {
-    return (*this = Float32StateValue {
+    return (*this = StateValue {
         static_cast<float>(value.getValue())
     });
 }
@@ -377,7 +395,7 @@ StateNode& StateNode::operator=(const AbstractEventValue& value)
 
 StateNode& StateNode::setNull()
 {
-    return (*this = _stateHistorySink->getNull());
+    return (*this = StateValue {});
 }
 
 StateNode& StateNode::setNullRecursive()
@@ -386,8 +404,10 @@ StateNode& StateNode::setNullRecursive()
     this->setNull();
 
     // nullify my children
-    for (const auto& quarkNodePair : _children) {
-        quarkNodePair.second->setNull();
+    for (const auto& child : _children) {
+        if (child.id != StateNodeChildren::NO_NODE) {
+            _stateHistorySink->getNode(child.id).setNull();
+        }
     }
 
     return *this;
@@ -405,24 +425,20 @@ StateNode& StateNode::operator--()
 
 StateNode& StateNode::operator+=(std::int64_t inc)
 {
-    if (!_stateValue) {
-        return *this;
-    }
-
-    if (_stateValue->isSint32()) {
-        auto curValue = _stateValue->asSint32();
+    if (_value.isSint32()) {
+        auto curValue = _value.asSint32();
 
         return this->operator=(static_cast<std::int32_t>(curValue + inc));
-    } else if (_stateValue->isUint32()) {
-        auto curValue = _stateValue->asUint32();
+    } else if (_value.isUint32()) {
+        auto curValue = _value.asUint32();
 
         return this->operator=(static_cast<std::uint32_t>(curValue + inc));
-    } else if (_stateValue->isSint64()) {
-        auto curValue = _stateValue->asSint64();
+    } else if (_value.isSint64()) {
+        auto curValue = _value.asSint64();
 
         return this->operator=(static_cast<std::int64_t>(curValue + inc));
-    } else if (_stateValue->isUint64()) {
-        auto curValue = _stateValue->asUint64();
+    } else if (_value.isUint64()) {
+        auto curValue = _value.asUint64();
 
         return this->operator=(static_cast<std::uint64_t>(curValue + inc));
     }
@@ -432,24 +448,20 @@ StateNode& StateNode::operator+=(std::int64_t inc)
 
 StateNode& StateNode::operator-=(std::int64_t dec)
 {
-    if (!_stateValue) {
-        return *this;
-    }
-
-    if (_stateValue->isSint32()) {
-        auto curValue = _stateValue->asSint32();
+    if (_value.isSint32()) {
+        auto curValue = _value.asSint32();
 
         return this->operator=(static_cast<std::int32_t>(curValue - dec));
-    } else if (_stateValue->isUint32()) {
-        auto curValue = _stateValue->asUint32();
+    } else if (_value.isUint32()) {
+        auto curValue = _value.asUint32();
 
         return this->operator=(static_cast<std::uint32_t>(curValue - dec));
-    } else if (_stateValue->isSint64()) {
-        auto curValue = _stateValue->asSint64();
+    } else if (_value.isSint64()) {
+        auto curValue = _value.asSint64();
 
         return this->operator=(static_cast<std::int64_t>(curValue - dec));
-    } else if (_stateValue->isUint64()) {
-        auto curValue = _stateValue->asUint64();
+    } else if (_value.isUint64()) {
+        auto curValue = _value.asUint64();
 
         return this->operator=(static_cast<std::uint64_t>(curValue - dec));
     }
@@ -464,8 +476,11 @@ void StateNode::acceptUpdate(AbstractStateNodeVisitor& visitor,
     visitor.visitUpdateEnter(quark, *this);
 
     // then my children
-    for (auto& quarkNodePair : _children) {
-        quarkNodePair.second->acceptUpdate(visitor, quarkNodePair.first);
+    for (const auto& child : _children) {
+        if (child.id != StateNodeChildren::NO_NODE) {
+            _stateHistorySink->getNode(child.id).acceptUpdate(visitor,
+                                                               child.quark);
+        }
     }
 
     // leaving
@@ -479,14 +494,37 @@ void StateNode::acceptRead(AbstractStateNodeVisitor& visitor,
     visitor.visitReadEnter(quark, *this);
 
     // then my children
-    for (auto& quarkNodePair : _children) {
-        quarkNodePair.second->acceptRead(visitor, quarkNodePair.first);
+    for (const auto& child : _children) {
+        if (child.id != StateNodeChildren::NO_NODE) {
+            const auto& childNode = _stateHistorySink->getNode(child.id);
+
+            childNode.acceptRead(visitor, child.quark);
+        }
     }
 
     // leaving
     visitor.visitReadLeave(quark, *this);
 }
 
+Quark StateNode::getIntKeyQuark(std::int64_t key) const
+{
+    if (Quark::canHoldInt(key)) {
+        return Quark::fromInt(key);
+    }
+
+    // doesn't fit: use its string instead
+    return _stateHistorySink->getQuark(std::to_string(key));
+}
+
+Quark StateNode::getIntKeyQuark(std::uint64_t key) const
+{
+    if (key <= static_cast<std::uint64_t>(Quark::MAX_INT)) {
+        return Quark::fromInt(static_cast<std::int64_t>(key));
+    }
+
+    return _stateHistorySink->getQuark(std::to_string(key));
+}
+
 void StateNode::writeInterval()
 {
     _stateHistorySink->writeInterval(*this);
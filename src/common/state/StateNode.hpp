@@ -19,13 +19,12 @@
 #define _TIBEE_COMMON_STATENODE_HPP
 
 #include <string>
-#include <memory>
 #include <cstdint>
-#include <unordered_map>
 
 #include <common/BasicTypes.hpp>
 #include <common/state/AbstractStateNodeVisitor.hpp>
 #include <common/state/AbstractStateValue.hpp>
+#include <common/state/StateValue.hpp>
 #include <common/state/Sint32StateValue.hpp>
 #include <common/state/Sint64StateValue.hpp>
 #include <common/state/Uint32StateValue.hpp>
@@ -33,6 +32,7 @@
 #include <common/state/Float32StateValue.hpp>
 #include <common/state/QuarkStateValue.hpp>
 #include <common/state/NullStateValue.hpp>
+#include <common/state/StateNodeChildren.hpp>
 #include <common/state/StateNodeIterator.hpp>
 #include <common/trace/AbstractEventValue.hpp>
 #include <common/trace/StringEventValue.hpp>
@@ -73,9 +73,15 @@ class StateHistorySink;
  * operator[]() returns a reference to an existing child node, creating
  * it if it doesn't exist yet.
  *
+ * State nodes are owned by the state history sink, which stores them
+ * contiguously, indexed by node ID. A node only keeps the IDs of its
+ * children (see StateNodeChildren), so that a state tree of hundreds
+ * of thousands of nodes remains compact and deep lookups don't chase
+ * scattered allocations. A state node reference remains valid as long
+ * as its state history sink is.
+ *
  * @author Philippe Proulx
  */
-#include <memory>
 
 class StateNode :
     boost::noncopyable
@@ -87,9 +93,6 @@ class StateNode :
     friend StateNodeIterator;
 
 public:
-    /// Unique pointer to StateNode
-    typedef std::unique_ptr<StateNode> UP;
-
     /// State node iterator
     typedef StateNodeIterator Iterator;
 
@@ -120,220 +123,156 @@ public:
      * Returns a const reference to the current state value of this
      * node.
      *
-     * If no state value is set yet, returns a null state value const
-     * reference.
-     *
-     * @returns Current state value or null state value const reference
-     */
-    const AbstractStateValue& getValue() const;
-
-    /**
-     * Forwarded to AbstractStateValue::asSint32Value() using this
-     * node's state value.
+     * If no state value is set yet, the returned state value is null.
      *
-     * @see AbstractStateValue::asSint32Value()
+     * @returns Current state value const reference
      */
-    const Sint32StateValue& asSint32Value() const
+    const StateValue& getValue() const
     {
-        return _stateValue->asSint32Value();
+        return _value;
     }
 
     /**
-     * Forwarded to AbstractStateValue::asSint32() using this
+     * Forwarded to StateValue::asSint32() using this
      * node's state value.
      *
-     * @see AbstractStateValue::asSint32()
+     * @see StateValue::asSint32()
      */
     std::int32_t asSint32() const
     {
-        return _stateValue->asSint32();
-    }
-
-    /**
-     * Forwarded to AbstractStateValue::asUint32Value() using this
-     * node's state value.
-     *
-     * @see AbstractStateValue::asUint32Value()
-     */
-    const Uint32StateValue& asUint32Value() const
-    {
-        return _stateValue->asUint32Value();
+        return _value.asSint32();
     }
 
     /**
-     * Forwarded to AbstractStateValue::asUint32() using this
+     * Forwarded to StateValue::asUint32() using this
      * node's state value.
      *
-     * @see AbstractStateValue::asUint32()
+     * @see StateValue::asUint32()
      */
     std::uint32_t asUint32() const
     {
-        return _stateValue->asUint32();
+        return _value.asUint32();
     }
 
     /**
-     * Forwarded to AbstractStateValue::asSint64Value() using this
+     * Forwarded to StateValue::asSint64() using this
      * node's state value.
      *
-     * @see AbstractStateValue::asSint64Value()
-     */
-    const Sint64StateValue& asSint64Value() const
-    {
-        return _stateValue->asSint64Value();
-    }
-
-    /**
-     * Forwarded to AbstractStateValue::asSint64() using this
-     * node's state value.
-     *
-     * @see AbstractStateValue::asSint64()
+     * @see StateValue::asSint64()
      */
     std::int64_t asSint64() const
     {
-        return _stateValue->asSint64();
-    }
-
-    /**
-     * Forwarded to AbstractStateValue::asUint64Value() using this
-     * node's state value.
-     *
-     * @see AbstractStateValue::asUint64Value()
-     */
-    const Uint64StateValue& asUint64Value() const
-    {
-        return _stateValue->asUint64Value();
+        return _value.asSint64();
     }
 
     /**
-     * Forwarded to AbstractStateValue::asUint64() using this
+     * Forwarded to StateValue::asUint64() using this
      * node's state value.
      *
-     * @see AbstractStateValue::asUint64()
+     * @see StateValue::asUint64()
      */
     std::uint64_t asUint64() const
     {
-        return _stateValue->asUint64();
-    }
-
-    /**
-     * Forwarded to AbstractStateValue::asFloat32Value() using this
-     * node's state value.
-     *
-     * @see AbstractStateValue::asFloat32Value()
-     */
-    const Float32StateValue& asFloat32Value() const
-    {
-        return _stateValue->asFloat32Value();
+        return _value.asUint64();
     }
 
     /**
-     * Forwarded to AbstractStateValue::asFloat32() using this
+     * Forwarded to StateValue::asFloat32() using this
      * node's state value.
      *
-     * @see AbstractStateValue::asFloat32()
+     * @see StateValue::asFloat32()
      */
     float asFloat32() const
     {
-        return _stateValue->asFloat32();
+        return _value.asFloat32();
     }
 
     /**
-     * Forwarded to AbstractStateValue::asQuarkValue() using this
+     * Forwarded to StateValue::asQuark() using this
      * node's state value.
      *
-     * @see AbstractStateValue::asQuarkValue()
-     */
-    const QuarkStateValue& asQuarkValue() const
-    {
-        return _stateValue->asQuarkValue();
-    }
-
-    /**
-     * Forwarded to AbstractStateValue::asQuark() using this
-     * node's state value.
-     *
-     * @see AbstractStateValue::asQuark()
+     * @see StateValue::asQuark()
      */
     Quark asQuark() const
     {
-        return _stateValue->asQuark();
+        return _value.asQuark();
     }
 
     /**
-     * Forwarded to AbstractStateValue::isSint32() using this
+     * Forwarded to StateValue::isSint32() using this
      * node's state value.
      *
-     * @see AbstractStateValue::isSint32()
+     * @see StateValue::isSint32()
      */
     bool isSint32() const
     {
-        return _stateValue->isSint32();
+        return _value.isSint32();
     }
 
     /**
-     * Forwarded to AbstractStateValue::isSint64() using this
+     * Forwarded to StateValue::isSint64() using this
      * node's state value.
      *
-     * @see AbstractStateValue::isSint64()
+     * @see StateValue::isSint64()
      */
     bool isSint64() const
     {
-        return _stateValue->isSint64();
+        return _value.isSint64();
     }
 
     /**
-     * Forwarded to AbstractStateValue::isUint32() using this
+     * Forwarded to StateValue::isUint32() using this
      * node's state value.
      *
-     * @see AbstractStateValue::isUint32()
+     * @see StateValue::isUint32()
      */
     bool isUint32() const
     {
-        return _stateValue->isUint32();
+        return _value.isUint32();
     }
 
     /**
-     * Forwarded to AbstractStateValue::isUint64() using this
+     * Forwarded to StateValue::isUint64() using this
      * node's state value.
      *
-     * @see AbstractStateValue::isUint64()
+     * @see StateValue::isUint64()
      */
     bool isUint64() const
     {
-        return _stateValue->isUint64();
+        return _value.isUint64();
     }
 
     /**
-     * Forwarded to AbstractStateValue::isFloat32() using this
+     * Forwarded to StateValue::isFloat32() using this
      * node's state value.
      *
-     * @see AbstractStateValue::isFloat32()
+     * @see StateValue::isFloat32()
      */
     bool isFloat32() const
     {
-        return _stateValue->isFloat32();
+        return _value.isFloat32();
     }
 
     /**
-     * Forwarded to AbstractStateValue::isQuark() using this
+     * Forwarded to StateValue::isQuark() using this
      * node's state value.
      *
-     * @see AbstractStateValue::isQuark()
+     * @see StateValue::isQuark()
      */
     bool isQuark() const
     {
-        return _stateValue->isQuark();
+        return _value.isQuark();
     }
 
     /**
-     * Forwarded to AbstractStateValue::isNull() using this
+     * Forwarded to StateValue::isNull() using this
      * node's state value.
      *
-     * @see AbstractStateValue::isNull()
+     * @see StateValue::isNull()
      */
     bool isNull() const
     {
-        return _stateValue->isNull();
+        return _value.isNull();
     }
 
     /**
@@ -345,7 +284,7 @@ public:
      */
     explicit operator bool() const
     {
-        return !_stateValue->isNull();
+        return !_value.isNull();
     }
 
     /**
@@ -374,14 +313,22 @@ public:
     StateNode& operator[](const char* key);
 
     /**
-     * Convenience method that converts the integer \p key to a string,
-     * gets the quark of this string and calls operator[](Quark)
-     * with the result.
+     * Convenience method that calls operator[](Quark) with the
+     * integer quark of \p key (see Quark::fromInt()): no string
+     * conversion nor string database lookup is performed.
+     *
+     * Integers which don't fit an integer quark (negative or too
+     * large) are converted to a string, and the quark of this string
+     * is used instead.
+     *
+     * Integer keys and string keys are distinct: the child of key 23
+     * is not the child of key "23", although both are named "23" in
+     * the written map of state nodes.
      *
      * @see operator[](Quark)
      *
      * @param key Child key to look up
-     * @returns   Child node with quark of \p key (as a string)
+     * @returns   Child node with key \p key
      */
     StateNode& operator[](std::int64_t key);
 
@@ -401,31 +348,38 @@ public:
     StateNode& operator[](std::uint32_t key);
 
     /**
-     * @see operator[](std::int64_t)
+     * Convenience method that converts the floating point number
+     * \p key to a string, gets the quark of this string and calls
+     * operator[](Quark) with the result.
+     *
+     * @see operator[](Quark)
+     *
+     * @param key Child key to look up
+     * @returns   Child node with quark of \p key (as a string)
      */
     StateNode& operator[](float key);
 
     /**
-     * Convenience method that converts the signed integer event value
-     * \p value to a string, gets the quark of this string and calls
-     * operator[](Quark) with the result.
+     * Convenience method that calls operator[](std::int64_t) or
+     * operator[](std::uint64_t) with the integer value of the
+     * signed integer event value \p value.
      *
-     * @see operator[](Quark)
+     * @see operator[](std::int64_t)
      *
      * @param value Signed integer event value to look up
-     * @returns     Child node with quark of \p value (as a string)
+     * @returns     Child node with key \p value
      */
     StateNode& operator[](const SintEventValue& value);
 
     /**
-     * Convenience method that converts the unsigned integer event value
-     * \p value to a string, gets the quark of this string and calls
-     * operator[](Quark) with the result.
+     * Convenience method that calls operator[](std::int64_t) or
+     * operator[](std::uint64_t) with the integer value of the
+     * unsigned integer event value \p value.
      *
-     * @see operator[](Quark)
+     * @see operator[](std::int64_t)
      *
      * @param value Unsigned integer event value to look up
-     * @returns     Child node with quark of \p value (as a string)
+     * @returns     Child node with key \p value
      */
     StateNode& operator[](const UintEventValue& value);
 
@@ -462,50 +416,50 @@ public:
     StateNode& operator[](const AbstractEventValue& value);
 
     /**
-     * Convenience method that converts the 32-bit signed integer
-     * value of the state value \p value to a string, gets the quark
-     * of this string and calls operator[](Quark) with the result.
+     * Convenience method that calls operator[](std::int64_t) or
+     * operator[](std::uint64_t) with the 32-bit signed integer
+     * value of the state value \p value.
      *
-     * @see operator[](Quark)
+     * @see operator[](std::int64_t)
      *
      * @param value State value containing key
-     * @returns     Child node with quark of \p value (as a string)
+     * @returns     Child node with key \p value
      */
     StateNode& operator[](const Sint32StateValue& value);
 
     /**
-     * Convenience method that converts the 64-bit signed integer
-     * value of the state value \p value to a string, gets the quark
-     * of this string and calls operator[](Quark) with the result.
+     * Convenience method that calls operator[](std::int64_t) or
+     * operator[](std::uint64_t) with the 64-bit signed integer
+     * value of the state value \p value.
      *
-     * @see operator[](Quark)
+     * @see operator[](std::int64_t)
      *
      * @param value State value containing key
-     * @returns     Child node with quark of \p value (as a string)
+     * @returns     Child node with key \p value
      */
     StateNode& operator[](const Sint64StateValue& value);
 
     /**
-     * Convenience method that converts the 32-bit unsigned integer
-     * value of the state value \p value to a string, gets the quark
-     * of this string and calls operator[](Quark) with the result.
+     * Convenience method that calls operator[](std::int64_t) or
+     * operator[](std::uint64_t) with the 32-bit unsigned integer
+     * value of the state value \p value.
      *
-     * @see operator[](Quark)
+     * @see operator[](std::int64_t)
      *
      * @param value State value containing key
-     * @returns     Child node with quark of \p value (as a string)
+     * @returns     Child node with key \p value
      */
     StateNode& operator[](const Uint32StateValue& value);
 
     /**
-     * Convenience method that converts the 64-bit unsigned integer
-     * value of the state value \p value to a string, gets the quark
-     * of this string and calls operator[](Quark) with the result.
+     * Convenience method that calls operator[](std::int64_t) or
+     * operator[](std::uint64_t) with the 64-bit unsigned integer
+     * value of the state value \p value.
      *
-     * @see operator[](Quark)
+     * @see operator[](std::int64_t)
      *
      * @param value State value containing key
-     * @returns     Child node with quark of \p value (as a string)
+     * @returns     Child node with key \p value
      */
     StateNode& operator[](const Uint64StateValue& value);
 
@@ -576,9 +530,9 @@ public:
     bool hasChild(const char* key) const;
 
     /**
-     * Convenience method that converts the signed integer \p key to
-     * a string, gets the quark for this string, calls hasChild(Quark)
-     * and returns this result.
+     * Convenience method that gets the key quark of the signed
+     * integer \p key like operator[](std::int64_t) does, calls
+     * hasChild(Quark) and returns this result.
      *
      * @see hasChild(Quark)
      *
@@ -588,9 +542,9 @@ public:
     bool hasChild(std::int64_t key) const;
 
     /**
-     * Convenience method that converts the unsigned integer \p key to
-     * a string, gets the quark for this string, calls hasChild(Quark)
-     * and returns this result.
+     * Convenience method that gets the key quark of the unsigned
+     * integer \p key like operator[](std::int64_t) does, calls
+     * hasChild(Quark) and returns this result.
      *
      * @see hasChild(Quark)
      *
@@ -600,11 +554,10 @@ public:
     bool hasChild(std::uint64_t key) const;
 
     /**
-     * Convenience method that converts the signed integer event value
-     * \p key to a string, gets the quark of this string, calls
-     * hasChild(Quark) and returns this result.
+     * Convenience method that calls hasChild(std::int64_t) with the
+     * integer value of the signed integer event value \p key.
      *
-     * @see hasChild(Quark)
+     * @see hasChild(std::int64_t)
      *
      * @param key Signed integer event value to look up
      * @returns   True if a child node exists with key \p key
@@ -612,11 +565,10 @@ public:
     bool hasChild(const SintEventValue& key) const;
 
     /**
-     * Convenience method that converts the unsigned integer event value
-     * \p key to a string, gets the quark of this string, calls
-     * hasChild(Quark) and returns this result.
+     * Convenience method that calls hasChild(std::uint64_t) with the
+     * integer value of the unsigned integer event value \p key.
      *
-     * @see hasChild(Quark)
+     * @see hasChild(std::uint64_t)
      *
      * @param key Unsigned integer event value to look up
      * @returns   True if a child node exists with key \p key
@@ -654,6 +606,29 @@ public:
      */
     bool hasChild(const AbstractEventValue& key) const;
 
+    /**
+     * Returns the child node identified by \p quark, or \c nullptr if
+     * there's none. Contrary to operator[](Quark), never creates a
+     * child node; contrary to hasChild(Quark), also returns null
+     * children.
+     *
+     * @param quark Quark to look up
+     * @returns     Child node or \c nullptr if not found
+     */
+    StateNode* getChild(Quark quark);
+
+    /**
+     * Convenience method that gets the key quark of the signed
+     * integer \p key like operator[](std::int64_t) does, calls
+     * getChild(Quark) and returns this result.
+     *
+     * @see getChild(Quark)
+     *
+     * @param key Child key to look up
+     * @returns   Child node or \c nullptr if not found
+     */
+    StateNode* getChild(std::int64_t key);
+
     /**
      * Returns how many children this node has, excluding null children.
      *
@@ -675,24 +650,23 @@ public:
     /**
      * Assigns a state value to this node.
      *
-     * All state values except AbstractStateValue should work here.
-     * There's a specialized method for AbstractStateValue,
-     * operator=(const AbstractStateValue&), which checks the concrete
-     * state value type and calls this method after an appropriate
-     * static cast.
+     * All the other assignment operators end up here. The value is
+     * copied into the node itself: no allocation is performed.
+     *
+     * If the owning state history sink is coalescing (the default) and
+     * \p value is equal to the current value of this node, nothing
+     * happens: the current interval simply goes on.
      *
      * @param value State value to assign
      * @returns     This node
      */
-    template<typename T>
-    StateNode& operator=(const T& value);
+    StateNode& operator=(const StateValue& value);
 
     /**
-     * Assigns a state value to this node.
+     * Assigns a boxed state value to this node.
      *
-     * The type of \p value has to checked in order to cast it to
-     * its proper class type and call the appropriate operator=()
-     * method.
+     * The value of \p value is copied to an inline StateValue and
+     * assigned with operator=(const StateValue&).
      *
      * Should you know the state value type in advance, please call
      * its dedicated operator=() method.
@@ -916,7 +890,14 @@ public:
 
 private:
     /**
-     * Builds a state node.
+     * Builds an unused state node; the state history sink builds
+     * whole chunks of those and initializes them with init() as
+     * needed.
+     */
+    StateNode();
+
+    /**
+     * Initializes this state node.
      *
      * \p stateHistorySink is a (weak) pointer to the owning state
      * history sink, to which most of StateNode's method calls are
@@ -928,20 +909,9 @@ private:
      * @param stateHistorySink Owning state history sink
      * @param beginTs          Initial begin timestamp of this node
      */
-    StateNode(state_node_id_t id, StateHistorySink* stateHistorySink,
+    void init(state_node_id_t id, StateHistorySink* stateHistorySink,
               timestamp_t beginTs);
 
-    /**
-     * Checks if a child node exists at all (be it null or not).
-     *
-     * @param quark Quark of child to look up
-     * @returns     True if the child node with quark \p quark exists at all
-     */
-    bool childExists(quark_t quark) const
-    {
-        return _children.find(quark) != _children.end();
-    }
-
     /**
      * Accepts a visitor \p visitor and makes it visit this node,
      * and then all its children (preorder).
@@ -967,6 +937,8 @@ private:
     static void acceptImpl(T& stateNode, AbstractStateNodeVisitor& visitor,
                            quark_t quark);
 
+    Quark getIntKeyQuark(std::int64_t key) const;
+    Quark getIntKeyQuark(std::uint64_t key) const;
     void writeInterval();
     timestamp_t getCurrentSinkTimestamp();
 
@@ -974,34 +946,19 @@ private:
     // node ID
     state_node_id_t _id;
 
-    // state value
-    AbstractStateValue::UP _stateValue;
+    // state value (inline)
+    StateValue _value;
 
     // current begin timestamp
     timestamp_t _beginTs;
 
-    // children (quark -> state node) map
-    std::unordered_map<quark_t, StateNode::UP> _children;
+    // children (quark -> state node ID) map
+    StateNodeChildren _children;
 
     // owning state history sink
     StateHistorySink* _stateHistorySink;
 };
 
-template<typename T>
-StateNode& StateNode::operator=(const T& value)
-{
-    // write current state as an interval
-    this->writeInterval();
-
-    // update current begin timestamp
-    this->_beginTs = this->getCurrentSinkTimestamp();
-
-    // assign new value
-    this->_stateValue = AbstractStateValue::UP {new T{value}};
-
-    return *this;
-}
-
 }
 }
 
@@ -0,0 +1,128 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include <common/state/StateNodeChildren.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+const state_node_id_t StateNodeChildren::NO_NODE;
+const std::uint32_t StateNodeChildren::LINEAR_MAX;
+
+StateNodeChildren::StateNodeChildren() :
+    _count {0},
+    _capacity {0}
+{
+}
+
+state_node_id_t StateNodeChildren::find(quark_t quark) const
+{
+    if (this->isLinear()) {
+        for (std::uint32_t x = 0; x < _count; ++x) {
+            if (_entries[x].quark == quark) {
+                return _entries[x].id;
+            }
+        }
+
+        return NO_NODE;
+    }
+
+    // probe until we find the quark or an empty slot
+    const auto mask = _capacity - 1;
+
+    for (auto slot = this->getSlot(quark); ; slot = (slot + 1) & mask) {
+        const auto& entry = _entries[slot];
+
+        if (entry.id == NO_NODE || entry.quark == quark) {
+            return entry.id;
+        }
+    }
+}
+
+void StateNodeChildren::insert(quark_t quark, state_node_id_t id)
+{
+    // keep the hash table at most half full
+    if (_count == _capacity || (!this->isLinear() && (_count + 1) * 2 > _capacity)) {
+        this->grow();
+    }
+
+    if (this->isLinear()) {
+        _entries[_count] = {quark, id};
+    } else {
+        this->insertHashed(quark, id);
+    }
+
+    _count++;
+}
+
+void StateNodeChildren::insertHashed(quark_t quark, state_node_id_t id)
+{
+    const auto mask = _capacity - 1;
+    auto slot = this->getSlot(quark);
+
+    while (_entries[slot].id != NO_NODE) {
+        slot = (slot + 1) & mask;
+    }
+
+    _entries[slot] = {quark, id};
+}
+
+void StateNodeChildren::grow()
+{
+    std::uint32_t newCapacity;
+
+    if (_capacity == 0) {
+        newCapacity = 2;
+    } else if (_capacity < LINEAR_MAX) {
+        newCapacity = _capacity * 2;
+    } else {
+        // leaving the linear layout: start with a quarter-full table
+        newCapacity = std::max(_capacity * 2, LINEAR_MAX * 4);
+    }
+
+    auto oldEntries = std::move(_entries);
+    auto oldCapacity = _capacity;
+
+    _entries = std::unique_ptr<Entry[]> {new Entry[newCapacity]};
+    _capacity = newCapacity;
+
+    for (std::uint32_t x = 0; x < newCapacity; ++x) {
+        _entries[x] = {0, NO_NODE};
+    }
+
+    // move existing children to the new table
+    for (std::uint32_t x = 0; x < oldCapacity; ++x) {
+        const auto& entry = oldEntries[x];
+
+        if (entry.id == NO_NODE) {
+            continue;
+        }
+
+        if (this->isLinear()) {
+            _entries[x] = entry;
+        } else {
+            this->insertHashed(entry.quark, entry.id);
+        }
+    }
+}
+
+}
+}
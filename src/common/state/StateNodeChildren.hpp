@@ -0,0 +1,157 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATENODECHILDREN_HPP
+#define _TIBEE_COMMON_STATENODECHILDREN_HPP
+
+#include <memory>
+#include <cstdint>
+#include <cstddef>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Children of a state node: a compact (subpath quark -> node ID) map.
+ *
+ * Most state nodes have only a few children, which are kept in a small
+ * unsorted array and found by a linear scan. Once a node has more than
+ * LINEAR_MAX children (think of the threads node of a Linux state
+ * tree), the array becomes an open addressing hash table with linear
+ * probing.
+ *
+ * Children are never removed (a removed state node is only nullified),
+ * which keeps both layouts trivial.
+ *
+ * Iterating begin() to end() visits all the slots of the table,
+ * including empty ones, of which the node ID is NO_NODE.
+ *
+ * @author Philippe Proulx
+ */
+class StateNodeChildren :
+    boost::noncopyable
+{
+public:
+    /// Node ID of an empty slot
+    static const state_node_id_t NO_NODE = 0xffffffff;
+
+    /// Maximum number of children kept in a linear array
+    static const std::uint32_t LINEAR_MAX = 8;
+
+    /**
+     * One slot of the table.
+     */
+    struct Entry
+    {
+        /// Subpath quark of child node
+        quark_t quark;
+
+        /// Child node ID, or NO_NODE if this slot is empty
+        state_node_id_t id;
+    };
+
+public:
+    /**
+     * Builds an empty children map (no allocation is performed until
+     * the first insertion).
+     */
+    StateNodeChildren();
+
+    /**
+     * Returns the node ID of the child identified by \p quark.
+     *
+     * @param quark Subpath quark of child node to look up
+     * @returns     Child node ID or NO_NODE if there's no such child
+     */
+    state_node_id_t find(quark_t quark) const;
+
+    /**
+     * Adds the child node ID \p id identified by \p quark.
+     *
+     * There must not already be a child identified by \p quark.
+     *
+     * @param quark Subpath quark of child node
+     * @param id    Child node ID
+     */
+    void insert(quark_t quark, state_node_id_t id);
+
+    /**
+     * Returns the number of children.
+     *
+     * @returns Number of children
+     */
+    std::size_t size() const
+    {
+        return _count;
+    }
+
+    /**
+     * Returns a pointer to the first slot of the table.
+     *
+     * @returns First slot
+     */
+    const Entry* begin() const
+    {
+        return _entries.get();
+    }
+
+    /**
+     * Returns a pointer to the slot following the last slot of the
+     * table.
+     *
+     * @returns Slot following the last one
+     */
+    const Entry* end() const
+    {
+        return _entries.get() + _capacity;
+    }
+
+private:
+    bool isLinear() const
+    {
+        return _capacity <= LINEAR_MAX;
+    }
+
+    std::uint32_t getSlot(quark_t quark) const
+    {
+        // multiplicative hashing (odd factor: no collisions within a run of quarks)
+        return (quark * 2654435761u) & (_capacity - 1);
+    }
+
+    void grow();
+    void insertHashed(quark_t quark, state_node_id_t id);
+
+private:
+    // slots
+    std::unique_ptr<Entry[]> _entries;
+
+    // number of children
+    std::uint32_t _count;
+
+    // number of slots (power of two)
+    std::uint32_t _capacity;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATENODECHILDREN_HPP
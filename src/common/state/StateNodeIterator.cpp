@@ -17,16 +17,19 @@
  */
 #include <common/state/StateNode.hpp>
 #include <common/state/StateNodeIterator.hpp>
+#include <common/state/StateHistorySink.hpp>
 
 namespace tibee
 {
 namespace common
 {
 
-StateNodeIterator::StateNodeIterator(const std::unordered_map<quark_t, std::unique_ptr<StateNode>>::iterator& it,
-                                     const std::unordered_map<quark_t, std::unique_ptr<StateNode>>::iterator& end) :
+StateNodeIterator::StateNodeIterator(const StateNodeChildren::Entry* it,
+                                     const StateNodeChildren::Entry* end,
+                                     const StateHistorySink* stateHistorySink) :
     _it {it},
-    _end {end}
+    _end {end},
+    _stateHistorySink {stateHistorySink}
 {
     // increment iterator if the pointed node is marked as removed
     this->findNextValidNode();
@@ -34,7 +37,8 @@ StateNodeIterator::StateNodeIterator(const std::unordered_map<quark_t, std::uniq
 
 StateNodeIterator::StateNodeIterator(const StateNodeIterator& it) :
     _it {it._it},
-    _end {it._end}
+    _end {it._end},
+    _stateHistorySink {it._stateHistorySink}
 {
     this->findNextValidNode();
 }
@@ -43,6 +47,7 @@ StateNodeIterator& StateNodeIterator::operator=(const StateNodeIterator& rhs)
 {
     _it = rhs._it;
     _end = rhs._end;
+    _stateHistorySink = rhs._stateHistorySink;
 
     this->findNextValidNode();
 
@@ -52,12 +57,22 @@ StateNodeIterator& StateNodeIterator::operator=(const StateNodeIterator& rhs)
 void StateNodeIterator::findNextValidNode()
 {
     if (_it != _end) {
-        if (_it->second->isNull()) {
+        if (!this->isValid()) {
             this->operator++();
         }
     }
 }
 
+bool StateNodeIterator::isValid() const
+{
+    // empty slot of the children table?
+    if (_it->id == StateNodeChildren::NO_NODE) {
+        return false;
+    }
+
+    return static_cast<bool>(_stateHistorySink->getNode(_it->id));
+}
+
 StateNodeIterator& StateNodeIterator::StateNodeIterator::operator++()
 {
     ++_it;
@@ -68,7 +83,7 @@ StateNodeIterator& StateNodeIterator::StateNodeIterator::operator++()
      * to be interested into getting it since it has no set value).
      */
     for (; _it != _end; ++_it) {
-        if (*(_it->second)) {
+        if (this->isValid()) {
             return *this;
         }
     }
@@ -91,7 +106,7 @@ bool StateNodeIterator::operator!=(const StateNodeIterator& rhs)
 
 quark_t StateNodeIterator::operator*()
 {
-    return _it->first;
+    return _it->quark;
 }
 
 }
@@ -18,15 +18,17 @@
 #ifndef _TIBEE_COMMON_STATENODEITERATOR_HPP
 #define _TIBEE_COMMON_STATENODEITERATOR_HPP
 
-#include <memory>
 #include <iterator>
 
+#include <common/BasicTypes.hpp>
+#include <common/state/StateNodeChildren.hpp>
+
 namespace tibee
 {
 namespace common
 {
 
-class StateNode;
+class StateHistorySink;
 
 /**
  * A state node iterator.
@@ -46,8 +48,9 @@ class StateNodeIterator :
     >
 {
 public:
-    StateNodeIterator(const std::unordered_map<quark_t, std::unique_ptr<StateNode>>::iterator& it,
-                      const std::unordered_map<quark_t, std::unique_ptr<StateNode>>::iterator& end);
+    StateNodeIterator(const StateNodeChildren::Entry* it,
+                      const StateNodeChildren::Entry* end,
+                      const StateHistorySink* stateHistorySink);
     StateNodeIterator(const StateNodeIterator& it);
 
     StateNodeIterator& operator=(const StateNodeIterator& rhs);
@@ -66,8 +69,12 @@ private:
     void findNextValidNode();
 
 private:
-    std::unordered_map<quark_t, std::unique_ptr<StateNode>>::iterator _it;
-    std::unordered_map<quark_t, std::unique_ptr<StateNode>>::iterator _end;
+    bool isValid() const;
+
+private:
+    const StateNodeChildren::Entry* _it;
+    const StateNodeChildren::Entry* _end;
+    const StateHistorySink* _stateHistorySink;
 };
 
 }
@@ -0,0 +1,190 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cassert>
+#include <memory>
+
+#include <common/state/StatePathHandle.hpp>
+#include <common/state/CurrentState.hpp>
+#include <common/state/StateNode.hpp>
+#include <common/ex/WrongStatePath.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+const std::size_t StatePathHandle::MAX_VARIABLES;
+
+StatePathHandle::StatePathHandle() :
+    _prefixNode {nullptr},
+    _variablesCount {0},
+    _lastKey {0, 0, 0},
+    _lastNode {nullptr}
+{
+}
+
+StatePathHandle::StatePathHandle(CurrentState& state,
+                                 const std::string& pathTemplate) :
+    _template {pathTemplate},
+    _prefixNode {std::addressof(state.getRoot())},
+    _variablesCount {0},
+    _lastKey {0, 0, 0},
+    _lastNode {nullptr}
+{
+    if (pathTemplate.empty()) {
+        // root
+        return;
+    }
+
+    // split path template
+    std::string::size_type begin = 0;
+
+    while (true) {
+        auto end = pathTemplate.find('/', begin);
+
+        if (end == std::string::npos) {
+            end = pathTemplate.size();
+        }
+
+        auto subpath = pathTemplate.substr(begin, end - begin);
+
+        if (subpath.empty()) {
+            throw ex::WrongStatePath {
+                "empty subpath in state path template", pathTemplate
+            };
+        }
+
+        if (subpath == "{int}") {
+            _variablesCount++;
+            _subpaths.push_back({true, Quark {}});
+        } else if (subpath.find_first_of("{}") != std::string::npos) {
+            throw ex::WrongStatePath {
+                "unknown variable subpath \"" + subpath + "\" in state path template",
+                pathTemplate
+            };
+        } else if (_variablesCount == 0) {
+            // still in the constant prefix: descend once and for all
+            _prefixNode = std::addressof((*_prefixNode)[state.getQuark(subpath)]);
+        } else {
+            _subpaths.push_back({false, state.getQuark(subpath)});
+        }
+
+        if (end == pathTemplate.size()) {
+            break;
+        }
+
+        begin = end + 1;
+    }
+
+    if (_variablesCount > StatePathHandle::MAX_VARIABLES) {
+        throw ex::WrongStatePath {
+            "too many variable subpaths in state path template", pathTemplate
+        };
+    }
+}
+
+StateNode& StatePathHandle::getNode()
+{
+    assert(_prefixNode && _variablesCount == 0);
+
+    return *_prefixNode;
+}
+
+StateNode& StatePathHandle::getNode(std::int64_t key)
+{
+    assert(_variablesCount == 1);
+
+    return this->resolve(Key {key, 0, 0});
+}
+
+StateNode& StatePathHandle::getNode(std::int64_t key1, std::int64_t key2)
+{
+    assert(_variablesCount == 2);
+
+    return this->resolve(Key {key1, key2, 0});
+}
+
+StateNode& StatePathHandle::getNode(const VariableKey& key)
+{
+    assert(_variablesCount == 1);
+
+    return this->resolve(Key {key.value, 0, key.isQuark ? 1U : 0U});
+}
+
+StateNode& StatePathHandle::getNode(const VariableKey& key1,
+                                    const VariableKey& key2)
+{
+    assert(_variablesCount == 2);
+
+    auto quarks = (key1.isQuark ? 1U : 0U) | (key2.isQuark ? 2U : 0U);
+
+    return this->resolve(Key {key1.value, key2.value, quarks});
+}
+
+StateNode& StatePathHandle::resolve(const Key& key)
+{
+    assert(_prefixNode);
+
+    if (_lastNode && key == _lastKey) {
+        return *_lastNode;
+    }
+
+    StateNode* node;
+    auto it = _cache.find(key);
+
+    if (it == _cache.end()) {
+        node = std::addressof(this->descend(key));
+        _cache[key] = node;
+    } else {
+        node = it->second;
+    }
+
+    _lastKey = key;
+    _lastNode = node;
+
+    return *node;
+}
+
+StateNode& StatePathHandle::descend(const Key& key) const
+{
+    auto node = _prefixNode;
+    std::size_t variableIndex = 0;
+
+    for (const auto& subpath : _subpaths) {
+        if (subpath.isVariable) {
+            auto varKey = (variableIndex == 0) ? key.first : key.second;
+
+            if (key.quarks & (1U << variableIndex)) {
+                Quark quark {static_cast<quark_t>(varKey)};
+
+                node = std::addressof((*node)[quark]);
+            } else {
+                node = std::addressof((*node)[varKey]);
+            }
+
+            variableIndex++;
+        } else {
+            node = std::addressof((*node)[subpath.quark]);
+        }
+    }
+
+    return *node;
+}
+
+}
+}
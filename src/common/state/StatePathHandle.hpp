@@ -0,0 +1,224 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATEPATHHANDLE_HPP
+#define _TIBEE_COMMON_STATEPATHHANDLE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <utility>
+#include <functional>
+#include <unordered_map>
+
+#include <common/state/Quark.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+class CurrentState;
+class StateNode;
+
+/**
+ * Compiled state path handle.
+ *
+ * A state path handle is built once from a path template, a
+ * slash-separated list of subpaths in which the special subpath
+ * <code>{int}</code> stands for a key given when resolving the handle,
+ * e.g. <code>linux/threads/{int}/status</code>: an integer or, with
+ * VariableKey, a string quark. Constant subpaths are converted to
+ * quarks when the handle is built.
+ *
+ * Resolving a handle returns the state node at the path obtained by
+ * replacing each variable subpath by its key, exactly like a chain of
+ * StateNode::operator[]() calls would. Since state nodes remain valid
+ * for the lifetime of their state history sink, the handle caches
+ * resolved nodes by key: repeated accesses to the same thread or CPU
+ * don't descend the state tree at all.
+ *
+ * A state path handle remains valid as long as the current state it
+ * was built from is.
+ *
+ * @author Philippe Proulx
+ */
+class StatePathHandle
+{
+public:
+    /// Maximum number of variable subpaths in a path template
+    static const std::size_t MAX_VARIABLES = 2;
+
+    /**
+     * Key of a variable subpath: an integer key, like
+     * StateNode::operator[](std::int64_t), or a string key given as
+     * its quark, like StateNode::operator[](Quark).
+     */
+    struct VariableKey
+    {
+        /// Integer key, or quark value if isQuark is true
+        std::int64_t value;
+
+        /// True if value is a quark
+        bool isQuark;
+    };
+
+public:
+    /**
+     * Builds an unusable state path handle, to be assigned later.
+     */
+    StatePathHandle();
+
+    /**
+     * Builds a state path handle, compiling the path template
+     * \p pathTemplate.
+     *
+     * Throws ex::WrongStatePath if the path template is malformed.
+     *
+     * @param state        Current state (must outlive this handle)
+     * @param pathTemplate Path template
+     */
+    StatePathHandle(CurrentState& state, const std::string& pathTemplate);
+
+    /**
+     * Returns the state node of a path template without variable
+     * subpaths.
+     *
+     * @returns State node
+     */
+    StateNode& getNode();
+
+    /**
+     * Returns the state node of a path template with one variable
+     * subpath, replaced by \p key.
+     *
+     * @param key Key of variable subpath
+     * @returns   State node
+     */
+    StateNode& getNode(std::int64_t key);
+
+    /**
+     * Returns the state node of a path template with two variable
+     * subpaths, replaced by \p key1 and \p key2 in this order.
+     *
+     * @param key1 Key of first variable subpath
+     * @param key2 Key of second variable subpath
+     * @returns    State node
+     */
+    StateNode& getNode(std::int64_t key1, std::int64_t key2);
+
+    /**
+     * Returns the state node of a path template with one variable
+     * subpath, replaced by \p key.
+     *
+     * @param key Key of variable subpath
+     * @returns   State node
+     */
+    StateNode& getNode(const VariableKey& key);
+
+    /**
+     * Returns the state node of a path template with two variable
+     * subpaths, replaced by \p key1 and \p key2 in this order.
+     *
+     * @param key1 Key of first variable subpath
+     * @param key2 Key of second variable subpath
+     * @returns    State node
+     */
+    StateNode& getNode(const VariableKey& key1, const VariableKey& key2);
+
+    /**
+     * Returns the number of variable subpaths of the path template.
+     *
+     * @returns Number of variable subpaths
+     */
+    std::size_t getVariablesCount() const
+    {
+        return _variablesCount;
+    }
+
+    /**
+     * Returns the path template of this handle.
+     *
+     * @returns Path template
+     */
+    const std::string& getTemplate() const
+    {
+        return _template;
+    }
+
+private:
+    // keys of both variables (bit n of quarks set: key n is a quark)
+    struct Key
+    {
+        bool operator==(const Key& other) const
+        {
+            return first == other.first && second == other.second &&
+                   quarks == other.quarks;
+        }
+
+        std::int64_t first;
+        std::int64_t second;
+        unsigned int quarks;
+    };
+
+    struct KeyHash
+    {
+        std::size_t operator()(const Key& key) const
+        {
+            auto first = static_cast<std::uint64_t>(key.first);
+            auto second = static_cast<std::uint64_t>(key.second);
+
+            return std::hash<std::uint64_t> {}((first * 31 + second) * 4 + key.quarks);
+        }
+    };
+
+    struct Subpath
+    {
+        bool isVariable;
+        Quark quark;
+    };
+
+private:
+    StateNode& resolve(const Key& key);
+    StateNode& descend(const Key& key) const;
+
+private:
+    // path template
+    std::string _template;
+
+    // node of the constant prefix of the path (up to the first variable)
+    StateNode* _prefixNode;
+
+    // subpaths following the constant prefix
+    std::vector<Subpath> _subpaths;
+
+    // number of variable subpaths
+    std::size_t _variablesCount;
+
+    // resolved nodes (keys -> node)
+    std::unordered_map<Key, StateNode*, KeyHash> _cache;
+
+    // last resolved keys and node (consecutive events often share them)
+    Key _lastKey;
+    StateNode* _lastNode;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATEPATHHANDLE_HPP
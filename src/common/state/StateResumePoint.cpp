@@ -0,0 +1,231 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+#include <boost/filesystem/fstream.hpp>
+
+#include <common/state/StateResumePoint.hpp>
+#include <common/state/StateValueType.hpp>
+#include <common/ex/ResumePoint.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+template<typename T>
+bool readRaw(std::istream& input, T& value)
+{
+    input.read(reinterpret_cast<char*>(&value), sizeof(value));
+
+    return static_cast<bool>(input);
+}
+
+template<typename T>
+void writeRaw(std::ostream& output, const T& value)
+{
+    output.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+}
+
+StateResumePoint::StateResumePoint(timestamp_t ts, std::size_t segment,
+                                   std::size_t changesCount,
+                                   std::uint64_t fingerprint) :
+    _ts {ts},
+    _segment {segment},
+    _changesCount {changesCount},
+    _fingerprint {fingerprint}
+{
+}
+
+void StateResumePoint::save(const bfs::path& path) const
+{
+    // write a temporary file first so that a crash never leaves a partial resume point
+    auto tmpPath = path;
+
+    tmpPath += ".tmp";
+
+    {
+        bfs::ofstream output {tmpPath, std::ios::binary | std::ios::trunc};
+
+        if (!output) {
+            throw ex::ResumePoint {
+                "cannot create resume point file \"" + tmpPath.string() + "\""
+            };
+        }
+
+        Header header {
+            StateResumePoint::MAGIC,
+            StateResumePoint::VERSION,
+            static_cast<std::uint64_t>(_ts),
+            static_cast<std::uint64_t>(_segment),
+            static_cast<std::uint64_t>(_changesCount),
+            _fingerprint,
+            static_cast<std::uint64_t>(_strings.size()),
+            static_cast<std::uint64_t>(_nodes.size())
+        };
+
+        writeRaw(output, header);
+
+        for (const auto& string : _strings) {
+            writeRaw(output, static_cast<std::uint32_t>(string.size()));
+            output.write(string.data(), string.size());
+        }
+
+        for (const auto& node : _nodes) {
+            NodeRecord record {
+                node.parentId,
+                node.key,
+                static_cast<std::uint32_t>(node.value.getType()),
+                0,
+                node.value.getRaw(),
+                static_cast<std::uint64_t>(node.beginTs)
+            };
+
+            writeRaw(output, record);
+        }
+
+        output.flush();
+
+        if (!output) {
+            throw ex::ResumePoint {
+                "cannot write resume point file \"" + tmpPath.string() + "\""
+            };
+        }
+    }
+
+    boost::system::error_code ec;
+
+    bfs::rename(tmpPath, path, ec);
+
+    if (ec) {
+        throw ex::ResumePoint {
+            "cannot write resume point file \"" + path.string() + "\": " +
+            ec.message()
+        };
+    }
+}
+
+StateResumePoint::UP StateResumePoint::load(const bfs::path& path)
+{
+    auto throwCorrupted = [&path] () {
+        throw ex::ResumePoint {
+            "corrupted resume point file \"" + path.string() + "\""
+        };
+    };
+
+    bfs::ifstream input {path, std::ios::binary};
+
+    if (!input) {
+        throw ex::ResumePoint {
+            "cannot open resume point file \"" + path.string() + "\""
+        };
+    }
+
+    Header header;
+
+    if (!readRaw(input, header) || header.magic != StateResumePoint::MAGIC ||
+            header.version != StateResumePoint::VERSION) {
+        throwCorrupted();
+    }
+
+    UP resumePoint {
+        new StateResumePoint {
+            static_cast<timestamp_t>(header.ts),
+            static_cast<std::size_t>(header.segment),
+            static_cast<std::size_t>(header.changesCount),
+            header.fingerprint
+        }
+    };
+
+    // strings
+    std::string string;
+
+    for (std::uint64_t x = 0; x < header.stringsCount; ++x) {
+        std::uint32_t length;
+
+        if (!readRaw(input, length)) {
+            throwCorrupted();
+        }
+
+        string.resize(length);
+
+        if (length > 0 && !input.read(&string[0], length)) {
+            throwCorrupted();
+        }
+
+        resumePoint->addString(string.data(), string.size());
+    }
+
+    // nodes: root first, then parents before their children
+    auto typesCount = static_cast<std::uint32_t>(StateValueType::NUL) + 1;
+
+    for (std::uint64_t id = 0; id < header.nodesCount; ++id) {
+        NodeRecord record;
+
+        if (!readRaw(input, record) || record.type >= typesCount ||
+                record.beginTs > header.ts) {
+            throwCorrupted();
+        }
+
+        if (id == 0) {
+            if (record.parentId != StateResumePoint::NO_PARENT) {
+                throwCorrupted();
+            }
+        } else if (record.parentId >= id) {
+            throwCorrupted();
+        }
+
+        resumePoint->addNode(record.parentId, record.key,
+                             StateValue::fromRaw(static_cast<StateValueType>(record.type),
+                                                 record.value),
+                             static_cast<timestamp_t>(record.beginTs));
+    }
+
+    if (header.nodesCount == 0) {
+        throwCorrupted();
+    }
+
+    return resumePoint;
+}
+
+bool StateResumePoint::readHeader(const bfs::path& path, timestamp_t& ts,
+                                  std::uint64_t& fingerprint)
+{
+    bfs::ifstream input {path, std::ios::binary};
+    Header header;
+
+    if (!input || !readRaw(input, header) ||
+            header.magic != StateResumePoint::MAGIC ||
+            header.version != StateResumePoint::VERSION) {
+        return false;
+    }
+
+    ts = static_cast<timestamp_t>(header.ts);
+    fingerprint = header.fingerprint;
+
+    return true;
+}
+
+}
+}
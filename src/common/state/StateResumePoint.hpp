@@ -0,0 +1,249 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATERESUMEPOINT_HPP
+#define _TIBEE_COMMON_STATERESUMEPOINT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/state/StateValue.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * State history resume point.
+ *
+ * A resume point holds everything a state history sink needs to go on
+ * building a state history from a given timestamp: the string database,
+ * the state tree (parent and key of each node, in node ID order) with
+ * the current value of each node and the begin timestamp of this
+ * value (its interval is still open), the index of the next history
+ * segment to write and the number of state changes logged so far. All
+ * the events up to and including the resume point timestamp were
+ * already processed.
+ *
+ * A resume point also holds an opaque fingerprint of whatever
+ * produced it (state providers and options), so that a build only
+ * resumes with the same configuration.
+ *
+ * @author Philippe Proulx
+ */
+class StateResumePoint :
+    boost::noncopyable
+{
+public:
+    typedef std::unique_ptr<StateResumePoint> UP;
+
+    // state of a node (root has parent ID StateResumePoint::NO_PARENT)
+    struct Node
+    {
+        state_node_id_t parentId;
+        quark_t key;
+        StateValue value;
+        timestamp_t beginTs;
+    };
+
+public:
+    // parent ID of the root node
+    static const state_node_id_t NO_PARENT = 0xffffffff;
+
+public:
+    /**
+     * Builds an empty resume point.
+     *
+     * @param ts           Resume point timestamp
+     * @param segment      Index of the next history segment to write
+     * @param changesCount Number of state changes logged so far
+     * @param fingerprint  Fingerprint of the build configuration
+     */
+    StateResumePoint(timestamp_t ts, std::size_t segment,
+                     std::size_t changesCount, std::uint64_t fingerprint);
+
+    /**
+     * Appends a string to the string database (strings must be added
+     * in quark order).
+     *
+     * @param string String
+     * @param length Length of \p string (bytes)
+     */
+    void addString(const char* string, std::size_t length)
+    {
+        _strings.push_back(std::string {string, length});
+    }
+
+    /**
+     * Appends a node to the state tree (nodes must be added in node
+     * ID order, and parents before their children).
+     *
+     * @param parentId Parent node ID
+     * @param key      Key quark of node within its parent
+     * @param value    Current node value
+     * @param beginTs  Begin timestamp of current node value
+     */
+    void addNode(state_node_id_t parentId, quark_t key, const StateValue& value,
+                 timestamp_t beginTs)
+    {
+        _nodes.push_back({parentId, key, value, beginTs});
+    }
+
+    /**
+     * Saves this resume point to file \p path, atomically replacing
+     * any previous one.
+     *
+     * Throws ex::ResumePoint on error.
+     *
+     * @param path Path of resume point file
+     */
+    void save(const boost::filesystem::path& path) const;
+
+    /**
+     * Loads the resume point file \p path.
+     *
+     * Throws ex::ResumePoint if the file cannot be read or is
+     * corrupted.
+     *
+     * @param path Path of resume point file
+     * @returns    Loaded resume point
+     */
+    static UP load(const boost::filesystem::path& path);
+
+    /**
+     * Reads only the timestamp and the fingerprint of resume point
+     * file \p path.
+     *
+     * @param path        Path of resume point file
+     * @param ts          Resume point timestamp (set on success)
+     * @param fingerprint Build configuration fingerprint (set on success)
+     * @returns           True if \p path is a resume point file
+     */
+    static bool readHeader(const boost::filesystem::path& path,
+                           timestamp_t& ts, std::uint64_t& fingerprint);
+
+    /**
+     * Returns the timestamp of this resume point.
+     *
+     * @returns Resume point timestamp
+     */
+    timestamp_t getTimestamp() const
+    {
+        return _ts;
+    }
+
+    /**
+     * Returns the index of the next history segment to write.
+     *
+     * @returns Next history segment index
+     */
+    std::size_t getSegment() const
+    {
+        return _segment;
+    }
+
+    /**
+     * Returns the number of state changes logged up to this resume
+     * point.
+     *
+     * @returns Number of logged state changes
+     */
+    std::size_t getChangesCount() const
+    {
+        return _changesCount;
+    }
+
+    /**
+     * Returns the fingerprint of the build configuration which saved
+     * this resume point.
+     *
+     * @returns Build configuration fingerprint
+     */
+    std::uint64_t getFingerprint() const
+    {
+        return _fingerprint;
+    }
+
+    /**
+     * Returns the string database, in quark order.
+     *
+     * @returns Strings
+     */
+    const std::vector<std::string>& getStrings() const
+    {
+        return _strings;
+    }
+
+    /**
+     * Returns the nodes of the state tree, in node ID order.
+     *
+     * @returns State tree nodes
+     */
+    const std::vector<Node>& getNodes() const
+    {
+        return _nodes;
+    }
+
+private:
+    // file header
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint64_t ts;
+        std::uint64_t segment;
+        std::uint64_t changesCount;
+        std::uint64_t fingerprint;
+        std::uint64_t stringsCount;
+        std::uint64_t nodesCount;
+    };
+
+    // file node record
+    struct NodeRecord
+    {
+        std::uint32_t parentId;
+        std::uint32_t key;
+        std::uint32_t type;
+        std::uint32_t reserved;
+        std::uint64_t value;
+        std::uint64_t beginTs;
+    };
+
+private:
+    static const std::uint32_t MAGIC = 0x54425250;
+    static const std::uint32_t VERSION = 2;
+
+private:
+    timestamp_t _ts;
+    std::size_t _segment;
+    std::size_t _changesCount;
+    std::uint64_t _fingerprint;
+    std::vector<std::string> _strings;
+    std::vector<Node> _nodes;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATERESUMEPOINT_HPP
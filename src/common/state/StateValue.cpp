@@ -0,0 +1,60 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <common/state/StateValue.hpp>
+#include <common/state/AbstractStateValue.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+StateValue::StateValue(const AbstractStateValue& value) :
+    StateValue {}
+{
+    switch (value.getType()) {
+    case StateValueType::SINT32:
+        *this = StateValue {value.asSint32()};
+        break;
+
+    case StateValueType::UINT32:
+        *this = StateValue {value.asUint32()};
+        break;
+
+    case StateValueType::SINT64:
+        *this = StateValue {value.asSint64()};
+        break;
+
+    case StateValueType::UINT64:
+        *this = StateValue {value.asUint64()};
+        break;
+
+    case StateValueType::FLOAT32:
+        *this = StateValue {value.asFloat32()};
+        break;
+
+    case StateValueType::QUARK:
+        *this = StateValue {value.asQuark()};
+        break;
+
+    case StateValueType::NUL:
+        break;
+    }
+}
+
+}
+}
@@ -0,0 +1,393 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STATEVALUE_HPP
+#define _TIBEE_COMMON_STATEVALUE_HPP
+
+#include <cassert>
+#include <cstdint>
+
+#include <common/BasicTypes.hpp>
+#include <common/state/StateValueType.hpp>
+#include <common/state/AbstractStateValue.hpp>
+#include <common/state/Quark.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Inline state value.
+ *
+ * This is a compact tagged union able to hold any of the types of
+ * StateValueType. Contrary to AbstractStateValue and its subclasses,
+ * it's copied by value, never allocated on the heap, and its accessors
+ * don't need any virtual dispatch: this is what state nodes use to keep
+ * their current value.
+ *
+ * A default-constructed state value is null.
+ *
+ * @author Philippe Proulx
+ */
+class StateValue
+{
+public:
+    /**
+     * Builds a null state value.
+     */
+    StateValue() :
+        _type {StateValueType::NUL}
+    {
+        _u.uint64 = 0;
+    }
+
+    /**
+     * Builds a 32-bit signed integer state value.
+     *
+     * @param value 32-bit signed integer value
+     */
+    explicit StateValue(std::int32_t value) :
+        _type {StateValueType::SINT32}
+    {
+        _u.uint64 = 0;
+        _u.sint32 = value;
+    }
+
+    /**
+     * Builds a 32-bit unsigned integer state value.
+     *
+     * @param value 32-bit unsigned integer value
+     */
+    explicit StateValue(std::uint32_t value) :
+        _type {StateValueType::UINT32}
+    {
+        _u.uint64 = 0;
+        _u.uint32 = value;
+    }
+
+    /**
+     * Builds a 64-bit signed integer state value.
+     *
+     * @param value 64-bit signed integer value
+     */
+    explicit StateValue(std::int64_t value) :
+        _type {StateValueType::SINT64}
+    {
+        _u.sint64 = value;
+    }
+
+    /**
+     * Builds a 64-bit unsigned integer state value.
+     *
+     * @param value 64-bit unsigned integer value
+     */
+    explicit StateValue(std::uint64_t value) :
+        _type {StateValueType::UINT64}
+    {
+        _u.uint64 = value;
+    }
+
+    /**
+     * Builds a 32-bit floating point number state value.
+     *
+     * @param value 32-bit floating point number value
+     */
+    explicit StateValue(float value) :
+        _type {StateValueType::FLOAT32}
+    {
+        _u.uint64 = 0;
+        _u.float32 = value;
+    }
+
+    /**
+     * Builds a quark state value.
+     *
+     * @param value Quark value
+     */
+    explicit StateValue(Quark value) :
+        _type {StateValueType::QUARK}
+    {
+        _u.uint64 = 0;
+        _u.quark = value.get();
+    }
+
+    /**
+     * Builds an inline copy of the boxed state value \p value.
+     *
+     * @param value Boxed state value to copy
+     */
+    explicit StateValue(const AbstractStateValue& value);
+
+    /**
+     * Returns this state value's type.
+     *
+     * @returns State value type
+     */
+    StateValueType getType() const
+    {
+        return _type;
+    }
+
+    /**
+     * Returns the 32-bit signed integer value of this state value.
+     *
+     * No runtime check is performed in release builds, so if the
+     * actual state value type is not StateValueType::SINT32, the
+     * behaviour is undefined.
+     *
+     * @returns This state value as a signed integer
+     */
+    std::int32_t asSint32() const
+    {
+        assert(this->isSint32());
+
+        return _u.sint32;
+    }
+
+    /**
+     * Returns the 32-bit unsigned integer value of this state value.
+     *
+     * @see asSint32()
+     *
+     * @returns This state value as an unsigned integer
+     */
+    std::uint32_t asUint32() const
+    {
+        assert(this->isUint32());
+
+        return _u.uint32;
+    }
+
+    /**
+     * Returns the 64-bit signed integer value of this state value.
+     *
+     * @see asSint32()
+     *
+     * @returns This state value as a signed integer
+     */
+    std::int64_t asSint64() const
+    {
+        assert(this->isSint64());
+
+        return _u.sint64;
+    }
+
+    /**
+     * Returns the 64-bit unsigned integer value of this state value.
+     *
+     * @see asSint32()
+     *
+     * @returns This state value as an unsigned integer
+     */
+    std::uint64_t asUint64() const
+    {
+        assert(this->isUint64());
+
+        return _u.uint64;
+    }
+
+    /**
+     * Returns the 32-bit floating point number value of this state
+     * value.
+     *
+     * @see asSint32()
+     *
+     * @returns This state value as a floating point number
+     */
+    float asFloat32() const
+    {
+        assert(this->isFloat32());
+
+        return _u.float32;
+    }
+
+    /**
+     * Returns the quark value of this state value.
+     *
+     * @see asSint32()
+     *
+     * @returns This state value as a quark
+     */
+    Quark asQuark() const
+    {
+        assert(this->isQuark());
+
+        return Quark {_u.quark};
+    }
+
+    /**
+     * Returns whether or not this is a 32-bit signed integer
+     * state value.
+     *
+     * @returns True if this is a 32-bit signed integer state value
+     */
+    bool isSint32() const
+    {
+        return _type == StateValueType::SINT32;
+    }
+
+    /**
+     * Returns whether or not this is a 64-bit signed integer
+     * state value.
+     *
+     * @returns True if this is a 64-bit signed integer state value
+     */
+    bool isSint64() const
+    {
+        return _type == StateValueType::SINT64;
+    }
+
+    /**
+     * Returns whether or not this is a 32-bit unsigned integer
+     * state value.
+     *
+     * @returns True if this is a 32-bit unsigned integer state value
+     */
+    bool isUint32() const
+    {
+        return _type == StateValueType::UINT32;
+    }
+
+    /**
+     * Returns whether or not this is a 64-bit unsigned integer
+     * state value.
+     *
+     * @returns True if this is a 64-bit unsigned integer state value
+     */
+    bool isUint64() const
+    {
+        return _type == StateValueType::UINT64;
+    }
+
+    /**
+     * Returns whether or not this is a 32-bit floating point number
+     * state value.
+     *
+     * @returns True if this is a 32-bit floating point number state value
+     */
+    bool isFloat32() const
+    {
+        return _type == StateValueType::FLOAT32;
+    }
+
+    /**
+     * Returns whether or not this is a quark state value.
+     *
+     * @returns True if this is a quark state value
+     */
+    bool isQuark() const
+    {
+        return _type == StateValueType::QUARK;
+    }
+
+    /**
+     * Returns whether or not this state value is null.
+     *
+     * @returns True if this is a null state value
+     */
+    bool isNull() const
+    {
+        return _type == StateValueType::NUL;
+    }
+
+    /**
+     * Not isNull().
+     *
+     * @see isNull()
+     *
+     * @returns True if this state value is not null
+     */
+    explicit operator bool() const
+    {
+        return !this->isNull();
+    }
+
+    /**
+     * Returns the raw bits of this state value (0 if null).
+     *
+     * Together with getType(), this is enough to serialize this
+     * state value and rebuild it later with fromRaw().
+     *
+     * @returns Raw bits of this state value
+     */
+    std::uint64_t getRaw() const
+    {
+        return _u.uint64;
+    }
+
+    /**
+     * Rebuilds a state value from its type and raw bits, as returned
+     * by getType() and getRaw().
+     *
+     * @param type Type of state value
+     * @param raw  Raw bits of state value
+     * @returns    Rebuilt state value
+     */
+    static StateValue fromRaw(StateValueType type, std::uint64_t raw)
+    {
+        StateValue value;
+
+        value._type = type;
+        value._u.uint64 = raw;
+
+        return value;
+    }
+
+    /**
+     * Compares two state values.
+     *
+     * Two state values are equal if they have the same type and the
+     * same bits (two null state values are equal).
+     *
+     * @param rhs Other state value to compare
+     * @returns   True if both state values are equal
+     */
+    bool operator==(const StateValue& rhs) const
+    {
+        return _type == rhs._type && _u.uint64 == rhs._u.uint64;
+    }
+
+    /**
+     * Not operator==(const StateValue&).
+     *
+     * @see operator==(const StateValue&)
+     */
+    bool operator!=(const StateValue& rhs) const
+    {
+        return !(*this == rhs);
+    }
+
+private:
+    // actual value, according to _type (unused bytes are always 0)
+    union {
+        std::int32_t sint32;
+        std::uint32_t uint32;
+        std::int64_t sint64;
+        std::uint64_t uint64;
+        float float32;
+        quark_t quark;
+    } _u;
+
+    // type of value
+    StateValueType _type;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STATEVALUE_HPP
@@ -0,0 +1,153 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstring>
+
+#include <common/state/StringInterner.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+// empty hash table slot
+const quark_t NO_QUARK = 0xffffffff;
+
+// initial number of hash table slots (power of two)
+const std::size_t INITIAL_TABLE_SIZE = 1024;
+
+// size of a string arena chunk
+const std::size_t CHUNK_SIZE = 64 * 1024;
+
+}
+
+StringInterner::StringInterner() :
+    _chunkAt {nullptr},
+    _chunkLeft {0}
+{
+    _table.resize(INITIAL_TABLE_SIZE, NO_QUARK);
+}
+
+std::uint32_t StringInterner::hash(const char* str, std::size_t length)
+{
+    // 32-bit FNV-1a
+    std::uint32_t hash = 2166136261u;
+
+    for (std::size_t x = 0; x < length; ++x) {
+        hash ^= static_cast<unsigned char>(str[x]);
+        hash *= 16777619u;
+    }
+
+    return hash;
+}
+
+quark_t StringInterner::intern(const char* str, std::size_t length)
+{
+    auto strHash = StringInterner::hash(str, length);
+    auto mask = _table.size() - 1;
+
+    // find existing string or first empty slot
+    auto slot = strHash & mask;
+
+    while (_table[slot] != NO_QUARK) {
+        const auto& entry = _entries[_table[slot]];
+
+        if (entry.hash == strHash && entry.length == length &&
+                std::memcmp(entry.str, str, length) == 0) {
+            return _table[slot];
+        }
+
+        slot = (slot + 1) & mask;
+    }
+
+    // not found: intern it
+    auto quark = static_cast<quark_t>(_entries.size());
+
+    _entries.push_back({
+        this->store(str, length),
+        static_cast<std::uint32_t>(length),
+        strHash
+    });
+    _table[slot] = quark;
+
+    // keep the hash table at most half full
+    if (_entries.size() * 2 > _table.size()) {
+        this->growTable();
+    }
+
+    return quark;
+}
+
+const char* StringInterner::store(const char* str, std::size_t length)
+{
+    auto size = length + 1;
+    char* dst;
+
+    if (size > CHUNK_SIZE / 4) {
+        // large string: dedicated chunk, keep filling the current one
+        _chunks.push_back(std::unique_ptr<char[]> {new char[size]});
+        dst = _chunks.back().get();
+    } else {
+        if (size > _chunkLeft) {
+            _chunks.push_back(std::unique_ptr<char[]> {new char[CHUNK_SIZE]});
+            _chunkAt = _chunks.back().get();
+            _chunkLeft = CHUNK_SIZE;
+        }
+
+        dst = _chunkAt;
+        _chunkAt += size;
+        _chunkLeft -= size;
+    }
+
+    std::memcpy(dst, str, length);
+    dst[length] = '\0';
+
+    return dst;
+}
+
+void StringInterner::growTable()
+{
+    std::vector<quark_t> table(_table.size() * 2, NO_QUARK);
+    auto mask = table.size() - 1;
+
+    for (quark_t quark = 0; quark < _entries.size(); ++quark) {
+        auto slot = _entries[quark].hash & mask;
+
+        while (table[slot] != NO_QUARK) {
+            slot = (slot + 1) & mask;
+        }
+
+        table[slot] = quark;
+    }
+
+    _table = std::move(table);
+}
+
+void StringInterner::clear()
+{
+    _entries.clear();
+    _table.assign(INITIAL_TABLE_SIZE, NO_QUARK);
+    _chunks.clear();
+    _chunkAt = nullptr;
+    _chunkLeft = 0;
+}
+
+}
+}
@@ -0,0 +1,155 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STRINGINTERNER_HPP
+#define _TIBEE_COMMON_STRINGINTERNER_HPP
+
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * String interner: assigns a unique quark to each distinct string.
+ *
+ * Quarks are assigned in insertion order, starting at 0, so that
+ * getting the string of a quark is a mere vector access. Interned
+ * strings are copied, null-terminated, into large contiguous chunks
+ * which are never moved nor freed before clear() is called; returned
+ * string pointers therefore remain valid until then.
+ *
+ * Lookups take a pointer and a length, so that callers having a C
+ * string (event field, event name, string literal) never need to
+ * build a temporary std::string. Each string's hash is computed once
+ * and kept next to it to avoid most comparisons when probing the
+ * open addressing hash table.
+ *
+ * @author Philippe Proulx
+ */
+class StringInterner :
+    boost::noncopyable
+{
+public:
+    /**
+     * Builds an empty string interner.
+     */
+    StringInterner();
+
+    /**
+     * Returns the quark of the string \p str of length \p length,
+     * interning it first if needed.
+     *
+     * @param str    String (does not need to be null-terminated)
+     * @param length Length of \p str, in bytes
+     * @returns      Quark of \p str
+     */
+    quark_t intern(const char* str, std::size_t length);
+
+    /**
+     * Returns whether or not \p quark is the quark of an interned
+     * string.
+     *
+     * @param quark Quark to check
+     * @returns     True if \p quark is known
+     */
+    bool hasQuark(quark_t quark) const
+    {
+        return quark < _entries.size();
+    }
+
+    /**
+     * Returns the null-terminated string associated with quark
+     * \p quark, which must be known (see hasQuark()).
+     *
+     * @param quark Quark
+     * @returns     Interned string
+     */
+    const char* getString(quark_t quark) const
+    {
+        return _entries[quark].str;
+    }
+
+    /**
+     * Returns the length, in bytes, of the string associated with
+     * quark \p quark, which must be known (see hasQuark()).
+     *
+     * @param quark Quark
+     * @returns     Length of interned string
+     */
+    std::size_t getLength(quark_t quark) const
+    {
+        return _entries[quark].length;
+    }
+
+    /**
+     * Returns the number of interned strings, which is also the
+     * next quark to be assigned.
+     *
+     * @returns Number of interned strings
+     */
+    std::size_t size() const
+    {
+        return _entries.size();
+    }
+
+    /**
+     * Forgets all interned strings and frees the arena.
+     */
+    void clear();
+
+private:
+    struct Entry
+    {
+        const char* str;
+        std::uint32_t length;
+        std::uint32_t hash;
+    };
+
+private:
+    static std::uint32_t hash(const char* str, std::size_t length);
+    const char* store(const char* str, std::size_t length);
+    void growTable();
+
+private:
+    // interned strings (quark -> entry)
+    std::vector<Entry> _entries;
+
+    // open addressing hash table of quarks (NO_QUARK: empty slot)
+    std::vector<quark_t> _table;
+
+    // string arena chunks
+    std::vector<std::unique_ptr<char[]>> _chunks;
+
+    // next free byte of the current chunk
+    char* _chunkAt;
+
+    // number of free bytes left in the current chunk
+    std::size_t _chunkLeft;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STRINGINTERNER_HPP
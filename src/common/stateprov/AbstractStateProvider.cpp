@@ -18,6 +18,8 @@
 #include <boost/regex.hpp>
 
 #include <common/stateprov/AbstractStateProvider.hpp>
+#include <common/stateprov/EventDispatchTable.hpp>
+#include <common/utils/Tsc.hpp>
 
 namespace tibee
 {
@@ -26,6 +28,7 @@ namespace common
 
 AbstractStateProvider::AbstractStateProvider(const StateProviderConfig& config) :
     _curTraceSet {nullptr},
+    _profiling {false},
     _config {config}
 {
 }
@@ -74,6 +77,124 @@ bool AbstractStateProvider::onEvent(CurrentState& state,
     return true;
 }
 
+void AbstractStateProvider::addSubscribedEvents(EventFilter& filter) const
+{
+    for (const auto& traceIdCallbackMapPair : _infamousMap) {
+        for (const auto& eventIdCallbackPair : traceIdCallbackMapPair.second) {
+            if (eventIdCallbackPair.second) {
+                filter.add(traceIdCallbackMapPair.first,
+                           eventIdCallbackPair.first);
+            }
+        }
+    }
+}
+
+void AbstractStateProvider::addEventCallbacks(EventDispatchTable& table)
+{
+    _profiles.clear();
+    _profileIndexes.clear();
+
+    if (!_profiling) {
+        this->addUnprofiledEventCallbacks(table);
+
+        return;
+    }
+
+    for (const auto& traceIdCallbackMapPair : _infamousMap) {
+        auto traceId = traceIdCallbackMapPair.first;
+
+        for (const auto& eventIdCallbackPair : traceIdCallbackMapPair.second) {
+            if (!eventIdCallbackPair.second) {
+                continue;
+            }
+
+            auto eventId = eventIdCallbackPair.first;
+            auto index = _profiles.size();
+
+            _profileIndexes[traceId][eventId] = index;
+            _profiles.push_back({
+                traceId,
+                eventId,
+                this->getEventName(traceId, eventId),
+                0, 0, 0
+            });
+
+            /* Wrap the callback: the profile is found by index since
+             * _profiles may grow while we're adding callbacks.
+             */
+            auto callback = eventIdCallbackPair.second;
+
+            table.add(traceId, eventId,
+                      [this, index, callback] (CurrentState& state, const Event& event) {
+                auto changesBefore = state.getStateChangesCount();
+                auto tscBefore = readTsc();
+                auto ret = callback(state, event);
+                auto& profile = _profiles[index];
+
+                profile.cycles += readTsc() - tscBefore;
+                profile.stateChanges += state.getStateChangesCount() - changesBefore;
+                profile.calls++;
+
+                return ret;
+            });
+        }
+    }
+}
+
+void AbstractStateProvider::addUnprofiledEventCallbacks(EventDispatchTable& table) const
+{
+    for (const auto& traceIdCallbackMapPair : _infamousMap) {
+        for (const auto& eventIdCallbackPair : traceIdCallbackMapPair.second) {
+            if (eventIdCallbackPair.second) {
+                table.add(traceIdCallbackMapPair.first,
+                          eventIdCallbackPair.first,
+                          eventIdCallbackPair.second);
+            }
+        }
+    }
+}
+
+void AbstractStateProvider::addProfileCycles(const Event& event,
+                                             std::uint64_t cycles)
+{
+    if (!_profiling) {
+        return;
+    }
+
+    auto eventIdIndexMapIt = _profileIndexes.find(event.getTraceId());
+
+    if (eventIdIndexMapIt == _profileIndexes.end()) {
+        return;
+    }
+
+    auto indexIt = eventIdIndexMapIt->second.find(event.getId());
+
+    if (indexIt != eventIdIndexMapIt->second.end()) {
+        _profiles[indexIt->second].cycles += cycles;
+    }
+}
+
+std::string AbstractStateProvider::getEventName(trace_id_t traceId,
+                                               event_id_t eventId) const
+{
+    if (_curTraceSet) {
+        for (const auto& traceInfos : _curTraceSet->getTracesInfos()) {
+            if (traceInfos->getId() != traceId) {
+                continue;
+            }
+
+            for (const auto& eventNameInfosPair : *traceInfos->getEventMap()) {
+                if (eventNameInfosPair.second->getId() == eventId) {
+                    return eventNameInfosPair.first;
+                }
+            }
+        }
+    }
+
+    // unknown event: at least make it unique
+    return "#" + std::to_string(eventId);
+}
+
 void AbstractStateProvider::onFini(CurrentState& state)
 {
     this->onFiniImpl(state);
@@ -88,6 +209,12 @@ void AbstractStateProvider::onInitImpl(CurrentState& state,
     // implemented here so that it's not mandatory for concrete providers
 }
 
+void AbstractStateProvider::onBatchImpl(CurrentState& state,
+                                        const EventBatch& batch)
+{
+    // implemented here so that it's not mandatory for concrete providers
+}
+
 void AbstractStateProvider::onFiniImpl(CurrentState& state)
 {
     // implemented here so that it's not mandatory for concrete providers
@@ -19,14 +19,19 @@
 #define _TIBEE_COMMON_ABSTRACTSTATEPROVIDER_HPP
 
 #include <boost/utility.hpp>
+#include <cstdint>
 #include <functional>
 #include <memory>
+#include <string>
 #include <unordered_map>
+#include <vector>
 
 #include <common/BasicTypes.hpp>
 #include <common/state/CurrentState.hpp>
 #include <common/stateprov/StateProviderConfig.hpp>
 #include <common/trace/Event.hpp>
+#include <common/trace/EventBatch.hpp>
+#include <common/trace/EventFilter.hpp>
 #include <common/trace/TraceSet.hpp>
 
 namespace tibee
@@ -34,6 +39,8 @@ namespace tibee
 namespace common
 {
 
+class EventDispatchTable;
+
 /**
  * An abstract state provider. Any state provider must inherit
  * this class.
@@ -50,6 +57,50 @@ public:
     /// On event function
     typedef std::function<bool (CurrentState& state, const Event& event)> OnEventFunc;
 
+    /// On event function receiving an opaque context
+    typedef bool (*OnEventContextFunc)(void* context, CurrentState& state,
+                                       const Event& event);
+
+    /**
+     * Event callback calling an OnEventContextFunc with its context.
+     *
+     * Wrap it in an OnEventFunc to register it: EventDispatchTable
+     * then calls the function directly.
+     */
+    struct ContextEventCallback
+    {
+        bool operator()(CurrentState& state, const Event& event) const
+        {
+            return func(context, state, event);
+        }
+
+        // function and its context
+        OnEventContextFunc func;
+        void* context;
+    };
+
+    /// Profile of the event callback of one event type
+    struct CallbackProfile
+    {
+        // trace and event IDs
+        trace_id_t traceId;
+        event_id_t eventId;
+
+        // event name
+        std::string eventName;
+
+        // number of calls
+        std::uint64_t calls;
+
+        /* cumulative time stamp counter cycles spent in the callback
+         * (and for this event type in onBatch(), see addProfileCycles())
+         */
+        std::uint64_t cycles;
+
+        // number of state changes made by the callback
+        std::uint64_t stateChanges;
+    };
+
 public:
     /**
      * Builds a state provider.
@@ -77,6 +128,19 @@ public:
      */
     bool onEvent(CurrentState& state, const Event& event);
 
+    /**
+     * Called with each batch of events, before its events are
+     * dispatched one by one to the registered event callbacks (see
+     * addEventCallbacks()).
+     *
+     * @param state Current state
+     * @param batch Batch of events about to be dispatched
+     */
+    void onBatch(CurrentState& state, const EventBatch& batch)
+    {
+        this->onBatchImpl(state, batch);
+    }
+
     /**
      * Called after having processed all events.
      *
@@ -84,6 +148,70 @@ public:
      */
     void onFini(CurrentState& state);
 
+    /**
+     * Adds all the events for which a callback is registered to
+     * \p filter.
+     *
+     * Only meaningful between onInit() and onFini(), since event
+     * callbacks are registered during onInit().
+     *
+     * @param filter Event filter to which to add subscribed events
+     */
+    void addSubscribedEvents(EventFilter& filter) const;
+
+    /**
+     * Adds all the registered event callbacks to \p table, so that
+     * events may be dispatched to several state providers at once
+     * instead of calling onEvent() for each of them.
+     *
+     * If profiling is enabled (see setProfiling()), the added
+     * callbacks are wrapped so as to fill the profiles returned by
+     * getCallbackProfiles(), which are reset. Callbacks added by a
+     * previous call refer to those profiles by index: they must be
+     * removed from their table (EventDispatchTable::clear()) before
+     * calling this again.
+     *
+     * Only meaningful between onInit() and onFini(), since event
+     * callbacks are registered during onInit().
+     *
+     * @param table Event dispatch table to which to add callbacks
+     */
+    void addEventCallbacks(EventDispatchTable& table);
+
+    /**
+     * Enables or disables the profiling of the event callbacks added
+     * by addEventCallbacks() (disabled by default).
+     *
+     * @param profiling True to enable profiling
+     */
+    void setProfiling(bool profiling)
+    {
+        _profiling = profiling;
+    }
+
+    /**
+     * Returns whether or not the event callbacks are profiled.
+     *
+     * @returns True if profiling is enabled
+     */
+    bool isProfiling() const
+    {
+        return _profiling;
+    }
+
+    /**
+     * Returns the profiles of the event callbacks added by the last
+     * call to addEventCallbacks(), one per (trace, event type) pair.
+     *
+     * Empty if profiling is disabled.
+     *
+     * @returns Event callback profiles
+     */
+    const std::vector<CallbackProfile>& getCallbackProfiles() const
+    {
+        return _profiles;
+    }
+
     /**
      * Returns this state provider's configuration.
      *
@@ -163,6 +291,29 @@ protected:
                                     const std::string& eventNameRe,
                                     const OnEventFunc& onEvent);
 
+    /**
+     * Same as addEventCallbacks(), but never profiles the added
+     * callbacks, for concrete state providers dispatching events to
+     * their own callbacks.
+     *
+     * @param table Event dispatch table to which to add callbacks
+     */
+    void addUnprofiledEventCallbacks(EventDispatchTable& table) const;
+
+    /**
+     * Charges \p cycles time stamp counter cycles to the profile of
+     * the event callback of \p event, for concrete state providers
+     * handling events outside of their callbacks (e.g. in
+     * onBatchImpl()).
+     *
+     * Does nothing if profiling is disabled or if there's no
+     * callback for \p event.
+     *
+     * @param event  Event for which cycles were spent
+     * @param cycles Time stamp counter cycles to charge
+     */
+    void addProfileCycles(const Event& event, std::uint64_t cycles);
+
 private:
     /**
      * Optional initialization implementation for a concrete state
@@ -182,6 +333,20 @@ private:
     virtual void onInitImpl(CurrentState& state,
                             const TraceSet* traceSet);
 
+    /**
+     * Optional batch preparation implementation for a concrete state
+     * provider.
+     *
+     * Internally called by onBatch(), this lets the implementor
+     * process a whole batch of events at once (the state changes
+     * still need to be applied by the event callbacks, when each
+     * event is dispatched, so that they get the right timestamp).
+     *
+     * @param state Current state
+     * @param batch Batch of events about to be dispatched
+     */
+    virtual void onBatchImpl(CurrentState& state, const EventBatch& batch);
+
     /**
      * Optional finalization implementation for a concrete state
      * provider.
@@ -208,6 +373,16 @@ private:
     static bool namesMatchSimple(const std::string& asked,
                                  const std::string& candidate);
 
+    /**
+     * Returns the name of event \p eventId of trace \p traceId within
+     * the current trace set.
+     *
+     * @param traceId Trace ID
+     * @param eventId Event ID
+     * @returns       Event name
+     */
+    std::string getEventName(trace_id_t traceId, event_id_t eventId) const;
+
 private:
     // (event ID -> event callback) map
     typedef std::unordered_map<event_id_t, OnEventFunc> EventIdCallbackMap;
@@ -215,6 +390,9 @@ private:
     // (trace ID -> (event ID -> event callback)) map
     typedef std::unordered_map<trace_id_t, EventIdCallbackMap> TraceIdEventIdCallbackMap;
 
+    // (trace ID -> (event ID -> index in _profiles)) map
+    typedef std::unordered_map<trace_id_t, std::unordered_map<event_id_t, std::size_t>> ProfileIndexMap;
+
 private:
     // master event callback map for this state provider
     TraceIdEventIdCallbackMap _infamousMap;
@@ -222,6 +400,15 @@ private:
     // current trace set, valid between onInit() and onFini() incl.
     const TraceSet* _curTraceSet;
 
+    // true to profile event callbacks
+    bool _profiling;
+
+    // event callback profiles
+    std::vector<CallbackProfile> _profiles;
+
+    // profile of each (trace ID, event ID) pair
+    ProfileIndexMap _profileIndexes;
+
     // configuration
     StateProviderConfig _config;
 };
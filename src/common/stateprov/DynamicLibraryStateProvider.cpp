@@ -34,7 +34,8 @@ namespace common
 DynamicLibraryStateProvider::DynamicLibraryStateProvider(const bfs::path& path,
                                                          const StateProviderConfig& config) :
     AbstractStateProviderFile {path, config},
-    _dlHandle {nullptr}
+    _dlHandle {nullptr},
+    _context {nullptr}
 {
     // try loading the dynamic library
     _dlHandle = ::dlopen(path.string().c_str(), RTLD_NOW);
@@ -54,6 +55,10 @@ DynamicLibraryStateProvider::DynamicLibraryStateProvider(const bfs::path& path,
     _dlOnFini = reinterpret_cast<decltype(_dlOnFini)>(
         ::dlsym(_dlHandle, DynamicLibraryStateProvider::ON_FINI_SYMBOL_NAME())
     );
+
+    _dlOnFiniContext = reinterpret_cast<decltype(_dlOnFiniContext)>(
+        ::dlsym(_dlHandle, DynamicLibraryStateProvider::ON_FINI_CONTEXT_SYMBOL_NAME())
+    );
 }
 
 std::string DynamicLibraryStateProvider::getErrorMsg(const std::string& base)
@@ -79,6 +84,17 @@ DynamicLibraryStateProvider::~DynamicLibraryStateProvider()
 void DynamicLibraryStateProvider::onInitImpl(CurrentState& state,
                                              const TraceSet* traceSet)
 {
+    /* A previous run without onFini() (interrupted build) may have
+     * left its context: free it before the library sets a new one.
+     */
+    if (_context) {
+        if (_dlOnFiniContext) {
+            _dlOnFiniContext(state, _context);
+        }
+
+        _context = nullptr;
+    }
+
     if (_dlOnInit) {
         // build temporary state provider adapter
         DynamicLibraryStateProvider::Adapter adapter {this};
@@ -90,10 +106,18 @@ void DynamicLibraryStateProvider::onInitImpl(CurrentState& state,
 
 void DynamicLibraryStateProvider::onFiniImpl(CurrentState& state)
 {
-    if (_dlOnFini) {
-        // delegate
+    /* Libraries built before instance contexts export
+     * onFini(CurrentState&): only pass the context to the newer
+     * onFiniContext() symbol.
+     */
+    if (_dlOnFiniContext) {
+        // delegate (also frees the context)
+        _dlOnFiniContext(state, _context);
+    } else if (_dlOnFini) {
         _dlOnFini(state);
     }
+
+    _context = nullptr;
 }
 
 DynamicLibraryStateProvider::Adapter::Adapter(DynamicLibraryStateProvider* stateProvider) :
@@ -101,6 +125,16 @@ DynamicLibraryStateProvider::Adapter::Adapter(DynamicLibraryStateProvider* state
 {
 }
 
+void DynamicLibraryStateProvider::Adapter::setContext(void* context)
+{
+    _stateProvider->_context = context;
+}
+
+void* DynamicLibraryStateProvider::Adapter::getContext() const
+{
+    return _stateProvider->_context;
+}
+
 bool DynamicLibraryStateProvider::Adapter::registerEventCallback(const std::string& traceType,
                                                                  const std::string& eventName,
                                                                  const OnEventFunc& onEvent)
@@ -108,6 +142,18 @@ bool DynamicLibraryStateProvider::Adapter::registerEventCallback(const std::stri
     return _stateProvider->registerEventCallback(traceType, eventName, onEvent);
 }
 
+bool DynamicLibraryStateProvider::Adapter::registerEventCallback(const std::string& traceType,
+                                                                 const std::string& eventName,
+                                                                 OnEventContextFunc onEvent)
+{
+    AbstractStateProvider::ContextEventCallback callback {
+        onEvent,
+        _stateProvider->_context
+    };
+
+    return _stateProvider->registerEventCallback(traceType, eventName, callback);
+}
+
 bool DynamicLibraryStateProvider::Adapter::registerEventCallbackRegex(const std::string& traceType,
                                                                       const std::string& eventName,
                                                                       const OnEventFunc& onEvent)
@@ -115,6 +161,18 @@ bool DynamicLibraryStateProvider::Adapter::registerEventCallbackRegex(const std:
     return _stateProvider->registerEventCallbackRegex(traceType, eventName, onEvent);
 }
 
+bool DynamicLibraryStateProvider::Adapter::registerEventCallbackRegex(const std::string& traceType,
+                                                                      const std::string& eventName,
+                                                                      OnEventContextFunc onEvent)
+{
+    AbstractStateProvider::ContextEventCallback callback {
+        onEvent,
+        _stateProvider->_context
+    };
+
+    return _stateProvider->registerEventCallbackRegex(traceType, eventName, callback);
+}
+
 const StateProviderConfig& DynamicLibraryStateProvider::Adapter::getConfig() const
 {
     return _stateProvider->getConfig();
@@ -34,6 +34,21 @@ namespace common
  * A state provider which loads a dynamic library, finds specific
  * symbols and call them to obtain state informations.
  *
+ * The library may export:
+ *
+ *   - <code>void onInit(CurrentState&, const TraceSet*, Adapter&)</code>
+ *   - <code>void onFiniContext(CurrentState&, void* context)</code>
+ *   - <code>void onFini(CurrentState&)</code> (only called if
+ *     onFiniContext() isn't exported)
+ *
+ * The same library may be loaded by more than one provider instance,
+ * in which case its global variables are shared. Per-instance data
+ * (quarks, path handles, field handles, caches, etc.) should thus
+ * live in a context allocated by onInit() and given to
+ * Adapter::setContext(). This opaque context is then passed to the
+ * event callbacks registered with an OnEventContextFunc and to
+ * onFiniContext(), which must free it.
+ *
  * @author Philippe Proulx
  */
 class DynamicLibraryStateProvider :
@@ -52,7 +67,29 @@ public:
     {
         friend class DynamicLibraryStateProvider;
 
+    public:
+        /// Event callback function receiving the instance context
+        typedef AbstractStateProvider::OnEventContextFunc OnEventContextFunc;
+
     public:
+        /**
+         * Sets the opaque context of this provider instance.
+         *
+         * The context is passed to the callbacks registered with an
+         * OnEventContextFunc (once set, so set it before registering
+         * them) and to the onFiniContext() symbol.
+         *
+         * @param context Instance context
+         */
+        void setContext(void* context);
+
+        /**
+         * Returns the opaque context of this provider instance.
+         *
+         * @returns Instance context or \a nullptr if not set
+         */
+        void* getContext() const;
+
         /**
          * Calls to this method are delegated to
          * AbstractStateProvider::registerEventCallback().
@@ -63,6 +100,16 @@ public:
                                    const std::string& eventName,
                                    const OnEventFunc& onEvent);
 
+        /**
+         * Same as registerEventCallback(const std::string&, const std::string&, const OnEventFunc&),
+         * but \p onEvent receives the instance context.
+         *
+         * @see setContext()
+         */
+        bool registerEventCallback(const std::string& traceType,
+                                   const std::string& eventName,
+                                   OnEventContextFunc onEvent);
+
         /**
          * Calls to this method are delegated to
          * AbstractStateProvider::registerEventCallbackRegex().
@@ -73,6 +120,16 @@ public:
                                         const std::string& eventName,
                                         const OnEventFunc& onEvent);
 
+        /**
+         * Same as registerEventCallbackRegex(const std::string&, const std::string&, const OnEventFunc&),
+         * but \p onEvent receives the instance context.
+         *
+         * @see setContext()
+         */
+        bool registerEventCallbackRegex(const std::string& traceType,
+                                        const std::string& eventName,
+                                        OnEventContextFunc onEvent);
+
         /**
          * Calls to this method are delegated to
          * AbstractStateProvider::getInstanceName().
@@ -128,6 +185,10 @@ private:
         return "onFini";
     }
 
+    static constexpr const char* ON_FINI_CONTEXT_SYMBOL_NAME() {
+        return "onFiniContext";
+    }
+
     void onInitImpl(CurrentState& state, const TraceSet* traceSet);
     void onEventImpl(CurrentState& state, const Event& event);
     void onFiniImpl(CurrentState& state);
@@ -139,6 +200,10 @@ private:
     // DL resolved symbols
     void (*_dlOnInit)(CurrentState&, const TraceSet*, Adapter&);
     void (*_dlOnFini)(CurrentState&);
+    void (*_dlOnFiniContext)(CurrentState&, void*);
+
+    // opaque instance context, set by the library's onInit()
+    void* _context;
 };
 
 }
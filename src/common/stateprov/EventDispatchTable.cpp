@@ -0,0 +1,131 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+
+#include <common/stateprov/EventDispatchTable.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+EventDispatchTable::EventDispatchTable()
+{
+    this->clear();
+}
+
+void EventDispatchTable::add(trace_id_t traceId, event_id_t eventId,
+                             const OnEventFunc& onEvent)
+{
+    if (traceId < 0 || !onEvent) {
+        return;
+    }
+
+    _added.push_back({
+        static_cast<std::size_t>(traceId),
+        EventDispatchTable::streamIndex(eventId),
+        EventDispatchTable::eventIndex(eventId),
+        onEvent
+    });
+}
+
+void EventDispatchTable::compile()
+{
+    const auto& all = _added;
+
+    // number of streams of each trace and of events of each stream
+    std::vector<std::vector<std::size_t>> eventsCounts;
+
+    for (const auto& callback : all) {
+        if (callback.traceIndex >= eventsCounts.size()) {
+            eventsCounts.resize(callback.traceIndex + 1);
+        }
+
+        auto& streams = eventsCounts[callback.traceIndex];
+
+        if (callback.streamIndex >= streams.size()) {
+            streams.resize(callback.streamIndex + 1, 0);
+        }
+
+        streams[callback.streamIndex] = std::max(streams[callback.streamIndex],
+                                                 callback.eventIndex + 1);
+    }
+
+    // assign ordinals, trace by trace, stream by stream
+    _traces.clear();
+    _streams.clear();
+
+    std::size_t ordinalsCount = 0;
+
+    for (const auto& streams : eventsCounts) {
+        _traces.push_back({_streams.size(), streams.size()});
+
+        for (auto eventsCount : streams) {
+            _streams.push_back({ordinalsCount, eventsCount});
+            ordinalsCount += eventsCount;
+        }
+    }
+
+    // count callbacks of each ordinal, then place them
+    std::vector<std::size_t> ordinals;
+
+    _slots.assign(ordinalsCount + 1, 0);
+
+    for (const auto& callback : all) {
+        const auto& trace = _traces[callback.traceIndex];
+        const auto& stream = _streams[trace.firstStream + callback.streamIndex];
+        auto ordinal = stream.firstOrdinal + callback.eventIndex;
+
+        ordinals.push_back(ordinal);
+        _slots[ordinal + 1]++;
+    }
+
+    for (std::size_t x = 1; x < _slots.size(); ++x) {
+        _slots[x] += _slots[x - 1];
+    }
+
+    std::vector<std::uint32_t> next {_slots.begin(), _slots.end() - 1};
+
+    _callbacks.clear();
+    _callbacks.resize(all.size());
+
+    for (std::size_t x = 0; x < all.size(); ++x) {
+        auto& callback = _callbacks[next[ordinals[x]]++];
+        auto func = all[x].onEvent.target<Func>();
+        auto contextCallback = all[x].onEvent.target<AbstractStateProvider::ContextEventCallback>();
+
+        callback.func = func ? *func : nullptr;
+        callback.contextFunc = contextCallback ? contextCallback->func : nullptr;
+        callback.context = contextCallback ? contextCallback->context : nullptr;
+        callback.onEvent = all[x].onEvent;
+    }
+}
+
+void EventDispatchTable::clear()
+{
+    _added.clear();
+    _traces.clear();
+    _streams.clear();
+    _callbacks.clear();
+
+    // a single, empty ordinal
+    _slots.assign(1, 0);
+}
+
+}
+}
@@ -0,0 +1,212 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_EVENTDISPATCHTABLE_HPP
+#define _TIBEE_COMMON_EVENTDISPATCHTABLE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/state/CurrentState.hpp>
+#include <common/stateprov/AbstractStateProvider.hpp>
+#include <common/trace/Event.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Event dispatch table shared by all the state providers of a state
+ * construction.
+ *
+ * The event callbacks registered by state providers (see
+ * AbstractStateProvider::addEventCallbacks()) are compiled into a
+ * dense table indexed by a compact (trace ID, event ID) ordinal: each
+ * slot holds the callbacks of all providers for this event, in
+ * provider order. Dispatching an event is then a few small array
+ * lookups instead of one hash map lookup per provider.
+ *
+ * Callbacks wrapping a plain function pointer or an
+ * AbstractStateProvider::ContextEventCallback are called directly.
+ *
+ * @author Philippe Proulx
+ */
+class EventDispatchTable :
+    boost::noncopyable
+{
+public:
+    /// Event callback (see AbstractStateProvider)
+    typedef AbstractStateProvider::OnEventFunc OnEventFunc;
+
+public:
+    /**
+     * Builds an empty event dispatch table.
+     */
+    EventDispatchTable();
+
+    /**
+     * Adds callback \p onEvent for event \p eventId of trace
+     * \p traceId, after all the callbacks already added for this
+     * event.
+     *
+     * The callback is only dispatched once compile() is called.
+     *
+     * @param traceId Trace ID
+     * @param eventId Event ID
+     * @param onEvent Event callback
+     */
+    void add(trace_id_t traceId, event_id_t eventId, const OnEventFunc& onEvent);
+
+    /**
+     * Compiles all the callbacks added since the last clear() into
+     * the dispatch table.
+     */
+    void compile();
+
+    /**
+     * Removes all callbacks.
+     */
+    void clear();
+
+    /**
+     * Returns the number of compiled callbacks.
+     *
+     * @returns Number of compiled callbacks
+     */
+    std::size_t size() const
+    {
+        return _callbacks.size();
+    }
+
+    /**
+     * Calls all the callbacks of event \p event, in the order they
+     * were added.
+     *
+     * @param state Current state
+     * @param event Event to dispatch
+     */
+    void dispatch(CurrentState& state, const Event& event) const
+    {
+        auto traceIndex = static_cast<std::size_t>(event.getTraceId());
+
+        if (traceIndex >= _traces.size()) {
+            return;
+        }
+
+        const auto& trace = _traces[traceIndex];
+        auto eventId = event.getId();
+        auto streamIndex = EventDispatchTable::streamIndex(eventId);
+
+        if (streamIndex >= trace.streamsCount) {
+            return;
+        }
+
+        const auto& stream = _streams[trace.firstStream + streamIndex];
+        auto eventIndex = EventDispatchTable::eventIndex(eventId);
+
+        if (eventIndex >= stream.eventsCount) {
+            return;
+        }
+
+        auto ordinal = stream.firstOrdinal + eventIndex;
+        auto end = _slots[ordinal + 1];
+
+        for (auto x = _slots[ordinal]; x < end; ++x) {
+            const auto& callback = _callbacks[x];
+
+            if (callback.func) {
+                callback.func(state, event);
+            } else if (callback.contextFunc) {
+                callback.contextFunc(callback.context, state, event);
+            } else {
+                callback.onEvent(state, event);
+            }
+        }
+    }
+
+private:
+    // plain function event callback
+    typedef bool (*Func)(CurrentState&, const Event&);
+
+    // compiled callback
+    struct Callback
+    {
+        Func func;
+        AbstractStateProvider::OnEventContextFunc contextFunc;
+        void* context;
+        OnEventFunc onEvent;
+    };
+
+    // added callback
+    struct AddedCallback
+    {
+        std::size_t traceIndex;
+        std::size_t streamIndex;
+        std::size_t eventIndex;
+        OnEventFunc onEvent;
+    };
+
+    // streams of a trace within _streams
+    struct TraceEntry
+    {
+        std::size_t firstStream;
+        std::size_t streamsCount;
+    };
+
+    // ordinals of the events of a stream
+    struct StreamEntry
+    {
+        std::size_t firstOrdinal;
+        std::size_t eventsCount;
+    };
+
+private:
+    static std::size_t streamIndex(event_id_t eventId)
+    {
+        return static_cast<std::size_t>(static_cast<std::uint32_t>(eventId) >> 20);
+    }
+
+    static std::size_t eventIndex(event_id_t eventId)
+    {
+        return static_cast<std::size_t>(eventId & 0xfffff);
+    }
+
+private:
+    // callbacks added since last clear()
+    std::vector<AddedCallback> _added;
+
+    // trace entries, indexed by trace ID
+    std::vector<TraceEntry> _traces;
+
+    // stream entries of all traces
+    std::vector<StreamEntry> _streams;
+
+    // index of first callback of each ordinal (plus end of last one)
+    std::vector<std::uint32_t> _slots;
+
+    // callbacks, by ordinal
+    std::vector<Callback> _callbacks;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_EVENTDISPATCHTABLE_HPP
@@ -15,11 +15,24 @@
  * You should have received a copy of the GNU General Public License
  * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
  */
+// Python.h must be included first
+#include <Python.h>
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <sstream>
 #include <boost/filesystem/path.hpp>
+#include <boost/filesystem/fstream.hpp>
 
 #include <common/trace/EventValueType.hpp>
 #include <common/trace/AbstractEventValue.hpp>
+#include <common/trace/ArrayEventValue.hpp>
+#include <common/trace/DictEventValue.hpp>
+#include <common/state/StateNode.hpp>
 #include <common/stateprov/PythonStateProvider.hpp>
+#include <common/utils/Tsc.hpp>
+#include <common/ex/WrongStateProvider.hpp>
 
 namespace bfs = boost::filesystem;
 
@@ -28,31 +41,1190 @@ namespace tibee
 namespace common
 {
 
-PythonStateProvider::PythonStateProvider(const boost::filesystem::path& path,
+namespace
+{
+
+// view over an event of the current batch (tibee.Event)
+struct PyEventView
+{
+    PyObject_HEAD
+    PythonStateProvider* provider;
+    const Event* event;
+    std::size_t index;
+    std::uint64_t generation;
+};
+
+// state (tibee.State)
+struct PyState
+{
+    PyObject_HEAD
+    PythonStateProvider* provider;
+};
+
+// on_init() context (tibee.Context)
+struct PyContext
+{
+    PyObject_HEAD
+    PythonStateProvider* provider;
+    PyObject* params;
+    PyObject* state;
+};
+
+}
+
+/**
+ * Glue between CPython and Python state providers: embedded
+ * interpreter, tibee module and its types.
+ *
+ * @author Philippe Proulx
+ */
+class PythonGlue
+{
+public:
+    static void init();
+    static PyObject* newEventView(PythonStateProvider* provider,
+                                  const Event* event, std::size_t index);
+    static PyObject* newState(PythonStateProvider* provider);
+    static PyObject* newContext(PythonStateProvider* provider,
+                                PyObject* params, PyObject* state);
+    static void detach(PyObject* stateOrContext);
+
+    static void invalidateEventViews()
+    {
+        _generation++;
+    }
+
+private:
+    static const Event* getEvent(PyObject* self);
+    static PyObject* toPython(const AbstractEventValue& value);
+    static void dealloc(PyObject* self);
+    static void deallocContext(PyObject* self);
+    static PyObject* eventGetName(PyObject* self, void* closure);
+    static PyObject* eventGetTimestamp(PyObject* self, void* closure);
+    static PyObject* eventGetId(PyObject* self, void* closure);
+    static PyObject* eventGetTraceId(PyObject* self, void* closure);
+    static PyObject* eventSubscript(PyObject* self, PyObject* key);
+    static PyObject* eventGet(PyObject* self, PyObject* args);
+    static PyObject* stateSet(PyObject* self, PyObject* args);
+    static PyObject* stateGet(PyObject* self, PyObject* args);
+    static PyObject* stateSubscript(PyObject* self, PyObject* path);
+    static PythonStateProvider* getStateProvider(PyObject* self);
+    static PyObject* contextRegister(PyObject* self, PyObject* args);
+    static PyObject* contextRegisterRegex(PyObject* self, PyObject* args);
+    static PyObject* contextRegisterImpl(PyObject* self, PyObject* args,
+                                         bool regex);
+    static PyObject* contextGetParams(PyObject* self, void* closure);
+    static PyObject* contextGetState(PyObject* self, void* closure);
+
+private:
+    // tibee module types
+    static PyTypeObject* _eventType;
+    static PyTypeObject* _stateType;
+    static PyTypeObject* _contextType;
+
+    // current event views generation (older ones are invalid)
+    static std::uint64_t _generation;
+};
+
+PyTypeObject* PythonGlue::_eventType = nullptr;
+PyTypeObject* PythonGlue::_stateType = nullptr;
+PyTypeObject* PythonGlue::_contextType = nullptr;
+std::uint64_t PythonGlue::_generation = 0;
+
+void PythonGlue::init()
+{
+    if (_eventType) {
+        return;
+    }
+
+    // no signal handlers: we're not the Python interpreter
+    if (!Py_IsInitialized()) {
+        Py_InitializeEx(0);
+    }
+
+    static PyGetSetDef eventGetSet[] = {
+        {const_cast<char*>("name"), eventGetName, nullptr, nullptr, nullptr},
+        {const_cast<char*>("timestamp"), eventGetTimestamp, nullptr, nullptr, nullptr},
+        {const_cast<char*>("id"), eventGetId, nullptr, nullptr, nullptr},
+        {const_cast<char*>("trace_id"), eventGetTraceId, nullptr, nullptr, nullptr},
+        {nullptr, nullptr, nullptr, nullptr, nullptr},
+    };
+    static PyMethodDef eventMethods[] = {
+        {"get", eventGet, METH_VARARGS, nullptr},
+        {nullptr, nullptr, 0, nullptr},
+    };
+    static PyType_Slot eventSlots[] = {
+        {Py_tp_dealloc, reinterpret_cast<void*>(dealloc)},
+        {Py_tp_getset, eventGetSet},
+        {Py_tp_methods, eventMethods},
+        {Py_mp_subscript, reinterpret_cast<void*>(eventSubscript)},
+        {0, nullptr},
+    };
+    static PyType_Spec eventSpec = {
+        "tibee.Event", sizeof(PyEventView), 0, Py_TPFLAGS_DEFAULT, eventSlots
+    };
+
+    static PyMethodDef stateMethods[] = {
+        {"set", stateSet, METH_VARARGS, nullptr},
+        {"get", stateGet, METH_VARARGS, nullptr},
+        {nullptr, nullptr, 0, nullptr},
+    };
+    static PyType_Slot stateSlots[] = {
+        {Py_tp_dealloc, reinterpret_cast<void*>(dealloc)},
+        {Py_tp_methods, stateMethods},
+        {Py_mp_subscript, reinterpret_cast<void*>(stateSubscript)},
+        {0, nullptr},
+    };
+    static PyType_Spec stateSpec = {
+        "tibee.State", sizeof(PyState), 0, Py_TPFLAGS_DEFAULT, stateSlots
+    };
+
+    static PyGetSetDef contextGetSet[] = {
+        {const_cast<char*>("params"), contextGetParams, nullptr, nullptr, nullptr},
+        {const_cast<char*>("state"), contextGetState, nullptr, nullptr, nullptr},
+        {nullptr, nullptr, nullptr, nullptr, nullptr},
+    };
+    static PyMethodDef contextMethods[] = {
+        {"register", contextRegister, METH_VARARGS, nullptr},
+        {"register_regex", contextRegisterRegex, METH_VARARGS, nullptr},
+        {nullptr, nullptr, 0, nullptr},
+    };
+    static PyType_Slot contextSlots[] = {
+        {Py_tp_dealloc, reinterpret_cast<void*>(deallocContext)},
+        {Py_tp_getset, contextGetSet},
+        {Py_tp_methods, contextMethods},
+        {0, nullptr},
+    };
+    static PyType_Spec contextSpec = {
+        "tibee.Context", sizeof(PyContext), 0, Py_TPFLAGS_DEFAULT, contextSlots
+    };
+
+    static PyModuleDef moduleDef = {
+        PyModuleDef_HEAD_INIT, "tibee", nullptr, -1, nullptr,
+        nullptr, nullptr, nullptr, nullptr
+    };
+
+    auto module = PyModule_Create(&moduleDef);
+    auto eventType = PyType_FromSpec(&eventSpec);
+    auto stateType = PyType_FromSpec(&stateSpec);
+    auto contextType = PyType_FromSpec(&contextSpec);
+
+    if (!module || !eventType || !stateType || !contextType ||
+            PyModule_AddObject(module, "Event", eventType) < 0 ||
+            PyModule_AddObject(module, "State", stateType) < 0 ||
+            PyModule_AddObject(module, "Context", contextType) < 0 ||
+            PyDict_SetItemString(PyImport_GetModuleDict(), "tibee", module) < 0) {
+        PyErr_Clear();
+
+        throw ex::WrongStateProvider {
+            "cannot initialize Python interpreter", std::string {"python"}
+        };
+    }
+
+    // the module keeps a reference to each type
+    _eventType = reinterpret_cast<PyTypeObject*>(eventType);
+    _stateType = reinterpret_cast<PyTypeObject*>(stateType);
+    _contextType = reinterpret_cast<PyTypeObject*>(contextType);
+}
+
+PyObject* PythonGlue::newEventView(PythonStateProvider* provider,
+                                   const Event* event, std::size_t index)
+{
+    auto view = PyObject_New(PyEventView, _eventType);
+
+    if (view) {
+        view->provider = provider;
+        view->event = event;
+        view->index = index;
+        view->generation = _generation;
+    }
+
+    return reinterpret_cast<PyObject*>(view);
+}
+
+PyObject* PythonGlue::newState(PythonStateProvider* provider)
+{
+    auto state = PyObject_New(PyState, _stateType);
+
+    if (state) {
+        state->provider = provider;
+    }
+
+    return reinterpret_cast<PyObject*>(state);
+}
+
+PyObject* PythonGlue::newContext(PythonStateProvider* provider,
+                                 PyObject* params, PyObject* state)
+{
+    auto ctx = PyObject_New(PyContext, _contextType);
+
+    if (ctx) {
+        Py_INCREF(params);
+        Py_INCREF(state);
+        ctx->provider = provider;
+        ctx->params = params;
+        ctx->state = state;
+    }
+
+    return reinterpret_cast<PyObject*>(ctx);
+}
+
+void PythonGlue::detach(PyObject* stateOrContext)
+{
+    if (!stateOrContext) {
+        return;
+    }
+
+    if (Py_TYPE(stateOrContext) == _stateType) {
+        reinterpret_cast<PyState*>(stateOrContext)->provider = nullptr;
+    } else if (Py_TYPE(stateOrContext) == _contextType) {
+        reinterpret_cast<PyContext*>(stateOrContext)->provider = nullptr;
+    }
+}
+
+void PythonGlue::dealloc(PyObject* self)
+{
+    auto type = Py_TYPE(self);
+
+    PyObject_Free(self);
+    Py_DECREF(type);
+}
+
+void PythonGlue::deallocContext(PyObject* self)
+{
+    auto ctx = reinterpret_cast<PyContext*>(self);
+
+    Py_XDECREF(ctx->params);
+    Py_XDECREF(ctx->state);
+    PythonGlue::dealloc(self);
+}
+
+const Event* PythonGlue::getEvent(PyObject* self)
+{
+    auto view = reinterpret_cast<PyEventView*>(self);
+
+    if (!view->event || view->generation != _generation) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "event used outside of its handler call");
+
+        return nullptr;
+    }
+
+    return view->event;
+}
+
+PyObject* PythonGlue::toPython(const AbstractEventValue& value)
+{
+    switch (value.getType()) {
+    case EventValueType::SINT:
+        return PyLong_FromLongLong(value.asSint());
+
+    case EventValueType::UINT:
+        return PyLong_FromUnsignedLongLong(value.asUint());
+
+    case EventValueType::FLOAT:
+        return PyFloat_FromDouble(value.asFloat());
+
+    case EventValueType::STRING:
+    {
+        auto string = value.asString();
+
+        return PyUnicode_DecodeUTF8(string, std::strlen(string), "replace");
+    }
+
+    case EventValueType::ENUM:
+    {
+        auto label = value.asEnumLabel();
+
+        if (!label) {
+            return PyLong_FromUnsignedLongLong(value.asEnumInt());
+        }
+
+        return PyUnicode_DecodeUTF8(label, std::strlen(label), "replace");
+    }
+
+    case EventValueType::ARRAY:
+    {
+        const auto& array = value.asArray();
+
+        // text (array of chars)
+        if (array.isString()) {
+            auto string = array.getString();
+
+            return PyUnicode_DecodeUTF8(string, std::strlen(string), "replace");
+        }
+
+        auto list = PyList_New(array.size());
+
+        for (std::size_t x = 0; list && x < array.size(); ++x) {
+            auto item = PythonGlue::toPython(*array.get(x));
+
+            if (!item) {
+                Py_DECREF(list);
+
+                return nullptr;
+            }
+
+            PyList_SET_ITEM(list, x, item);
+        }
+
+        return list;
+    }
+
+    case EventValueType::DICT:
+    {
+        const auto& dict = value.asDict();
+        auto pyDict = PyDict_New();
+
+        for (std::size_t x = 0; pyDict && x < dict.size(); ++x) {
+            auto item = PythonGlue::toPython(*dict.get(x));
+
+            if (!item || PyDict_SetItemString(pyDict, dict.getKeyName(x), item) < 0) {
+                Py_XDECREF(item);
+                Py_DECREF(pyDict);
+
+                return nullptr;
+            }
+
+            Py_DECREF(item);
+        }
+
+        return pyDict;
+    }
+
+    default:
+        Py_RETURN_NONE;
+    }
+}
+
+PyObject* PythonGlue::eventGetName(PyObject* self, void* closure)
+{
+    auto event = PythonGlue::getEvent(self);
+
+    if (!event) {
+        return nullptr;
+    }
+
+    return PyUnicode_FromString(event->getName());
+}
+
+PyObject* PythonGlue::eventGetTimestamp(PyObject* self, void* closure)
+{
+    auto event = PythonGlue::getEvent(self);
+
+    if (!event) {
+        return nullptr;
+    }
+
+    return PyLong_FromUnsignedLongLong(event->getTimestamp());
+}
+
+PyObject* PythonGlue::eventGetId(PyObject* self, void* closure)
+{
+    auto event = PythonGlue::getEvent(self);
+
+    if (!event) {
+        return nullptr;
+    }
+
+    return PyLong_FromLong(event->getId());
+}
+
+PyObject* PythonGlue::eventGetTraceId(PyObject* self, void* closure)
+{
+    auto event = PythonGlue::getEvent(self);
+
+    if (!event) {
+        return nullptr;
+    }
+
+    return PyLong_FromLong(event->getTraceId());
+}
+
+PyObject* PythonGlue::eventSubscript(PyObject* self, PyObject* key)
+{
+    auto event = PythonGlue::getEvent(self);
+
+    if (!event) {
+        return nullptr;
+    }
+
+    auto name = PyUnicode_AsUTF8(key);
+
+    if (!name) {
+        return nullptr;
+    }
+
+    const auto& value = (*event)[name];
+
+    if (value.isNull()) {
+        PyErr_SetObject(PyExc_KeyError, key);
+
+        return nullptr;
+    }
+
+    return PythonGlue::toPython(value);
+}
+
+PyObject* PythonGlue::eventGet(PyObject* self, PyObject* args)
+{
+    const char* name;
+    PyObject* defaultValue = Py_None;
+
+    if (!PyArg_ParseTuple(args, "s|O:get", &name, &defaultValue)) {
+        return nullptr;
+    }
+
+    auto event = PythonGlue::getEvent(self);
+
+    if (!event) {
+        return nullptr;
+    }
+
+    const auto& value = (*event)[name];
+
+    if (value.isNull()) {
+        Py_INCREF(defaultValue);
+
+        return defaultValue;
+    }
+
+    return PythonGlue::toPython(value);
+}
+
+PyObject* PythonGlue::stateSet(PyObject* self, PyObject* args)
+{
+    PyObject* ev;
+    PyObject* path;
+    PyObject* value;
+
+    if (!PyArg_ParseTuple(args, "OOO:set", &ev, &path, &value)) {
+        return nullptr;
+    }
+
+    auto provider = PythonGlue::getStateProvider(self);
+
+    if (!provider) {
+        return nullptr;
+    }
+
+    bool ok;
+
+    if (ev == Py_None) {
+        ok = provider->applyWrite(path, value);
+    } else {
+        if (!PyObject_TypeCheck(ev, _eventType)) {
+            PyErr_SetString(PyExc_TypeError, "expecting a tibee.Event or None");
+
+            return nullptr;
+        }
+
+        if (!PythonGlue::getEvent(ev)) {
+            return nullptr;
+        }
+
+        auto view = reinterpret_cast<PyEventView*>(ev);
+
+        if (view->provider != provider) {
+            PyErr_SetString(PyExc_ValueError,
+                            "event delivered to another state provider");
+
+            return nullptr;
+        }
+
+        ok = provider->bufferWrite(view->index, path, value);
+    }
+
+    if (!ok) {
+        return nullptr;
+    }
+
+    Py_RETURN_NONE;
+}
+
+PyObject* PythonGlue::stateGet(PyObject* self, PyObject* args)
+{
+    PyObject* path;
+    PyObject* defaultValue = Py_None;
+
+    if (!PyArg_ParseTuple(args, "O|O:get", &path, &defaultValue)) {
+        return nullptr;
+    }
+
+    auto provider = PythonGlue::getStateProvider(self);
+
+    if (!provider) {
+        return nullptr;
+    }
+
+    return provider->getValue(path, defaultValue);
+}
+
+PyObject* PythonGlue::stateSubscript(PyObject* self, PyObject* path)
+{
+    auto provider = PythonGlue::getStateProvider(self);
+
+    if (!provider) {
+        return nullptr;
+    }
+
+    // no default value: KeyError if there's no value
+    return provider->getValue(path, nullptr);
+}
+
+PythonStateProvider* PythonGlue::getStateProvider(PyObject* self)
+{
+    auto provider = reinterpret_cast<PyState*>(self)->provider;
+
+    if (!provider || !provider->_curState) {
+        PyErr_SetString(PyExc_RuntimeError, "state is not available");
+
+        return nullptr;
+    }
+
+    return provider;
+}
+
+PyObject* PythonGlue::contextRegister(PyObject* self, PyObject* args)
+{
+    return PythonGlue::contextRegisterImpl(self, args, false);
+}
+
+PyObject* PythonGlue::contextRegisterRegex(PyObject* self, PyObject* args)
+{
+    return PythonGlue::contextRegisterImpl(self, args, true);
+}
+
+PyObject* PythonGlue::contextRegisterImpl(PyObject* self, PyObject* args,
+                                          bool regex)
+{
+    const char* traceType;
+    const char* eventName;
+    PyObject* handler;
+
+    if (!PyArg_ParseTuple(args, "ssO", &traceType, &eventName, &handler)) {
+        return nullptr;
+    }
+
+    auto provider = reinterpret_cast<PyContext*>(self)->provider;
+
+    if (!provider) {
+        PyErr_SetString(PyExc_RuntimeError, "state provider is gone");
+
+        return nullptr;
+    }
+
+    if (!PyCallable_Check(handler)) {
+        PyErr_SetString(PyExc_TypeError, "event handler is not callable");
+
+        return nullptr;
+    }
+
+    auto matched = provider->registerHandler(traceType, eventName, handler,
+                                             regex);
+
+    return PyBool_FromLong(matched);
+}
+
+PyObject* PythonGlue::contextGetParams(PyObject* self, void* closure)
+{
+    auto params = reinterpret_cast<PyContext*>(self)->params;
+
+    Py_INCREF(params);
+
+    return params;
+}
+
+PyObject* PythonGlue::contextGetState(PyObject* self, void* closure)
+{
+    auto state = reinterpret_cast<PyContext*>(self)->state;
+
+    Py_INCREF(state);
+
+    return state;
+}
+
+PythonStateProvider::PythonStateProvider(const bfs::path& path,
                                          const StateProviderConfig& config) :
-    AbstractStateProviderFile {path, config}
+    AbstractStateProviderFile {path, config},
+    _module {nullptr},
+    _ctx {nullptr},
+    _state {nullptr},
+    _collecting {false},
+    _cursor {0},
+    _curState {nullptr}
 {
-    std::cout << "python state provider: loading script " << path << std::endl;
+    PythonGlue::init();
+
+    // read script
+    bfs::ifstream input {path};
+    std::stringstream source;
+
+    if (!input) {
+        throw ex::WrongStateProvider {"cannot read Python script", path};
+    }
+
+    source << input.rdbuf();
+
+    // let the script import modules next to it
+    auto sysPath = PySys_GetObject("path");
+    auto dir = PyUnicode_FromString(bfs::absolute(path).parent_path().string().c_str());
+
+    if (sysPath && dir && !PySequence_Contains(sysPath, dir)) {
+        PyList_Insert(sysPath, 0, dir);
+    }
+
+    Py_XDECREF(dir);
+    PyErr_Clear();
+
+    // run it as a module of its own (the same script may be loaded twice)
+    static unsigned int modulesCount = 0;
+    auto moduleName = "tibee_provider_" + std::to_string(modulesCount++);
+    auto code = Py_CompileString(source.str().c_str(), path.string().c_str(),
+                                 Py_file_input);
+
+    if (code) {
+        _module = PyImport_ExecCodeModuleEx(moduleName.c_str(), code,
+                                            path.string().c_str());
+        Py_DECREF(code);
+    }
+
+    if (!_module) {
+        this->throwPythonError("script");
+    }
+
+    // parameters, state and context objects
+    auto params = PyDict_New();
+
+    for (const auto& keyValuePair : config.getParams()) {
+        auto value = PyUnicode_FromString(keyValuePair.second.asString().c_str());
+
+        if (value) {
+            PyDict_SetItemString(params, keyValuePair.first.c_str(), value);
+            Py_DECREF(value);
+        }
+    }
+
+    _state = PythonGlue::newState(this);
+    _ctx = PythonGlue::newContext(this, params, _state);
+    Py_DECREF(params);
+
+    if (!_state || !_ctx) {
+        this->throwPythonError("initialization");
+    }
 }
 
 PythonStateProvider::~PythonStateProvider()
 {
-    std::cout << "python state provider: unloading script" << std::endl;
+    this->resetBatch();
+
+    for (auto handler : _handlers) {
+        Py_DECREF(handler);
+    }
+
+    // the script may keep references to those
+    PythonGlue::detach(_state);
+    PythonGlue::detach(_ctx);
+    Py_XDECREF(_ctx);
+    Py_XDECREF(_state);
+    Py_XDECREF(_module);
+}
+
+void PythonStateProvider::throwPythonError(const std::string& what)
+{
+    std::string msg {"Python error in " + what};
+    PyObject* type;
+    PyObject* value;
+    PyObject* traceback;
+
+    PyErr_Fetch(&type, &value, &traceback);
+    PyErr_NormalizeException(&type, &value, &traceback);
+
+    if (value) {
+        auto str = PyObject_Str(value);
+
+        if (str && PyUnicode_AsUTF8(str)) {
+            msg += ": ";
+            msg += PyUnicode_AsUTF8(str);
+        }
+
+        Py_XDECREF(str);
+
+        // the traceback helps script authors
+        if (type) {
+            PyErr_Display(type, value, traceback);
+        }
+    }
+
+    Py_XDECREF(type);
+    Py_XDECREF(value);
+    Py_XDECREF(traceback);
+    PyErr_Clear();
+
+    throw ex::WrongStateProvider {msg, this->getPath()};
+}
+
+void PythonStateProvider::onInitImpl(CurrentState& state,
+                                     const TraceSet* traceSet)
+{
+    _curState = &state;
+
+    // fresh registrations
+    for (auto handler : _handlers) {
+        Py_DECREF(handler);
+    }
+
+    _handlers.clear();
+    _collectTable.clear();
+    this->resetBatch();
+
+    if (PyObject_HasAttrString(_module, "on_init")) {
+        auto ret = PyObject_CallMethod(_module, "on_init", "O", _ctx);
+
+        if (!ret) {
+            this->throwPythonError("on_init()");
+        }
+
+        Py_DECREF(ret);
+    }
+
+    // same callbacks, to select the events of each batch
+    this->addUnprofiledEventCallbacks(_collectTable);
+    _collectTable.compile();
+}
+
+bool PythonStateProvider::registerHandler(const std::string& traceType,
+                                          const std::string& eventName,
+                                          PyObject* handler, bool regex)
+{
+    auto index = _handlers.size();
+    OnEventFunc onEvent = [this, index] (CurrentState& state, const Event& event) {
+        return this->onEvent(state, event, index);
+    };
+
+    Py_INCREF(handler);
+    _handlers.push_back(handler);
+
+    if (regex) {
+        return this->registerEventCallbackRegex(traceType, eventName, onEvent);
+    }
+
+    return this->registerEventCallback(traceType, eventName, onEvent);
+}
+
+void PythonStateProvider::onBatchImpl(CurrentState& state,
+                                      const EventBatch& batch)
+{
+    this->resetBatch();
+
+    if (_handlers.empty()) {
+        return;
+    }
+
+    // select our events
+    _collecting = true;
+
+    for (std::size_t x = 0; x < batch.size(); ++x) {
+        _collectTable.dispatch(state, batch[x]);
+    }
+
+    _collecting = false;
+
+    if (!_batch.empty()) {
+        this->runHandlers(this->isProfiling());
+    }
+}
+
+bool PythonStateProvider::onEvent(CurrentState& state, const Event& event,
+                                  std::size_t handler)
+{
+    if (_collecting) {
+        _batch.push_back({&event, handler, 0});
+
+        return true;
+    }
+
+    // prepared event (normally the next one): apply its state changes
+    for (auto x = _cursor; x < _batch.size(); ++x) {
+        if (_batch[x].event == &event) {
+            this->applyWrites(x);
+            _cursor = x + 1;
+
+            return true;
+        }
+    }
+
+    // event outside of a batch: handle it alone (already profiled)
+    this->resetBatch();
+    _batch.push_back({&event, handler, 0});
+    this->runHandlers(false);
+    this->applyWrites(0);
+    this->resetBatch();
+
+    return true;
+}
+
+void PythonStateProvider::runHandlers(bool profile)
+{
+    // group events by handler, keeping time order
+    std::vector<std::vector<std::size_t>> groups;
+
+    groups.resize(_handlers.size());
+
+    for (std::size_t x = 0; x < _batch.size(); ++x) {
+        groups[_batch[x].handler].push_back(x);
+    }
+
+    for (std::size_t h = 0; h < groups.size(); ++h) {
+        const auto& group = groups[h];
+
+        if (group.empty()) {
+            continue;
+        }
+
+        auto tscBefore = profile ? readTsc() : 0;
+        auto events = PyList_New(group.size());
+
+        for (std::size_t x = 0; events && x < group.size(); ++x) {
+            auto view = PythonGlue::newEventView(this, _batch[group[x]].event,
+                                                 group[x]);
+
+            if (!view) {
+                Py_CLEAR(events);
+                break;
+            }
+
+            PyList_SET_ITEM(events, x, view);
+        }
+
+        PyObject* ret = nullptr;
+
+        if (events) {
+            ret = PyObject_CallFunctionObjArgs(_handlers[h], events, _state,
+                                               nullptr);
+            Py_DECREF(events);
+        }
+
+        if (!ret) {
+            PythonGlue::invalidateEventViews();
+            this->resetBatch();
+            this->throwPythonError("event handler");
+        }
+
+        Py_DECREF(ret);
+
+        /* The handler may handle more than one event type: share its
+         * cycles between the profiles of its events.
+         */
+        if (profile) {
+            auto cycles = (readTsc() - tscBefore) / group.size();
+
+            for (auto x : group) {
+                this->addProfileCycles(*_batch[x].event, cycles);
+            }
+        }
+    }
+
+    // event views of this batch must not be used anymore
+    PythonGlue::invalidateEventViews();
+
+    // writes in event order, then in call order
+    std::stable_sort(_writes.begin(), _writes.end(),
+                     [] (const Write& a, const Write& b) {
+        return a.event < b.event;
+    });
+
+    std::size_t w = 0;
+
+    for (std::size_t x = 0; x < _batch.size(); ++x) {
+        while (w < _writes.size() && _writes[w].event < x) {
+            w++;
+        }
+
+        _batch[x].firstWrite = w;
+    }
+}
+
+void PythonStateProvider::applyWrites(std::size_t event)
+{
+    auto& root = _curState->getRoot();
+
+    for (auto w = _batch[event].firstWrite;
+            w < _writes.size() && _writes[w].event == event; ++w) {
+        const auto& write = _writes[w];
+        auto node = &root;
+
+        for (std::size_t c = 0; c < write.componentsCount; ++c) {
+            const auto& component = _components[write.firstComponent + c];
+
+            if (component.isInt) {
+                node = &(*node)[component.intKey];
+            } else {
+                node = &(*node)[component.quark];
+            }
+        }
+
+        *node = write.value;
+    }
+}
+
+bool PythonStateProvider::bufferWrite(std::size_t event, PyObject* path,
+                                      PyObject* value)
+{
+    Write write;
+
+    write.event = event;
+
+    if (!this->convertWrite(path, value, write)) {
+        return false;
+    }
+
+    _writes.push_back(write);
+
+    return true;
 }
 
-void PythonStateProvider::onInitImpl(CurrentState& state)
+bool PythonStateProvider::applyWrite(PyObject* path, PyObject* value)
 {
-    std::cout << "python state provider: initializing" << std::endl;
+    // through a write of its own, applied right away
+    Write write;
+
+    if (!this->convertWrite(path, value, write)) {
+        return false;
+    }
+
+    auto node = &_curState->getRoot();
+
+    for (std::size_t c = 0; c < write.componentsCount; ++c) {
+        const auto& component = _components[write.firstComponent + c];
+
+        if (component.isInt) {
+            node = &(*node)[component.intKey];
+        } else {
+            node = &(*node)[component.quark];
+        }
+    }
+
+    *node = write.value;
+    _components.resize(write.firstComponent);
+
+    return true;
 }
 
-void PythonStateProvider::onEventImpl(CurrentState& state, const Event& event)
+bool PythonStateProvider::convertWrite(PyObject* path, PyObject* value,
+                                       Write& write)
 {
-    // getting event
+    auto firstComponent = _components.size();
+
+    write.firstComponent = firstComponent;
+
+    if (!this->convertPath(path)) {
+        return false;
+    }
+
+    write.componentsCount = _components.size() - firstComponent;
+
+    if (!this->convertValue(value, write.value)) {
+        _components.resize(firstComponent);
+
+        return false;
+    }
+
+    return true;
+}
+
+bool PythonStateProvider::convertPath(PyObject* path)
+{
+    auto firstComponent = _components.size();
+
+    if (PyUnicode_Check(path)) {
+        auto pathStr = PyUnicode_AsUTF8(path);
+
+        if (!pathStr) {
+            return false;
+        }
+
+        // subpaths separated by '/'
+        std::string subpath;
+
+        for (auto ch = pathStr; ; ++ch) {
+            if (*ch == '/' || *ch == '\0') {
+                if (!subpath.empty()) {
+                    _components.push_back({false, 0, _curState->getQuark(subpath)});
+                    subpath.clear();
+                }
+
+                if (*ch == '\0') {
+                    break;
+                }
+            } else {
+                subpath += *ch;
+            }
+        }
+    } else if (PyList_Check(path) || PyTuple_Check(path)) {
+        auto size = PySequence_Size(path);
+
+        for (Py_ssize_t x = 0; x < size; ++x) {
+            auto item = PySequence_Fast_GET_ITEM(path, x);
+
+            if (PyLong_Check(item)) {
+                auto key = PyLong_AsLongLong(item);
+
+                if (key == -1 && PyErr_Occurred()) {
+                    _components.resize(firstComponent);
+
+                    return false;
+                }
+
+                _components.push_back({true, key, Quark {}});
+            } else if (PyUnicode_Check(item)) {
+                auto subpath = PyUnicode_AsUTF8(item);
+
+                if (!subpath) {
+                    _components.resize(firstComponent);
+
+                    return false;
+                }
+
+                _components.push_back({false, 0, _curState->getQuark(subpath)});
+            } else {
+                PyErr_SetString(PyExc_TypeError,
+                                "state subpaths must be strings or integers");
+                _components.resize(firstComponent);
+
+                return false;
+            }
+        }
+    } else {
+        PyErr_SetString(PyExc_TypeError,
+                        "state path must be a string, a list or a tuple");
+
+        return false;
+    }
+
+    return true;
+}
+
+bool PythonStateProvider::convertValue(PyObject* value, StateValue& stateValue)
+{
+    if (value == Py_None) {
+        stateValue = StateValue {};
+    } else if (PyLong_Check(value)) {
+        int overflow;
+        auto sint = PyLong_AsLongLongAndOverflow(value, &overflow);
+
+        if (overflow > 0) {
+            auto uint = PyLong_AsUnsignedLongLong(value);
+
+            if (PyErr_Occurred()) {
+                return false;
+            }
+
+            stateValue = StateValue {static_cast<std::uint64_t>(uint)};
+        } else if (overflow < 0) {
+            PyErr_SetString(PyExc_OverflowError, "state value is too small");
+
+            return false;
+        } else if (sint >= std::numeric_limits<std::int32_t>::min() &&
+                sint <= std::numeric_limits<std::int32_t>::max()) {
+            stateValue = StateValue {static_cast<std::int32_t>(sint)};
+        } else {
+            stateValue = StateValue {static_cast<std::int64_t>(sint)};
+        }
+    } else if (PyFloat_Check(value)) {
+        stateValue = StateValue {static_cast<float>(PyFloat_AsDouble(value))};
+    } else if (PyUnicode_Check(value)) {
+        auto string = PyUnicode_AsUTF8(value);
+
+        if (!string) {
+            return false;
+        }
+
+        stateValue = StateValue {_curState->getQuark(string)};
+    } else {
+        PyErr_SetString(PyExc_TypeError,
+                        "state value must be an integer, a float, a string or None");
+
+        return false;
+    }
+
+    return true;
+}
+
+PyObject* PythonStateProvider::getValue(PyObject* path, PyObject* defaultValue)
+{
+    auto firstComponent = _components.size();
+
+    if (!this->convertPath(path)) {
+        return nullptr;
+    }
+
+    // walk existing nodes only
+    StateNode* node = &_curState->getRoot();
+
+    for (auto c = firstComponent; node && c < _components.size(); ++c) {
+        const auto& component = _components[c];
+
+        if (component.isInt) {
+            node = node->getChild(component.intKey);
+        } else {
+            node = node->getChild(component.quark);
+        }
+    }
+
+    _components.resize(firstComponent);
+
+    if (!node || node->isNull()) {
+        if (!defaultValue) {
+            PyErr_SetObject(PyExc_KeyError, path);
+
+            return nullptr;
+        }
+
+        Py_INCREF(defaultValue);
+
+        return defaultValue;
+    }
+
+    if (node->isSint32()) {
+        return PyLong_FromLong(node->asSint32());
+    } else if (node->isUint32()) {
+        return PyLong_FromUnsignedLong(node->asUint32());
+    } else if (node->isSint64()) {
+        return PyLong_FromLongLong(node->asSint64());
+    } else if (node->isUint64()) {
+        return PyLong_FromUnsignedLongLong(node->asUint64());
+    } else if (node->isFloat32()) {
+        return PyFloat_FromDouble(node->asFloat32());
+    }
+
+    auto string = _curState->getString(node->asQuark());
+
+    return PyUnicode_DecodeUTF8(string, std::strlen(string), "replace");
+}
+
+void PythonStateProvider::resetBatch()
+{
+    _batch.clear();
+    _writes.clear();
+    _components.clear();
+    _cursor = 0;
 }
 
 void PythonStateProvider::onFiniImpl(CurrentState& state)
 {
-    std::cout << "python state provider: finishing" << std::endl;
+    if (PyObject_HasAttrString(_module, "on_fini")) {
+        auto ret = PyObject_CallMethod(_module, "on_fini", "O", _state);
+
+        if (!ret) {
+            this->throwPythonError("on_fini()");
+        }
+
+        Py_DECREF(ret);
+    }
+
+    this->resetBatch();
+    _curState = nullptr;
 }
 
 }
@@ -18,26 +18,72 @@
 #ifndef _TIBEE_COMMON_PYTHONSTATEPROVIDER_HPP
 #define _TIBEE_COMMON_PYTHONSTATEPROVIDER_HPP
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
 #include <boost/filesystem.hpp>
 
-#include <common/trace/EventValueType.hpp>
-#include <common/trace/AbstractEventValue.hpp>
+#include <common/BasicTypes.hpp>
+#include <common/state/Quark.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/stateprov/EventDispatchTable.hpp>
 #include "AbstractStateProviderFile.hpp"
 
+// CPython object (see Python.h)
+struct _object;
+
 namespace tibee
 {
 namespace common
 {
 
+class PythonGlue;
+
 /**
  * A state provider which loads a Python user script and calls specific
  * functions to obtain state informations.
  *
+ * The script is run by an embedded CPython interpreter. Its optional
+ * on_init(ctx) function registers event handlers with
+ * ctx.register(trace_type, event_name, handler) and
+ * ctx.register_regex(trace_type_re, event_name_re, handler) (same
+ * semantics as registerEventCallback() and
+ * registerEventCallbackRegex()); ctx.params is the dictionary of
+ * provider parameters and ctx.state the state.
+ *
+ * Events are delivered by batches: for each batch of events, each
+ * handler is called once as handler(events, state), where events is
+ * the list, in time order, of the events of the batch it handles.
+ * Each event is a view over the decoded event (ev.name,
+ * ev.timestamp, ev.id, ev.trace_id, ev[field] and
+ * ev.get(field, default)): field values are only converted when
+ * accessed, and events are only valid during the handler call.
+ * Handlers of different event types see their events in separate
+ * lists.
+ *
+ * State changes are made with state.set(ev, path, value), where path
+ * is a list of subpaths (strings or integers) or a string of subpaths
+ * separated by <code>/</code>, and value is an integer, a float, a
+ * string or None. They are buffered and applied when event ev is
+ * dispatched, at its timestamp. With ev set to None, the change is
+ * applied immediately, at the current timestamp (meant for on_init()
+ * and on_fini(state)).
+ *
+ * state.get(path, default=None) and state[path] read a state value
+ * (default, or KeyError, if there's none). Handlers read the state as
+ * it was before the first event of the batch: their buffered changes
+ * are not visible yet.
+ *
+ * Throws ex::WrongStateProvider on any Python error.
+ *
  * @author Philippe Proulx
  */
 class PythonStateProvider :
     public AbstractStateProviderFile
 {
+    friend class PythonGlue;
+
 public:
     /**
      * Builds a Python state provider.
@@ -51,9 +97,79 @@ public:
     ~PythonStateProvider();
 
 private:
-    void onInitImpl(CurrentState& state);
-    void onEventImpl(CurrentState& state, const Event& event);
+    // event of the current batch handled by this provider
+    struct BatchEvent
+    {
+        const Event* event;
+        std::size_t handler;
+
+        // first buffered write for this event (index in _writes)
+        std::size_t firstWrite;
+    };
+
+    // subpath of a buffered write
+    struct PathComponent
+    {
+        bool isInt;
+        std::int64_t intKey;
+        Quark quark;
+    };
+
+    // buffered state write
+    struct Write
+    {
+        std::size_t event;
+        std::size_t firstComponent;
+        std::size_t componentsCount;
+        StateValue value;
+    };
+
+private:
+    void onInitImpl(CurrentState& state, const TraceSet* traceSet);
+    void onBatchImpl(CurrentState& state, const EventBatch& batch);
     void onFiniImpl(CurrentState& state);
+    bool onEvent(CurrentState& state, const Event& event, std::size_t handler);
+    void runHandlers(bool profile);
+    void applyWrites(std::size_t event);
+    bool registerHandler(const std::string& traceType,
+                         const std::string& eventName, _object* handler,
+                         bool regex);
+    bool bufferWrite(std::size_t event, _object* path, _object* value);
+    bool applyWrite(_object* path, _object* value);
+    bool convertWrite(_object* path, _object* value, Write& write);
+    bool convertPath(_object* path);
+    bool convertValue(_object* value, StateValue& stateValue);
+    _object* getValue(_object* path, _object* defaultValue);
+    void resetBatch();
+    void throwPythonError(const std::string& what);
+
+private:
+    // script module, context and state objects
+    _object* _module;
+    _object* _ctx;
+    _object* _state;
+
+    // Python event handlers
+    std::vector<_object*> _handlers;
+
+    // this provider's event callbacks, to select the events of a batch
+    EventDispatchTable _collectTable;
+
+    // true while selecting the events of a batch
+    bool _collecting;
+
+    // events of the current batch, in time order
+    std::vector<BatchEvent> _batch;
+
+    // index in _batch of the next event to apply
+    std::size_t _cursor;
+
+    // buffered writes and their subpaths
+    std::vector<Write> _writes;
+    std::vector<PathComponent> _components;
+
+    // current state, valid between onInit() and onFini() incl.
+    CurrentState* _curState;
 };
 
 }
@@ -0,0 +1,713 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstring>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <sstream>
+#include <utility>
+#include <boost/filesystem/fstream.hpp>
+#include <boost/regex.hpp>
+
+#include <common/state/CurrentState.hpp>
+#include <common/state/StateNode.hpp>
+#include <common/stateprov/RuleStateProvider.hpp>
+#include <common/trace/AbstractEventValue.hpp>
+#include <common/trace/EventValueType.hpp>
+#include <common/trace/TraceSet.hpp>
+#include <common/utils/JsonParser.hpp>
+#include <common/ex/WrongStatePath.hpp>
+#include <common/ex/WrongStateProvider.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+const std::uint32_t RuleStateProvider::NO_FIELD;
+
+RuleStateProvider::RuleStateProvider(const bfs::path& path,
+                                     const StateProviderConfig& config) :
+    AbstractStateProviderFile {path, config},
+    _traceSet {nullptr}
+{
+    this->load();
+}
+
+RuleStateProvider::~RuleStateProvider()
+{
+}
+
+void RuleStateProvider::load()
+{
+    const auto& path = this->getPath();
+
+    // read and parse whole file
+    bfs::ifstream input {path};
+    std::stringstream json;
+
+    if (!input) {
+        throw ex::WrongStateProvider {"cannot read rules file", path};
+    }
+
+    json << input.rdbuf();
+
+    JsonParser parser;
+    auto root = parser.parse(json.str());
+
+    if (!root) {
+        throw ex::WrongStateProvider {"rules file is not valid JSON", path};
+    }
+
+    auto error = [&path] (std::size_t rule, const std::string& msg) {
+        return ex::WrongStateProvider {
+            "rule " + std::to_string(rule) + ": " + msg, path
+        };
+    };
+
+    auto fieldRef = [] (const std::string& name) {
+        FieldRef field {FieldHandle::Scope::FIELDS, false, name};
+
+        if (name.compare(0, 8, "context.") == 0) {
+            field.scope = FieldHandle::Scope::CONTEXT;
+            field.name = name.substr(8);
+        } else if (name.compare(0, 15, "packet_context.") == 0) {
+            field.isPacketContext = true;
+            field.name = name.substr(15);
+        }
+
+        return field;
+    };
+
+    auto literal = [] (const JsonValue& value, Literal& literal) {
+        literal.type = Literal::Type::NUL;
+
+        switch (value.type) {
+        case JsonValue::Type::NUL:
+            return true;
+
+        case JsonValue::Type::BOOL:
+            literal.type = Literal::Type::INT;
+            literal.intValue = value.boolValue ? 1 : 0;
+            return true;
+
+        case JsonValue::Type::INT:
+            literal.type = Literal::Type::INT;
+            literal.intValue = value.intValue;
+            return true;
+
+        case JsonValue::Type::DOUBLE:
+            literal.type = Literal::Type::FLOAT;
+            literal.floatValue = value.doubleValue;
+            return true;
+
+        case JsonValue::Type::STRING:
+            literal.type = Literal::Type::STRING;
+            literal.stringValue = value.stringValue;
+            return true;
+
+        default:
+            return false;
+        }
+    };
+
+    auto rules = root->type == JsonValue::Type::MAP ? root->find("rules") : nullptr;
+
+    if (!rules || rules->type != JsonValue::Type::ARRAY) {
+        throw ex::WrongStateProvider {"missing \"rules\" array", path};
+    }
+
+    for (std::size_t r = 0; r < rules->items.size(); ++r) {
+        const auto& ruleValue = *rules->items[r];
+
+        if (ruleValue.type != JsonValue::Type::MAP) {
+            throw error(r, "rule is not an object");
+        }
+
+        RuleSpec rule {};
+        auto traceType = ruleValue.find("trace-type");
+        auto eventName = ruleValue.find("event");
+        auto regex = ruleValue.find("regex");
+        auto tests = ruleValue.find("if");
+        auto sets = ruleValue.find("set");
+
+        if (traceType && traceType->type != JsonValue::Type::STRING) {
+            throw error(r, "\"trace-type\" is not a string");
+        }
+
+        if (!eventName || eventName->type != JsonValue::Type::STRING) {
+            throw error(r, "missing \"event\" string");
+        }
+
+        if (regex && regex->type != JsonValue::Type::BOOL) {
+            throw error(r, "\"regex\" is not a boolean");
+        }
+
+        rule.traceType = traceType ? traceType->stringValue : "";
+        rule.eventName = eventName->stringValue;
+        rule.regex = regex ? regex->boolValue : false;
+
+        if (rule.regex) {
+            try {
+                boost::regex {rule.traceType};
+                boost::regex {rule.eventName};
+            } catch (const std::exception& ex) {
+                throw error(r, "invalid regular expression");
+            }
+        }
+
+        // predicates
+        if (tests && tests->type != JsonValue::Type::ARRAY) {
+            throw error(r, "\"if\" is not an array");
+        }
+
+        for (std::size_t x = 0; tests && x < tests->items.size(); ++x) {
+            static const char* operators[] = {"==", "!=", "<", "<=", ">", ">="};
+            const auto& testValue = *tests->items[x];
+
+            if (testValue.type != JsonValue::Type::ARRAY ||
+                    testValue.items.size() != 3 ||
+                    testValue.items[0]->type != JsonValue::Type::STRING ||
+                    testValue.items[1]->type != JsonValue::Type::STRING) {
+                throw error(r, "predicate is not a [field, operator, value] array");
+            }
+
+            TestSpec test {};
+            std::size_t op;
+
+            for (op = 0; op < 6; ++op) {
+                if (testValue.items[1]->stringValue == operators[op]) {
+                    break;
+                }
+            }
+
+            if (op == 6) {
+                throw error(r, "unknown operator \"" + testValue.items[1]->stringValue + "\"");
+            }
+
+            test.field = fieldRef(testValue.items[0]->stringValue);
+            test.compare = static_cast<Compare>(op);
+
+            if (!literal(*testValue.items[2], test.value) ||
+                    (test.value.type != Literal::Type::INT &&
+                     test.value.type != Literal::Type::STRING)) {
+                throw error(r, "predicate value is not an integer or a string");
+            }
+
+            if (test.value.type == Literal::Type::STRING &&
+                    test.compare != Compare::EQ && test.compare != Compare::NE) {
+                throw error(r, "strings may only be compared with == and !=");
+            }
+
+            rule.tests.push_back(test);
+        }
+
+        // state changes
+        if (!sets || sets->type != JsonValue::Type::ARRAY) {
+            throw error(r, "missing \"set\" array");
+        }
+
+        for (std::size_t x = 0; x < sets->items.size(); ++x) {
+            const auto& setValue = *sets->items[x];
+
+            if (setValue.type != JsonValue::Type::ARRAY ||
+                    setValue.items.size() != 2 ||
+                    setValue.items[0]->type != JsonValue::Type::STRING) {
+                throw error(r, "state change is not a [path, value] array");
+            }
+
+            SetSpec set {};
+
+            // variable subpaths: {field}
+            const auto& pathTemplate = setValue.items[0]->stringValue;
+            std::size_t begin = 0;
+
+            while (begin <= pathTemplate.size()) {
+                auto end = pathTemplate.find('/', begin);
+
+                if (end == std::string::npos) {
+                    end = pathTemplate.size();
+                }
+
+                auto subpath = pathTemplate.substr(begin, end - begin);
+
+                if (subpath.size() > 2 && subpath.front() == '{' &&
+                        subpath.back() == '}') {
+                    set.variables.push_back(fieldRef(subpath.substr(1, subpath.size() - 2)));
+                    subpath = "{int}";
+                }
+
+                if (!set.pathTemplate.empty()) {
+                    set.pathTemplate += '/';
+                }
+
+                set.pathTemplate += subpath;
+                begin = end + 1;
+            }
+
+            if (set.variables.size() > StatePathHandle::MAX_VARIABLES) {
+                throw error(r, "too many variable subpaths in \"" + pathTemplate + "\"");
+            }
+
+            // value: literal or {"field": field}
+            const auto& value = *setValue.items[1];
+            auto fieldName = value.type == JsonValue::Type::MAP ? value.find("field") : nullptr;
+
+            set.isField = (fieldName != nullptr);
+
+            if (set.isField) {
+                if (fieldName->type != JsonValue::Type::STRING) {
+                    throw error(r, "\"field\" is not a string");
+                }
+
+                set.field = fieldRef(fieldName->stringValue);
+            } else if (!literal(value, set.value)) {
+                throw error(r, "unknown state value");
+            }
+
+            rule.sets.push_back(set);
+        }
+
+        _rules.push_back(rule);
+    }
+}
+
+void RuleStateProvider::onInitImpl(CurrentState& state,
+                                   const TraceSet* traceSet)
+{
+    _traceSet = traceSet;
+    _code.clear();
+    _fields.clear();
+    _paths.clear();
+    _constants.clear();
+    _literals.clear();
+
+    // matching (trace type, event name) pairs of each rule
+    typedef std::pair<std::string, std::string> EventKey;
+
+    std::map<EventKey, std::vector<std::size_t>> eventRules;
+    std::vector<std::vector<Instruction>> rulesCode;
+
+    rulesCode.resize(_rules.size());
+
+    for (std::size_t r = 0; r < _rules.size(); ++r) {
+        const auto& rule = _rules[r];
+        boost::regex traceTypeBre;
+        boost::regex eventNameBre;
+        std::set<std::string> eventNames;
+
+        if (rule.regex) {
+            traceTypeBre = rule.traceType;
+            eventNameBre = rule.eventName;
+        }
+
+        for (const auto& traceInfos : traceSet->getTracesInfos()) {
+            const auto& traceType = traceInfos->getTraceType();
+
+            if (rule.regex ? !boost::regex_search(traceType, traceTypeBre) :
+                    !(rule.traceType.empty() || rule.traceType == traceType)) {
+                continue;
+            }
+
+            for (const auto& eventNameIdPair : *traceInfos->getEventMap()) {
+                const auto& eventName = eventNameIdPair.first;
+
+                if (rule.regex ? !boost::regex_search(eventName, eventNameBre) :
+                        rule.eventName != eventName) {
+                    continue;
+                }
+
+                auto& ruleIndexes = eventRules[EventKey {traceType, eventName}];
+
+                if (ruleIndexes.empty() || ruleIndexes.back() != r) {
+                    ruleIndexes.push_back(r);
+                }
+
+                eventNames.insert(eventName);
+            }
+        }
+
+        if (!eventNames.empty()) {
+            std::vector<std::string> eventNamesVec {eventNames.begin(), eventNames.end()};
+
+            this->compileRule(state, rule, eventNamesVec, rulesCode[r]);
+        }
+    }
+
+    // one program per event: its rules, in order
+    for (const auto& eventKeyRulesPair : eventRules) {
+        auto pc = _code.size();
+
+        for (auto r : eventKeyRulesPair.second) {
+            const auto& ruleCode = rulesCode[r];
+            auto ruleBegin = _code.size();
+
+            _code.insert(_code.end(), ruleCode.begin(), ruleCode.end());
+            _code[ruleBegin].a = static_cast<std::uint32_t>(_code.size());
+        }
+
+        _code.push_back({Opcode::END, Compare::EQ, 0, 0, 0});
+
+        this->registerEventCallback(eventKeyRulesPair.first.first,
+                                    eventKeyRulesPair.first.second,
+                                    [this, pc] (CurrentState& state, const Event& event) {
+            return this->run(state, event, pc);
+        });
+    }
+
+    _traceSet = nullptr;
+}
+
+void RuleStateProvider::compileRule(CurrentState& state, const RuleSpec& rule,
+                                    const std::vector<std::string>& eventNames,
+                                    std::vector<Instruction>& code)
+{
+    code.push_back({Opcode::RULE, Compare::EQ, 0, 0, 0});
+
+    for (const auto& test : rule.tests) {
+        auto field = this->compileField(test.field, eventNames);
+
+        code.push_back({
+            Opcode::TEST,
+            test.compare,
+            field,
+            static_cast<std::uint32_t>(_literals.size()),
+            0
+        });
+        _literals.push_back(test.value);
+    }
+
+    for (const auto& set : rule.sets) {
+        // path
+        Instruction node {Opcode::NODE, Compare::EQ, 0, NO_FIELD, NO_FIELD};
+
+        try {
+            node.a = static_cast<std::uint32_t>(_paths.size());
+            _paths.push_back(state.compilePath(set.pathTemplate));
+        } catch (const ex::WrongStatePath& ex) {
+            throw ex::WrongStateProvider {
+                std::string {ex.what()} + ": \"" + ex.getPath() + "\"",
+                this->getPath()
+            };
+        }
+
+        if (set.variables.size() >= 1) {
+            node.b = this->compileField(set.variables[0], eventNames);
+        }
+
+        if (set.variables.size() >= 2) {
+            node.c = this->compileField(set.variables[1], eventNames);
+        }
+
+        code.push_back(node);
+
+        // value
+        if (set.isField) {
+            code.push_back({
+                Opcode::SET_FIELD,
+                Compare::EQ,
+                this->compileField(set.field, eventNames),
+                0,
+                0
+            });
+            continue;
+        }
+
+        StateValue value;
+
+        switch (set.value.type) {
+        case Literal::Type::INT:
+            if (set.value.intValue >= std::numeric_limits<std::int32_t>::min() &&
+                    set.value.intValue <= std::numeric_limits<std::int32_t>::max()) {
+                value = StateValue {static_cast<std::int32_t>(set.value.intValue)};
+            } else {
+                value = StateValue {set.value.intValue};
+            }
+            break;
+
+        case Literal::Type::FLOAT:
+            value = StateValue {static_cast<float>(set.value.floatValue)};
+            break;
+
+        case Literal::Type::STRING:
+            value = StateValue {state.getQuark(set.value.stringValue)};
+            break;
+
+        default:
+            break;
+        }
+
+        code.push_back({
+            Opcode::SET_CONST,
+            Compare::EQ,
+            static_cast<std::uint32_t>(_constants.size()),
+            0,
+            0
+        });
+        _constants.push_back(value);
+    }
+}
+
+std::uint32_t RuleStateProvider::compileField(const FieldRef& field,
+                                              const std::vector<std::string>& eventNames)
+{
+    Field compiledField;
+
+    compiledField.isPacketContext = field.isPacketContext;
+    compiledField.name = field.name;
+
+    // packet context fields are looked up by name
+    if (!field.isPacketContext) {
+        compiledField.handle = FieldHandle {
+            _traceSet, eventNames, field.name, field.scope
+        };
+    }
+
+    _fields.push_back(std::move(compiledField));
+
+    return static_cast<std::uint32_t>(_fields.size() - 1);
+}
+
+const AbstractEventValue& RuleStateProvider::getField(const Event& event,
+                                                      std::uint32_t field) const
+{
+    const auto& compiledField = _fields[field];
+
+    if (compiledField.isPacketContext) {
+        return event.getStreamPacketContext()[compiledField.name];
+    }
+
+    return event[compiledField.handle];
+}
+
+bool RuleStateProvider::getInt(const AbstractEventValue& value,
+                               std::int64_t& intValue)
+{
+    switch (value.getType()) {
+    case EventValueType::SINT:
+        intValue = value.asSint();
+        return true;
+
+    case EventValueType::UINT:
+        intValue = static_cast<std::int64_t>(value.asUint());
+        return true;
+
+    case EventValueType::ENUM:
+        intValue = static_cast<std::int64_t>(value.asEnumInt());
+        return true;
+
+    default:
+        return false;
+    }
+}
+
+bool RuleStateProvider::getKey(CurrentState& state, const Event& event,
+                               std::uint32_t field,
+                               StatePathHandle::VariableKey& key) const
+{
+    const auto& value = this->getField(event, field);
+
+    // string fields are string keys
+    if (value.getType() == EventValueType::STRING) {
+        key.value = static_cast<std::int64_t>(state.getQuark(value.asString()).get());
+        key.isQuark = true;
+
+        return true;
+    }
+
+    key.isQuark = false;
+
+    return RuleStateProvider::getInt(value, key.value);
+}
+
+bool RuleStateProvider::test(const Event& event,
+                             const Instruction& instruction) const
+{
+    const auto& literal = _literals[instruction.b];
+    const auto& value = this->getField(event, instruction.a);
+
+    // string comparison
+    if (literal.type == Literal::Type::STRING) {
+        const char* string;
+
+        if (value.getType() == EventValueType::STRING) {
+            string = value.asString();
+        } else if (value.getType() == EventValueType::ENUM) {
+            string = value.asEnumLabel();
+        } else {
+            return false;
+        }
+
+        auto equal = string && literal.stringValue == string;
+
+        return (instruction.compare == Compare::EQ) == equal;
+    }
+
+    // integer comparison
+    std::int64_t intValue;
+
+    if (!RuleStateProvider::getInt(value, intValue)) {
+        return false;
+    }
+
+    switch (instruction.compare) {
+    case Compare::EQ:
+        return intValue == literal.intValue;
+
+    case Compare::NE:
+        return intValue != literal.intValue;
+
+    case Compare::LT:
+        return intValue < literal.intValue;
+
+    case Compare::LE:
+        return intValue <= literal.intValue;
+
+    case Compare::GT:
+        return intValue > literal.intValue;
+
+    case Compare::GE:
+        return intValue >= literal.intValue;
+    }
+
+    return false;
+}
+
+bool RuleStateProvider::run(CurrentState& state, const Event& event,
+                            std::size_t pc)
+{
+    std::size_t nextRule = 0;
+    StateNode* node = nullptr;
+
+    while (true) {
+        const auto& instruction = _code[pc];
+
+        switch (instruction.opcode) {
+        case Opcode::RULE:
+            nextRule = instruction.a;
+            pc++;
+            break;
+
+        case Opcode::TEST:
+            pc = this->test(event, instruction) ? pc + 1 : nextRule;
+            break;
+
+        case Opcode::NODE:
+        {
+            auto& path = _paths[instruction.a];
+            StatePathHandle::VariableKey key1;
+            StatePathHandle::VariableKey key2;
+
+            if (instruction.b == NO_FIELD) {
+                node = &path.getNode();
+            } else if (!this->getKey(state, event, instruction.b, key1)) {
+                pc = nextRule;
+                break;
+            } else if (instruction.c == NO_FIELD) {
+                node = &path.getNode(key1);
+            } else if (!this->getKey(state, event, instruction.c, key2)) {
+                pc = nextRule;
+                break;
+            } else {
+                node = &path.getNode(key1, key2);
+            }
+
+            pc++;
+            break;
+        }
+
+        case Opcode::SET_CONST:
+            *node = _constants[instruction.a];
+            pc++;
+            break;
+
+        case Opcode::SET_FIELD:
+        {
+            const auto& value = this->getField(event, instruction.a);
+
+            switch (value.getType()) {
+            case EventValueType::SINT:
+            {
+                auto sint = value.asSint();
+
+                if (sint >= std::numeric_limits<std::int32_t>::min() &&
+                        sint <= std::numeric_limits<std::int32_t>::max()) {
+                    *node = static_cast<std::int32_t>(sint);
+                } else {
+                    *node = sint;
+                }
+                break;
+            }
+
+            case EventValueType::UINT:
+            {
+                auto uint = value.asUint();
+
+                if (uint <= std::numeric_limits<std::uint32_t>::max()) {
+                    *node = static_cast<std::uint32_t>(uint);
+                } else {
+                    *node = uint;
+                }
+                break;
+            }
+
+            case EventValueType::FLOAT:
+                *node = static_cast<float>(value.asFloat());
+                break;
+
+            case EventValueType::STRING:
+                *node = state.getQuark(value.asString());
+                break;
+
+            case EventValueType::ENUM:
+                if (value.asEnumLabel()) {
+                    *node = state.getQuark(value.asEnumLabel());
+                } else {
+                    *node = value.asEnumInt();
+                }
+                break;
+
+            default:
+                pc = nextRule;
+                continue;
+            }
+
+            pc++;
+            break;
+        }
+
+        case Opcode::END:
+            return true;
+        }
+    }
+}
+
+void RuleStateProvider::onFiniImpl(CurrentState& state)
+{
+    _code.clear();
+    _fields.clear();
+    _paths.clear();
+    _constants.clear();
+    _literals.clear();
+}
+
+}
+}
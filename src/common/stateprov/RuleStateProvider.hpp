@@ -0,0 +1,235 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_RULESTATEPROVIDER_HPP
+#define _TIBEE_COMMON_RULESTATEPROVIDER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include <common/state/StatePathHandle.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/trace/FieldHandle.hpp>
+#include "AbstractStateProviderFile.hpp"
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * A state provider which loads declarative rules from a JSON file.
+ *
+ * The file contains an object with a <code>rules</code> array. Each
+ * rule applies to the events named <code>event</code> of traces of
+ * type <code>trace-type</code> (both regular expressions if
+ * <code>regex</code> is true; same semantics as
+ * registerEventCallback() and registerEventCallbackRegex()), and is
+ * made of:
+ *
+ *   - <code>if</code> (optional): array of
+ *     <code>[field, operator, value]</code> predicates which must all
+ *     be true for the rule to apply, where operator is one of
+ *     <code>==</code>, <code>!=</code>, <code>&lt;</code>,
+ *     <code>&lt;=</code>, <code>&gt;</code> and <code>&gt;=</code>,
+ *     and value an integer or a string (<code>==</code> and
+ *     <code>!=</code> only);
+ *   - <code>set</code>: array of <code>[path, value]</code> state
+ *     changes, applied in order, where path is a state path template
+ *     whose variable subpaths (at most StatePathHandle::MAX_VARIABLES)
+ *     are integer or string fields, e.g.
+ *     <code>linux/threads/{next_tid}/status</code> (integer fields
+ *     give integer keys, like StateNode::operator[](std::int64_t)),
+ *     and value is an integer, a float, a string, null or
+ *     <code>{"field": field}</code> to copy the value of a field.
+ *
+ * A field is a name within the event fields, or within the event
+ * context or stream packet context with the <code>context.</code> or
+ * <code>packet_context.</code> prefix, e.g.
+ * <code>packet_context.cpu_id</code>.
+ *
+ * Rules are applied in file order. When a field used by a rule is
+ * missing or has an unexpected type, the rest of the rule is skipped.
+ *
+ * Rules are compiled when initializing the provider: fields are
+ * resolved to field handles, paths to state path handles and string
+ * values to quarks, and the rules of each event are translated to a
+ * small program run for each event, so that no name is compared when
+ * handling events.
+ *
+ * Throws ex::WrongStateProvider if the rules file is invalid.
+ *
+ * @author Philippe Proulx
+ */
+class RuleStateProvider :
+    public AbstractStateProviderFile
+{
+public:
+    /**
+     * Builds a rule state provider, loading its rules.
+     *
+     * @param path   Rules file path
+     * @param config State provider configuration
+     */
+    RuleStateProvider(const boost::filesystem::path& path,
+                      const StateProviderConfig& config);
+
+    ~RuleStateProvider();
+
+private:
+    enum class Compare : std::uint8_t
+    {
+        EQ,
+        NE,
+        LT,
+        LE,
+        GT,
+        GE,
+    };
+
+    enum class Opcode : std::uint8_t
+    {
+        // begin rule (a: index of next rule's first instruction)
+        RULE,
+
+        // test field a against literal b (skip rule if false)
+        TEST,
+
+        // select node of path handle a (variables: fields b and c)
+        NODE,
+
+        // set selected node to constant a
+        SET_CONST,
+
+        // set selected node to value of field a
+        SET_FIELD,
+
+        // end of program
+        END,
+    };
+
+    // event field reference
+    struct FieldRef
+    {
+        FieldHandle::Scope scope;
+        bool isPacketContext;
+        std::string name;
+    };
+
+    // literal value of a rule
+    struct Literal
+    {
+        enum class Type
+        {
+            NUL,
+            INT,
+            FLOAT,
+            STRING,
+        };
+
+        Type type;
+        std::int64_t intValue;
+        double floatValue;
+        std::string stringValue;
+    };
+
+    struct TestSpec
+    {
+        FieldRef field;
+        Compare compare;
+        Literal value;
+    };
+
+    struct SetSpec
+    {
+        std::string pathTemplate;
+        std::vector<FieldRef> variables;
+        bool isField;
+        FieldRef field;
+        Literal value;
+    };
+
+    struct RuleSpec
+    {
+        std::string traceType;
+        std::string eventName;
+        bool regex;
+        std::vector<TestSpec> tests;
+        std::vector<SetSpec> sets;
+    };
+
+    struct Instruction
+    {
+        Opcode opcode;
+        Compare compare;
+        std::uint32_t a;
+        std::uint32_t b;
+        std::uint32_t c;
+    };
+
+    // compiled field reference
+    struct Field
+    {
+        FieldHandle handle;
+        bool isPacketContext;
+        std::string name;
+    };
+
+private:
+    static const std::uint32_t NO_FIELD = 0xffffffff;
+
+private:
+    void onInitImpl(CurrentState& state, const TraceSet* traceSet);
+    void onFiniImpl(CurrentState& state);
+    bool run(CurrentState& state, const Event& event, std::size_t pc);
+    const AbstractEventValue& getField(const Event& event,
+                                       std::uint32_t field) const;
+    static bool getInt(const AbstractEventValue& value, std::int64_t& intValue);
+    bool getKey(CurrentState& state, const Event& event, std::uint32_t field,
+                StatePathHandle::VariableKey& key) const;
+    bool test(const Event& event, const Instruction& instruction) const;
+    void load();
+    void compileRule(CurrentState& state, const RuleSpec& rule,
+                     const std::vector<std::string>& eventNames,
+                     std::vector<Instruction>& code);
+    std::uint32_t compileField(const FieldRef& field,
+                               const std::vector<std::string>& eventNames);
+
+private:
+    // rules, as loaded
+    std::vector<RuleSpec> _rules;
+
+    // current trace set (while compiling)
+    const TraceSet* _traceSet;
+
+    // programs of all events
+    std::vector<Instruction> _code;
+
+    // fields, path handles, constants and test literals of _code
+    std::vector<Field> _fields;
+    std::vector<StatePathHandle> _paths;
+    std::vector<StateValue> _constants;
+    std::vector<Literal> _literals;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_RULESTATEPROVIDER_HPP
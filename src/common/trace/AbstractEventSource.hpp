@@ -0,0 +1,124 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_ABSTRACTEVENTSOURCE_HPP
+#define _TIBEE_COMMON_ABSTRACTEVENTSOURCE_HPP
+
+#include <boost/utility.hpp>
+
+#include <common/trace/Event.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Abstract source of time-ordered events which a trace set iterator
+ * may follow instead of the trace set's own Babeltrace iterator.
+ *
+ * @author Philippe Proulx
+ */
+class AbstractEventSource :
+    boost::noncopyable
+{
+public:
+    virtual ~AbstractEventSource()
+    {
+    }
+
+    /**
+     * Moves to the next event, invalidating the current one.
+     *
+     * @returns True if there's a current event, false when done
+     */
+    bool next()
+    {
+        return this->nextImpl();
+    }
+
+    /**
+     * Returns the current event.
+     *
+     * Only valid after a successful call to next(), and until the next
+     * call to next().
+     *
+     * @returns Current event
+     */
+    const Event& getCurrentEvent() const
+    {
+        return this->getCurrentEventImpl();
+    }
+
+    /**
+     * Returns whether or not this event source may keep its events
+     * valid after next() (see keepCurrentEvent()).
+     *
+     * @returns True if this event source may keep events
+     */
+    bool canKeepEvents() const
+    {
+        return this->canKeepEventsImpl();
+    }
+
+    /**
+     * Asks this event source to keep the current event valid after
+     * the next call to next(), until releaseKeptEvents() is called,
+     * so that a consumer may use it without copying it.
+     *
+     * Always fails if canKeepEvents() returns false.
+     *
+     * @returns True if the current event is kept, false if this event
+     *          source cannot keep any more events
+     */
+    bool keepCurrentEvent()
+    {
+        return this->keepCurrentEventImpl();
+    }
+
+    /**
+     * Releases all the events kept by keepCurrentEvent(), which must
+     * not be used afterwards.
+     */
+    void releaseKeptEvents()
+    {
+        this->releaseKeptEventsImpl();
+    }
+
+private:
+    virtual bool nextImpl() = 0;
+    virtual const Event& getCurrentEventImpl() const = 0;
+
+    virtual bool canKeepEventsImpl() const
+    {
+        return false;
+    }
+
+    virtual bool keepCurrentEventImpl()
+    {
+        return false;
+    }
+
+    virtual void releaseKeptEventsImpl()
+    {
+    }
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_ABSTRACTEVENTSOURCE_HPP
@@ -49,7 +49,26 @@ public:
     AbstractIntegerEventValue(const ::bt_definition* def,
                               const EventValueFactory* valueFactory) :
         AbstractEventValue {VT, valueFactory},
-        _btDef {def}
+        _btDef {def},
+        _detached {false}
+    {
+    }
+
+    /**
+     * Builds an abstract integer event value out of an already
+     * decoded integer (not attached to any BT definition).
+     *
+     * @param value        Integer value
+     * @param base         Expected display base or -1
+     * @param valueFactory Value factory used to create other event values
+     */
+    AbstractIntegerEventValue(T value, int base,
+                              const EventValueFactory* valueFactory) :
+        AbstractEventValue {VT, valueFactory},
+        _btDef {nullptr},
+        _detached {true},
+        _detachedValue {value},
+        _detachedBase {base}
     {
     }
 
@@ -68,6 +87,10 @@ public:
      */
     int getDisplayBase() const
     {
+        if (_detached) {
+            return _detachedBase;
+        }
+
         auto decl = ::bt_ctf_get_decl_from_def(_btDef);
         auto base = ::bt_ctf_get_int_base(decl);
 
@@ -295,16 +318,36 @@ protected:
         return _btDef;
     }
 
+    /**
+     * Copies the value and display base out of the BT definition;
+     * the BT definition is not used anymore afterwards.
+     *
+     * Must be called by the most derived class once it is built.
+     */
+    void detach()
+    {
+        _detachedBase = this->getDisplayBase();
+        _detachedValue = this->getValueImpl();
+        _detached = true;
+    }
+
 private:
     virtual T getValueImpl() const = 0;
 
 private:
     const ::bt_definition* _btDef;
+    bool _detached;
+    T _detachedValue;
+    int _detachedBase;
 };
 
 template<typename T, EventValueType VT>
 T AbstractIntegerEventValue<T, VT>::getValue() const
 {
+    if (_detached) {
+        return _detachedValue;
+    }
+
     return this->getValueImpl();
 }
 
@@ -36,11 +36,31 @@ ArrayEventValue::ArrayEventValue(const ::bt_definition* def, const ::bt_ctf_even
     _btDef {def},
     _btEvent {ev},
     _btFieldList {nullptr},
-    _size {0}
+    _size {0},
+    _detached {false}
 {
     this->buildCache();
 }
 
+ArrayEventValue::ArrayEventValue(std::size_t childrenIndex, std::size_t size,
+                                 const char* text,
+                                 const EventValueFactory* valueFactory) :
+    AbstractEventValue {EventValueType::ARRAY, valueFactory},
+    _btDef {nullptr},
+    _btDecl {nullptr},
+    _btEvent {nullptr},
+    _btFieldList {nullptr},
+    _size {size},
+    _detached {true},
+    _detachedIndex {childrenIndex},
+    _detachedIsString {text != nullptr},
+    _detachedHasString {text != nullptr}
+{
+    if (text) {
+        _detachedStringOffset = valueFactory->copyDetachedString(text, size);
+    }
+}
+
 void ArrayEventValue::buildCache()
 {
     _btDecl = ::bt_ctf_get_decl_from_def(_btDef);
@@ -52,6 +72,37 @@ void ArrayEventValue::buildCache()
     if (ret == 0) {
         _size = count;
     }
+
+    if (!this->getValueFactory()->isDetached()) {
+        return;
+    }
+
+    // build all items and copy the string representation now
+    auto valueFactory = this->getValueFactory();
+
+    _detachedIsString = this->isString();
+
+    const char* str = nullptr;
+
+    if (_detachedIsString) {
+        str = this->getString();
+    }
+
+    _detachedHasString = (str != nullptr);
+
+    if (str) {
+        _detachedStringOffset = valueFactory->copyDetachedString(str);
+    }
+
+    _detachedIndex = valueFactory->reserveDetachedChildren(_size);
+
+    for (std::size_t x = 0; x < _size; ++x) {
+        valueFactory->setDetachedChild(_detachedIndex + x,
+                                       valueFactory->buildEventValue(_btFieldList[x], _btEvent),
+                                       nullptr);
+    }
+
+    _detached = true;
 }
 
 std::size_t ArrayEventValue::size() const
@@ -61,6 +112,10 @@ std::size_t ArrayEventValue::size() const
 
 const AbstractEventValue* ArrayEventValue::get(field_index_t index) const
 {
+    if (_detached) {
+        return this->getValueFactory()->getDetachedChild(_detachedIndex + index);
+    }
+
     // this should work for both CTF array and sequence
     auto itemDef = _btFieldList[index];
 
@@ -89,6 +144,10 @@ const AbstractEventValue& ArrayEventValue::getFieldImpl(field_index_t index) con
 
 bool ArrayEventValue::isString() const
 {
+    if (_detached) {
+        return _detachedIsString;
+    }
+
     auto encoding = ::bt_ctf_get_encoding(_btDecl);
 
     return encoding == ::CTF_STRING_UTF8 || encoding == ::CTF_STRING_ASCII;
@@ -96,6 +155,14 @@ bool ArrayEventValue::isString() const
 
 const char* ArrayEventValue::getString() const
 {
+    if (_detached) {
+        if (!_detachedHasString) {
+            return nullptr;
+        }
+
+        return this->getValueFactory()->getDetachedString(_detachedStringOffset);
+    }
+
     if (::bt_ctf_field_type(_btDecl) == CTF_TYPE_SEQUENCE) {
         // FIXME: find the proper way to retrieve a CTF sequence string
         return nullptr;
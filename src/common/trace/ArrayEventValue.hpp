@@ -52,6 +52,22 @@ public:
     ArrayEventValue(const ::bt_definition* def, const ::bt_ctf_event* ev,
                     const EventValueFactory* valueFactory);
 
+    /**
+     * Builds an array value out of detached items already set in the
+     * value factory (see EventValueFactory::setDetachedChild()).
+     *
+     * If \p text is not \a nullptr, this array is a string and
+     * \p text points to its \p size raw characters (not necessarily
+     * null-terminated), which are copied.
+     *
+     * @param childrenIndex Index of the first detached child slot
+     * @param size          Number of items
+     * @param text          Raw characters or \a nullptr
+     * @param valueFactory  Value factory used to create other event values
+     */
+    ArrayEventValue(std::size_t childrenIndex, std::size_t size,
+                    const char* text, const EventValueFactory* valueFactory);
+
     /**
      * Returns the number of items in this array.
      *
@@ -109,6 +125,11 @@ private:
     const ::bt_ctf_event* _btEvent;
     ::bt_definition const* const* _btFieldList;
     std::size_t _size;
+    bool _detached;
+    std::size_t _detachedIndex;
+    bool _detachedIsString;
+    bool _detachedHasString;
+    std::size_t _detachedStringOffset;
 };
 
 }
@@ -38,11 +38,25 @@ DictEventValue::DictEventValue(const ::bt_definition* def,
     _btDef {def},
     _btEvent {ev},
     _btFieldList {nullptr},
-    _size {0}
+    _size {0},
+    _detached {false}
 {
     this->buildCache();
 }
 
+DictEventValue::DictEventValue(std::size_t childrenIndex, std::size_t size,
+                               const EventValueFactory* valueFactory) :
+    AbstractEventValue {EventValueType::DICT, valueFactory},
+    _btDef {nullptr},
+    _btDecl {nullptr},
+    _btEvent {nullptr},
+    _btFieldList {nullptr},
+    _size {size},
+    _detached {true},
+    _detachedIndex {childrenIndex}
+{
+}
+
 void DictEventValue::buildCache()
 {
     _btDecl = ::bt_ctf_get_decl_from_def(_btDef);
@@ -54,6 +68,25 @@ void DictEventValue::buildCache()
     if (ret == 0) {
         _size = count;
     }
+
+    if (!this->getValueFactory()->isDetached() || !_btFieldList) {
+        return;
+    }
+
+    // build all fields now; field names belong to the declarations
+    auto valueFactory = this->getValueFactory();
+
+    _detachedIndex = valueFactory->reserveDetachedChildren(_size);
+
+    for (std::size_t x = 0; x < _size; ++x) {
+        auto itemDef = _btFieldList[x];
+
+        valueFactory->setDetachedChild(_detachedIndex + x,
+                                       valueFactory->buildEventValue(itemDef, _btEvent),
+                                       ::bt_ctf_field_name(itemDef));
+    }
+
+    _detached = true;
 }
 
 std::size_t DictEventValue::size() const
@@ -63,6 +96,10 @@ std::size_t DictEventValue::size() const
 
 const char* DictEventValue::getKeyName(std::size_t index) const
 {
+    if (_detached) {
+        return this->getValueFactory()->getDetachedName(_detachedIndex + index);
+    }
+
     if (!_btFieldList) {
         return nullptr;
     }
@@ -85,6 +122,10 @@ std::string DictEventValue::getKeyNameStr(std::size_t index) const
 
 const AbstractEventValue* DictEventValue::get(field_index_t index) const
 {
+    if (_detached) {
+        return this->getValueFactory()->getDetachedChild(_detachedIndex + index);
+    }
+
     auto itemDef = _btFieldList[index];
 
     return this->getValueFactory()->buildEventValue(itemDef, _btEvent);
@@ -56,6 +56,17 @@ public:
     DictEventValue(const ::bt_definition* def, const ::bt_ctf_event* ev,
                    const EventValueFactory* valueFactory);
 
+    /**
+     * Builds a dictionary value out of detached children already set
+     * in the value factory (see EventValueFactory::setDetachedChild()).
+     *
+     * @param childrenIndex Index of the first detached child slot
+     * @param size          Number of items
+     * @param valueFactory  Value factory used to create other event values
+     */
+    DictEventValue(std::size_t childrenIndex, std::size_t size,
+                   const EventValueFactory* valueFactory);
+
     /**
      * Returns the number of items in this dictionary.
      *
@@ -119,6 +130,8 @@ private:
     const ::bt_ctf_event* _btEvent;
     ::bt_definition const* const* _btFieldList;
     std::size_t _size;
+    bool _detached;
+    std::size_t _detachedIndex;
 };
 
 }
@@ -22,6 +22,7 @@
 #include <common/trace/EventValueType.hpp>
 #include <common/trace/AbstractEventValue.hpp>
 #include <common/trace/EnumEventValue.hpp>
+#include <common/trace/EventValueFactory.hpp>
 
 namespace tibee
 {
@@ -31,12 +32,33 @@ namespace common
 EnumEventValue::EnumEventValue(const ::bt_definition* def,
                                const EventValueFactory* valueFactory) :
     AbstractEventValue {EventValueType::ENUM, valueFactory},
-    _btDef {def}
+    _btDef {def},
+    _detached {false}
+{
+    if (valueFactory->isDetached()) {
+        // labels belong to the enumeration declaration: no need to copy
+        _detachedIntValue = this->getIntValue();
+        _detachedLabel = this->getLabel();
+        _detached = true;
+    }
+}
+
+EnumEventValue::EnumEventValue(std::uint64_t intValue, const char* label,
+                               const EventValueFactory* valueFactory) :
+    AbstractEventValue {EventValueType::ENUM, valueFactory},
+    _btDef {nullptr},
+    _detached {true},
+    _detachedIntValue {intValue},
+    _detachedLabel {label}
 {
 }
 
 std::uint64_t EnumEventValue::getIntValue() const
 {
+    if (_detached) {
+        return _detachedIntValue;
+    }
+
     auto intDef = ::bt_ctf_get_enum_int(_btDef);
 
     return ::bt_ctf_get_uint64(intDef);
@@ -44,6 +66,10 @@ std::uint64_t EnumEventValue::getIntValue() const
 
 const char* EnumEventValue::getLabel() const
 {
+    if (_detached) {
+        return _detachedLabel;
+    }
+
     return ::bt_ctf_get_enum_str(_btDef);
 }
 
@@ -47,6 +47,17 @@ public:
     EnumEventValue(const ::bt_definition* def,
                    const EventValueFactory* valueFactory);
 
+    /**
+     * Builds an enumeration item value out of an already decoded
+     * integer and its label.
+     *
+     * @param intValue     Integer value
+     * @param label        Label (must outlive this value)
+     * @param valueFactory Value factory used to create other event values
+     */
+    EnumEventValue(std::uint64_t intValue, const char* label,
+                   const EventValueFactory* valueFactory);
+
     /**
      * Returns the integer value of this enumeration item.
      *
@@ -74,6 +85,9 @@ private:
 
 private:
     const ::bt_definition* _btDef;
+    bool _detached;
+    std::uint64_t _detachedIntValue;
+    const char* _detachedLabel;
 };
 
 }
@@ -21,6 +21,7 @@
 #include <common/trace/babeltrace-internals.h>
 #include <common/trace/DictEventValue.hpp>
 #include <common/trace/Event.hpp>
+#include <common/trace/FieldHandle.hpp>
 #include <common/trace/TraceUtils.hpp>
 
 namespace tibee
@@ -29,12 +30,17 @@ namespace common
 {
 
 Event::Event(const EventValueFactory* valueFactory) :
-    _valueFactory {valueFactory}
+    _valueFactory {valueFactory},
+    _detached {false}
 {
 }
 
 const char* Event::getName() const
 {
+    if (_detached) {
+        return _detachedName;
+    }
+
     return ::bt_ctf_event_name(_btEvent);
 }
 
@@ -45,11 +51,19 @@ std::string Event::getNameStr() const
 
 trace_cycles_t Event::getCycles() const
 {
+    if (_detached) {
+        return _detachedCycles;
+    }
+
     return static_cast<trace_cycles_t>(::bt_ctf_get_cycles(_btEvent));
 }
 
 timestamp_t Event::getTimestamp() const
 {
+    if (_detached) {
+        return _detachedTimestamp;
+    }
+
     return static_cast<timestamp_t>(::bt_ctf_get_timestamp(_btEvent));
 }
 
@@ -142,17 +156,41 @@ const AbstractEventValue& Event::operator[](std::size_t index) const
     return fieldsDict[index];
 }
 
+const AbstractEventValue& Event::operator[](const FieldHandle& handle) const
+{
+    auto index = handle.getIndex(*this);
+
+    if (index == FieldHandle::NO_INDEX) {
+        return *_valueFactory->getNull();
+    }
+
+    if (handle.getScope() == FieldHandle::Scope::CONTEXT) {
+        return this->getContext()[index];
+    }
+
+    return this->getFields()[index];
+}
+
 void Event::setPrivateEvent(::bt_ctf_event* btEvent)
 {
     // set the attribute
     _btEvent = btEvent;
 
+    // not detached anymore
+    _detached = false;
+
     // reset cached pointers
     _fieldsDict = nullptr;
     _contextDict = nullptr;
     _streamEventContextDict = nullptr;
     _streamPacketContextDict = nullptr;
 
+    Event::getBtEventIds(btEvent, _id, _traceId);
+}
+
+void Event::getBtEventIds(const ::bt_ctf_event* btEvent, event_id_t& id,
+                          trace_id_t& traceId)
+{
     /* In CTF, an event ID is unique within its _stream_, so in order
      * to keep a real unique ID for the whole trace, we include the
      * CTF stream ID and the CTF event ID in our version of an event ID.
@@ -163,17 +201,96 @@ void Event::setPrivateEvent(::bt_ctf_event* btEvent)
      * to have 1 mibievents per stream and 4096 different streams per
      * trace, which seems reasonable.
      */
-    auto tibeeBtCtfEvent = reinterpret_cast<::tibee_bt_ctf_event*>(btEvent);
+    auto tibeeBtCtfEvent = reinterpret_cast<const ::tibee_bt_ctf_event*>(btEvent);
     auto tibeeStream = tibeeBtCtfEvent->parent->stream;
     auto ctfEventId = tibeeStream->event_id;
     auto ctfStreamId = tibeeStream->stream_id;
-    _id = TraceUtils::tibeeEventIdFromCtf(ctfStreamId, ctfEventId);
+    id = TraceUtils::tibeeEventIdFromCtf(ctfStreamId, ctfEventId);
 
     /* Let's use the trace handle (an integer starting at 0) here, which
-     * is unique for each trace in the same Babeltrace context (and we
-     * only have one).
+     * is unique for each trace in the same Babeltrace context. Stream
+     * group decoders use their own contexts and translate this back to
+     * the trace set handle when detaching the event.
+     */
+    traceId = tibeeStream->stream_class->trace->parent.handle->id;
+}
+
+void Event::detach(trace_id_t traceId)
+{
+    /* Build all top-level scopes now: the value factory is expected to
+     * be a detached one, so that the resulting values do not refer to
+     * BT definitions anymore. The event name belongs to the event
+     * declaration and does not need to be copied.
+     */
+    this->getFields();
+    this->getContext();
+    this->getStreamEventContext();
+    this->getStreamPacketContext();
+
+    _detachedName = this->getName();
+    _detachedCycles = this->getCycles();
+    _detachedTimestamp = this->getTimestamp();
+    _traceId = traceId;
+    _btEvent = nullptr;
+    _detached = true;
+}
+
+void Event::setNativeEvent(event_id_t id, trace_id_t traceId, const char* name,
+                           trace_cycles_t cycles, timestamp_t timestamp)
+{
+    /* A native event is decoded without Babeltrace and is detached from
+     * the start: top-level scopes are set afterwards with
+     * setNativeScope(), and are null until then.
+     */
+    _btEvent = nullptr;
+    _detached = true;
+    _id = id;
+    _traceId = traceId;
+    _detachedName = name;
+    _detachedCycles = cycles;
+    _detachedTimestamp = timestamp;
+    _fieldsDict = _valueFactory->getNull();
+    _contextDict = _valueFactory->getNull();
+    _streamEventContextDict = _valueFactory->getNull();
+    _streamPacketContextDict = _valueFactory->getNull();
+}
+
+void Event::setNativeScope(::bt_ctf_scope scope, const AbstractEventValue* value)
+{
+    switch (scope) {
+    case ::BT_EVENT_FIELDS:
+        _fieldsDict = value;
+        break;
+
+    case ::BT_EVENT_CONTEXT:
+        _contextDict = value;
+        break;
+
+    case ::BT_STREAM_EVENT_CONTEXT:
+        _streamEventContextDict = value;
+        break;
+
+    case ::BT_STREAM_PACKET_CONTEXT:
+        _streamPacketContextDict = value;
+        break;
+
+    default:
+        break;
+    }
+}
+
+void Event::copy(const Event& event)
+{
+    /* Our value factory must be a detached one: all values are copied
+     * into its pools, so that this event remains valid even after
+     * the original one is not anymore.
      */
-    _traceId = tibeeStream->stream_class->trace->parent.handle->id;
+    this->setNativeEvent(event.getId(), event.getTraceId(), event.getName(),
+                         event.getCycles(), event.getTimestamp());
+    _fieldsDict = _valueFactory->copyEventValue(event.getFields());
+    _contextDict = _valueFactory->copyEventValue(event.getContext());
+    _streamEventContextDict = _valueFactory->copyEventValue(event.getStreamEventContext());
+    _streamPacketContextDict = _valueFactory->copyEventValue(event.getStreamPacketContext());
 }
 
 }
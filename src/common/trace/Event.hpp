@@ -30,6 +30,8 @@ namespace tibee
 namespace common
 {
 
+class FieldHandle;
+
 /**
  * An event, the object returned by a TraceSetIterator.
  *
@@ -39,6 +41,10 @@ class Event :
     boost::noncopyable
 {
     friend class TraceSetIterator;
+    friend class StreamGroupDecoder;
+    friend class NativeCtfStream;
+    friend class EventBatch;
+    friend class EventCacheReader;
 
 public:
     /**
@@ -168,6 +174,19 @@ public:
      */
     const AbstractEventValue& operator[](field_index_t index) const;
 
+    /**
+     * Returns the value of a field using a pre-resolved field handle.
+     *
+     * This is the fastest way to access a field of this event.
+     *
+     * If the field handle doesn't resolve this event, this method
+     * returns a null event value.
+     *
+     * @param handle Field handle
+     * @returns      Field value or null event value if not found
+     */
+    const AbstractEventValue& operator[](const FieldHandle& handle) const;
+
     /**
      * Returns this event's numeric ID.
      *
@@ -199,6 +218,13 @@ private:
     Event(const EventValueFactory* valueFactory);
     const AbstractEventValue& getTopLevelScope(::bt_ctf_scope topLevelScope) const;
     void setPrivateEvent(::bt_ctf_event* btEvent);
+    void detach(trace_id_t traceId);
+    void setNativeEvent(event_id_t id, trace_id_t traceId, const char* name,
+                        trace_cycles_t cycles, timestamp_t timestamp);
+    void setNativeScope(::bt_ctf_scope scope, const AbstractEventValue* value);
+    void copy(const Event& event);
+    static void getBtEventIds(const ::bt_ctf_event* btEvent, event_id_t& id,
+                              trace_id_t& traceId);
 
 private:
     ::bt_ctf_event* _btEvent;
@@ -209,6 +235,10 @@ private:
     mutable const AbstractEventValue* _streamPacketContextDict;
     event_id_t _id;
     trace_id_t _traceId;
+    bool _detached;
+    const char* _detachedName;
+    trace_cycles_t _detachedCycles;
+    timestamp_t _detachedTimestamp;
 };
 
 }
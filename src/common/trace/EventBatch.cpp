@@ -0,0 +1,64 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <common/trace/EventBatch.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+EventBatch::EventBatch(std::size_t capacity) :
+    _valueFactory {true},
+    _size {0}
+{
+    if (capacity == 0) {
+        capacity = 1;
+    }
+
+    _slots.resize(capacity);
+    _events.resize(capacity, nullptr);
+
+    for (auto& slot : _slots) {
+        slot = std::unique_ptr<Event> {
+            new Event {std::addressof(_valueFactory)}
+        };
+    }
+}
+
+void EventBatch::clear()
+{
+    _valueFactory.resetPools();
+    _size = 0;
+}
+
+Event& EventBatch::append()
+{
+    auto& event = *_slots[_size];
+
+    _events[_size++] = std::addressof(event);
+
+    return event;
+}
+
+void EventBatch::appendKept(const Event& event)
+{
+    _events[_size++] = std::addressof(event);
+}
+
+}
+}
@@ -0,0 +1,151 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_EVENTBATCH_HPP
+#define _TIBEE_COMMON_EVENTBATCH_HPP
+
+#include <cstddef>
+#include <memory>
+#include <vector>
+#include <boost/utility.hpp>
+
+#include <common/trace/Event.hpp>
+#include <common/trace/EventValueFactory.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Batch of consecutive events.
+ *
+ * All the events of a batch remain valid at the same time, until the
+ * batch is filled again. This makes it possible to deliver many events
+ * to a consumer at once instead of one at a time.
+ *
+ * The events of a batch are either events kept in place by the event
+ * source of the trace set (see AbstractEventSource::keepCurrentEvent()),
+ * or events built in the batch's own slots. All the event values of
+ * the latter are built by a single detached value factory owned by the
+ * batch, so that they are packed together in memory.
+ *
+ * Do not fill a batch directly; use TraceSetIterator::fill().
+ *
+ * @author Philippe Proulx
+ */
+class EventBatch :
+    boost::noncopyable
+{
+    friend class TraceSetIterator;
+
+public:
+    /**
+     * Builds an empty event batch.
+     *
+     * @param capacity Maximum number of events of this batch
+     */
+    explicit EventBatch(std::size_t capacity);
+
+    /**
+     * Returns the number of events in this batch.
+     *
+     * @returns Number of events
+     */
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+    /**
+     * Returns whether or not this batch is empty.
+     *
+     * @returns True if this batch is empty
+     */
+    bool empty() const
+    {
+        return _size == 0;
+    }
+
+    /**
+     * Returns the maximum number of events of this batch.
+     *
+     * @returns Batch capacity
+     */
+    std::size_t getCapacity() const
+    {
+        return _events.size();
+    }
+
+    /**
+     * Returns whether or not this batch is full.
+     *
+     * @returns True if this batch is full
+     */
+    bool isFull() const
+    {
+        return _size == _events.size();
+    }
+
+    /**
+     * Returns the event at index \p index.
+     *
+     * Caller must make sure \p index is lesser than size().
+     *
+     * @param index Index of event to retrieve
+     * @returns     Event
+     */
+    const Event& operator[](std::size_t index) const
+    {
+        return *_events[index];
+    }
+
+    /**
+     * Returns the last event of this batch.
+     *
+     * Caller must make sure this batch is not empty.
+     *
+     * @returns Last event
+     */
+    const Event& back() const
+    {
+        return *_events[_size - 1];
+    }
+
+private:
+    void clear();
+    Event& append();
+    void appendKept(const Event& event);
+
+private:
+    // detached value factory shared by all our own events
+    EventValueFactory _valueFactory;
+
+    // our own event slots (allocated once)
+    std::vector<std::unique_ptr<Event>> _slots;
+
+    // events of this batch (our own slots or kept events)
+    std::vector<const Event*> _events;
+
+    // number of valid events
+    std::size_t _size;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_EVENTBATCH_HPP
@@ -0,0 +1,387 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <set>
+#include <string>
+
+#include <common/trace/EventCacheReader.hpp>
+#include <common/trace/TraceSet.hpp>
+#include <common/ex/TraceSet.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+EventCacheReader::EventCacheReader(const bfs::path& dir,
+                                   const TraceSet& traceSet,
+                                   const EventFilter* filter,
+                                   timestamp_t beginTs, timestamp_t endTs) :
+    _dir {dir},
+    _filter {filter},
+    _endTs {endTs},
+    _timestamps {nullptr},
+    _cycles {nullptr},
+    _typeIndexes {nullptr},
+    _row {0},
+    _valueFactory {true}
+{
+    _schema = EventCacheSchema::load(dir);
+
+    if (!_schema) {
+        throw ex::TraceSet {
+            "no complete event cache in \"" + dir.string() + "\""
+        };
+    }
+
+    // the cache must have been written for the same traces
+    EventCacheSchema::TracePaths tracePaths;
+
+    for (const auto& traceInfos : traceSet.getTracesInfos()) {
+        tracePaths[traceInfos->getId()] = traceInfos->getPath();
+    }
+
+    if (tracePaths != _schema->getTracePaths()) {
+        throw ex::TraceSet {
+            "event cache in \"" + dir.string() + "\" was written for other traces"
+        };
+    }
+
+    /* Replaying events which were not cached would silently give no
+     * such event at all.
+     */
+    if (_filter) {
+        this->checkCachedEvents(traceSet);
+    }
+
+    this->mapGlobalColumns();
+
+    // only map the columns of accepted event types
+    const auto& eventTypes = _schema->getEventTypes();
+
+    _types.resize(eventTypes.size());
+
+    for (std::size_t t = 0; t < eventTypes.size(); ++t) {
+        auto& type = _types[t];
+
+        type.row = 0;
+        type.accepted = !_filter || _filter->accepts(eventTypes[t].traceId,
+                                                     eventTypes[t].eventId);
+
+        if (type.accepted) {
+            this->mapTypeColumns(t);
+        }
+    }
+
+    // skip the rows before the range
+    auto rows = _schema->getRows();
+
+    if (beginTs > 0) {
+        _row = static_cast<std::uint64_t>(std::lower_bound(_timestamps, _timestamps + rows,
+                                                           beginTs) - _timestamps);
+
+        for (std::uint64_t row = 0; row < _row; ++row) {
+            _types[_typeIndexes[row]].row++;
+        }
+    }
+
+    _event = std::unique_ptr<Event> {
+        new Event {std::addressof(_valueFactory)}
+    };
+}
+
+bool EventCacheReader::exists(const bfs::path& dir)
+{
+    return static_cast<bool>(EventCacheSchema::load(dir));
+}
+
+void EventCacheReader::checkCachedEvents(const TraceSet& traceSet) const
+{
+    std::set<std::string> missingNames;
+    const auto& cachedEvents = _schema->getCachedEvents();
+
+    for (const auto& traceInfos : traceSet.getTracesInfos()) {
+        auto traceId = traceInfos->getId();
+
+        for (const auto& eventInfos : *traceInfos->getEventMap()) {
+            auto eventId = eventInfos.second->getId();
+
+            if (_filter->accepts(traceId, eventId) &&
+                    cachedEvents.find({traceId, eventId}) == cachedEvents.end()) {
+                missingNames.insert(eventInfos.first);
+            }
+        }
+    }
+
+    if (missingNames.empty()) {
+        return;
+    }
+
+    std::string names;
+
+    for (const auto& name : missingNames) {
+        if (!names.empty()) {
+            names += ", ";
+        }
+
+        names += "\"" + name + "\"";
+    }
+
+    throw ex::TraceSet {
+        "event cache in \"" + _dir.string() + "\" has no " + names +
+        " events (not cached when written)"
+    };
+}
+
+void EventCacheReader::throwCorrupted(const std::string& what) const
+{
+    throw ex::TraceSet {
+        "corrupted event cache in \"" + _dir.string() + "\": " + what
+    };
+}
+
+void EventCacheReader::mapGlobalColumns()
+{
+    auto rows = _schema->getRows();
+    auto map = [this, rows] (const char* name, std::size_t entrySize) {
+        std::unique_ptr<MappedFile> file {
+            new MappedFile {EventCacheSchema::getGlobalColumnPath(_dir, name)}
+        };
+
+        if (file->getSize() != rows * entrySize) {
+            this->throwCorrupted(std::string {"wrong size of column \""} + name + "\"");
+        }
+
+        return file;
+    };
+
+    _timestampsFile = map("timestamp", sizeof(timestamp_t));
+    _cyclesFile = map("cycles", sizeof(trace_cycles_t));
+    _typeIndexesFile = map("type-index", sizeof(std::uint32_t));
+    _timestamps = EventCacheReader::getColumnData<timestamp_t>(*_timestampsFile);
+    _cycles = EventCacheReader::getColumnData<trace_cycles_t>(*_cyclesFile);
+    _typeIndexes = EventCacheReader::getColumnData<std::uint32_t>(*_typeIndexesFile);
+
+    for (std::uint64_t row = 0; row < rows; ++row) {
+        if (_typeIndexes[row] >= _schema->getEventTypes().size()) {
+            this->throwCorrupted("unknown event type index");
+        }
+    }
+}
+
+void EventCacheReader::mapTypeColumns(std::size_t typeIndex)
+{
+    typedef EventCacheSchema::ColumnKind Kind;
+
+    const auto& eventType = _schema->getEventTypes()[typeIndex];
+    auto& type = _types[typeIndex];
+
+    for (std::size_t s = 0; s < EventCacheSchema::SCOPES_COUNT; ++s) {
+        const auto& columns = eventType.scopes[s].columns;
+
+        for (std::size_t c = 0; c < columns.size(); ++c) {
+            const auto& column = columns[c];
+            TypeColumn typeColumn;
+            std::size_t entrySize = 0;
+
+            switch (column.kind) {
+            case Kind::SINT:
+            case Kind::UINT:
+            case Kind::FLOAT:
+            case Kind::STRING:
+                entrySize = 8;
+                break;
+
+            case Kind::ENUM:
+            case Kind::TEXT:
+                entrySize = 16;
+                break;
+
+            default:
+                break;
+            }
+
+            if (entrySize > 0) {
+                typeColumn.values = std::unique_ptr<MappedFile> {
+                    new MappedFile {
+                        EventCacheSchema::getColumnPath(_dir, typeIndex, s, c, ".col")
+                    }
+                };
+
+                if (typeColumn.values->getSize() != eventType.rows * entrySize) {
+                    this->throwCorrupted("wrong size of column \"" + column.name +
+                                         "\" of event \"" + eventType.name + "\"");
+                }
+            }
+
+            if (column.kind == Kind::ENUM || column.kind == Kind::STRING ||
+                    column.kind == Kind::TEXT) {
+                typeColumn.strings = std::unique_ptr<MappedFile> {
+                    new MappedFile {
+                        EventCacheSchema::getColumnPath(_dir, typeIndex, s, c, ".str")
+                    }
+                };
+
+                // all strings are null-terminated
+                const auto& strings = *typeColumn.strings;
+
+                if (eventType.rows > 0 &&
+                        (!strings.getData() || strings.getData()[strings.getSize() - 1] != '\0')) {
+                    this->throwCorrupted("wrong strings of column \"" + column.name +
+                                         "\" of event \"" + eventType.name + "\"");
+                }
+            }
+
+            type.columns[s].push_back(std::move(typeColumn));
+        }
+    }
+}
+
+const AbstractEventValue* EventCacheReader::buildValue(const EventCacheSchema::Column& column,
+                                                       const TypeColumn& typeColumn,
+                                                       std::uint64_t row) const
+{
+    typedef EventCacheSchema::ColumnKind Kind;
+
+    switch (column.kind) {
+    case Kind::SINT:
+        return _valueFactory.buildSint(EventCacheReader::getColumnData<std::int64_t>(*typeColumn.values)[row],
+                                       column.base);
+
+    case Kind::UINT:
+        return _valueFactory.buildUint(EventCacheReader::getColumnData<std::uint64_t>(*typeColumn.values)[row],
+                                       column.base);
+
+    case Kind::FLOAT:
+        return _valueFactory.buildFloat(EventCacheReader::getColumnData<double>(*typeColumn.values)[row]);
+
+    default:
+        break;
+    }
+
+    if (column.kind == Kind::NONE) {
+        return _valueFactory.getNull();
+    }
+
+    // string: find its beginning (end of the previous one)
+    auto values = EventCacheReader::getColumnData<std::uint64_t>(*typeColumn.values);
+    auto stride = (column.kind == Kind::STRING) ? 1 : 2;
+    auto endOffset = values[row * stride + stride - 1];
+    std::uint64_t offset = 0;
+
+    if (row > 0) {
+        offset = values[(row - 1) * stride + stride - 1];
+    }
+
+    if (offset >= endOffset || endOffset > typeColumn.strings->getSize()) {
+        this->throwCorrupted("wrong string offset in column \"" + column.name + "\"");
+    }
+
+    // null-terminated, and mapped as long as this reader exists
+    auto str = typeColumn.strings->getData() + offset;
+
+    if (column.kind == Kind::STRING) {
+        return _valueFactory.buildString(str);
+    } else if (column.kind == Kind::ENUM) {
+        return _valueFactory.buildEnum(values[row * 2], str);
+    }
+
+    // text: rebuild the character items too
+    auto size = static_cast<std::size_t>(values[row * 2]);
+    auto len = static_cast<std::size_t>(endOffset - offset - 1);
+    auto childrenIndex = _valueFactory.reserveDetachedChildren(size);
+
+    for (std::size_t x = 0; x < size; ++x) {
+        std::uint64_t c = (x < len) ? static_cast<unsigned char>(str[x]) : 0;
+
+        _valueFactory.setDetachedChild(childrenIndex + x,
+                                       _valueFactory.buildUint(c, 10), nullptr);
+    }
+
+    return _valueFactory.buildArray(childrenIndex, size, str);
+}
+
+const AbstractEventValue* EventCacheReader::buildScope(std::size_t typeIndex,
+                                                       std::size_t scope,
+                                                       std::uint64_t row) const
+{
+    const auto& columns = _schema->getEventTypes()[typeIndex].scopes[scope].columns;
+    const auto& typeColumns = _types[typeIndex].columns[scope];
+    auto childrenIndex = _valueFactory.reserveDetachedChildren(columns.size());
+
+    // field names belong to the schema
+    for (std::size_t c = 0; c < columns.size(); ++c) {
+        _valueFactory.setDetachedChild(childrenIndex + c,
+                                       this->buildValue(columns[c], typeColumns[c], row),
+                                       columns[c].name.c_str());
+    }
+
+    return _valueFactory.buildDict(childrenIndex, columns.size());
+}
+
+bool EventCacheReader::nextImpl()
+{
+    auto rows = _schema->getRows();
+
+    while (_row < rows) {
+        auto row = _row++;
+        auto typeIndex = _typeIndexes[row];
+        auto& type = _types[typeIndex];
+        auto typeRow = type.row++;
+
+        if (_timestamps[row] > _endTs) {
+            // past the range
+            _row = rows;
+
+            return false;
+        }
+
+        if (!type.accepted) {
+            continue;
+        }
+
+        // rebuild event
+        const auto& eventType = _schema->getEventTypes()[typeIndex];
+
+        _valueFactory.resetPools();
+        _event->setNativeEvent(eventType.eventId, eventType.traceId,
+                               eventType.name.c_str(), _cycles[row],
+                               _timestamps[row]);
+
+        for (std::size_t s = 0; s < EventCacheSchema::SCOPES_COUNT; ++s) {
+            if (eventType.scopes[s].present) {
+                _event->setNativeScope(EventCacheSchema::getBtScope(s),
+                                       this->buildScope(typeIndex, s, typeRow));
+            }
+        }
+
+        return true;
+    }
+
+    return false;
+}
+
+const Event& EventCacheReader::getCurrentEventImpl() const
+{
+    return *_event;
+}
+
+}
+}
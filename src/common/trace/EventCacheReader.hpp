@@ -0,0 +1,167 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_EVENTCACHEREADER_HPP
+#define _TIBEE_COMMON_EVENTCACHEREADER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/AbstractEventSource.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventCacheSchema.hpp>
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/EventValueFactory.hpp>
+#include <common/utils/MappedFile.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+class TraceSet;
+
+/**
+ * Columnar event cache reader.
+ *
+ * Replays the events of a columnar event cache (see EventCacheSchema)
+ * written by EventCacheWriter. All columns are mapped in memory and
+ * events are rebuilt out of them as detached events, without decoding
+ * anything.
+ *
+ * @author Philippe Proulx
+ */
+class EventCacheReader :
+    public AbstractEventSource
+{
+public:
+    /**
+     * Opens the event cache of directory \p dir.
+     *
+     * The cache must have been written for the same traces, with the
+     * same IDs, as \p traceSet, and must have cached all the events
+     * accepted by \p filter. Throws ex::TraceSet if there's no
+     * complete cache in \p dir or if it doesn't match \p traceSet and
+     * \p filter.
+     *
+     * @param dir      Cache directory
+     * @param traceSet Trace set of the cached events
+     * @param filter   Event filter (must outlive this reader) or
+     *                 \a nullptr to replay all cached events
+     * @param beginTs  Timestamp of the first event to replay
+     * @param endTs    Timestamp of the last event to replay
+     */
+    EventCacheReader(const boost::filesystem::path& dir,
+                     const TraceSet& traceSet, const EventFilter* filter,
+                     timestamp_t beginTs, timestamp_t endTs);
+
+    /**
+     * Returns whether or not directory \p dir holds a complete event
+     * cache.
+     *
+     * @param dir Cache directory
+     * @returns   True if \p dir holds a complete event cache
+     */
+    static bool exists(const boost::filesystem::path& dir);
+
+    /**
+     * Returns the total number of cached events.
+     *
+     * @returns Number of cached events
+     */
+    std::uint64_t getEventCount() const
+    {
+        return _schema->getRows();
+    }
+
+private:
+    // mapped files of an event type column
+    struct TypeColumn
+    {
+        std::unique_ptr<MappedFile> values;
+        std::unique_ptr<MappedFile> strings;
+    };
+
+    // replay state of an event type
+    struct TypeState
+    {
+        // false if filtered out (columns not mapped)
+        bool accepted;
+
+        // index of the next row of this type
+        std::uint64_t row;
+
+        // mapped columns of each scope
+        std::array<std::vector<TypeColumn>, EventCacheSchema::SCOPES_COUNT> columns;
+    };
+
+private:
+    bool nextImpl();
+    const Event& getCurrentEventImpl() const;
+    void checkCachedEvents(const TraceSet& traceSet) const;
+    void mapGlobalColumns();
+    void mapTypeColumns(std::size_t typeIndex);
+    const AbstractEventValue* buildScope(std::size_t typeIndex,
+                                         std::size_t scope,
+                                         std::uint64_t row) const;
+    const AbstractEventValue* buildValue(const EventCacheSchema::Column& column,
+                                         const TypeColumn& typeColumn,
+                                         std::uint64_t row) const;
+    void throwCorrupted(const std::string& what) const;
+
+    template<typename T>
+    static const T* getColumnData(const MappedFile& file)
+    {
+        return reinterpret_cast<const T*>(file.getData());
+    }
+
+private:
+    boost::filesystem::path _dir;
+    EventCacheSchema::UP _schema;
+    const EventFilter* _filter;
+    timestamp_t _endTs;
+
+    // global columns
+    std::unique_ptr<MappedFile> _timestampsFile;
+    std::unique_ptr<MappedFile> _cyclesFile;
+    std::unique_ptr<MappedFile> _typeIndexesFile;
+    const timestamp_t* _timestamps;
+    const trace_cycles_t* _cycles;
+    const std::uint32_t* _typeIndexes;
+
+    // replay state of each event type
+    std::vector<TypeState> _types;
+
+    // index of the next global row
+    std::uint64_t _row;
+
+    // value factory of the current event
+    EventValueFactory _valueFactory;
+
+    // current event
+    std::unique_ptr<Event> _event;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_EVENTCACHEREADER_HPP
@@ -0,0 +1,294 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstring>
+#include <fstream>
+
+#include <common/trace/EventCacheSchema.hpp>
+#include <common/utils/MappedFile.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+const char MAGIC[] = {'T', 'B', 'E', 'C'};
+const std::uint32_t VERSION = 2;
+const char SCHEMA_FILE_NAME[] = "schema";
+
+// bounds-checked reader of a schema file
+class Reader
+{
+public:
+    Reader(const char* data, std::size_t size) :
+        _at {data},
+        _end {data + size}
+    {
+    }
+
+    template<typename T>
+    bool read(T& value)
+    {
+        if (static_cast<std::size_t>(_end - _at) < sizeof(value)) {
+            return false;
+        }
+
+        std::memcpy(&value, _at, sizeof(value));
+        _at += sizeof(value);
+
+        return true;
+    }
+
+    bool read(std::string& str)
+    {
+        std::uint32_t len;
+
+        if (!this->read(len) || static_cast<std::size_t>(_end - _at) < len) {
+            return false;
+        }
+
+        str.assign(_at, len);
+        _at += len;
+
+        return true;
+    }
+
+    bool isDone() const
+    {
+        return _at == _end;
+    }
+
+private:
+    const char* _at;
+    const char* _end;
+};
+
+template<typename T>
+void write(std::ostream& os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void write(std::ostream& os, const std::string& str)
+{
+    write(os, static_cast<std::uint32_t>(str.size()));
+    os.write(str.data(), str.size());
+}
+
+}
+
+const std::size_t EventCacheSchema::SCOPES_COUNT;
+
+EventCacheSchema::EventCacheSchema() :
+    _rows {0}
+{
+}
+
+bfs::path EventCacheSchema::getGlobalColumnPath(const bfs::path& dir,
+                                                const char* name)
+{
+    return dir / (std::string {name} + ".col");
+}
+
+bfs::path EventCacheSchema::getColumnPath(const bfs::path& dir,
+                                          std::size_t type, std::size_t scope,
+                                          std::size_t column,
+                                          const char* extension)
+{
+    return dir / ("type-" + std::to_string(type) +
+                  "-scope-" + std::to_string(scope) +
+                  "-column-" + std::to_string(column) + extension);
+}
+
+::bt_ctf_scope EventCacheSchema::getBtScope(std::size_t scope)
+{
+    static const ::bt_ctf_scope btScopes[] = {
+        ::BT_EVENT_FIELDS,
+        ::BT_EVENT_CONTEXT,
+        ::BT_STREAM_EVENT_CONTEXT,
+        ::BT_STREAM_PACKET_CONTEXT,
+    };
+
+    return btScopes[scope];
+}
+
+EventCacheSchema::UP EventCacheSchema::load(const bfs::path& dir)
+{
+    MappedFile file {dir / SCHEMA_FILE_NAME};
+
+    if (!file.getData()) {
+        return nullptr;
+    }
+
+    Reader reader {file.getData(), file.getSize()};
+    char magic[sizeof(MAGIC)];
+    std::uint32_t version;
+
+    for (auto& c : magic) {
+        if (!reader.read(c)) {
+            return nullptr;
+        }
+    }
+
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            !reader.read(version) || version != VERSION) {
+        return nullptr;
+    }
+
+    EventCacheSchema::UP schema {new EventCacheSchema};
+    std::uint32_t tracesCount;
+
+    if (!reader.read(schema->_rows) || !reader.read(tracesCount)) {
+        return nullptr;
+    }
+
+    for (std::uint32_t x = 0; x < tracesCount; ++x) {
+        trace_id_t traceId;
+        std::string path;
+
+        if (!reader.read(traceId) || !reader.read(path)) {
+            return nullptr;
+        }
+
+        schema->_tracePaths[traceId] = path;
+    }
+
+    std::uint32_t cachedEventsCount;
+
+    if (!reader.read(cachedEventsCount)) {
+        return nullptr;
+    }
+
+    for (std::uint32_t x = 0; x < cachedEventsCount; ++x) {
+        trace_id_t traceId;
+        event_id_t eventId;
+
+        if (!reader.read(traceId) || !reader.read(eventId)) {
+            return nullptr;
+        }
+
+        schema->_cachedEvents.insert({traceId, eventId});
+    }
+
+    std::uint32_t typesCount;
+
+    if (!reader.read(typesCount)) {
+        return nullptr;
+    }
+
+    schema->_eventTypes.resize(typesCount);
+
+    for (auto& eventType : schema->_eventTypes) {
+        if (!reader.read(eventType.traceId) || !reader.read(eventType.eventId) ||
+                !reader.read(eventType.name) || !reader.read(eventType.rows)) {
+            return nullptr;
+        }
+
+        for (auto& scope : eventType.scopes) {
+            std::uint8_t present;
+            std::uint32_t columnsCount;
+
+            if (!reader.read(present) || !reader.read(columnsCount)) {
+                return nullptr;
+            }
+
+            scope.present = (present != 0);
+
+            for (std::uint32_t c = 0; c < columnsCount; ++c) {
+                Column column;
+                std::uint8_t kind;
+                std::int32_t base;
+
+                if (!reader.read(column.name) || !reader.read(kind) ||
+                        !reader.read(base)) {
+                    return nullptr;
+                }
+
+                if (kind > static_cast<std::uint8_t>(ColumnKind::TEXT)) {
+                    return nullptr;
+                }
+
+                column.kind = static_cast<ColumnKind>(kind);
+                column.base = base;
+                scope.columns.push_back(std::move(column));
+            }
+        }
+    }
+
+    if (!reader.isDone()) {
+        return nullptr;
+    }
+
+    return schema;
+}
+
+bool EventCacheSchema::save(const bfs::path& dir) const
+{
+    std::ofstream os {(dir / SCHEMA_FILE_NAME).string(),
+                      std::ios::binary | std::ios::trunc};
+
+    if (!os) {
+        return false;
+    }
+
+    os.write(MAGIC, sizeof(MAGIC));
+    write(os, VERSION);
+    write(os, _rows);
+    write(os, static_cast<std::uint32_t>(_tracePaths.size()));
+
+    for (const auto& tracePath : _tracePaths) {
+        write(os, tracePath.first);
+        write(os, tracePath.second.string());
+    }
+
+    write(os, static_cast<std::uint32_t>(_cachedEvents.size()));
+
+    for (const auto& cachedEvent : _cachedEvents) {
+        write(os, cachedEvent.first);
+        write(os, cachedEvent.second);
+    }
+
+    write(os, static_cast<std::uint32_t>(_eventTypes.size()));
+
+    for (const auto& eventType : _eventTypes) {
+        write(os, eventType.traceId);
+        write(os, eventType.eventId);
+        write(os, eventType.name);
+        write(os, eventType.rows);
+
+        for (const auto& scope : eventType.scopes) {
+            write(os, static_cast<std::uint8_t>(scope.present));
+            write(os, static_cast<std::uint32_t>(scope.columns.size()));
+
+            for (const auto& column : scope.columns) {
+                write(os, column.name);
+                write(os, static_cast<std::uint8_t>(column.kind));
+                write(os, static_cast<std::int32_t>(column.base));
+            }
+        }
+    }
+
+    return os.good();
+}
+
+}
+}
@@ -0,0 +1,291 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_EVENTCACHESCHEMA_HPP
+#define _TIBEE_COMMON_EVENTCACHESCHEMA_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <babeltrace/ctf/events.h>
+
+#include <common/BasicTypes.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Schema of a columnar event cache.
+ *
+ * An event cache is a directory of column files. Four global columns
+ * have one entry per cached event, in playback order: timestamp,
+ * cycles, trace ID and event ID (plus the index of the event type
+ * within this schema). Each event type then has one column per
+ * top-level field of each of its scopes (fields, context, stream event
+ * context and stream packet context), with one entry per event of this
+ * type.
+ *
+ * Numbers are stored as is (".col" files). Strings, enumeration labels
+ * and character array texts are stored one after the other, with
+ * their terminating null character, in a separate ".str" file, and
+ * their ".col" file holds their end offsets within it.
+ *
+ * The schema also records which events were cached, including those
+ * which never occurred, so that replaying events which were not cached
+ * is an error rather than an absence of events.
+ *
+ * The schema file is written last: a cache without one is incomplete.
+ *
+ * @see EventCacheWriter
+ * @see EventCacheReader
+ *
+ * @author Philippe Proulx
+ */
+class EventCacheSchema
+{
+public:
+    /// Unique pointer to event cache schema
+    typedef std::unique_ptr<EventCacheSchema> UP;
+
+    /// Number of scopes of an event type
+    static const std::size_t SCOPES_COUNT = 4;
+
+    /// Column kind
+    enum class ColumnKind : std::uint8_t
+    {
+        // not cached (replayed as a null value)
+        NONE,
+
+        // 64-bit signed integers
+        SINT,
+
+        // 64-bit unsigned integers
+        UINT,
+
+        // double precision floating point numbers
+        FLOAT,
+
+        // (64-bit integer, label end offset) pairs
+        ENUM,
+
+        // string end offsets
+        STRING,
+
+        // (array size, text end offset) pairs
+        TEXT,
+    };
+
+    /// Column of an event type scope
+    struct Column
+    {
+        // field name
+        std::string name;
+
+        // column kind
+        ColumnKind kind;
+
+        // display base of integers
+        int base;
+    };
+
+    /// Scope of an event type
+    struct Scope
+    {
+        // false if events of this type have no such scope
+        bool present;
+
+        // one column per top-level field, in field order
+        std::vector<Column> columns;
+    };
+
+    /// Event type
+    struct EventType
+    {
+        trace_id_t traceId;
+        event_id_t eventId;
+        std::string name;
+
+        // number of cached events of this type
+        std::uint64_t rows;
+
+        // scopes, in EventCacheSchema::getBtScope() order
+        std::array<Scope, SCOPES_COUNT> scopes;
+    };
+
+    /// (trace ID -> trace path) map
+    typedef std::map<trace_id_t, boost::filesystem::path> TracePaths;
+
+    /// Set of cached (trace ID, event ID) pairs
+    typedef std::set<std::pair<trace_id_t, event_id_t>> CachedEvents;
+
+public:
+    /**
+     * Builds an empty schema.
+     */
+    EventCacheSchema();
+
+    /**
+     * Loads the schema of cache directory \p dir.
+     *
+     * @param dir Cache directory
+     * @returns   Schema or \a nullptr if there's no complete cache in
+     *            \p dir
+     */
+    static UP load(const boost::filesystem::path& dir);
+
+    /**
+     * Saves this schema into cache directory \p dir.
+     *
+     * @param dir Cache directory
+     * @returns   True if saved
+     */
+    bool save(const boost::filesystem::path& dir) const;
+
+    /**
+     * Returns the path of a global column file.
+     *
+     * @param dir  Cache directory
+     * @param name Global column name
+     * @returns    Column file path
+     */
+    static boost::filesystem::path getGlobalColumnPath(const boost::filesystem::path& dir,
+                                                       const char* name);
+
+    /**
+     * Returns the path of an event type column file.
+     *
+     * @param dir       Cache directory
+     * @param type      Event type index
+     * @param scope     Scope index
+     * @param column    Column index
+     * @param extension File extension (".col" or ".str")
+     * @returns         Column file path
+     */
+    static boost::filesystem::path getColumnPath(const boost::filesystem::path& dir,
+                                                 std::size_t type,
+                                                 std::size_t scope,
+                                                 std::size_t column,
+                                                 const char* extension);
+
+    /**
+     * Returns the Babeltrace scope of scope index \p scope.
+     *
+     * @param scope Scope index
+     * @returns     Babeltrace scope
+     */
+    static ::bt_ctf_scope getBtScope(std::size_t scope);
+
+    /**
+     * Returns the total number of cached events.
+     *
+     * @returns Number of events
+     */
+    std::uint64_t getRows() const
+    {
+        return _rows;
+    }
+
+    /**
+     * Sets the total number of cached events.
+     *
+     * @param rows Number of events
+     */
+    void setRows(std::uint64_t rows)
+    {
+        _rows = rows;
+    }
+
+    /**
+     * Returns the paths of the cached traces.
+     *
+     * @returns Trace paths
+     */
+    const TracePaths& getTracePaths() const
+    {
+        return _tracePaths;
+    }
+
+    /**
+     * Returns the paths of the cached traces.
+     *
+     * @returns Trace paths
+     */
+    TracePaths& getTracePaths()
+    {
+        return _tracePaths;
+    }
+
+    /**
+     * Returns the (trace ID, event ID) pairs of the cached events.
+     *
+     * @returns Cached events
+     */
+    const CachedEvents& getCachedEvents() const
+    {
+        return _cachedEvents;
+    }
+
+    /**
+     * Returns the (trace ID, event ID) pairs of the cached events.
+     *
+     * @returns Cached events
+     */
+    CachedEvents& getCachedEvents()
+    {
+        return _cachedEvents;
+    }
+
+    /**
+     * Returns the event types.
+     *
+     * @returns Event types
+     */
+    const std::vector<EventType>& getEventTypes() const
+    {
+        return _eventTypes;
+    }
+
+    /**
+     * Returns the event types.
+     *
+     * @returns Event types
+     */
+    std::vector<EventType>& getEventTypes()
+    {
+        return _eventTypes;
+    }
+
+private:
+    std::uint64_t _rows;
+    TracePaths _tracePaths;
+    CachedEvents _cachedEvents;
+    std::vector<EventType> _eventTypes;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_EVENTCACHESCHEMA_HPP
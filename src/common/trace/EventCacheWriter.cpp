@@ -0,0 +1,356 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstring>
+#include <fstream>
+#include <string>
+
+#include <common/trace/EventCacheWriter.hpp>
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/ArrayEventValue.hpp>
+#include <common/trace/DictEventValue.hpp>
+#include <common/ex/TraceSet.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+// column data kept in memory before being appended to its file
+const std::size_t FLUSH_SIZE = 256 * 1024;
+
+const AbstractEventValue& getScopeValue(const Event& event, std::size_t scope)
+{
+    switch (EventCacheSchema::getBtScope(scope)) {
+    case ::BT_EVENT_FIELDS:
+        return event.getFields();
+
+    case ::BT_EVENT_CONTEXT:
+        return event.getContext();
+
+    case ::BT_STREAM_EVENT_CONTEXT:
+        return event.getStreamEventContext();
+
+    default:
+        return event.getStreamPacketContext();
+    }
+}
+
+}
+
+EventCacheWriter::ColumnBuffer::ColumnBuffer(const bfs::path& path) :
+    _path {path},
+    _size {0}
+{
+}
+
+void EventCacheWriter::ColumnBuffer::append(const void* data, std::size_t size)
+{
+    auto bytes = static_cast<const char*>(data);
+
+    _data.insert(_data.end(), bytes, bytes + size);
+    _size += size;
+
+    if (_data.size() >= FLUSH_SIZE) {
+        this->flush();
+    }
+}
+
+void EventCacheWriter::ColumnBuffer::flush()
+{
+    if (_data.empty()) {
+        return;
+    }
+
+    std::ofstream os {_path.string(), std::ios::binary | std::ios::app};
+
+    os.write(_data.data(), _data.size());
+
+    if (!os.good()) {
+        throw ex::TraceSet {
+            "cannot write event cache column \"" + _path.string() + "\""
+        };
+    }
+
+    _data.clear();
+}
+
+EventCacheWriter::EventCacheWriter(const bfs::path& dir,
+                                   const TraceSet& traceSet,
+                                   const EventFilter* filter) :
+    _dir {dir},
+    _timestamps {EventCacheSchema::getGlobalColumnPath(dir, "timestamp")},
+    _cycles {EventCacheSchema::getGlobalColumnPath(dir, "cycles")},
+    _traceIds {EventCacheSchema::getGlobalColumnPath(dir, "trace-id")},
+    _eventIds {EventCacheSchema::getGlobalColumnPath(dir, "event-id")},
+    _typeIndexes {EventCacheSchema::getGlobalColumnPath(dir, "type-index")}
+{
+    try {
+        bfs::remove_all(dir);
+        bfs::create_directories(dir);
+    } catch (const bfs::filesystem_error& ex) {
+        throw ex::TraceSet {
+            std::string {"cannot create event cache: "} + ex.what()
+        };
+    }
+
+    // remember which trace is which and which events are cached
+    for (const auto& traceInfos : traceSet.getTracesInfos()) {
+        auto traceId = traceInfos->getId();
+
+        _schema.getTracePaths()[traceId] = traceInfos->getPath();
+
+        for (const auto& eventInfos : *traceInfos->getEventMap()) {
+            auto eventId = eventInfos.second->getId();
+
+            if (!filter || filter->accepts(traceId, eventId)) {
+                _schema.getCachedEvents().insert({traceId, eventId});
+            }
+        }
+    }
+}
+
+EventCacheSchema::Column EventCacheWriter::getColumn(const char* name,
+                                                     const AbstractEventValue& value)
+{
+    typedef EventCacheSchema::ColumnKind Kind;
+
+    EventCacheSchema::Column column {name ? name : "", Kind::NONE, -1};
+
+    switch (value.getType()) {
+    case EventValueType::SINT:
+        column.kind = Kind::SINT;
+        column.base = value.asSintValue().getDisplayBase();
+        break;
+
+    case EventValueType::UINT:
+        column.kind = Kind::UINT;
+        column.base = value.asUintValue().getDisplayBase();
+        break;
+
+    case EventValueType::FLOAT:
+        column.kind = Kind::FLOAT;
+        break;
+
+    case EventValueType::ENUM:
+        column.kind = Kind::ENUM;
+        break;
+
+    case EventValueType::STRING:
+        column.kind = Kind::STRING;
+        break;
+
+    case EventValueType::ARRAY:
+        if (value.asArray().isString()) {
+            column.kind = Kind::TEXT;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return column;
+}
+
+std::size_t EventCacheWriter::getTypeIndex(const Event& event)
+{
+    auto key = (static_cast<std::uint64_t>(event.getTraceId()) << 32) |
+               static_cast<std::uint32_t>(event.getId());
+    auto it = _typeIndexMap.find(key);
+
+    if (it != _typeIndexMap.end()) {
+        return it->second;
+    }
+
+    // first event of this type: discover its schema
+    auto typeIndex = _schema.getEventTypes().size();
+    EventCacheSchema::EventType eventType;
+    TypeColumns typeColumns;
+
+    eventType.traceId = event.getTraceId();
+    eventType.eventId = event.getId();
+    eventType.name = event.getName();
+    eventType.rows = 0;
+
+    for (std::size_t s = 0; s < EventCacheSchema::SCOPES_COUNT; ++s) {
+        auto& scope = eventType.scopes[s];
+        const auto& scopeValue = getScopeValue(event, s);
+
+        scope.present = (scopeValue.getType() == EventValueType::DICT);
+
+        if (!scope.present) {
+            continue;
+        }
+
+        const auto& dict = scopeValue.asDict();
+
+        for (std::size_t c = 0; c < dict.size(); ++c) {
+            scope.columns.push_back(EventCacheWriter::getColumn(dict.getKeyName(c),
+                                                                *dict.get(c)));
+            typeColumns[s].push_back(TypeColumn {
+                ColumnBuffer {EventCacheSchema::getColumnPath(_dir, typeIndex, s, c, ".col")},
+                ColumnBuffer {EventCacheSchema::getColumnPath(_dir, typeIndex, s, c, ".str")}
+            });
+        }
+    }
+
+    _schema.getEventTypes().push_back(std::move(eventType));
+    _typeColumns.push_back(std::move(typeColumns));
+    _typeIndexMap[key] = typeIndex;
+
+    return typeIndex;
+}
+
+void EventCacheWriter::appendValue(const EventCacheSchema::Column& column,
+                                   const AbstractEventValue* value,
+                                   TypeColumn& typeColumn)
+{
+    typedef EventCacheSchema::ColumnKind Kind;
+
+    // missing values or values not matching their column are written as defaults
+    auto type = value ? value->getType() : EventValueType::NUL;
+    const char* str = nullptr;
+
+    switch (column.kind) {
+    case Kind::SINT:
+        typeColumn.values.append<std::int64_t>(type == EventValueType::SINT ?
+                                               value->asSint() : 0);
+        return;
+
+    case Kind::UINT:
+        typeColumn.values.append<std::uint64_t>(type == EventValueType::UINT ?
+                                                value->asUint() : 0);
+        return;
+
+    case Kind::FLOAT:
+        typeColumn.values.append<double>(type == EventValueType::FLOAT ?
+                                         value->asFloat() : 0.);
+        return;
+
+    case Kind::ENUM:
+        // (integer value, label end offset) pairs
+        if (type == EventValueType::ENUM) {
+            typeColumn.values.append<std::uint64_t>(value->asEnumInt());
+            str = value->asEnumLabel();
+        } else {
+            typeColumn.values.append<std::uint64_t>(0);
+        }
+        break;
+
+    case Kind::STRING:
+        if (type == EventValueType::STRING) {
+            str = value->asString();
+        }
+        break;
+
+    case Kind::TEXT:
+        // (array size, text end offset) pairs
+        if (type == EventValueType::ARRAY) {
+            typeColumn.values.append<std::uint64_t>(value->asArray().size());
+            str = value->asArray().getString();
+        } else {
+            typeColumn.values.append<std::uint64_t>(0);
+        }
+        break;
+
+    default:
+        return;
+    }
+
+    if (!str) {
+        str = "";
+    }
+
+    // strings are null-terminated; their column holds their end offsets
+    typeColumn.strings.append(str, std::strlen(str) + 1);
+    typeColumn.values.append(typeColumn.strings.getSize());
+}
+
+void EventCacheWriter::append(const Event& event)
+{
+    auto typeIndex = this->getTypeIndex(event);
+    auto& eventType = _schema.getEventTypes()[typeIndex];
+    auto& typeColumns = _typeColumns[typeIndex];
+
+    _timestamps.append(event.getTimestamp());
+    _cycles.append(event.getCycles());
+    _traceIds.append(event.getTraceId());
+    _eventIds.append(event.getId());
+    _typeIndexes.append(static_cast<std::uint32_t>(typeIndex));
+
+    for (std::size_t s = 0; s < EventCacheSchema::SCOPES_COUNT; ++s) {
+        const auto& scope = eventType.scopes[s];
+
+        if (!scope.present) {
+            continue;
+        }
+
+        const auto& scopeValue = getScopeValue(event, s);
+        const DictEventValue* dict = nullptr;
+
+        if (scopeValue.getType() == EventValueType::DICT) {
+            dict = &scopeValue.asDict();
+        }
+
+        for (std::size_t c = 0; c < scope.columns.size(); ++c) {
+            const AbstractEventValue* value = nullptr;
+
+            if (dict && c < dict->size()) {
+                value = dict->get(c);
+            }
+
+            this->appendValue(scope.columns[c], value, typeColumns[s][c]);
+        }
+    }
+
+    eventType.rows++;
+    _schema.setRows(_schema.getRows() + 1);
+}
+
+void EventCacheWriter::close()
+{
+    _timestamps.flush();
+    _cycles.flush();
+    _traceIds.flush();
+    _eventIds.flush();
+    _typeIndexes.flush();
+
+    for (auto& typeColumns : _typeColumns) {
+        for (auto& scopeColumns : typeColumns) {
+            for (auto& typeColumn : scopeColumns) {
+                typeColumn.values.flush();
+                typeColumn.strings.flush();
+            }
+        }
+    }
+
+    // the schema makes the cache complete
+    if (!_schema.save(_dir)) {
+        throw ex::TraceSet {
+            "cannot write event cache schema in \"" + _dir.string() + "\""
+        };
+    }
+}
+
+}
+}
@@ -0,0 +1,166 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_EVENTCACHEWRITER_HPP
+#define _TIBEE_COMMON_EVENTCACHEWRITER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/AbstractEventValue.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventCacheSchema.hpp>
+#include <common/trace/EventFilter.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+class TraceSet;
+
+/**
+ * Columnar event cache writer.
+ *
+ * Appends events to a columnar event cache (see EventCacheSchema).
+ * The schema of an event type is discovered from its first event:
+ * integer, floating point number, enumeration, string and character
+ * array fields get a column; other fields (arrays of numbers, nested
+ * dictionaries) are replayed as null values.
+ *
+ * Column data is buffered in memory and appended to the column files
+ * by large chunks, so that only one file is open at a time.
+ *
+ * @author Philippe Proulx
+ */
+class EventCacheWriter :
+    boost::noncopyable
+{
+public:
+    /**
+     * Builds an event cache writer, removing any previous cache in
+     * directory \p dir.
+     *
+     * Only events accepted by \p filter are expected to be appended:
+     * the cache records them as cached, even if none occurs.
+     *
+     * @param dir      Cache directory
+     * @param traceSet Trace set of the events to cache
+     * @param filter   Filter of the events to cache or \a nullptr to
+     *                 cache all events
+     */
+    EventCacheWriter(const boost::filesystem::path& dir,
+                     const TraceSet& traceSet, const EventFilter* filter);
+
+    /**
+     * Appends event \p event to the cache.
+     *
+     * @param event Event to append
+     */
+    void append(const Event& event);
+
+    /**
+     * Flushes all columns and writes the schema, completing the cache.
+     *
+     * Throws ex::TraceSet on error.
+     */
+    void close();
+
+    /**
+     * Returns the number of events appended so far.
+     *
+     * @returns Number of events
+     */
+    std::uint64_t getEventCount() const
+    {
+        return _schema.getRows();
+    }
+
+private:
+    // in-memory tail of a column file
+    class ColumnBuffer
+    {
+    public:
+        explicit ColumnBuffer(const boost::filesystem::path& path);
+
+        template<typename T>
+        void append(T value)
+        {
+            this->append(&value, sizeof(value));
+        }
+
+        void append(const void* data, std::size_t size);
+        void flush();
+
+        std::uint64_t getSize() const
+        {
+            return _size;
+        }
+
+    private:
+        boost::filesystem::path _path;
+        std::vector<char> _data;
+
+        // total size (bytes), including what is already flushed
+        std::uint64_t _size;
+    };
+
+    // column buffers of an event type scope column
+    struct TypeColumn
+    {
+        ColumnBuffer values;
+        ColumnBuffer strings;
+    };
+
+    // column buffers of an event type
+    typedef std::array<std::vector<TypeColumn>, EventCacheSchema::SCOPES_COUNT> TypeColumns;
+
+private:
+    std::size_t getTypeIndex(const Event& event);
+    void appendValue(const EventCacheSchema::Column& column,
+                     const AbstractEventValue* value, TypeColumn& typeColumn);
+    static EventCacheSchema::Column getColumn(const char* name,
+                                              const AbstractEventValue& value);
+
+private:
+    boost::filesystem::path _dir;
+    EventCacheSchema _schema;
+
+    // global columns
+    ColumnBuffer _timestamps;
+    ColumnBuffer _cycles;
+    ColumnBuffer _traceIds;
+    ColumnBuffer _eventIds;
+    ColumnBuffer _typeIndexes;
+
+    // columns of each event type
+    std::vector<TypeColumns> _typeColumns;
+
+    // ((trace ID << 32 | event ID) -> event type index) map
+    std::unordered_map<std::uint64_t, std::size_t> _typeIndexMap;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_EVENTCACHEWRITER_HPP
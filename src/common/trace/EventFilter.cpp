@@ -0,0 +1,87 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/TraceUtils.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+EventFilter::EventFilter() :
+    _size {0}
+{
+}
+
+void EventFilter::add(trace_id_t traceId, event_id_t eventId)
+{
+    if (traceId < 0) {
+        return;
+    }
+
+    auto traceIndex = static_cast<std::size_t>(traceId);
+
+    if (traceIndex >= _traces.size()) {
+        _traces.resize(traceIndex + 1);
+    }
+
+    auto& streams = _traces[traceIndex];
+    auto streamIndex = EventFilter::streamIndex(eventId);
+
+    if (streamIndex >= streams.size()) {
+        streams.resize(streamIndex + 1);
+    }
+
+    auto& bitmap = streams[streamIndex];
+    auto bit = EventFilter::bitIndex(eventId);
+    auto word = bit / 64;
+
+    if (word >= bitmap.size()) {
+        bitmap.resize(word + 1, 0);
+    }
+
+    std::uint64_t mask = static_cast<std::uint64_t>(1) << (bit % 64);
+
+    if (!(bitmap[word] & mask)) {
+        bitmap[word] |= mask;
+        _size++;
+    }
+}
+
+void EventFilter::merge(const EventFilter& other)
+{
+    for (std::size_t t = 0; t < other._traces.size(); ++t) {
+        const auto& streams = other._traces[t];
+
+        for (std::size_t s = 0; s < streams.size(); ++s) {
+            const auto& bitmap = streams[s];
+
+            for (std::size_t w = 0; w < bitmap.size(); ++w) {
+                for (std::size_t b = 0; b < 64; ++b) {
+                    if ((bitmap[w] >> b) & 1) {
+                        this->add(static_cast<trace_id_t>(t),
+                                  TraceUtils::tibeeEventIdFromCtf(s, w * 64 + b));
+                    }
+                }
+            }
+        }
+    }
+}
+
+}
+}
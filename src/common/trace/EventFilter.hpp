@@ -0,0 +1,139 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_EVENTFILTER_HPP
+#define _TIBEE_COMMON_EVENTFILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include <common/BasicTypes.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Set of accepted (trace ID, event ID) pairs.
+ *
+ * An event filter is given to TraceSet::begin() so that events nobody
+ * is interested in are skipped as early as possible, before any Event
+ * object or event value is built for them.
+ *
+ * Internally, this is a bitmap per (trace ID, CTF stream ID) pair,
+ * indexed by CTF event ID, so that checking an event is a matter of
+ * a few array accesses.
+ *
+ * An empty filter accepts no event.
+ *
+ * @author Philippe Proulx
+ */
+class EventFilter
+{
+public:
+    /**
+     * Builds an empty event filter (accepting no event).
+     */
+    EventFilter();
+
+    /**
+     * Accepts event \p eventId of trace \p traceId.
+     *
+     * @param traceId Trace ID
+     * @param eventId Event ID
+     */
+    void add(trace_id_t traceId, event_id_t eventId);
+
+    /**
+     * Accepts all the events accepted by \p other.
+     *
+     * @param other Other event filter
+     */
+    void merge(const EventFilter& other);
+
+    /**
+     * Returns whether or not event \p eventId of trace \p traceId is
+     * accepted by this filter.
+     *
+     * @param traceId Trace ID
+     * @param eventId Event ID
+     * @returns       True if the event is accepted
+     */
+    bool accepts(trace_id_t traceId, event_id_t eventId) const
+    {
+        auto traceIndex = static_cast<std::size_t>(traceId);
+
+        if (traceIndex >= _traces.size()) {
+            return false;
+        }
+
+        const auto& streams = _traces[traceIndex];
+        auto streamIndex = EventFilter::streamIndex(eventId);
+
+        if (streamIndex >= streams.size()) {
+            return false;
+        }
+
+        const auto& bitmap = streams[streamIndex];
+        auto bit = EventFilter::bitIndex(eventId);
+        auto word = bit / 64;
+
+        if (word >= bitmap.size()) {
+            return false;
+        }
+
+        return (bitmap[word] >> (bit % 64)) & 1;
+    }
+
+    /**
+     * Returns the number of accepted events.
+     *
+     * @returns Number of accepted (trace ID, event ID) pairs
+     */
+    std::size_t size() const
+    {
+        return _size;
+    }
+
+private:
+    typedef std::vector<std::uint64_t> Bitmap;
+
+private:
+    static std::size_t streamIndex(event_id_t eventId)
+    {
+        return static_cast<std::size_t>(static_cast<std::uint32_t>(eventId) >> 20);
+    }
+
+    static std::size_t bitIndex(event_id_t eventId)
+    {
+        return static_cast<std::size_t>(eventId & 0xfffff);
+    }
+
+private:
+    // bitmaps, indexed by trace ID, then by CTF stream ID
+    std::vector<std::vector<Bitmap>> _traces;
+
+    // number of accepted events
+    std::size_t _size;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_EVENTFILTER_HPP
@@ -0,0 +1,192 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_EVENTVALUEARENA_HPP
+#define _TIBEE_COMMON_EVENTVALUEARENA_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Event value arena.
+ *
+ * This is a specific allocator for our use case: we never want to
+ * "free" objects, only allocate them one after the other, and free all
+ * the arena memory on destruction or "reset" it on demand (not freeing
+ * anything, but effectively restarting allocation from the beginning).
+ *
+ * Objects of any type are allocated by bumping a pointer within
+ * contiguous slabs of memory, so that the event values of a given
+ * event are packed together, in allocation order. When the current
+ * slab is full, allocation continues in the next one, which is only
+ * requested from the system the first time it's needed. Resetting the
+ * arena is O(1) and slabs are kept, so the steady state is
+ * allocation-free.
+ *
+ * The returned memory address when getting a new object space is
+ * guaranteed to respect the specified object type alignment.
+ *
+ * No constructor/destructor are called by this arena.
+ *
+ * @author Philippe Proulx
+ */
+class EventValueArena
+{
+public:
+    /**
+     * Builds an event value arena.
+     *
+     * @param slabSize Size of each slab (bytes)
+     */
+    explicit EventValueArena(std::size_t slabSize = 16384) :
+        _slabSize {slabSize},
+        _curSlab {0}
+    {
+        this->addSlab(slabSize);
+        this->reset();
+    }
+
+    /**
+     * Returns free space for an object of type \p T. The object is not
+     * constructed and never destroyed. It should not be freed by the
+     * caller.
+     *
+     * @returns Free space for an object of type \p T
+     */
+    template<typename T>
+    T* get()
+    {
+        return static_cast<T*>(this->allocate(sizeof(T), alignof(T)));
+    }
+
+    /**
+     * Resets the arena (capacity stays as is, but allocation restarts
+     * at the beginning of the first slab).
+     */
+    void reset()
+    {
+        _curSlab = 0;
+        this->useSlab(0);
+    }
+
+    /**
+     * Returns the total capacity of this arena.
+     *
+     * @returns Capacity (bytes)
+     */
+    std::size_t getCapacity() const
+    {
+        std::size_t capacity = 0;
+
+        for (const auto& slab : _slabs) {
+            capacity += slab.size;
+        }
+
+        return capacity;
+    }
+
+private:
+    struct Slab
+    {
+        std::unique_ptr<char[]> data;
+        std::size_t size;
+    };
+
+private:
+    void* allocate(std::size_t size, std::size_t align)
+    {
+        auto addr = EventValueArena::alignUp(_next, align);
+
+        if (addr + size <= _end) {
+            _next = addr + size;
+
+            return reinterpret_cast<void*>(addr);
+        }
+
+        return this->allocateSlow(size, align);
+    }
+
+    void* allocateSlow(std::size_t size, std::size_t align)
+    {
+        // next slab, or a new one if none is big enough
+        while (true) {
+            _curSlab++;
+
+            if (_curSlab == _slabs.size()) {
+                this->addSlab(std::max(_slabSize, size + align));
+            }
+
+            this->useSlab(_curSlab);
+
+            auto addr = EventValueArena::alignUp(_next, align);
+
+            if (addr + size <= _end) {
+                _next = addr + size;
+
+                return reinterpret_cast<void*>(addr);
+            }
+        }
+    }
+
+    void addSlab(std::size_t size)
+    {
+        _slabs.push_back(Slab {
+            std::unique_ptr<char[]> {new char[size]},
+            size
+        });
+    }
+
+    void useSlab(std::size_t index)
+    {
+        const auto& slab = _slabs[index];
+
+        _next = reinterpret_cast<std::uintptr_t>(slab.data.get());
+        _end = _next + slab.size;
+    }
+
+    static std::uintptr_t alignUp(std::uintptr_t addr, std::size_t align)
+    {
+        return (addr + align - 1) & ~static_cast<std::uintptr_t>(align - 1);
+    }
+
+private:
+    // size of regular slabs
+    std::size_t _slabSize;
+
+    // our slabs (never freed before destruction)
+    std::vector<Slab> _slabs;
+
+    // index of current slab
+    std::size_t _curSlab;
+
+    // next free address and end of current slab
+    std::uintptr_t _next;
+    std::uintptr_t _end;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_EVENTVALUEARENA_HPP
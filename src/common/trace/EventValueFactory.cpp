@@ -17,6 +17,7 @@
  */
 #include <memory>
 #include <functional>
+#include <cstring>
 #include <babeltrace/ctf/events.h>
 
 #include <common/trace/EventValueFactory.hpp>
@@ -26,14 +27,8 @@ namespace tibee
 namespace common
 {
 
-EventValueFactory::EventValueFactory() :
-    _arrayPool {128},
-    _dictPool {32},
-    _enumPool {64},
-    _floatPool {64},
-    _sintPool {128},
-    _stringPool {64},
-    _uintPool {128}
+EventValueFactory::EventValueFactory(bool detached) :
+    _detached {detached}
 {
     // initialize our null event value singleton
     _null = std::unique_ptr<NullEventValue> {new NullEventValue {this}};
@@ -51,7 +46,7 @@ void EventValueFactory::initTypes()
     // precious builder functions
     auto unknownBuilder = [this] (const ::bt_definition* def, const ::bt_ctf_event* ev)
     {
-        return _null.get();
+        return this->getNull();
     };
 
     auto intBuilder = [this] (const ::bt_definition* def, const ::bt_ctf_event* ev) -> const AbstractEventValue*
@@ -59,30 +54,30 @@ void EventValueFactory::initTypes()
         auto decl = ::bt_ctf_get_decl_from_def(def);
 
         if (::bt_ctf_get_int_signedness(decl) == 1) {
-            return new(_sintPool.get()) SintEventValue {def, this};
+            return new(_arena.get<SintEventValue>()) SintEventValue {def, this};
         } else {
-            return new(_uintPool.get()) UintEventValue {def, this};
+            return new(_arena.get<UintEventValue>()) UintEventValue {def, this};
         }
     };
 
     auto floatBuilder = [this] (const ::bt_definition* def, const ::bt_ctf_event* ev)
     {
-        return new(_floatPool.get()) FloatEventValue {def, this};
+        return new(_arena.get<FloatEventValue>()) FloatEventValue {def, this};
     };
 
     auto enumBuilder = [this] (const ::bt_definition* def, const ::bt_ctf_event* ev)
     {
-        return new(_enumPool.get()) EnumEventValue {def, this};
+        return new(_arena.get<EnumEventValue>()) EnumEventValue {def, this};
     };
 
     auto stringBuilder = [this] (const ::bt_definition* def, const ::bt_ctf_event* ev)
     {
-        return new(_stringPool.get()) StringEventValue {def, this};
+        return new(_arena.get<StringEventValue>()) StringEventValue {def, this};
     };
 
     auto structBuilder = [this] (const ::bt_definition* def, const ::bt_ctf_event* ev)
     {
-        return new(_dictPool.get()) DictEventValue {def, ev, this};
+        return new(_arena.get<DictEventValue>()) DictEventValue {def, ev, this};
     };
 
     auto variantBuilder = [this] (const ::bt_definition* def, const ::bt_ctf_event* ev)
@@ -94,7 +89,7 @@ void EventValueFactory::initTypes()
 
     auto arraySequenceBuilder = [this] (const ::bt_definition* def, const ::bt_ctf_event* ev)
     {
-        return new(_arrayPool.get()) ArrayEventValue {def, ev, this};
+        return new(_arena.get<ArrayEventValue>()) ArrayEventValue {def, ev, this};
     };
 
     // fill our builders
@@ -123,15 +118,117 @@ const AbstractEventValue* EventValueFactory::buildEventValue(const ::bt_definiti
     return _builders[valueType](def, ev);
 }
 
+const AbstractEventValue* EventValueFactory::copyEventValue(const AbstractEventValue& value) const
+{
+    switch (value.getType()) {
+    case EventValueType::SINT:
+        return this->buildSint(value.asSint(),
+                               value.asSintValue().getDisplayBase());
+
+    case EventValueType::UINT:
+        return this->buildUint(value.asUint(),
+                               value.asUintValue().getDisplayBase());
+
+    case EventValueType::FLOAT:
+        return this->buildFloat(value.asFloat());
+
+    case EventValueType::ENUM:
+        // labels belong to the enumeration declaration: no need to copy
+        return this->buildEnum(value.asEnumInt(), value.asEnumLabel());
+
+    case EventValueType::STRING:
+        return this->buildStringCopy(value.asString());
+
+    case EventValueType::ARRAY:
+    {
+        const auto& array = value.asArray();
+        auto size = array.size();
+        auto childrenIndex = this->reserveDetachedChildren(size);
+
+        for (std::size_t x = 0; x < size; ++x) {
+            this->setDetachedChild(childrenIndex + x,
+                                   this->copyEventValue(*array.get(x)),
+                                   nullptr);
+        }
+
+        const char* text = nullptr;
+
+        if (array.isString()) {
+            text = array.getString();
+        }
+
+        return this->buildArray(childrenIndex, size, text);
+    }
+
+    case EventValueType::DICT:
+    {
+        // field names belong to the declarations: no need to copy
+        const auto& dict = value.asDict();
+        auto size = dict.size();
+        auto childrenIndex = this->reserveDetachedChildren(size);
+
+        for (std::size_t x = 0; x < size; ++x) {
+            this->setDetachedChild(childrenIndex + x,
+                                   this->copyEventValue(*dict.get(x)),
+                                   dict.getKeyName(x));
+        }
+
+        return this->buildDict(childrenIndex, size);
+    }
+
+    default:
+        return this->getNull();
+    }
+}
+
 void EventValueFactory::resetPools()
 {
-    _arrayPool.reset();
-    _dictPool.reset();
-    _enumPool.reset();
-    _floatPool.reset();
-    _sintPool.reset();
-    _stringPool.reset();
-    _uintPool.reset();
+    _arena.reset();
+
+    // forget detached values (capacity is kept)
+    _detachedChildren.clear();
+    _detachedNames.clear();
+    _detachedStrings.clear();
+}
+
+std::size_t EventValueFactory::reserveDetachedChildren(std::size_t count) const
+{
+    auto index = _detachedChildren.size();
+
+    _detachedChildren.resize(index + count, nullptr);
+    _detachedNames.resize(index + count, nullptr);
+
+    return index;
+}
+
+std::size_t EventValueFactory::copyDetachedString(const char* str) const
+{
+    auto offset = _detachedStrings.size();
+
+    if (!str) {
+        str = "";
+    }
+
+    _detachedStrings.insert(_detachedStrings.end(), str,
+                            str + std::strlen(str) + 1);
+
+    return offset;
+}
+
+std::size_t EventValueFactory::copyDetachedString(const char* str,
+                                                  std::size_t len) const
+{
+    auto offset = _detachedStrings.size();
+    auto end = static_cast<const char*>(std::memchr(str, '\0', len));
+
+    if (!end) {
+        end = str + len;
+    }
+
+    _detachedStrings.insert(_detachedStrings.end(), str, end);
+    _detachedStrings.push_back('\0');
+
+    return offset;
 }
 
 }
@@ -19,10 +19,11 @@
 #define _TIBEE_COMMON_EVENTVALUEFACTORY_HPP
 
 #include <array>
+#include <vector>
 #include <functional>
 #include <babeltrace/ctf/events.h>
 
-#include <common/trace/EventValuePool.hpp>
+#include <common/trace/EventValueArena.hpp>
 #include <common/trace/AbstractEventValue.hpp>
 #include <common/trace/EventValueType.hpp>
 #include <common/trace/StringEventValue.hpp>
@@ -52,8 +53,16 @@ class EventValueFactory
 public:
     /**
      * Builds an event value factory.
+     *
+     * A detached factory builds event values which copy everything
+     * they need out of their BT definition when they are created, so
+     * that they remain valid after the BT iterator moves on. This is
+     * slower for a single event, but makes it possible to decode
+     * events ahead of their consumption.
+     *
+     * @param detached True to build detached event values
      */
-    EventValueFactory();
+    EventValueFactory(bool detached = false);
 
     /**
      * Destroys an event value factory.
@@ -77,7 +86,147 @@ public:
                                               const ::bt_ctf_event* ev) const;
 
     /**
-     * Resets all internal pools.
+     * Builds an unsigned integer event value out of an already decoded
+     * integer.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param value Integer value
+     * @param base  Expected display base or -1
+     * @returns     Unsigned integer event value
+     */
+    const AbstractEventValue* buildUint(std::uint64_t value, int base) const
+    {
+        return new(_arena.get<UintEventValue>()) UintEventValue {value, base, this};
+    }
+
+    /**
+     * Builds a signed integer event value out of an already decoded
+     * integer.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param value Integer value
+     * @param base  Expected display base or -1
+     * @returns     Signed integer event value
+     */
+    const AbstractEventValue* buildSint(std::int64_t value, int base) const
+    {
+        return new(_arena.get<SintEventValue>()) SintEventValue {value, base, this};
+    }
+
+    /**
+     * Builds a floating point number event value out of an already
+     * decoded number.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param value Floating point number value
+     * @returns     Floating point number event value
+     */
+    const AbstractEventValue* buildFloat(double value) const
+    {
+        return new(_arena.get<FloatEventValue>()) FloatEventValue {value, this};
+    }
+
+    /**
+     * Builds an enumeration item event value out of an already decoded
+     * integer and its label.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param intValue Integer value
+     * @param label    Label (must outlive the returned value)
+     * @returns        Enumeration item event value
+     */
+    const AbstractEventValue* buildEnum(std::uint64_t intValue,
+                                        const char* label) const
+    {
+        return new(_arena.get<EnumEventValue>()) EnumEventValue {intValue, label, this};
+    }
+
+    /**
+     * Builds a string event value out of an existing null-terminated
+     * string, without copying it.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param value String (must outlive the returned value)
+     * @returns     String event value
+     */
+    const AbstractEventValue* buildString(const char* value) const
+    {
+        return new(_arena.get<StringEventValue>()) StringEventValue {value, this};
+    }
+
+    /**
+     * Builds a string event value out of a copy of \p value.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param value String to copy
+     * @returns     String event value
+     */
+    const AbstractEventValue* buildStringCopy(const char* value) const
+    {
+        auto offset = this->copyDetachedString(value);
+
+        return new(_arena.get<StringEventValue>()) StringEventValue {offset, this};
+    }
+
+    /**
+     * Builds a dictionary event value out of \p size detached children
+     * starting at slot \p childrenIndex.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param childrenIndex Index of the first detached child slot
+     * @param size          Number of items
+     * @returns             Dictionary event value
+     */
+    const AbstractEventValue* buildDict(std::size_t childrenIndex,
+                                        std::size_t size) const
+    {
+        return new(_arena.get<DictEventValue>()) DictEventValue {childrenIndex, size, this};
+    }
+
+    /**
+     * Builds an array event value out of \p size detached children
+     * starting at slot \p childrenIndex.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param childrenIndex Index of the first detached child slot
+     * @param size          Number of items
+     * @param text          Raw characters if this array is a string, or
+     *                      \a nullptr
+     * @returns             Array event value
+     */
+    const AbstractEventValue* buildArray(std::size_t childrenIndex,
+                                         std::size_t size,
+                                         const char* text) const
+    {
+        return new(_arena.get<ArrayEventValue>()) ArrayEventValue {
+            childrenIndex, size, text, this
+        };
+    }
+
+    /**
+     * Builds a detached copy of an event value built by any factory.
+     *
+     * This factory should be a detached one so that the copy remains
+     * valid as long as this factory's pools are not reset.
+     *
+     * Caller doesn't own this pointer and should not free it.
+     *
+     * @param value Event value to copy
+     * @returns     Copy of \p value
+     */
+    const AbstractEventValue* copyEventValue(const AbstractEventValue& value) const;
+
+    /**
+     * Resets all internal pools (event value arena and detached value
+     * storage). This is O(1) and doesn't free any memory.
      */
     void resetPools();
 
@@ -93,6 +242,95 @@ public:
         return _null.get();
     }
 
+    /**
+     * Returns whether or not this factory builds detached event values.
+     *
+     * @returns True if this factory builds detached event values
+     */
+    bool isDetached() const
+    {
+        return _detached;
+    }
+
+    /**
+     * Reserves \p count contiguous detached child slots and returns
+     * the index of the first one.
+     *
+     * @param count Number of slots to reserve
+     * @returns     Index of the first reserved slot
+     */
+    std::size_t reserveDetachedChildren(std::size_t count) const;
+
+    /**
+     * Sets a detached child slot.
+     *
+     * @param index Slot index
+     * @param value Child event value
+     * @param name  Child name (must outlive the current event) or
+     *              \a nullptr
+     */
+    void setDetachedChild(std::size_t index, const AbstractEventValue* value,
+                          const char* name) const
+    {
+        _detachedChildren[index] = value;
+        _detachedNames[index] = name;
+    }
+
+    /**
+     * Returns the value of detached child slot \p index.
+     *
+     * @param index Slot index
+     * @returns     Child event value
+     */
+    const AbstractEventValue* getDetachedChild(std::size_t index) const
+    {
+        return _detachedChildren[index];
+    }
+
+    /**
+     * Returns the name of detached child slot \p index.
+     *
+     * @param index Slot index
+     * @returns     Child name or \a nullptr
+     */
+    const char* getDetachedName(std::size_t index) const
+    {
+        return _detachedNames[index];
+    }
+
+    /**
+     * Copies a string into this factory's detached string storage.
+     *
+     * @param str String to copy
+     * @returns   Offset of the copy within the detached string storage
+     */
+    std::size_t copyDetachedString(const char* str) const;
+
+    /**
+     * Copies at most \p len characters of a string (stopping at the
+     * first null character) into this factory's detached string
+     * storage. The copy is always null-terminated.
+     *
+     * @param str String to copy
+     * @param len Maximum number of characters to copy
+     * @returns   Offset of the copy within the detached string storage
+     */
+    std::size_t copyDetachedString(const char* str, std::size_t len) const;
+
+    /**
+     * Returns a detached string previously copied with
+     * copyDetachedString().
+     *
+     * The returned pointer is valid until the pools are reset.
+     *
+     * @param offset Offset returned by copyDetachedString()
+     * @returns      Detached string
+     */
+    const char* getDetachedString(std::size_t offset) const
+    {
+        return _detachedStrings.data() + offset;
+    }
+
 private:
     typedef std::function<const AbstractEventValue* (const ::bt_definition*, const ::bt_ctf_event* ev)> BuildValueFunc;
 
@@ -103,17 +341,24 @@ private:
     // array mapping (CTF types -> event value builder functions)
     std::array<BuildValueFunc, 32> _builders;
 
-    // our object pools
-    EventValuePool<ArrayEventValue> _arrayPool;
-    EventValuePool<DictEventValue> _dictPool;
-    EventValuePool<EnumEventValue> _enumPool;
-    EventValuePool<FloatEventValue> _floatPool;
-    EventValuePool<SintEventValue> _sintPool;
-    EventValuePool<StringEventValue> _stringPool;
-    EventValuePool<UintEventValue> _uintPool;
+    // arena of all our event values (const build methods use it)
+    mutable EventValueArena _arena;
 
     // null event value "singleton", always valid when this factory exists
     std::unique_ptr<NullEventValue> _null;
+
+    // true if this factory builds detached event values
+    bool _detached;
+
+    /* Storage of detached values (children of detached dictionaries
+     * and arrays, and copies of strings). Event values refer to this
+     * storage using indexes since it may grow while an event is being
+     * detached. Clearing those vectors on reset doesn't free anything,
+     * so the steady state is allocation-free.
+     */
+    mutable std::vector<const AbstractEventValue*> _detachedChildren;
+    mutable std::vector<const char*> _detachedNames;
+    mutable std::vector<char> _detachedStrings;
 };
 
 }
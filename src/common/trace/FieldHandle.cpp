@@ -0,0 +1,121 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+
+#include <common/trace/FieldHandle.hpp>
+#include <common/trace/TraceSet.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+const field_index_t FieldHandle::NO_INDEX;
+
+FieldHandle::FieldHandle() :
+    _traceEntries {0},
+    _scope {Scope::FIELDS}
+{
+}
+
+FieldHandle::FieldHandle(const TraceSet* traceSet,
+                         const std::string& eventName,
+                         const std::string& fieldName, Scope scope) :
+    _traceEntries {0},
+    _scope {scope}
+{
+    this->resolve(traceSet, std::vector<std::string> {eventName}, fieldName);
+}
+
+FieldHandle::FieldHandle(const TraceSet* traceSet,
+                         const std::vector<std::string>& eventNames,
+                         const std::string& fieldName, Scope scope) :
+    _traceEntries {0},
+    _scope {scope}
+{
+    this->resolve(traceSet, eventNames, fieldName);
+}
+
+void FieldHandle::resolve(const TraceSet* traceSet,
+                          const std::vector<std::string>& eventNames,
+                          const std::string& fieldName)
+{
+    const char* scopeName = (_scope == Scope::CONTEXT) ? "context" : "fields";
+
+    // (trace ID -> entries) map, ordered by trace ID
+    std::map<trace_id_t, std::vector<Entry>> traceEntries;
+    trace_id_t maxTraceId = -1;
+
+    for (const auto& traceInfos : traceSet->getTracesInfos()) {
+        maxTraceId = std::max(maxTraceId, traceInfos->getId());
+
+        for (const auto& eventName : eventNames) {
+            auto eventIt = traceInfos->getEventMap()->find(eventName);
+
+            if (eventIt == traceInfos->getEventMap()->end()) {
+                continue;
+            }
+
+            const auto& eventInfos = eventIt->second;
+            auto scopeIt = eventInfos->getFieldMap()->find(scopeName);
+
+            if (scopeIt == eventInfos->getFieldMap()->end() || !scopeIt->second) {
+                continue;
+            }
+
+            const auto& scopeFieldMap = scopeIt->second->getFieldMap();
+
+            if (!scopeFieldMap) {
+                continue;
+            }
+
+            auto fieldIt = scopeFieldMap->find(fieldName);
+
+            if (fieldIt == scopeFieldMap->end()) {
+                continue;
+            }
+
+            traceEntries[traceInfos->getId()].push_back({
+                eventInfos->getId(),
+                fieldIt->second->getIndex()
+            });
+        }
+    }
+
+    // flatten
+    _entries.clear();
+    _traceEntries.clear();
+
+    for (trace_id_t traceId = 0; traceId <= maxTraceId; ++traceId) {
+        _traceEntries.push_back(_entries.size());
+
+        auto it = traceEntries.find(traceId);
+
+        if (it != traceEntries.end()) {
+            _entries.insert(_entries.end(), it->second.begin(), it->second.end());
+        }
+    }
+
+    _traceEntries.push_back(_entries.size());
+}
+
+}
+}
@@ -0,0 +1,169 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_FIELDHANDLE_HPP
+#define _TIBEE_COMMON_FIELDHANDLE_HPP
+
+#include <cstddef>
+#include <limits>
+#include <string>
+#include <vector>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/Event.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+class TraceSet;
+
+/**
+ * Pre-resolved handle to a top-level field of one or more events.
+ *
+ * A field handle is built once (usually when initializing a state
+ * provider) using the event and field informations of a trace set.
+ * Reading a field of an event through a field handle, using
+ * Event::operator[](const FieldHandle&), is then a matter of looking
+ * up a few integers instead of comparing field names.
+ *
+ * The same handle works for all the traces of the set, even if the
+ * field is not found at the same index in all of them.
+ *
+ * @author Philippe Proulx
+ */
+class FieldHandle
+{
+public:
+    /// Top-level scope of the field
+    enum class Scope
+    {
+        FIELDS,
+        CONTEXT,
+    };
+
+    /// Index returned when the field is unknown for a given event
+    static const field_index_t NO_INDEX = std::numeric_limits<field_index_t>::max();
+
+public:
+    /**
+     * Builds an empty field handle (resolving nothing).
+     */
+    FieldHandle();
+
+    /**
+     * Builds a field handle for field \p fieldName of event
+     * \p eventName, for all the traces of \p traceSet.
+     *
+     * @param traceSet  Trace set
+     * @param eventName Event name
+     * @param fieldName Field name
+     * @param scope     Top-level scope of the field
+     */
+    FieldHandle(const TraceSet* traceSet, const std::string& eventName,
+                const std::string& fieldName, Scope scope = Scope::FIELDS);
+
+    /**
+     * Builds a field handle for field \p fieldName of all events named
+     * \p eventNames, for all the traces of \p traceSet.
+     *
+     * @param traceSet   Trace set
+     * @param eventNames Event names
+     * @param fieldName  Field name
+     * @param scope      Top-level scope of the field
+     */
+    FieldHandle(const TraceSet* traceSet,
+                const std::vector<std::string>& eventNames,
+                const std::string& fieldName, Scope scope = Scope::FIELDS);
+
+    /**
+     * Returns the index of this field within its top-level scope for
+     * a given event.
+     *
+     * @param event Event
+     * @returns     Field index or FieldHandle::NO_INDEX if this field
+     *              is unknown for \p event
+     */
+    field_index_t getIndex(const Event& event) const
+    {
+        auto traceId = static_cast<std::size_t>(event.getTraceId());
+
+        // _traceEntries always has at least one element
+        if (traceId >= _traceEntries.size() - 1) {
+            return NO_INDEX;
+        }
+
+        // very few entries per trace: linear search
+        for (auto x = _traceEntries[traceId]; x < _traceEntries[traceId + 1]; ++x) {
+            if (_entries[x].eventId == event.getId()) {
+                return _entries[x].index;
+            }
+        }
+
+        return NO_INDEX;
+    }
+
+    /**
+     * Returns the top-level scope of this field.
+     *
+     * @returns Top-level scope
+     */
+    Scope getScope() const
+    {
+        return _scope;
+    }
+
+    /**
+     * Returns whether or not this handle resolved its field in at
+     * least one trace.
+     *
+     * @returns True if this handle resolves something
+     */
+    bool isValid() const
+    {
+        return !_entries.empty();
+    }
+
+private:
+    struct Entry
+    {
+        event_id_t eventId;
+        field_index_t index;
+    };
+
+private:
+    void resolve(const TraceSet* traceSet,
+                 const std::vector<std::string>& eventNames,
+                 const std::string& fieldName);
+
+private:
+    // entries, sorted by trace ID
+    std::vector<Entry> _entries;
+
+    /* Index of the first entry of each trace ID within _entries; the
+     * entries of trace ID n are in [_traceEntries[n], _traceEntries[n + 1]).
+     */
+    std::vector<std::size_t> _traceEntries;
+
+    Scope _scope;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_FIELDHANDLE_HPP
@@ -21,6 +21,7 @@
 #include <common/trace/EventValueType.hpp>
 #include <common/trace/AbstractEventValue.hpp>
 #include <common/trace/FloatEventValue.hpp>
+#include <common/trace/EventValueFactory.hpp>
 
 namespace tibee
 {
@@ -30,12 +31,30 @@ namespace common
 FloatEventValue::FloatEventValue(const ::bt_definition* def,
                                  const EventValueFactory* valueFactory) :
     AbstractEventValue {EventValueType::FLOAT, valueFactory},
-    _btDef {def}
+    _btDef {def},
+    _detached {false}
+{
+    if (valueFactory->isDetached()) {
+        _detachedValue = this->getValue();
+        _detached = true;
+    }
+}
+
+FloatEventValue::FloatEventValue(double value,
+                                 const EventValueFactory* valueFactory) :
+    AbstractEventValue {EventValueType::FLOAT, valueFactory},
+    _btDef {nullptr},
+    _detached {true},
+    _detachedValue {value}
 {
 }
 
 double FloatEventValue::getValue() const
 {
+    if (_detached) {
+        return _detachedValue;
+    }
+
     return ::bt_ctf_get_float(_btDef);
 }
 
@@ -45,6 +45,15 @@ public:
     FloatEventValue(const ::bt_definition* def,
                     const EventValueFactory* valueFactory);
 
+    /**
+     * Builds a floating point number value out of an already decoded
+     * number.
+     *
+     * @param value        Floating point number value
+     * @param valueFactory Value factory used to create other event values
+     */
+    FloatEventValue(double value, const EventValueFactory* valueFactory);
+
     /**
      * Returns the floating point number value.
      *
@@ -57,6 +66,8 @@ private:
 
 private:
     const ::bt_definition* _btDef;
+    bool _detached;
+    double _detachedValue;
 };
 
 }
@@ -0,0 +1,156 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <functional>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include <common/trace/NativeCtfDecoder.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+NativeCtfDecoder::NativeCtfDecoder(::bt_context* btCtx,
+                                   const std::set<std::unique_ptr<TraceInfos>>& tracesInfos,
+                                   const EventFilter* filter,
+                                   timestamp_t beginTs, timestamp_t endTs,
+                                   const PacketIndex::Map* packetIndexes) :
+    _supported {false},
+    _filter {filter},
+    _packetIndexes {packetIndexes},
+    _beginTs {beginTs},
+    _endTs {endTs},
+    _curStream {nullptr},
+    _curStreamIndex {0}
+{
+    // sort traces by ID to keep streams deterministic
+    std::vector<const TraceInfos*> sortedTracesInfos;
+
+    for (const auto& traceInfos : tracesInfos) {
+        sortedTracesInfos.push_back(traceInfos.get());
+    }
+
+    std::sort(sortedTracesInfos.begin(), sortedTracesInfos.end(),
+              [] (const TraceInfos* a, const TraceInfos* b) {
+        return a->getId() < b->getId();
+    });
+
+    // compile all traces
+    for (auto traceInfos : sortedTracesInfos) {
+        auto trace = NativeCtfTrace::create(btCtx, *traceInfos);
+
+        if (!trace) {
+            return;
+        }
+
+        _traces.push_back(std::move(trace));
+    }
+
+    _supported = true;
+
+    this->openStreams();
+}
+
+void NativeCtfDecoder::openStreams()
+{
+    for (const auto& trace : _traces) {
+        // packet index of this trace, if any
+        const PacketIndex* packetIndex = nullptr;
+
+        if (_packetIndexes) {
+            auto it = _packetIndexes->find(trace->getId());
+
+            if (it != _packetIndexes->end()) {
+                packetIndex = it->second.get();
+            }
+        }
+
+        for (const auto& path : trace->getStreamPaths()) {
+            const PacketIndex::Stream* streamIndex = nullptr;
+
+            if (packetIndex) {
+                streamIndex = packetIndex->getStream(path.filename().string());
+            }
+
+            _streams.push_back(NativeCtfStream::UP {
+                new NativeCtfStream {
+                    path, *trace, _filter, _beginTs, streamIndex
+                }
+            });
+        }
+    }
+
+    // fill the heap with the first event of each stream
+    for (std::size_t x = 0; x < _streams.size(); ++x) {
+        this->pushStream(x);
+    }
+}
+
+void NativeCtfDecoder::pushStream(std::size_t index)
+{
+    auto& stream = *_streams[index];
+
+    if (!stream.next()) {
+        // this stream is done
+        return;
+    }
+
+    auto ts = stream.getCurrentEvent().getTimestamp();
+
+    if (ts > _endTs) {
+        // past the range: this stream is done too
+        return;
+    }
+
+    _heap.push_back(std::make_pair(ts, index));
+    std::push_heap(_heap.begin(), _heap.end(), std::greater<HeapEntry> {});
+}
+
+bool NativeCtfDecoder::nextImpl()
+{
+    // decode the next event of the previous stream
+    if (_curStream) {
+        _curStream = nullptr;
+        this->pushStream(_curStreamIndex);
+    }
+
+    if (_heap.empty()) {
+        return false;
+    }
+
+    // pick the stream with the oldest current event
+    std::pop_heap(_heap.begin(), _heap.end(), std::greater<HeapEntry> {});
+    _curStreamIndex = _heap.back().second;
+    _heap.pop_back();
+
+    _curStream = _streams[_curStreamIndex].get();
+
+    return true;
+}
+
+const Event& NativeCtfDecoder::getCurrentEventImpl() const
+{
+    return _curStream->getCurrentEvent();
+}
+
+}
+}
@@ -0,0 +1,136 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_NATIVECTFDECODER_HPP
+#define _TIBEE_COMMON_NATIVECTFDECODER_HPP
+
+#include <cstddef>
+#include <memory>
+#include <set>
+#include <utility>
+#include <vector>
+#include <babeltrace/babeltrace.h>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/AbstractEventSource.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/NativeCtfStream.hpp>
+#include <common/trace/NativeCtfTrace.hpp>
+#include <common/trace/PacketIndex.hpp>
+#include <common/trace/TraceInfos.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Native CTF decoder.
+ *
+ * Decodes all the streams of a set of CTF traces without Babeltrace
+ * (see NativeCtfStream), and merges their events by timestamp using a
+ * heap, like Babeltrace does.
+ *
+ * Babeltrace is still used to parse the trace metadata. Not all CTF
+ * layouts are supported: isSupported() must be checked after building
+ * a native decoder, and Babeltrace used instead if it returns false.
+ *
+ * Packets are decoded on the caller thread, in place: event values
+ * (strings included) point straight into the mapped streams and are
+ * only valid until the next event. Decoding packets ahead on other
+ * threads would mean copying each event out of the stream like
+ * StreamGroupDecoder does, which costs about as much as decoding it
+ * natively in the first place.
+ *
+ * @author Philippe Proulx
+ */
+class NativeCtfDecoder :
+    public AbstractEventSource
+{
+public:
+    /**
+     * Builds a native CTF decoder.
+     *
+     * @param btCtx       Babeltrace context in which all traces of
+     *                    \p tracesInfos were added
+     * @param tracesInfos Informations about the traces to decode
+     * @param filter      Event filter (must outlive this decoder) or
+     *                    \a nullptr to decode all events
+     * @param beginTs     Timestamp of the first event to decode
+     * @param endTs       Timestamp of the last event to decode
+     * @param packetIndexes Packet indexes of (some of) the traces
+     *                      (must outlive this decoder) or \a nullptr
+     */
+    NativeCtfDecoder(::bt_context* btCtx,
+                     const std::set<std::unique_ptr<TraceInfos>>& tracesInfos,
+                     const EventFilter* filter, timestamp_t beginTs,
+                     timestamp_t endTs, const PacketIndex::Map* packetIndexes);
+
+    /**
+     * Returns whether or not all traces may be decoded natively.
+     *
+     * @returns True if this decoder may be used
+     */
+    bool isSupported() const
+    {
+        return _supported;
+    }
+
+private:
+    typedef std::pair<timestamp_t, std::size_t> HeapEntry;
+
+private:
+    bool nextImpl();
+    const Event& getCurrentEventImpl() const;
+    void openStreams();
+    void pushStream(std::size_t index);
+
+private:
+    // true if all traces may be decoded natively
+    bool _supported;
+
+    // event filter or null
+    const EventFilter* _filter;
+
+    // packet indexes or null
+    const PacketIndex::Map* _packetIndexes;
+
+    // range of events to decode
+    timestamp_t _beginTs;
+    timestamp_t _endTs;
+
+    // compiled traces
+    std::vector<NativeCtfTrace::UP> _traces;
+
+    // all streams of all traces
+    std::vector<NativeCtfStream::UP> _streams;
+
+    // (timestamp of current event, stream index) min-heap
+    std::vector<HeapEntry> _heap;
+
+    // stream of current event or null
+    NativeCtfStream* _curStream;
+
+    // index of current stream
+    std::size_t _curStreamIndex;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_NATIVECTFDECODER_HPP
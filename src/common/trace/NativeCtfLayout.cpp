@@ -0,0 +1,741 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cstring>
+#include <vector>
+#include <endian.h>
+#include <glib.h>
+
+#include <common/trace/NativeCtfLayout.hpp>
+#include <common/trace/babeltrace-internals.h>
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+std::uint64_t readBits(const std::uint8_t* base, std::uint64_t offset,
+                       unsigned int size, bool isBigEndian)
+{
+    auto bytes = base + offset / 8;
+    std::uint64_t value = 0;
+
+    // fast path: byte-aligned, byte-sized integer
+    if (offset % 8 == 0 && size % 8 == 0) {
+#if __BYTE_ORDER == __LITTLE_ENDIAN
+        if (!isBigEndian) {
+            std::memcpy(&value, bytes, size / 8);
+
+            return value;
+        }
+#endif
+
+        if (isBigEndian) {
+            for (unsigned int x = 0; x < size / 8; ++x) {
+                value = (value << 8) | bytes[x];
+            }
+        } else {
+            for (unsigned int x = size / 8; x > 0; --x) {
+                value = (value << 8) | bytes[x - 1];
+            }
+        }
+
+        return value;
+    }
+
+    /* CTF bit fields: little-endian fields start at the least
+     * significant bit of their first byte, big-endian fields at the
+     * most significant bit.
+     */
+    unsigned int done = 0;
+
+    while (done < size) {
+        auto pos = offset + done;
+        auto bit = static_cast<unsigned int>(pos % 8);
+        auto take = std::min(8 - bit, size - done);
+        auto byte = static_cast<unsigned int>(base[pos / 8]);
+        auto mask = (1u << take) - 1;
+
+        if (isBigEndian) {
+            value = (value << take) | ((byte >> (8 - bit - take)) & mask);
+        } else {
+            value |= static_cast<std::uint64_t>((byte >> bit) & mask) << done;
+        }
+
+        done += take;
+    }
+
+    return value;
+}
+
+std::uint64_t signExtend(std::uint64_t value, unsigned int size)
+{
+    if (size < 64 && (value >> (size - 1)) & 1) {
+        value |= ~static_cast<std::uint64_t>(0) << size;
+    }
+
+    return value;
+}
+
+bool lessThan(std::uint64_t a, std::uint64_t b, bool isSigned)
+{
+    if (isSigned) {
+        return static_cast<std::int64_t>(a) < static_cast<std::int64_t>(b);
+    }
+
+    return a < b;
+}
+
+bool isLittleOrBigEndian(int byteOrder)
+{
+    return byteOrder == LITTLE_ENDIAN || byteOrder == BIG_ENDIAN;
+}
+
+const char* fieldName(GQuark quark)
+{
+    // same as bt_ctf_field_name(): do not pick the first '_' character
+    auto name = ::g_quark_to_string(quark);
+
+    if (name && name[0] == '_') {
+        ++name;
+    }
+
+    return name;
+}
+
+NativeCtfLayout::Role roleFromName(::bt_ctf_scope scope, const char* name)
+{
+    typedef NativeCtfLayout::Role Role;
+
+    if (!name) {
+        return Role::NONE;
+    }
+
+    switch (scope) {
+    case ::BT_TRACE_PACKET_HEADER:
+        if (std::strcmp(name, "magic") == 0) {
+            return Role::MAGIC;
+        } else if (std::strcmp(name, "stream_id") == 0) {
+            return Role::STREAM_ID;
+        }
+        break;
+
+    case ::BT_STREAM_PACKET_CONTEXT:
+        if (std::strcmp(name, "content_size") == 0) {
+            return Role::CONTENT_SIZE;
+        } else if (std::strcmp(name, "packet_size") == 0) {
+            return Role::PACKET_SIZE;
+        } else if (std::strcmp(name, "timestamp_begin") == 0) {
+            return Role::TIMESTAMP_BEGIN;
+        } else if (std::strcmp(name, "timestamp_end") == 0) {
+            return Role::TIMESTAMP_END;
+        } else if (std::strcmp(name, "cpu_id") == 0) {
+            return Role::CPU_ID;
+        }
+        break;
+
+    case ::BT_STREAM_EVENT_HEADER:
+        // may be found at any depth (e.g. in LTTng's compact/extended variant)
+        if (std::strcmp(name, "id") == 0) {
+            return Role::EVENT_ID;
+        } else if (std::strcmp(name, "timestamp") == 0) {
+            return Role::TIMESTAMP;
+        }
+        break;
+
+    default:
+        break;
+    }
+
+    return Role::NONE;
+}
+
+}
+
+const std::size_t NativeCtfLayout::NO_SIBLING;
+
+NativeCtfLayout::NativeCtfLayout()
+{
+}
+
+NativeCtfLayout::UP NativeCtfLayout::compile(const ::tibee_bt_declaration* decl,
+                                             ::bt_ctf_scope scope)
+{
+    if (!decl || decl->id != ::CTF_TYPE_STRUCT) {
+        return nullptr;
+    }
+
+    UP layout {new NativeCtfLayout};
+    std::size_t rootIndex;
+
+    if (!layout->compileNode(decl, nullptr, scope, NO_SIBLING, NO_SIBLING,
+                             rootIndex)) {
+        return nullptr;
+    }
+
+    return layout;
+}
+
+bool NativeCtfLayout::compileNode(const ::tibee_bt_declaration* decl,
+                                  const char* name, ::bt_ctf_scope scope,
+                                  std::size_t sibling, std::size_t siblingNode,
+                                  std::size_t& nodeIndex)
+{
+    if (!decl) {
+        return false;
+    }
+
+    // reserve our node now so that the root structure is node 0
+    nodeIndex = _nodes.size();
+    _nodes.push_back(Node {});
+
+    Node node;
+
+    node.alignment = std::max(static_cast<unsigned int>(decl->alignment), 1u);
+    node.size = 0;
+    node.isSigned = false;
+    node.isBigEndian = false;
+    node.isText = false;
+    node.base = -1;
+    node.role = Role::NONE;
+    node.name = name;
+    node.length = 0;
+    node.sibling = sibling;
+
+    if ((node.alignment & (node.alignment - 1)) != 0) {
+        return false;
+    }
+
+    switch (decl->id) {
+    case ::CTF_TYPE_INTEGER:
+    case ::CTF_TYPE_ENUM:
+    {
+        const ::tibee_declaration_integer* intDecl;
+
+        if (decl->id == ::CTF_TYPE_ENUM) {
+            auto enumDecl = reinterpret_cast<const ::tibee_declaration_enum*>(decl);
+
+            node.type = NodeType::ENUM;
+            intDecl = enumDecl->integer_declaration;
+
+            // flatten (label -> ranges) table
+            ::GHashTableIter it;
+            ::gpointer key;
+            ::gpointer value;
+
+            ::g_hash_table_iter_init(&it, enumDecl->table.quark_to_range_set);
+
+            while (::g_hash_table_iter_next(&it, &key, &value)) {
+                auto label = ::g_quark_to_string(static_cast<GQuark>(GPOINTER_TO_UINT(key)));
+                auto ranges = static_cast<const GArray*>(value);
+
+                for (std::size_t x = 0; x < ranges->len; ++x) {
+                    const auto& range = g_array_index(ranges, ::tibee_enum_range, x);
+
+                    node.ranges.push_back({
+                        range.start._unsigned,
+                        range.end._unsigned,
+                        label,
+                        0
+                    });
+                }
+            }
+        } else {
+            node.type = NodeType::INTEGER;
+            intDecl = reinterpret_cast<const ::tibee_declaration_integer*>(decl);
+        }
+
+        if (!intDecl || intDecl->len == 0 || intDecl->len > 64 ||
+                !isLittleOrBigEndian(intDecl->byte_order)) {
+            return false;
+        }
+
+        node.size = intDecl->len;
+        node.isSigned = (intDecl->signedness != 0);
+        node.isBigEndian = (intDecl->byte_order == BIG_ENDIAN);
+        node.isText = (intDecl->encoding != ::CTF_STRING_NONE);
+        node.base = intDecl->base;
+        node.role = roleFromName(scope, name);
+
+        auto isSigned = node.isSigned;
+
+        std::sort(node.ranges.begin(), node.ranges.end(),
+                  [isSigned] (const Range& a, const Range& b) {
+            return lessThan(a.start, b.start, isSigned);
+        });
+        break;
+    }
+
+    case ::CTF_TYPE_FLOAT:
+    {
+        auto floatDecl = reinterpret_cast<const ::tibee_declaration_float*>(decl);
+
+        if (!floatDecl->exp || !floatDecl->mantissa ||
+                !isLittleOrBigEndian(floatDecl->byte_order)) {
+            return false;
+        }
+
+        // mantissa length excludes the implicit bit
+        auto expLen = floatDecl->exp->len;
+        auto mantLen = floatDecl->mantissa->len;
+
+        if (expLen == 8 && mantLen == 23) {
+            node.size = 32;
+        } else if (expLen == 11 && mantLen == 52) {
+            node.size = 64;
+        } else {
+            return false;
+        }
+
+        node.type = NodeType::FLOAT;
+        node.isBigEndian = (floatDecl->byte_order == BIG_ENDIAN);
+        break;
+    }
+
+    case ::CTF_TYPE_STRING:
+        node.type = NodeType::STRING;
+        node.alignment = std::max(node.alignment, 8u);
+        break;
+
+    case ::CTF_TYPE_STRUCT:
+        node.type = NodeType::STRUCT;
+
+        if (!this->compileStruct(decl, scope, node)) {
+            return false;
+        }
+        break;
+
+    case ::CTF_TYPE_ARRAY:
+    case ::CTF_TYPE_SEQUENCE:
+    {
+        const ::tibee_bt_declaration* elemDecl;
+
+        if (decl->id == ::CTF_TYPE_ARRAY) {
+            auto arrayDecl = reinterpret_cast<const ::tibee_declaration_array*>(decl);
+
+            node.type = NodeType::ARRAY;
+            node.length = arrayDecl->len;
+            elemDecl = arrayDecl->elem;
+        } else {
+            auto sequenceDecl = reinterpret_cast<const ::tibee_declaration_sequence*>(decl);
+
+            // length must be a previous integer of the same structure
+            if (sibling == NO_SIBLING) {
+                return false;
+            }
+
+            auto lengthType = _nodes[siblingNode].type;
+
+            if (lengthType != NodeType::INTEGER && lengthType != NodeType::ENUM) {
+                return false;
+            }
+
+            node.type = NodeType::SEQUENCE;
+            elemDecl = sequenceDecl->elem;
+        }
+
+        std::size_t elemIndex;
+
+        if (!this->compileNode(elemDecl, nullptr, scope, NO_SIBLING,
+                               NO_SIBLING, elemIndex)) {
+            return false;
+        }
+
+        const auto& elemNode = _nodes[elemIndex];
+
+        node.children.push_back(elemIndex);
+        node.isText = elemNode.type == NodeType::INTEGER && elemNode.isText &&
+                      elemNode.size == 8 && elemNode.alignment == 8;
+        break;
+    }
+
+    case ::CTF_TYPE_VARIANT:
+    {
+        auto variantDecl = reinterpret_cast<const ::tibee_declaration_variant*>(decl);
+        auto untaggedDecl = variantDecl->untagged_variant;
+
+        // tag must be a previous enumeration of the same structure
+        if (sibling == NO_SIBLING || !untaggedDecl || !untaggedDecl->fields) {
+            return false;
+        }
+
+        if (_nodes[siblingNode].type != NodeType::ENUM) {
+            return false;
+        }
+
+        node.type = NodeType::VARIANT;
+        node.isSigned = _nodes[siblingNode].isSigned;
+
+        // compile options
+        std::vector<const char*> optionNames;
+
+        for (std::size_t x = 0; x < untaggedDecl->fields->len; ++x) {
+            const auto& field = g_array_index(untaggedDecl->fields,
+                                              ::tibee_declaration_field, x);
+            std::size_t optionIndex;
+
+            if (!this->compileNode(field.declaration, fieldName(field.name),
+                                   scope, NO_SIBLING, NO_SIBLING,
+                                   optionIndex)) {
+                return false;
+            }
+
+            node.children.push_back(optionIndex);
+            optionNames.push_back(::g_quark_to_string(field.name));
+        }
+
+        // map tag ranges to options (by label)
+        for (const auto& tagRange : _nodes[siblingNode].ranges) {
+            for (std::size_t x = 0; x < optionNames.size(); ++x) {
+                if (std::strcmp(tagRange.label, optionNames[x]) == 0) {
+                    node.ranges.push_back({
+                        tagRange.start,
+                        tagRange.end,
+                        tagRange.label,
+                        x
+                    });
+                    break;
+                }
+            }
+        }
+        break;
+    }
+
+    default:
+        // untagged variant or unknown
+        return false;
+    }
+
+    _nodes[nodeIndex] = std::move(node);
+
+    return true;
+}
+
+bool NativeCtfLayout::compileStruct(const ::tibee_bt_declaration* decl,
+                                    ::bt_ctf_scope scope, Node& node)
+{
+    auto structDecl = reinterpret_cast<const ::tibee_declaration_struct*>(decl);
+
+    if (!structDecl->fields) {
+        return false;
+    }
+
+    std::vector<GQuark> names;
+
+    for (std::size_t x = 0; x < structDecl->fields->len; ++x) {
+        const auto& field = g_array_index(structDecl->fields,
+                                          ::tibee_declaration_field, x);
+        auto fieldDecl = field.declaration;
+
+        if (!fieldDecl) {
+            return false;
+        }
+
+        // find the sequence length or variant tag field, if any
+        const GArray* path = nullptr;
+        auto sibling = NO_SIBLING;
+
+        if (fieldDecl->id == ::CTF_TYPE_SEQUENCE) {
+            path = reinterpret_cast<const ::tibee_declaration_sequence*>(fieldDecl)->length_name;
+        } else if (fieldDecl->id == ::CTF_TYPE_VARIANT) {
+            path = reinterpret_cast<const ::tibee_declaration_variant*>(fieldDecl)->tag_name;
+        }
+
+        if (path) {
+            if (path->len != 1) {
+                return false;
+            }
+
+            auto it = std::find(names.begin(), names.end(),
+                                g_array_index(path, GQuark, 0));
+
+            if (it == names.end()) {
+                return false;
+            }
+
+            sibling = static_cast<std::size_t>(it - names.begin());
+        }
+
+        std::size_t childIndex;
+        auto siblingNode = (sibling == NO_SIBLING) ? NO_SIBLING : node.children[sibling];
+
+        if (!this->compileNode(fieldDecl, fieldName(field.name), scope,
+                               sibling, siblingNode, childIndex)) {
+            return false;
+        }
+
+        node.children.push_back(childIndex);
+        names.push_back(field.name);
+    }
+
+    return true;
+}
+
+const NativeCtfLayout::Range* NativeCtfLayout::findRange(const Node& node,
+                                                         std::uint64_t raw)
+{
+    // ranges are sorted by start value
+    for (const auto& range : node.ranges) {
+        if (lessThan(raw, range.start, node.isSigned)) {
+            break;
+        }
+
+        if (!lessThan(range.end, raw, node.isSigned)) {
+            return &range;
+        }
+    }
+
+    return nullptr;
+}
+
+bool NativeCtfLayout::decode(Cursor& cursor,
+                             const EventValueFactory* valueFactory,
+                             Specials& specials,
+                             const AbstractEventValue*& value) const
+{
+    std::uint64_t raw;
+
+    cursor.raw.clear();
+
+    return this->decodeNode(0, cursor, 0, valueFactory, specials, value, raw);
+}
+
+bool NativeCtfLayout::decodeNode(std::size_t nodeIndex, Cursor& cursor,
+                                 std::size_t siblingsBase,
+                                 const EventValueFactory* valueFactory,
+                                 Specials& specials,
+                                 const AbstractEventValue*& value,
+                                 std::uint64_t& raw) const
+{
+    const auto& node = _nodes[nodeIndex];
+
+    // align (relative to the packet start)
+    std::uint64_t alignMask = node.alignment - 1;
+
+    cursor.offset = (cursor.offset + alignMask) & ~alignMask;
+    raw = 0;
+
+    switch (node.type) {
+    case NodeType::INTEGER:
+    case NodeType::ENUM:
+        if (cursor.offset + node.size > cursor.limit) {
+            return false;
+        }
+
+        raw = readBits(cursor.base, cursor.offset, node.size, node.isBigEndian);
+        cursor.offset += node.size;
+
+        if (node.isSigned) {
+            raw = signExtend(raw, node.size);
+        }
+
+        if (node.role != Role::NONE) {
+            auto role = static_cast<unsigned int>(node.role);
+
+            specials.found |= 1u << role;
+            specials.values[role] = raw;
+
+            if (node.role == Role::TIMESTAMP) {
+                specials.timestampSize = node.size;
+            }
+        }
+
+        if (!valueFactory) {
+            return true;
+        }
+
+        if (node.type == NodeType::ENUM) {
+            auto range = NativeCtfLayout::findRange(node, raw);
+
+            value = valueFactory->buildEnum(raw, range ? range->label : nullptr);
+        } else if (node.isSigned) {
+            value = valueFactory->buildSint(static_cast<std::int64_t>(raw),
+                                            node.base);
+        } else {
+            value = valueFactory->buildUint(raw, node.base);
+        }
+
+        return true;
+
+    case NodeType::FLOAT:
+    {
+        if (cursor.offset + node.size > cursor.limit) {
+            return false;
+        }
+
+        auto bits = readBits(cursor.base, cursor.offset, node.size,
+                             node.isBigEndian);
+
+        cursor.offset += node.size;
+
+        if (!valueFactory) {
+            return true;
+        }
+
+        double number;
+
+        if (node.size == 32) {
+            auto bits32 = static_cast<std::uint32_t>(bits);
+            float number32;
+
+            std::memcpy(&number32, &bits32, sizeof(number32));
+            number = number32;
+        } else {
+            std::memcpy(&number, &bits, sizeof(number));
+        }
+
+        value = valueFactory->buildFloat(number);
+
+        return true;
+    }
+
+    case NodeType::STRING:
+    {
+        if (cursor.offset >= cursor.limit) {
+            return false;
+        }
+
+        // zero copy: the string stays in the mapped packet
+        auto str = reinterpret_cast<const char*>(cursor.base + cursor.offset / 8);
+        auto avail = (cursor.limit - cursor.offset) / 8;
+        auto end = static_cast<const char*>(std::memchr(str, '\0', avail));
+
+        if (!end) {
+            return false;
+        }
+
+        cursor.offset += (end - str + 1) * 8;
+
+        if (valueFactory) {
+            value = valueFactory->buildString(str);
+        }
+
+        return true;
+    }
+
+    case NodeType::STRUCT:
+    {
+        auto count = node.children.size();
+        auto base = cursor.raw.size();
+        std::size_t childrenIndex = 0;
+
+        cursor.raw.resize(base + count);
+
+        if (valueFactory) {
+            childrenIndex = valueFactory->reserveDetachedChildren(count);
+        }
+
+        for (std::size_t x = 0; x < count; ++x) {
+            auto childNodeIndex = node.children[x];
+            const AbstractEventValue* childValue = nullptr;
+            std::uint64_t childRaw;
+
+            if (!this->decodeNode(childNodeIndex, cursor, base, valueFactory,
+                                  specials, childValue, childRaw)) {
+                return false;
+            }
+
+            cursor.raw[base + x] = childRaw;
+
+            if (valueFactory) {
+                valueFactory->setDetachedChild(childrenIndex + x, childValue,
+                                               _nodes[childNodeIndex].name);
+            }
+        }
+
+        cursor.raw.resize(base);
+
+        if (valueFactory) {
+            value = valueFactory->buildDict(childrenIndex, count);
+        }
+
+        return true;
+    }
+
+    case NodeType::VARIANT:
+    {
+        auto range = NativeCtfLayout::findRange(node, cursor.raw[siblingsBase + node.sibling]);
+
+        if (!range) {
+            return false;
+        }
+
+        return this->decodeNode(node.children[range->option], cursor,
+                                siblingsBase, valueFactory, specials, value,
+                                raw);
+    }
+
+    case NodeType::ARRAY:
+    case NodeType::SEQUENCE:
+    {
+        std::uint64_t length = node.length;
+
+        if (node.type == NodeType::SEQUENCE) {
+            length = cursor.raw[siblingsBase + node.sibling];
+        }
+
+        // each element takes at least one bit (protects from bad lengths)
+        if (length > cursor.limit - cursor.offset) {
+            return false;
+        }
+
+        const char* text = nullptr;
+
+        if (node.isText) {
+            text = reinterpret_cast<const char*>(cursor.base + cursor.offset / 8);
+        }
+
+        auto elemIndex = node.children.front();
+        std::size_t childrenIndex = 0;
+
+        if (valueFactory) {
+            childrenIndex = valueFactory->reserveDetachedChildren(length);
+        }
+
+        for (std::size_t x = 0; x < length; ++x) {
+            const AbstractEventValue* childValue = nullptr;
+            std::uint64_t childRaw;
+
+            if (!this->decodeNode(elemIndex, cursor, siblingsBase,
+                                  valueFactory, specials, childValue,
+                                  childRaw)) {
+                return false;
+            }
+
+            if (valueFactory) {
+                valueFactory->setDetachedChild(childrenIndex + x, childValue,
+                                               nullptr);
+            }
+        }
+
+        if (valueFactory) {
+            value = valueFactory->buildArray(childrenIndex, length, text);
+        }
+
+        return true;
+    }
+    }
+
+    return false;
+}
+
+}
+}
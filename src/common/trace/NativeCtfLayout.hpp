@@ -0,0 +1,228 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_NATIVECTFLAYOUT_HPP
+#define _TIBEE_COMMON_NATIVECTFLAYOUT_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <boost/utility.hpp>
+#include <babeltrace/ctf/events.h>
+
+#include <common/trace/AbstractEventValue.hpp>
+#include <common/trace/EventValueFactory.hpp>
+
+struct tibee_bt_declaration;
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Compiled layout of a CTF top-level scope (packet header, packet
+ * context, event header, event context or event fields).
+ *
+ * A native CTF layout is compiled once from the declarations of a
+ * trace parsed by Babeltrace, and is then able to decode a scope
+ * straight from the bytes of a packet, building detached event values.
+ *
+ * Not all CTF declarations are supported: sequence lengths and variant
+ * tags must be previous fields of the same structure, and floating
+ * point numbers must be IEEE 754 single or double precision. Unsupported
+ * layouts are reported by compile() so that callers may fall back to
+ * Babeltrace.
+ *
+ * @author Philippe Proulx
+ */
+class NativeCtfLayout :
+    boost::noncopyable
+{
+public:
+    /// Unique pointer to native CTF layout
+    typedef std::unique_ptr<NativeCtfLayout> UP;
+
+    /// Special integers the decoder needs to know about
+    enum class Role
+    {
+        NONE,
+        MAGIC,
+        STREAM_ID,
+        CONTENT_SIZE,
+        PACKET_SIZE,
+        TIMESTAMP_BEGIN,
+        TIMESTAMP_END,
+        CPU_ID,
+        EVENT_ID,
+        TIMESTAMP,
+    };
+
+    /// Values of special integers found while decoding a scope
+    struct Specials
+    {
+        /// Forgets all special values
+        void reset()
+        {
+            found = 0;
+        }
+
+        /// Returns whether or not a special value was found
+        bool has(Role role) const
+        {
+            return (found & (1u << static_cast<unsigned int>(role))) != 0;
+        }
+
+        /// Returns a special value
+        std::uint64_t get(Role role) const
+        {
+            return values[static_cast<unsigned int>(role)];
+        }
+
+        unsigned int found;
+        std::uint64_t values[10];
+
+        // size of the last TIMESTAMP value found (bits)
+        unsigned int timestampSize;
+    };
+
+    /// Decoding position within a packet
+    struct Cursor
+    {
+        // packet start (CTF alignment is relative to it)
+        const std::uint8_t* base;
+
+        // current offset from the packet start (bits)
+        std::uint64_t offset;
+
+        // offset of the end of the readable content (bits)
+        std::uint64_t limit;
+
+        // raw integer values of the fields of the structures being decoded
+        std::vector<std::uint64_t> raw;
+    };
+
+public:
+    /**
+     * Compiles the layout of top-level scope \p scope out of its
+     * Babeltrace declaration.
+     *
+     * @param decl  Babeltrace declaration of the scope (a structure)
+     * @param scope Top-level scope (determines special integers)
+     * @returns     Compiled layout or \a nullptr if not supported
+     */
+    static UP compile(const ::tibee_bt_declaration* decl, ::bt_ctf_scope scope);
+
+    /**
+     * Decodes this scope at the current position of \p cursor,
+     * advancing it.
+     *
+     * If \p valueFactory is \a nullptr, no event value is built and
+     * \p value is left untouched.
+     *
+     * @param cursor       Decoding position
+     * @param valueFactory Detached value factory or \a nullptr
+     * @param specials     Special values found (not reset)
+     * @param value        Decoded event value (dictionary)
+     * @returns            True if decoded, false if the scope does
+     *                     not fit within the packet content
+     */
+    bool decode(Cursor& cursor, const EventValueFactory* valueFactory,
+                Specials& specials, const AbstractEventValue*& value) const;
+
+private:
+    enum class NodeType
+    {
+        INTEGER,
+        ENUM,
+        FLOAT,
+        STRING,
+        STRUCT,
+        VARIANT,
+        ARRAY,
+        SEQUENCE,
+    };
+
+    // enumeration label range or variant option range
+    struct Range
+    {
+        std::uint64_t start;
+        std::uint64_t end;
+        const char* label;
+        std::size_t option;
+    };
+
+    struct Node
+    {
+        NodeType type;
+
+        // alignment (bits)
+        unsigned int alignment;
+
+        // integer, enumeration or floating point number size (bits)
+        unsigned int size;
+
+        bool isSigned;
+        bool isBigEndian;
+        bool isText;
+        int base;
+        Role role;
+
+        // field name (without leading underscore) or null
+        const char* name;
+
+        // fields (structure), options (variant) or element (array, sequence)
+        std::vector<std::size_t> children;
+
+        // array length
+        std::size_t length;
+
+        // index of length field (sequence) or tag field (variant) in parent
+        std::size_t sibling;
+
+        // enumeration labels (enumeration) or options (variant), sorted
+        std::vector<Range> ranges;
+    };
+
+private:
+    NativeCtfLayout();
+    bool compileNode(const ::tibee_bt_declaration* decl, const char* name,
+                     ::bt_ctf_scope scope, std::size_t sibling,
+                     std::size_t siblingNode, std::size_t& nodeIndex);
+    bool compileStruct(const ::tibee_bt_declaration* decl,
+                       ::bt_ctf_scope scope, Node& node);
+    bool decodeNode(std::size_t nodeIndex, Cursor& cursor,
+                    std::size_t siblingsBase,
+                    const EventValueFactory* valueFactory,
+                    Specials& specials, const AbstractEventValue*& value,
+                    std::uint64_t& raw) const;
+    static const Range* findRange(const Node& node, std::uint64_t raw);
+
+private:
+    // no sibling (node not directly within a structure)
+    static const std::size_t NO_SIBLING = static_cast<std::size_t>(-1);
+
+private:
+    // all nodes; the root structure is node 0
+    std::vector<Node> _nodes;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_NATIVECTFLAYOUT_HPP
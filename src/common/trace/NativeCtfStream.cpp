@@ -0,0 +1,403 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cerrno>
+#include <cstring>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <common/trace/NativeCtfStream.hpp>
+#include <common/ex/TraceSet.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+const std::uint64_t CTF_MAGIC = 0xc1fc1fc1;
+
+}
+
+NativeCtfStream::NativeCtfStream(const boost::filesystem::path& path,
+                                 const NativeCtfTrace& trace,
+                                 const EventFilter* filter,
+                                 timestamp_t beginTs,
+                                 const PacketIndex::Stream* streamIndex) :
+    _trace {std::addressof(trace)},
+    _filter {filter},
+    _beginTs {beginTs},
+    _path {path},
+    _fd {-1},
+    _data {nullptr},
+    _size {0},
+    _packetOffset {0},
+    _packetSize {0},
+    _inPacket {false},
+    _streamClass {nullptr},
+    _cycles {0},
+    _packetValueFactory {true},
+    _packetContext {nullptr},
+    _valueFactory {true}
+{
+    _fd = ::open(path.string().c_str(), O_RDONLY);
+
+    if (_fd < 0) {
+        throw ex::TraceSet {
+            "cannot open stream \"" + path.string() + "\": " + std::strerror(errno)
+        };
+    }
+
+    struct ::stat st;
+
+    if (::fstat(_fd, &st) < 0) {
+        ::close(_fd);
+
+        throw ex::TraceSet {
+            "cannot stat stream \"" + path.string() + "\": " + std::strerror(errno)
+        };
+    }
+
+    _size = static_cast<std::size_t>(st.st_size);
+
+    if (_size > 0) {
+        auto addr = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, _fd, 0);
+
+        if (addr == MAP_FAILED) {
+            ::close(_fd);
+
+            throw ex::TraceSet {
+                "cannot map stream \"" + path.string() + "\": " + std::strerror(errno)
+            };
+        }
+
+        // packets are read in order
+        ::madvise(addr, _size, MADV_SEQUENTIAL);
+        _data = static_cast<const std::uint8_t*>(addr);
+    }
+
+    _event = std::unique_ptr<Event> {
+        new Event {std::addressof(_valueFactory)}
+    };
+
+    // jump to the first packet of the range
+    if (streamIndex && _beginTs > 0) {
+        auto packet = streamIndex->findPacket(_beginTs);
+
+        if (packet < streamIndex->packets.size()) {
+            _packetOffset = streamIndex->packets[packet].offset;
+        } else {
+            _packetOffset = _size;
+        }
+    }
+}
+
+NativeCtfStream::~NativeCtfStream()
+{
+    if (_data) {
+        ::munmap(const_cast<std::uint8_t*>(_data), _size);
+    }
+
+    ::close(_fd);
+}
+
+void NativeCtfStream::throwCorrupted(const std::string& what) const
+{
+    throw ex::TraceSet {
+        "cannot decode stream \"" + _path.string() + "\" (packet at " +
+        std::to_string(_packetOffset) + "): " + what
+    };
+}
+
+void NativeCtfStream::checkEventSize(std::uint64_t eventOffset) const
+{
+    /* An empty event would be decoded again and again until the end
+     * of its packet, which never comes.
+     */
+    if (_cursor.offset == eventOffset) {
+        this->throwCorrupted("empty event at bit " + std::to_string(eventOffset));
+    }
+}
+
+bool NativeCtfStream::openPacket()
+{
+    if (_packetOffset >= _size) {
+        return false;
+    }
+
+    _cursor.base = _data + _packetOffset;
+    _cursor.offset = 0;
+    _cursor.limit = static_cast<std::uint64_t>(_size - _packetOffset) * 8;
+    _specials.reset();
+
+    // packet header (not kept)
+    const AbstractEventValue* unused;
+    auto packetHeader = _trace->getPacketHeader();
+
+    if (packetHeader && !packetHeader->decode(_cursor, nullptr, _specials, unused)) {
+        this->throwCorrupted("truncated packet header");
+    }
+
+    typedef NativeCtfLayout::Role Role;
+
+    if (_specials.has(Role::MAGIC) && _specials.get(Role::MAGIC) != CTF_MAGIC) {
+        this->throwCorrupted("wrong magic number");
+    }
+
+    auto streamId = _specials.has(Role::STREAM_ID) ? _specials.get(Role::STREAM_ID) : 0;
+
+    _streamClass = _trace->getStreamClass(streamId);
+
+    if (!_streamClass) {
+        this->throwCorrupted("unknown stream ID " + std::to_string(streamId));
+    }
+
+    // packet context (kept for all the events of this packet)
+    _packetValueFactory.resetPools();
+    _packetContext = _packetValueFactory.getNull();
+
+    auto packetContext = _streamClass->packetContext.get();
+
+    if (packetContext && !packetContext->decode(_cursor, &_packetValueFactory,
+                                                _specials, _packetContext)) {
+        this->throwCorrupted("truncated packet context");
+    }
+
+    auto packetSize = _cursor.limit;
+
+    if (_specials.has(Role::PACKET_SIZE)) {
+        packetSize = _specials.get(Role::PACKET_SIZE);
+    }
+
+    auto contentSize = packetSize;
+
+    if (_specials.has(Role::CONTENT_SIZE)) {
+        contentSize = _specials.get(Role::CONTENT_SIZE);
+    }
+
+    if (packetSize == 0 || packetSize % 8 != 0 || packetSize > _cursor.limit ||
+            contentSize > packetSize || contentSize < _cursor.offset) {
+        this->throwCorrupted("invalid packet or content size");
+    }
+
+    _packetSize = packetSize;
+    _cursor.limit = contentSize;
+
+    if (_specials.has(Role::TIMESTAMP_BEGIN)) {
+        _cycles = _specials.get(Role::TIMESTAMP_BEGIN);
+    }
+
+    // whole packet before the first event to decode: skip its events
+    if (_beginTs > 0 && _specials.has(Role::TIMESTAMP_END)) {
+        auto endTs = _trace->cyclesToTimestamp(_specials.get(Role::TIMESTAMP_END));
+
+        if (endTs < _beginTs) {
+            _cursor.limit = _cursor.offset;
+        }
+    }
+
+    _inPacket = true;
+
+    return true;
+}
+
+void NativeCtfStream::updateCycles(std::uint64_t value, unsigned int size)
+{
+    // same as Babeltrace's ctf_update_timestamp()
+    if (size >= 64) {
+        _cycles = value;
+
+        return;
+    }
+
+    auto mask = (static_cast<std::uint64_t>(1) << size) - 1;
+
+    // a smaller value than the current low-order bits means a wrap
+    if (value < (_cycles & mask)) {
+        _cycles += static_cast<std::uint64_t>(1) << size;
+    }
+
+    _cycles = (_cycles & ~mask) | value;
+}
+
+void NativeCtfStream::decodeScope(const NativeCtfLayout* layout,
+                                  ::bt_ctf_scope scope)
+{
+    if (!layout) {
+        return;
+    }
+
+    const AbstractEventValue* value;
+
+    if (!layout->decode(_cursor, &_valueFactory, _specials, value)) {
+        this->throwCorrupted("truncated event");
+    }
+
+    _event->setNativeScope(scope, value);
+}
+
+void NativeCtfStream::skipScope(const NativeCtfLayout* layout)
+{
+    if (!layout) {
+        return;
+    }
+
+    const AbstractEventValue* unused;
+
+    if (!layout->decode(_cursor, nullptr, _specials, unused)) {
+        this->throwCorrupted("truncated event");
+    }
+}
+
+const NativeCtfTrace::EventClass& NativeCtfStream::decodeEventHeader()
+{
+    typedef NativeCtfLayout::Role Role;
+
+    // event header (not kept)
+    const AbstractEventValue* unused;
+    auto eventHeader = _streamClass->eventHeader.get();
+
+    _specials.reset();
+
+    if (eventHeader && !eventHeader->decode(_cursor, nullptr, _specials, unused)) {
+        this->throwCorrupted("truncated event header");
+    }
+
+    if (_specials.has(Role::TIMESTAMP)) {
+        this->updateCycles(_specials.get(Role::TIMESTAMP),
+                           _specials.timestampSize);
+    }
+
+    auto ctfEventId = _specials.has(Role::EVENT_ID) ? _specials.get(Role::EVENT_ID) : 0;
+
+    if (ctfEventId >= _streamClass->eventClasses.size() ||
+            !_streamClass->eventClasses[ctfEventId]) {
+        this->throwCorrupted("unknown event ID " + std::to_string(ctfEventId));
+    }
+
+    return *_streamClass->eventClasses[ctfEventId];
+}
+
+void NativeCtfStream::skipPayload(const NativeCtfTrace::EventClass& eventClass)
+{
+    this->skipScope(_streamClass->eventContext.get());
+    this->skipScope(eventClass.context.get());
+    this->skipScope(eventClass.fields.get());
+}
+
+bool NativeCtfStream::next()
+{
+    while (true) {
+        // find the next packet having events left
+        while (true) {
+            if (!_inPacket && !this->openPacket()) {
+                return false;
+            }
+
+            if (_cursor.offset < _cursor.limit) {
+                break;
+            }
+
+            _packetOffset += _packetSize / 8;
+            _inPacket = false;
+        }
+
+        auto eventOffset = _cursor.offset;
+        const auto& eventClass = this->decodeEventHeader();
+        auto ts = _trace->cyclesToTimestamp(_cycles);
+
+        if (ts < _beginTs ||
+                (_filter && !_filter->accepts(_trace->getId(), eventClass.id))) {
+            // filtered out: skip its payload without building anything
+            this->skipPayload(eventClass);
+            this->checkEventSize(eventOffset);
+
+            continue;
+        }
+
+        // new event
+        _valueFactory.resetPools();
+        _event->setNativeEvent(eventClass.id, _trace->getId(), eventClass.name,
+                               _cycles, ts);
+        _event->setNativeScope(::BT_STREAM_PACKET_CONTEXT, _packetContext);
+
+        this->decodeScope(_streamClass->eventContext.get(), ::BT_STREAM_EVENT_CONTEXT);
+        this->decodeScope(eventClass.context.get(), ::BT_EVENT_CONTEXT);
+        this->decodeScope(eventClass.fields.get(), ::BT_EVENT_FIELDS);
+        this->checkEventSize(eventOffset);
+
+        return true;
+    }
+}
+
+void NativeCtfStream::index(std::vector<PacketIndex::Packet>& packets)
+{
+    typedef NativeCtfLayout::Role Role;
+
+    // visit all packets from the beginning, whatever the range
+    _packetOffset = 0;
+    _inPacket = false;
+
+    timestamp_t lastTs = 0;
+
+    while (this->openPacket()) {
+        PacketIndex::Packet packet;
+
+        packet.offset = _packetOffset;
+        packet.size = _packetSize / 8;
+        packet.beginTs = lastTs;
+        packet.endTs = lastTs;
+        packet.eventCount = 0;
+        packet.cpu = PacketIndex::NO_CPU;
+
+        if (_specials.has(Role::CPU_ID)) {
+            packet.cpu = _specials.get(Role::CPU_ID);
+        }
+
+        while (_cursor.offset < _cursor.limit) {
+            auto eventOffset = _cursor.offset;
+            const auto& eventClass = this->decodeEventHeader();
+            auto ts = _trace->cyclesToTimestamp(_cycles);
+
+            this->skipPayload(eventClass);
+            this->checkEventSize(eventOffset);
+
+            if (packet.eventCount == 0) {
+                packet.beginTs = ts;
+            }
+
+            packet.endTs = ts;
+            packet.eventCount++;
+        }
+
+        lastTs = packet.endTs;
+        packets.push_back(packet);
+
+        _packetOffset += _packetSize / 8;
+        _inPacket = false;
+    }
+
+    _packetOffset = 0;
+}
+
+}
+}
@@ -0,0 +1,179 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_NATIVECTFSTREAM_HPP
+#define _TIBEE_COMMON_NATIVECTFSTREAM_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/EventValueFactory.hpp>
+#include <common/trace/NativeCtfLayout.hpp>
+#include <common/trace/NativeCtfTrace.hpp>
+#include <common/trace/PacketIndex.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Native decoder of a single CTF stream file.
+ *
+ * The whole stream file is mapped in memory and its packets are
+ * visited in order. Events are decoded straight from the mapped
+ * packets using the compiled layouts of their trace, and strings are
+ * not even copied.
+ *
+ * @see NativeCtfDecoder
+ *
+ * @author Philippe Proulx
+ */
+class NativeCtfStream :
+    boost::noncopyable
+{
+public:
+    /// Unique pointer to native CTF stream
+    typedef std::unique_ptr<NativeCtfStream> UP;
+
+public:
+    /**
+     * Maps a stream file in memory.
+     *
+     * If \p filter is not \a nullptr, events it doesn't accept are
+     * skipped without building any event value. Events before
+     * \p beginTs are skipped the same way, and so are whole packets
+     * ending before \p beginTs, without even looking at their events.
+     * If \p streamIndex is not \a nullptr, decoding starts directly at
+     * the first packet of the range it records.
+     *
+     * @param path        Stream file path
+     * @param trace       Trace of this stream (must outlive this stream)
+     * @param filter      Event filter (must outlive this stream) or
+     *                    \a nullptr to decode all events
+     * @param beginTs     Timestamp of the first event to decode
+     * @param streamIndex Packet index of this stream or \a nullptr
+     */
+    NativeCtfStream(const boost::filesystem::path& path,
+                    const NativeCtfTrace& trace, const EventFilter* filter,
+                    timestamp_t beginTs,
+                    const PacketIndex::Stream* streamIndex);
+
+    /**
+     * Unmaps the stream file.
+     */
+    ~NativeCtfStream();
+
+    /**
+     * Decodes the next event of this stream, invalidating the
+     * current one.
+     *
+     * @returns True if there's a current event, false when done
+     */
+    bool next();
+
+    /**
+     * Returns the current event.
+     *
+     * @returns Current event
+     */
+    const Event& getCurrentEvent() const
+    {
+        return *_event;
+    }
+
+    /**
+     * Visits all the packets and events of this stream, from the
+     * beginning, without building any event value, and appends one
+     * entry per packet to \p packets.
+     *
+     * This stream must be rewound (recreated) before calling next().
+     *
+     * @param packets Packet entries to fill
+     */
+    void index(std::vector<PacketIndex::Packet>& packets);
+
+private:
+    bool openPacket();
+    void updateCycles(std::uint64_t value, unsigned int size);
+    void decodeScope(const NativeCtfLayout* layout, ::bt_ctf_scope scope);
+    void skipScope(const NativeCtfLayout* layout);
+    void skipPayload(const NativeCtfTrace::EventClass& eventClass);
+    const NativeCtfTrace::EventClass& decodeEventHeader();
+    void checkEventSize(std::uint64_t eventOffset) const;
+    void throwCorrupted(const std::string& what) const;
+
+private:
+    // trace of this stream
+    const NativeCtfTrace* _trace;
+
+    // event filter or null
+    const EventFilter* _filter;
+
+    // timestamp of the first event to decode
+    timestamp_t _beginTs;
+
+    // stream file path
+    boost::filesystem::path _path;
+
+    // mapped stream file
+    int _fd;
+    const std::uint8_t* _data;
+    std::size_t _size;
+
+    // offset of the current packet within the file (bytes)
+    std::size_t _packetOffset;
+
+    // size of the current packet (bits)
+    std::uint64_t _packetSize;
+
+    // true if a packet is opened
+    bool _inPacket;
+
+    // stream class of the current packet
+    const NativeCtfTrace::StreamClass* _streamClass;
+
+    // decoding position within the current packet
+    NativeCtfLayout::Cursor _cursor;
+
+    // special values of the current packet or event
+    NativeCtfLayout::Specials _specials;
+
+    // current clock value
+    trace_cycles_t _cycles;
+
+    // packet context values (live as long as the current packet)
+    EventValueFactory _packetValueFactory;
+    const AbstractEventValue* _packetContext;
+
+    // our only Event object, and its values
+    EventValueFactory _valueFactory;
+    std::unique_ptr<Event> _event;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_NATIVECTFSTREAM_HPP
@@ -0,0 +1,227 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <glib.h>
+#include <babeltrace/ctf/events.h>
+
+#include <common/trace/NativeCtfTrace.hpp>
+#include <common/trace/TraceUtils.hpp>
+#include <common/trace/babeltrace-internals.h>
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+/* Compiles an optional scope: returns false only if the scope exists
+ * and is not supported.
+ */
+bool compileScope(const ::tibee_declaration_struct* decl,
+                  ::bt_ctf_scope scope, NativeCtfLayout::UP& layout)
+{
+    if (!decl) {
+        return true;
+    }
+
+    layout = NativeCtfLayout::compile(reinterpret_cast<const ::tibee_bt_declaration*>(decl),
+                                      scope);
+
+    return layout != nullptr;
+}
+
+}
+
+NativeCtfTrace::UP NativeCtfTrace::create(::bt_context* btCtx,
+                                          const TraceInfos& traceInfos)
+{
+    ::bt_ctf_event_decl* const* eventDeclList;
+    unsigned int count;
+
+    auto ret = ::bt_ctf_get_event_decl_list(traceInfos.getId(), btCtx,
+                                            &eventDeclList, &count);
+
+    if (ret < 0 || count == 0) {
+        return nullptr;
+    }
+
+    // use first event declaration to retrieve the CTF trace
+    auto tibeeEventDecl = reinterpret_cast<const ::tibee_bt_ctf_event_decl*>(eventDeclList[0]);
+    auto ctfTrace = tibeeEventDecl->parent.stream->trace;
+
+    NativeCtfTrace::UP trace {new NativeCtfTrace {ctfTrace, traceInfos}};
+
+    if (!trace->isSupported()) {
+        return nullptr;
+    }
+
+    return trace;
+}
+
+NativeCtfTrace::NativeCtfTrace(const ::tibee_ctf_trace* ctfTrace,
+                               const TraceInfos& traceInfos) :
+    _id {traceInfos.getId()},
+    _path {traceInfos.getPath()},
+    _hasClock {false},
+    _clockFreq {1000000000ULL},
+    _offsetNs {0}
+{
+    _supported = this->compile(ctfTrace);
+
+    auto clock = ctfTrace->parent.single_clock;
+
+    if (clock && clock->freq != 0) {
+        _hasClock = true;
+        _clockFreq = clock->freq;
+
+        // same as Babeltrace's ctf_get_real_timestamp()
+        auto collection = ctfTrace->parent.collection;
+
+        if (collection && collection->clock_use_offset_avg) {
+            _offsetNs = collection->single_clock_offset_avg;
+        } else {
+            _offsetNs = clock->offset_s * 1000000000ULL +
+                        this->cyclesToNs(clock->offset);
+        }
+    }
+}
+
+bool NativeCtfTrace::compile(const ::tibee_ctf_trace* ctfTrace)
+{
+    if (!compileScope(ctfTrace->packet_header_decl, ::BT_TRACE_PACKET_HEADER,
+                      _packetHeader)) {
+        return false;
+    }
+
+    if (!ctfTrace->streams) {
+        return false;
+    }
+
+    for (std::size_t s = 0; s < ctfTrace->streams->len; ++s) {
+        auto ctfStream = static_cast<const ::tibee_ctf_stream_declaration*>(g_ptr_array_index(ctfTrace->streams, s));
+
+        if (!ctfStream) {
+            _streamClasses.push_back(nullptr);
+            continue;
+        }
+
+        std::unique_ptr<StreamClass> streamClass {new StreamClass};
+
+        streamClass->id = s;
+
+        if (!compileScope(ctfStream->packet_context_decl,
+                          ::BT_STREAM_PACKET_CONTEXT,
+                          streamClass->packetContext)) {
+            return false;
+        }
+
+        if (!compileScope(ctfStream->event_header_decl,
+                          ::BT_STREAM_EVENT_HEADER,
+                          streamClass->eventHeader)) {
+            return false;
+        }
+
+        if (!compileScope(ctfStream->event_context_decl,
+                          ::BT_STREAM_EVENT_CONTEXT,
+                          streamClass->eventContext)) {
+            return false;
+        }
+
+        if (ctfStream->events_by_id) {
+            for (std::size_t e = 0; e < ctfStream->events_by_id->len; ++e) {
+                auto ctfEvent = static_cast<const ::tibee_ctf_event_declaration*>(g_ptr_array_index(ctfStream->events_by_id, e));
+
+                if (!ctfEvent) {
+                    streamClass->eventClasses.push_back(nullptr);
+                    continue;
+                }
+
+                std::unique_ptr<EventClass> eventClass {new EventClass};
+
+                eventClass->id = TraceUtils::tibeeEventIdFromCtf(s, e);
+                eventClass->name = ::g_quark_to_string(ctfEvent->name);
+
+                if (!compileScope(ctfEvent->context_decl, ::BT_EVENT_CONTEXT,
+                                  eventClass->context)) {
+                    return false;
+                }
+
+                if (!compileScope(ctfEvent->fields_decl, ::BT_EVENT_FIELDS,
+                                  eventClass->fields)) {
+                    return false;
+                }
+
+                streamClass->eventClasses.push_back(std::move(eventClass));
+            }
+        }
+
+        _streamClasses.push_back(std::move(streamClass));
+    }
+
+    return true;
+}
+
+std::vector<boost::filesystem::path> NativeCtfTrace::getStreamPaths() const
+{
+    namespace bfs = boost::filesystem;
+
+    std::vector<bfs::path> paths;
+
+    for (bfs::directory_iterator it {_path}; it != bfs::directory_iterator {}; ++it) {
+        auto name = it->path().filename().string();
+
+        if (name == "metadata" || name.at(0) == '.') {
+            continue;
+        }
+
+        if (!bfs::is_regular_file(it->path())) {
+            continue;
+        }
+
+        paths.push_back(it->path());
+    }
+
+    std::sort(paths.begin(), paths.end());
+
+    return paths;
+}
+
+std::uint64_t NativeCtfTrace::cyclesToNs(std::uint64_t cycles) const
+{
+    // same as Babeltrace's clock_cycles_to_ns()
+    if (_clockFreq == 1000000000ULL) {
+        return cycles;
+    }
+
+    return static_cast<std::uint64_t>(static_cast<double>(cycles) * 1000000000.0 /
+                                      static_cast<double>(_clockFreq));
+}
+
+timestamp_t NativeCtfTrace::cyclesToTimestamp(trace_cycles_t cycles) const
+{
+    if (!_hasClock) {
+        return cycles;
+    }
+
+    return this->cyclesToNs(cycles) + _offsetNs;
+}
+
+}
+}
@@ -0,0 +1,210 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_NATIVECTFTRACE_HPP
+#define _TIBEE_COMMON_NATIVECTFTRACE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <babeltrace/babeltrace.h>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/NativeCtfLayout.hpp>
+#include <common/trace/TraceInfos.hpp>
+
+struct tibee_ctf_trace;
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Compiled layouts of all the scopes of a CTF trace, for native
+ * decoding.
+ *
+ * The trace metadata is still parsed by Babeltrace: a native CTF trace
+ * is built out of the resulting declarations.
+ *
+ * @see NativeCtfStream
+ *
+ * @author Philippe Proulx
+ */
+class NativeCtfTrace :
+    boost::noncopyable
+{
+public:
+    /// Unique pointer to native CTF trace
+    typedef std::unique_ptr<NativeCtfTrace> UP;
+
+    /// Event class
+    struct EventClass
+    {
+        // tigerbeetle event ID
+        event_id_t id;
+
+        // event name
+        const char* name;
+
+        // event context and fields layouts (null if absent)
+        NativeCtfLayout::UP context;
+        NativeCtfLayout::UP fields;
+    };
+
+    /// Stream class
+    struct StreamClass
+    {
+        // CTF stream ID
+        std::uint64_t id;
+
+        // packet context, event header and stream event context layouts
+        // (null if absent)
+        NativeCtfLayout::UP packetContext;
+        NativeCtfLayout::UP eventHeader;
+        NativeCtfLayout::UP eventContext;
+
+        // event classes, indexed by CTF event ID (null if absent)
+        std::vector<std::unique_ptr<EventClass>> eventClasses;
+    };
+
+public:
+    /**
+     * Compiles all layouts of a trace.
+     *
+     * @param ctfTrace   Babeltrace CTF trace
+     * @param traceInfos Informations about this trace
+     */
+    NativeCtfTrace(const ::tibee_ctf_trace* ctfTrace,
+                   const TraceInfos& traceInfos);
+
+    /**
+     * Returns whether or not all the layouts of this trace are
+     * supported by the native decoder.
+     *
+     * @returns True if this trace may be decoded natively
+     */
+    bool isSupported() const
+    {
+        return _supported;
+    }
+
+    /**
+     * Returns the trace ID of this trace within its trace set.
+     *
+     * @returns Trace ID
+     */
+    trace_id_t getId() const
+    {
+        return _id;
+    }
+
+    /**
+     * Returns the path of this trace.
+     *
+     * @returns Trace path
+     */
+    const boost::filesystem::path& getPath() const
+    {
+        return _path;
+    }
+
+    /**
+     * Builds a native CTF trace out of a trace added to a Babeltrace
+     * context.
+     *
+     * @param btCtx      Babeltrace context containing the trace
+     * @param traceInfos Informations about the trace (its ID is its
+     *                   handle within \p btCtx)
+     * @returns          Native CTF trace or \a nullptr if the trace
+     *                   cannot be decoded natively
+     */
+    static UP create(::bt_context* btCtx, const TraceInfos& traceInfos);
+
+    /**
+     * Returns the paths of all the stream files of this trace, sorted
+     * by name.
+     *
+     * @returns Stream file paths
+     */
+    std::vector<boost::filesystem::path> getStreamPaths() const;
+
+    /**
+     * Returns the packet header layout.
+     *
+     * @returns Packet header layout or \a nullptr if absent
+     */
+    const NativeCtfLayout* getPacketHeader() const
+    {
+        return _packetHeader.get();
+    }
+
+    /**
+     * Returns a stream class.
+     *
+     * @param id CTF stream ID
+     * @returns  Stream class or \a nullptr if not found
+     */
+    const StreamClass* getStreamClass(std::uint64_t id) const
+    {
+        if (id >= _streamClasses.size()) {
+            return nullptr;
+        }
+
+        return _streamClasses[id].get();
+    }
+
+    /**
+     * Converts a clock value to a timestamp, the same way Babeltrace
+     * does: the clock offset is the one of the trace's clock, or the
+     * average offset of all the traces of the Babeltrace context when
+     * their clocks are not absolute.
+     *
+     * @param cycles Clock value (cycles)
+     * @returns      Timestamp (ns)
+     */
+    timestamp_t cyclesToTimestamp(trace_cycles_t cycles) const;
+
+private:
+    bool compile(const ::tibee_ctf_trace* ctfTrace);
+    std::uint64_t cyclesToNs(std::uint64_t cycles) const;
+
+private:
+    trace_id_t _id;
+    boost::filesystem::path _path;
+    bool _supported;
+
+    // packet header layout
+    NativeCtfLayout::UP _packetHeader;
+
+    // stream classes, indexed by CTF stream ID (null if absent)
+    std::vector<std::unique_ptr<StreamClass>> _streamClasses;
+
+    // clock
+    bool _hasClock;
+    std::uint64_t _clockFreq;
+
+    // offset added to all timestamps (ns)
+    std::uint64_t _offsetNs;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_NATIVECTFTRACE_HPP
@@ -0,0 +1,329 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <boost/filesystem.hpp>
+
+#include <common/trace/PacketIndex.hpp>
+#include <common/trace/NativeCtfStream.hpp>
+#include <common/trace/NativeCtfTrace.hpp>
+#include <common/utils/MappedFile.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+const char MAGIC[] = {'T', 'B', 'P', 'I'};
+const std::uint32_t VERSION = 2;
+
+template<typename T>
+void write(std::ostream& os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+template<typename T>
+bool read(std::istream& is, T& value)
+{
+    is.read(reinterpret_cast<char*>(&value), sizeof(value));
+
+    return is.good();
+}
+
+}
+
+const std::uint64_t PacketIndex::NO_CPU;
+
+std::size_t PacketIndex::Stream::findPacket(timestamp_t ts) const
+{
+    // end timestamps never decrease within a stream
+    auto it = std::lower_bound(packets.begin(), packets.end(), ts,
+                               [] (const Packet& packet, timestamp_t ts) {
+        return packet.endTs < ts;
+    });
+
+    return static_cast<std::size_t>(it - packets.begin());
+}
+
+PacketIndex::PacketIndex() :
+    _metadataHash {0},
+    _metadataSize {0}
+{
+}
+
+bool PacketIndex::getTraceKey(const NativeCtfTrace& trace, std::string& path,
+                              std::uint64_t& metadataHash,
+                              std::uint64_t& metadataSize)
+{
+    MappedFile metadata {trace.getPath() / "metadata"};
+
+    if (!metadata.getData()) {
+        return false;
+    }
+
+    path = bfs::absolute(trace.getPath()).string();
+    metadataHash = metadata.getHash();
+    metadataSize = metadata.getSize();
+
+    return true;
+}
+
+PacketIndex::UP PacketIndex::build(const NativeCtfTrace& trace)
+{
+    PacketIndex::UP packetIndex {new PacketIndex};
+
+    PacketIndex::getTraceKey(trace, packetIndex->_tracePath,
+                             packetIndex->_metadataHash,
+                             packetIndex->_metadataSize);
+
+    for (const auto& path : trace.getStreamPaths()) {
+        Stream stream;
+
+        stream.name = path.filename().string();
+        stream.fileSize = bfs::file_size(path);
+        stream.mtime = static_cast<std::int64_t>(bfs::last_write_time(path));
+
+        NativeCtfStream nativeStream {path, trace, nullptr, 0, nullptr};
+
+        nativeStream.index(stream.packets);
+        packetIndex->_streams.push_back(std::move(stream));
+    }
+
+    return packetIndex;
+}
+
+PacketIndex::UP PacketIndex::load(const bfs::path& path,
+                                  const NativeCtfTrace& trace)
+{
+    std::ifstream is {path.string(), std::ios::binary};
+
+    if (!is) {
+        return nullptr;
+    }
+
+    char magic[sizeof(MAGIC)];
+    std::uint32_t version;
+
+    is.read(magic, sizeof(magic));
+
+    if (!is.good() || std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0) {
+        return nullptr;
+    }
+
+    if (!read(is, version) || version != VERSION) {
+        return nullptr;
+    }
+
+    PacketIndex::UP packetIndex {new PacketIndex};
+    std::uint64_t pathLen;
+    std::uint64_t streamsCount;
+
+    if (!read(is, pathLen) || pathLen > 4096) {
+        return nullptr;
+    }
+
+    packetIndex->_tracePath.resize(pathLen);
+    is.read(&packetIndex->_tracePath[0], pathLen);
+
+    if (!read(is, packetIndex->_metadataHash) ||
+            !read(is, packetIndex->_metadataSize) ||
+            !read(is, streamsCount)) {
+        return nullptr;
+    }
+
+    for (std::uint64_t s = 0; s < streamsCount; ++s) {
+        Stream stream;
+        std::uint64_t nameLen;
+        std::uint64_t packetsCount;
+
+        if (!read(is, nameLen) || nameLen > 4096) {
+            return nullptr;
+        }
+
+        stream.name.resize(nameLen);
+        is.read(&stream.name[0], nameLen);
+
+        if (!read(is, stream.fileSize) || !read(is, stream.mtime) ||
+                !read(is, packetsCount)) {
+            return nullptr;
+        }
+
+        for (std::uint64_t p = 0; p < packetsCount; ++p) {
+            Packet packet;
+
+            if (!read(is, packet.offset) || !read(is, packet.size) ||
+                    !read(is, packet.beginTs) || !read(is, packet.endTs) ||
+                    !read(is, packet.eventCount) || !read(is, packet.cpu)) {
+                return nullptr;
+            }
+
+            stream.packets.push_back(packet);
+        }
+
+        packetIndex->_streams.push_back(std::move(stream));
+    }
+
+    // make sure it's the index of this trace...
+    std::string tracePath;
+    std::uint64_t metadataHash;
+    std::uint64_t metadataSize;
+
+    if (!PacketIndex::getTraceKey(trace, tracePath, metadataHash, metadataSize) ||
+            tracePath != packetIndex->_tracePath ||
+            metadataHash != packetIndex->_metadataHash ||
+            metadataSize != packetIndex->_metadataSize) {
+        return nullptr;
+    }
+
+    // ...and that it still matches the stream files
+    auto paths = trace.getStreamPaths();
+
+    if (paths.size() != packetIndex->_streams.size()) {
+        return nullptr;
+    }
+
+    for (std::size_t x = 0; x < paths.size(); ++x) {
+        const auto& stream = packetIndex->_streams[x];
+        boost::system::error_code ec;
+
+        if (paths[x].filename().string() != stream.name ||
+                bfs::file_size(paths[x], ec) != stream.fileSize || ec) {
+            return nullptr;
+        }
+
+        auto mtime = bfs::last_write_time(paths[x], ec);
+
+        if (ec || static_cast<std::int64_t>(mtime) != stream.mtime) {
+            return nullptr;
+        }
+    }
+
+    return packetIndex;
+}
+
+bool PacketIndex::save(const bfs::path& path) const
+{
+    std::ofstream os {path.string(), std::ios::binary | std::ios::trunc};
+
+    if (!os) {
+        return false;
+    }
+
+    os.write(MAGIC, sizeof(MAGIC));
+    write(os, VERSION);
+    write(os, static_cast<std::uint64_t>(_tracePath.size()));
+    os.write(_tracePath.data(), _tracePath.size());
+    write(os, _metadataHash);
+    write(os, _metadataSize);
+    write(os, static_cast<std::uint64_t>(_streams.size()));
+
+    for (const auto& stream : _streams) {
+        write(os, static_cast<std::uint64_t>(stream.name.size()));
+        os.write(stream.name.data(), stream.name.size());
+        write(os, stream.fileSize);
+        write(os, stream.mtime);
+        write(os, static_cast<std::uint64_t>(stream.packets.size()));
+
+        for (const auto& packet : stream.packets) {
+            write(os, packet.offset);
+            write(os, packet.size);
+            write(os, packet.beginTs);
+            write(os, packet.endTs);
+            write(os, packet.eventCount);
+            write(os, packet.cpu);
+        }
+    }
+
+    return os.good();
+}
+
+const PacketIndex::Stream* PacketIndex::getStream(const std::string& name) const
+{
+    for (const auto& stream : _streams) {
+        if (stream.name == name) {
+            return std::addressof(stream);
+        }
+    }
+
+    return nullptr;
+}
+
+timestamp_t PacketIndex::getBegin() const
+{
+    auto begin = std::numeric_limits<timestamp_t>::max();
+    bool found = false;
+
+    for (const auto& stream : _streams) {
+        for (const auto& packet : stream.packets) {
+            if (packet.eventCount > 0) {
+                begin = std::min(begin, packet.beginTs);
+                found = true;
+                break;
+            }
+        }
+    }
+
+    return found ? begin : -1;
+}
+
+timestamp_t PacketIndex::getEnd() const
+{
+    timestamp_t end = 0;
+    bool found = false;
+
+    for (const auto& stream : _streams) {
+        for (auto it = stream.packets.rbegin(); it != stream.packets.rend(); ++it) {
+            if (it->eventCount > 0) {
+                end = std::max(end, it->endTs);
+                found = true;
+                break;
+            }
+        }
+    }
+
+    return found ? end : -1;
+}
+
+std::uint64_t PacketIndex::getEventCount(timestamp_t begin, timestamp_t end) const
+{
+    std::uint64_t count = 0;
+
+    for (const auto& stream : _streams) {
+        for (auto x = stream.findPacket(begin); x < stream.packets.size(); ++x) {
+            const auto& packet = stream.packets[x];
+
+            if (packet.eventCount > 0 && packet.beginTs > end) {
+                break;
+            }
+
+            count += packet.eventCount;
+        }
+    }
+
+    return count;
+}
+
+}
+}
@@ -0,0 +1,217 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_PACKETINDEX_HPP
+#define _TIBEE_COMMON_PACKETINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+
+#include <common/BasicTypes.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+class NativeCtfTrace;
+
+/**
+ * Packet index of all the streams of a CTF trace.
+ *
+ * For each packet of each stream file, a packet index records its
+ * offset and size within the file, the timestamps of its first and
+ * last events, its number of events and its CPU. A packet index is
+ * built once by visiting all the events of a trace without building
+ * any event value, and then saved to a file, so that later uses only
+ * need to load this file.
+ *
+ * With a packet index, the bounds and the number of events of a trace
+ * are known without decoding anything, and finding the packet
+ * containing a given timestamp within a stream is a binary search.
+ *
+ * @author Philippe Proulx
+ */
+class PacketIndex :
+    boost::noncopyable
+{
+public:
+    /// Unique pointer to packet index
+    typedef std::unique_ptr<PacketIndex> UP;
+
+    /// Packet index of each trace, by trace ID
+    typedef std::map<trace_id_t, UP> Map;
+
+    /// CPU of a packet without CPU ID
+    static const std::uint64_t NO_CPU = std::numeric_limits<std::uint64_t>::max();
+
+    /// Packet entry
+    struct Packet
+    {
+        // offset of the packet within its stream file (bytes)
+        std::uint64_t offset;
+
+        // packet size (bytes)
+        std::uint64_t size;
+
+        /* Timestamps of the first and last events of the packet (those
+         * of the previous packet if this one is empty, so that they
+         * never decrease within a stream).
+         */
+        timestamp_t beginTs;
+        timestamp_t endTs;
+
+        // number of events
+        std::uint64_t eventCount;
+
+        // CPU ID or PacketIndex::NO_CPU
+        std::uint64_t cpu;
+    };
+
+    /// Stream entry
+    struct Stream
+    {
+        /**
+         * Returns the index of the first packet having events at or
+         * after timestamp \p ts.
+         *
+         * @param ts Timestamp
+         * @returns  Packet index, or number of packets if there's no
+         *           such packet
+         */
+        std::size_t findPacket(timestamp_t ts) const;
+
+        // stream file name
+        std::string name;
+
+        // stream file size when indexed (bytes)
+        std::uint64_t fileSize;
+
+        // stream file modification time when indexed
+        std::int64_t mtime;
+
+        // packets, in file order
+        std::vector<Packet> packets;
+    };
+
+public:
+    /**
+     * Builds the packet index of trace \p trace by visiting all its
+     * streams.
+     *
+     * @param trace Trace to index
+     * @returns     Packet index
+     */
+    static UP build(const NativeCtfTrace& trace);
+
+    /**
+     * Loads the packet index of trace \p trace from file \p path.
+     *
+     * @param path  Packet index file path
+     * @param trace Indexed trace
+     * The packet index file records the absolute path of the trace,
+     * a hash of its metadata and the name, size and modification
+     * time of each stream file: an index of another trace, or of
+     * stream files changed since, is rejected.
+     *
+     * @returns     Packet index, or \a nullptr if the file doesn't
+     *              exist, is invalid, or doesn't match \p trace and
+     *              its current streams anymore
+     */
+    static UP load(const boost::filesystem::path& path,
+                   const NativeCtfTrace& trace);
+
+    /**
+     * Saves this packet index to file \p path.
+     *
+     * @param path Packet index file path
+     * @returns    True if the file was successfully written
+     */
+    bool save(const boost::filesystem::path& path) const;
+
+    /**
+     * Returns a stream entry.
+     *
+     * @param name Stream file name
+     * @returns    Stream entry or \a nullptr if not found
+     */
+    const Stream* getStream(const std::string& name) const;
+
+    /**
+     * Returns all stream entries.
+     *
+     * @returns Stream entries
+     */
+    const std::vector<Stream>& getStreams() const
+    {
+        return _streams;
+    }
+
+    /**
+     * Returns the timestamp of the first event of the trace.
+     *
+     * @returns Begin timestamp, or -1 if the trace has no events
+     */
+    timestamp_t getBegin() const;
+
+    /**
+     * Returns the timestamp of the last event of the trace.
+     *
+     * @returns End timestamp, or -1 if the trace has no events
+     */
+    timestamp_t getEnd() const;
+
+    /**
+     * Returns the number of events of the packets overlapping
+     * [\p begin, \p end].
+     *
+     * This is the exact number of events of the trace when the range
+     * covers the whole trace, and an upper bound otherwise.
+     *
+     * @param begin Range begin
+     * @param end   Range end
+     * @returns     Number of events
+     */
+    std::uint64_t getEventCount(timestamp_t begin, timestamp_t end) const;
+
+private:
+    PacketIndex();
+    static bool getTraceKey(const NativeCtfTrace& trace, std::string& path,
+                            std::uint64_t& metadataHash,
+                            std::uint64_t& metadataSize);
+
+private:
+    // indexed trace: absolute path, metadata hash and size
+    std::string _tracePath;
+    std::uint64_t _metadataHash;
+    std::uint64_t _metadataSize;
+
+    // stream entries, sorted by name
+    std::vector<Stream> _streams;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_PACKETINDEX_HPP
@@ -19,6 +19,7 @@
 #include <babeltrace/ctf/events.h>
 
 #include <common/trace/SintEventValue.hpp>
+#include <common/trace/EventValueFactory.hpp>
 
 namespace tibee
 {
@@ -31,6 +32,19 @@ SintEventValue::SintEventValue(const ::bt_definition* def,
         def,
         valueFactory
     }
+{
+    if (valueFactory->isDetached()) {
+        this->detach();
+    }
+}
+
+SintEventValue::SintEventValue(std::int64_t value, int base,
+                               const EventValueFactory* valueFactory) :
+    AbstractIntegerEventValue<std::int64_t, EventValueType::SINT> {
+        value,
+        base,
+        valueFactory
+    }
 {
 }
 
@@ -48,6 +48,16 @@ public:
     SintEventValue(const ::bt_definition* def,
                    const EventValueFactory* valueFactory);
 
+    /**
+     * Builds a signed integer value out of an already decoded integer.
+     *
+     * @param value        Integer value
+     * @param base         Expected display base or -1
+     * @param valueFactory Value factory used to create other event values
+     */
+    SintEventValue(std::int64_t value, int base,
+                   const EventValueFactory* valueFactory);
+
 private:
     std::int64_t getValueImpl() const;
     std::string toStringImpl() const;
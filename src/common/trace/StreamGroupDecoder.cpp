@@ -0,0 +1,300 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <babeltrace/ctf/iterator.h>
+#include <babeltrace/ctf/events.h>
+
+#include <common/trace/StreamGroupDecoder.hpp>
+#include <common/trace/Event.hpp>
+#include <common/ex/TraceSet.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+std::mutex StreamGroupDecoder::_btSetupMutex;
+
+StreamGroupDecoder::StreamGroupDecoder(const Traces& traces,
+                                       const EventFilter* filter,
+                                       timestamp_t beginTs,
+                                       timestamp_t endTs) :
+    _btCtx {nullptr},
+    _btCtfIter {nullptr},
+    _btIter {nullptr},
+    _filter {filter},
+    _endTs {endTs},
+    _head {0},
+    _cur {0},
+    _tail {0},
+    _done {false},
+    _stopping {false},
+    _waiters {0}
+{
+    try {
+        this->setup(traces, beginTs);
+
+        // create slots (detached value factories)
+        _slots.resize(StreamGroupDecoder::SLOTS_COUNT);
+
+        for (auto& slot : _slots) {
+            slot.valueFactory = std::unique_ptr<EventValueFactory> {
+                new EventValueFactory {true}
+            };
+            slot.event = std::unique_ptr<Event> {
+                new Event {slot.valueFactory.get()}
+            };
+        }
+
+        // go!
+        _thread = std::thread {&StreamGroupDecoder::decode, this};
+    } catch (...) {
+        // the destructor won't be called
+        this->destroyBt();
+
+        throw;
+    }
+}
+
+void StreamGroupDecoder::setup(const Traces& traces, timestamp_t beginTs)
+{
+    /* Metadata parsing and iterator creation are not known to be
+     * thread-safe in libbabeltrace: only do one at a time.
+     */
+    std::lock_guard<std::mutex> lock {_btSetupMutex};
+
+    _btCtx = ::bt_context_create();
+
+    if (!_btCtx) {
+        throw ex::TraceSet {"cannot create Babeltrace context"};
+    }
+
+    // add all traces, remembering their trace set ID
+    for (const auto& trace : traces) {
+        auto handle = ::bt_context_add_trace(_btCtx,
+                                             trace.first.string().c_str(),
+                                             "ctf", nullptr, nullptr,
+                                             nullptr);
+
+        if (handle < 0) {
+            throw ex::TraceSet {
+                "cannot add stream group trace \"" + trace.first.string() + "\""
+            };
+        }
+
+        if (static_cast<std::size_t>(handle) >= _traceIds.size()) {
+            _traceIds.resize(handle + 1, -1);
+        }
+
+        _traceIds[handle] = trace.second;
+    }
+
+    ::bt_iter_pos beginPos;
+
+    if (beginTs > 0) {
+        beginPos.type = ::BT_SEEK_TIME;
+        beginPos.u.seek_time = beginTs;
+    } else {
+        beginPos.type = ::BT_SEEK_BEGIN;
+        beginPos.u.seek_time = 0;
+    }
+
+    _btCtfIter = ::bt_ctf_iter_create(_btCtx, &beginPos, nullptr);
+
+    if (!_btCtfIter) {
+        throw ex::TraceSet {"cannot create Babeltrace iterator"};
+    }
+
+    _btIter = ::bt_ctf_get_iter(_btCtfIter);
+}
+
+void StreamGroupDecoder::destroyBt()
+{
+    std::lock_guard<std::mutex> lock {_btSetupMutex};
+
+    if (_btCtfIter) {
+        ::bt_ctf_iter_destroy(_btCtfIter);
+        _btCtfIter = nullptr;
+    }
+
+    if (_btCtx) {
+        ::bt_context_put(_btCtx);
+        _btCtx = nullptr;
+    }
+}
+
+StreamGroupDecoder::~StreamGroupDecoder()
+{
+    // stop worker thread
+    _stopping = true;
+
+    {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        _cond.notify_all();
+    }
+
+    if (_thread.joinable()) {
+        _thread.join();
+    }
+
+    this->destroyBt();
+}
+
+template<typename Predicate>
+void StreamGroupDecoder::wait(Predicate predicate)
+{
+    /* The other side is usually not far behind, so spin a little
+     * before going to sleep.
+     */
+    for (unsigned int x = 0; x < 64; ++x) {
+        if (predicate()) {
+            return;
+        }
+
+        std::this_thread::yield();
+    }
+
+    std::unique_lock<std::mutex> lock {_mutex};
+
+    _waiters++;
+    _cond.wait(lock, predicate);
+    _waiters--;
+}
+
+void StreamGroupDecoder::notify()
+{
+    /* _waiters is incremented before the waiting side checks its
+     * predicate for the last time, so if it's 0 here, the waiting side
+     * will see our update without being notified.
+     */
+    if (_waiters > 0) {
+        std::lock_guard<std::mutex> lock {_mutex};
+
+        _cond.notify_all();
+    }
+}
+
+void StreamGroupDecoder::decode()
+{
+    const auto slotsCount = _slots.size();
+
+    while (true) {
+        // wait for a free slot
+        this->wait([this, slotsCount] () {
+            return _stopping || _tail - _head < slotsCount;
+        });
+
+        if (_stopping) {
+            break;
+        }
+
+        // read current event
+        auto btEvent = ::bt_ctf_iter_read_event(_btCtfIter);
+
+        if (!btEvent) {
+            break;
+        }
+
+        // past the range?
+        if (static_cast<timestamp_t>(::bt_ctf_get_timestamp(btEvent)) > _endTs) {
+            break;
+        }
+
+        // filtered out: don't even detach it
+        if (_filter) {
+            event_id_t id;
+            trace_id_t traceId;
+
+            Event::getBtEventIds(btEvent, id, traceId);
+
+            if (!_filter->accepts(_traceIds[traceId], id)) {
+                if (::bt_iter_next(_btIter) < 0) {
+                    break;
+                }
+
+                continue;
+            }
+        }
+
+        // detach event into the next free slot
+        auto& slot = _slots[_tail % slotsCount];
+
+        slot.valueFactory->resetPools();
+        slot.event->setPrivateEvent(btEvent);
+        slot.event->detach(_traceIds[slot.event->getTraceId()]);
+
+        // publish it
+        _tail++;
+        this->notify();
+
+        if (::bt_iter_next(_btIter) < 0) {
+            break;
+        }
+    }
+
+    _done = true;
+    this->notify();
+}
+
+const Event* StreamGroupDecoder::getCurrentEvent()
+{
+    this->wait([this] () {
+        return _cur != _tail || _done;
+    });
+
+    // _done is set after the last slot is published
+    if (_cur == _tail) {
+        return nullptr;
+    }
+
+    return _slots[_cur % _slots.size()].event.get();
+}
+
+void StreamGroupDecoder::release()
+{
+    // slots are given back in order: not before the kept ones
+    if (_head == _cur) {
+        _head++;
+        this->notify();
+    }
+
+    _cur++;
+}
+
+bool StreamGroupDecoder::keep()
+{
+    // the worker thread needs a free slot to decode our next event
+    if (_cur + 1 - _head >= _slots.size()) {
+        return false;
+    }
+
+    _cur++;
+
+    return true;
+}
+
+void StreamGroupDecoder::releaseKept()
+{
+    if (_head != _cur) {
+        _head = _cur;
+        this->notify();
+    }
+}
+
+}
+}
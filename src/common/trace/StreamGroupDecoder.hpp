@@ -0,0 +1,204 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STREAMGROUPDECODER_HPP
+#define _TIBEE_COMMON_STREAMGROUPDECODER_HPP
+
+#include <memory>
+#include <vector>
+#include <utility>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+#include <babeltrace/babeltrace.h>
+#include <babeltrace/ctf/iterator.h>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/EventValueFactory.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Stream group decoder.
+ *
+ * A stream group decoder owns a private Babeltrace context containing
+ * a subset of the streams of one or more traces, and decodes its
+ * events on a dedicated worker thread, ahead of their consumption.
+ *
+ * Decoded events are detached (they don't refer to Babeltrace data
+ * anymore) and kept in a fixed-size ring of slots, so that the worker
+ * thread may continue decoding while the consumer still uses previous
+ * events. There must be a single consumer.
+ *
+ * libbabeltrace makes no thread-safety promise. This class relies on
+ * the fact that a Babeltrace context, its traces and its iterator
+ * don't share any mutable state with other contexts once created:
+ * each decoder's context is only read by its own worker thread
+ * (after construction, and until the thread is joined), while the
+ * creation and destruction of contexts, which parse metadata and
+ * touch libbabeltrace's global format registry, are serialized
+ * among all decoders.
+ *
+ * @see StreamGroupMerger
+ *
+ * @author Philippe Proulx
+ */
+class StreamGroupDecoder :
+    boost::noncopyable
+{
+public:
+    /// Unique pointer to stream group decoder
+    typedef std::unique_ptr<StreamGroupDecoder> UP;
+
+    /// (trace path, trace set trace ID) pairs
+    typedef std::vector<std::pair<boost::filesystem::path, trace_id_t>> Traces;
+
+public:
+    /**
+     * Builds a stream group decoder and starts its worker thread.
+     *
+     * Each path of \p traces is a CTF trace directory containing a
+     * subset of the streams of the original trace identified by its
+     * associated trace ID within the trace set.
+     *
+     * Events not accepted by \p filter are skipped by the worker
+     * thread without being detached. Decoding starts at the first
+     * event at or after \p beginTs, and stops after the last event at
+     * or before \p endTs.
+     *
+     * @param traces  Traces to decode
+     * @param filter  Event filter (must outlive this decoder) or
+     *                \a nullptr to decode all events
+     * @param beginTs Timestamp of the first event to decode
+     * @param endTs   Timestamp of the last event to decode
+     */
+    StreamGroupDecoder(const Traces& traces, const EventFilter* filter,
+                       timestamp_t beginTs, timestamp_t endTs);
+
+    /**
+     * Stops the worker thread and destroys this decoder.
+     */
+    ~StreamGroupDecoder();
+
+    /**
+     * Returns the oldest event which was not released or kept yet,
+     * waiting for the worker thread to decode it if needed.
+     *
+     * @returns Current event or \a nullptr if there's no more events
+     */
+    const Event* getCurrentEvent();
+
+    /**
+     * Releases the current event, giving its slot back to the
+     * worker thread (once all the kept events before it are released
+     * too). The current event must not be used afterwards.
+     */
+    void release();
+
+    /**
+     * Moves to the next event, but keeps the current one valid until
+     * releaseKept() is called.
+     *
+     * Fails when keeping the current event would leave the worker
+     * thread without any free slot to decode the next one.
+     *
+     * @returns True if the current event is kept
+     */
+    bool keep();
+
+    /**
+     * Releases all kept events.
+     */
+    void releaseKept();
+
+private:
+    struct Slot
+    {
+        std::unique_ptr<EventValueFactory> valueFactory;
+        std::unique_ptr<Event> event;
+    };
+
+private:
+    void setup(const Traces& traces, timestamp_t beginTs);
+    void destroyBt();
+    void decode();
+    template<typename Predicate>
+    void wait(Predicate predicate);
+    void notify();
+
+private:
+    /* Ring of decoded events (power of two): large enough for all the
+     * events of a batch (TraceDeck) to be kept in place.
+     */
+    static const std::size_t SLOTS_COUNT = 512;
+
+    // serializes Babeltrace context creation/destruction
+    static std::mutex _btSetupMutex;
+
+private:
+    // our own libbabeltrace context and iterators
+    ::bt_context* _btCtx;
+    ::bt_ctf_iter* _btCtfIter;
+    ::bt_iter* _btIter;
+
+    // event filter or null
+    const EventFilter* _filter;
+
+    // timestamp of the last event to decode
+    timestamp_t _endTs;
+
+    // trace set trace IDs, indexed by trace handle within our context
+    std::vector<trace_id_t> _traceIds;
+
+    // ring slots
+    std::vector<Slot> _slots;
+
+    // index of the first slot not given back to the worker thread
+    std::atomic<std::size_t> _head;
+
+    // index of the current slot (only used by the consumer)
+    std::size_t _cur;
+
+    // index of the next slot to fill
+    std::atomic<std::size_t> _tail;
+
+    // true when the worker thread has no more events to decode
+    std::atomic<bool> _done;
+
+    // true when the worker thread must stop as soon as possible
+    std::atomic<bool> _stopping;
+
+    // number of threads waiting on _cond
+    std::atomic<unsigned int> _waiters;
+
+    std::mutex _mutex;
+    std::condition_variable _cond;
+    std::thread _thread;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STREAMGROUPDECODER_HPP
@@ -0,0 +1,297 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include <common/trace/StreamGroupMerger.hpp>
+#include <common/ex/TraceSet.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+struct StreamFile
+{
+    trace_id_t traceId;
+    bfs::path tracePath;
+    bfs::path name;
+    std::uintmax_t size;
+};
+
+}
+
+StreamGroupMerger::StreamGroupMerger(const std::set<std::unique_ptr<TraceInfos>>& tracesInfos,
+                                     std::size_t groupsCount,
+                                     const EventFilter* filter,
+                                     timestamp_t beginTs,
+                                     timestamp_t endTs) :
+    _curDecoder {nullptr},
+    _curDecoderIndex {0},
+    _curEventKept {false},
+    _curEvent {nullptr}
+{
+    try {
+        this->buildDecoders(tracesInfos, groupsCount, filter, beginTs, endTs);
+    } catch (...) {
+        boost::system::error_code ec;
+
+        _decoders.clear();
+        bfs::remove_all(_groupsDir, ec);
+
+        try {
+            throw;
+        } catch (const bfs::filesystem_error& fsEx) {
+            throw ex::TraceSet {
+                std::string {"cannot create stream groups: "} + fsEx.what()
+            };
+        }
+    }
+
+    // fill the heap with the first event of each decoder
+    for (std::size_t x = 0; x < _decoders.size(); ++x) {
+        this->pushDecoder(x);
+    }
+}
+
+StreamGroupMerger::~StreamGroupMerger()
+{
+    // stop all worker threads before removing their traces
+    _decoders.clear();
+
+    boost::system::error_code ec;
+
+    bfs::remove_all(_groupsDir, ec);
+}
+
+void StreamGroupMerger::buildDecoders(const std::set<std::unique_ptr<TraceInfos>>& tracesInfos,
+                                      std::size_t groupsCount,
+                                      const EventFilter* filter,
+                                      timestamp_t beginTs,
+                                      timestamp_t endTs)
+{
+    // sort traces by ID to keep groups deterministic
+    std::vector<const TraceInfos*> sortedTracesInfos;
+
+    for (const auto& traceInfos : tracesInfos) {
+        sortedTracesInfos.push_back(traceInfos.get());
+    }
+
+    std::sort(sortedTracesInfos.begin(), sortedTracesInfos.end(),
+              [] (const TraceInfos* a, const TraceInfos* b) {
+        return a->getId() < b->getId();
+    });
+
+    // list all stream files, trace by trace
+    std::vector<StreamFile> streamFiles;
+    std::uintmax_t totalSize = 0;
+
+    for (auto traceInfos : sortedTracesInfos) {
+        const auto& tracePath = traceInfos->getPath();
+        std::vector<bfs::path> names;
+
+        for (bfs::directory_iterator it {tracePath}; it != bfs::directory_iterator {}; ++it) {
+            auto name = it->path().filename();
+            auto nameStr = name.string();
+
+            if (nameStr == "metadata" || nameStr.at(0) == '.') {
+                continue;
+            }
+
+            if (!bfs::is_regular_file(it->path())) {
+                continue;
+            }
+
+            names.push_back(name);
+        }
+
+        std::sort(names.begin(), names.end());
+
+        for (const auto& name : names) {
+            auto size = bfs::file_size(tracePath / name);
+
+            streamFiles.push_back({
+                traceInfos->getId(),
+                tracePath,
+                name,
+                size
+            });
+            totalSize += size;
+        }
+    }
+
+    if (streamFiles.empty()) {
+        return;
+    }
+
+    if (groupsCount == 0) {
+        groupsCount = 1;
+    }
+
+    groupsCount = std::min(groupsCount, streamFiles.size());
+
+    /* Assign contiguous runs of streams to each group so that groups
+     * have about the same number of bytes to decode, while keeping the
+     * streams of a given trace together (each trace a group touches
+     * means one more metadata to parse).
+     */
+    std::vector<std::map<trace_id_t, std::vector<const StreamFile*>>> groups;
+    std::uintmax_t sizeBefore = 0;
+
+    groups.resize(groupsCount);
+
+    for (std::size_t x = 0; x < streamFiles.size(); ++x) {
+        const auto& streamFile = streamFiles[x];
+        std::size_t group;
+
+        if (totalSize == 0) {
+            group = x * groupsCount / streamFiles.size();
+        } else {
+            group = static_cast<std::size_t>(sizeBefore * groupsCount / totalSize);
+        }
+
+        group = std::min(group, groupsCount - 1);
+        groups[group][streamFile.traceId].push_back(std::addressof(streamFile));
+        sizeBefore += streamFile.size;
+    }
+
+    // create group traces
+    _groupsDir = bfs::temp_directory_path() /
+                 bfs::unique_path("tibee-groups-%%%%-%%%%-%%%%-%%%%");
+
+    for (std::size_t g = 0; g < groups.size(); ++g) {
+        if (groups[g].empty()) {
+            continue;
+        }
+
+        StreamGroupDecoder::Traces traces;
+
+        for (const auto& traceStreams : groups[g]) {
+            auto traceDir = _groupsDir / ("group-" + std::to_string(g)) /
+                            ("trace-" + std::to_string(traceStreams.first));
+            const auto& tracePath = traceStreams.second.front()->tracePath;
+            auto indexPath = tracePath / "index";
+
+            bfs::create_directories(traceDir);
+            bfs::create_symlink(bfs::absolute(tracePath / "metadata"),
+                                traceDir / "metadata");
+
+            for (auto streamFile : traceStreams.second) {
+                bfs::create_symlink(bfs::absolute(tracePath / streamFile->name),
+                                    traceDir / streamFile->name);
+
+                // stream index, if any, to avoid scanning all packets
+                auto indexName = streamFile->name.string() + ".idx";
+
+                if (bfs::exists(indexPath / indexName)) {
+                    bfs::create_directories(traceDir / "index");
+                    bfs::create_symlink(bfs::absolute(indexPath / indexName),
+                                        traceDir / "index" / indexName);
+                }
+            }
+
+            traces.push_back(std::make_pair(traceDir, traceStreams.first));
+        }
+
+        _decoders.push_back(StreamGroupDecoder::UP {
+            new StreamGroupDecoder {traces, filter, beginTs, endTs}
+        });
+    }
+}
+
+void StreamGroupMerger::pushDecoder(std::size_t index)
+{
+    auto event = _decoders[index]->getCurrentEvent();
+
+    if (!event) {
+        // this group is done
+        return;
+    }
+
+    _heap.push_back(std::make_pair(event->getTimestamp(), index));
+    std::push_heap(_heap.begin(), _heap.end(), std::greater<HeapEntry> {});
+}
+
+bool StreamGroupMerger::nextImpl()
+{
+    // release the previous event and put its decoder back in the heap
+    if (_curDecoder) {
+        if (!_curEventKept) {
+            _curDecoder->release();
+        }
+
+        _curEventKept = false;
+        _curDecoder = nullptr;
+        this->pushDecoder(_curDecoderIndex);
+    }
+
+    if (_heap.empty()) {
+        _curEvent = nullptr;
+
+        return false;
+    }
+
+    // pick the decoder with the oldest current event
+    std::pop_heap(_heap.begin(), _heap.end(), std::greater<HeapEntry> {});
+    _curDecoderIndex = _heap.back().second;
+    _heap.pop_back();
+
+    _curDecoder = _decoders[_curDecoderIndex].get();
+    _curEvent = _curDecoder->getCurrentEvent();
+
+    return true;
+}
+
+const Event& StreamGroupMerger::getCurrentEventImpl() const
+{
+    return *_curEvent;
+}
+
+bool StreamGroupMerger::canKeepEventsImpl() const
+{
+    // events are already detached in the slots of the decoders
+    return true;
+}
+
+bool StreamGroupMerger::keepCurrentEventImpl()
+{
+    if (!_curEventKept) {
+        _curEventKept = _curDecoder->keep();
+    }
+
+    return _curEventKept;
+}
+
+void StreamGroupMerger::releaseKeptEventsImpl()
+{
+    for (auto& decoder : _decoders) {
+        decoder->releaseKept();
+    }
+}
+
+}
+}
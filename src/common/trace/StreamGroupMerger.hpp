@@ -0,0 +1,117 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_STREAMGROUPMERGER_HPP
+#define _TIBEE_COMMON_STREAMGROUPMERGER_HPP
+
+#include <memory>
+#include <set>
+#include <vector>
+#include <utility>
+#include <boost/filesystem.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/AbstractEventSource.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/StreamGroupDecoder.hpp>
+#include <common/trace/TraceInfos.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Stream group merger.
+ *
+ * Splits the streams of a set of traces into groups of similar sizes,
+ * decodes each group on its own thread (see StreamGroupDecoder), and
+ * merges the decoded events by timestamp using a heap, so that the
+ * resulting sequence of events is globally ordered.
+ *
+ * Babeltrace can only open whole trace directories, so each group
+ * gets, for each trace it touches, a temporary directory made of
+ * symbolic links to the original trace metadata, the streams of the
+ * group and their index files.
+ *
+ * @author Philippe Proulx
+ */
+class StreamGroupMerger :
+    public AbstractEventSource
+{
+public:
+    /**
+     * Builds a stream group merger and starts decoding.
+     *
+     * @param tracesInfos Informations about the traces to decode
+     * @param groupsCount Maximum number of stream groups (threads)
+     * @param filter      Event filter (must outlive this merger) or
+     *                    \a nullptr to decode all events
+     * @param beginTs     Timestamp of the first event to decode
+     * @param endTs       Timestamp of the last event to decode
+     */
+    StreamGroupMerger(const std::set<std::unique_ptr<TraceInfos>>& tracesInfos,
+                      std::size_t groupsCount, const EventFilter* filter,
+                      timestamp_t beginTs, timestamp_t endTs);
+
+    /**
+     * Stops decoding and removes temporary directories.
+     */
+    ~StreamGroupMerger();
+
+private:
+    typedef std::pair<timestamp_t, std::size_t> HeapEntry;
+
+private:
+    bool nextImpl();
+    const Event& getCurrentEventImpl() const;
+    bool canKeepEventsImpl() const;
+    bool keepCurrentEventImpl();
+    void releaseKeptEventsImpl();
+    void buildDecoders(const std::set<std::unique_ptr<TraceInfos>>& tracesInfos,
+                       std::size_t groupsCount, const EventFilter* filter,
+                       timestamp_t beginTs, timestamp_t endTs);
+    void pushDecoder(std::size_t index);
+
+private:
+    // temporary directory containing all stream group traces
+    boost::filesystem::path _groupsDir;
+
+    // our stream group decoders
+    std::vector<StreamGroupDecoder::UP> _decoders;
+
+    // (timestamp of current event, decoder index) min-heap
+    std::vector<HeapEntry> _heap;
+
+    // decoder of current event
+    StreamGroupDecoder* _curDecoder;
+
+    // index of current decoder
+    std::size_t _curDecoderIndex;
+
+    // true if the current event is kept by its decoder
+    bool _curEventKept;
+
+    // current event
+    const Event* _curEvent;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_STREAMGROUPMERGER_HPP
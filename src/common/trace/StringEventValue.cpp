@@ -22,6 +22,7 @@
 #include <common/trace/EventValueType.hpp>
 #include <common/trace/AbstractEventValue.hpp>
 #include <common/trace/StringEventValue.hpp>
+#include <common/trace/EventValueFactory.hpp>
 
 namespace tibee
 {
@@ -31,12 +32,46 @@ namespace common
 StringEventValue::StringEventValue(const ::bt_definition* def,
                                    const EventValueFactory* valueFactory) :
     AbstractEventValue {EventValueType::STRING, valueFactory},
-    _btDef {def}
+    _btDef {def},
+    _detached {false},
+    _inPlaceValue {nullptr}
+{
+    if (valueFactory->isDetached()) {
+        // the BT string buffer is reused for the next event: copy it
+        _detachedOffset = valueFactory->copyDetachedString(this->getValue());
+        _detached = true;
+    }
+}
+
+StringEventValue::StringEventValue(const char* value,
+                                   const EventValueFactory* valueFactory) :
+    AbstractEventValue {EventValueType::STRING, valueFactory},
+    _btDef {nullptr},
+    _detached {false},
+    _inPlaceValue {value}
+{
+}
+
+StringEventValue::StringEventValue(std::size_t detachedOffset,
+                                   const EventValueFactory* valueFactory) :
+    AbstractEventValue {EventValueType::STRING, valueFactory},
+    _btDef {nullptr},
+    _detached {true},
+    _detachedOffset {detachedOffset},
+    _inPlaceValue {nullptr}
 {
 }
 
 const char* StringEventValue::getValue() const
 {
+    if (_inPlaceValue) {
+        return _inPlaceValue;
+    }
+
+    if (_detached) {
+        return this->getValueFactory()->getDetachedString(_detachedOffset);
+    }
+
     return ::bt_ctf_get_string(_btDef);
 }
 
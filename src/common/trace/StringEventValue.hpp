@@ -19,6 +19,7 @@
 #define _TIBEE_COMMON_STRINGEVENTVALUE_HPP
 
 #include <string>
+#include <cstddef>
 #include <babeltrace/ctf/events.h>
 
 #include <common/trace/AbstractEventValue.hpp>
@@ -47,6 +48,25 @@ public:
     StringEventValue(const ::bt_definition* def,
                      const EventValueFactory* valueFactory);
 
+    /**
+     * Builds a string value out of an existing null-terminated string,
+     * without copying it.
+     *
+     * @param value        String (must outlive this value)
+     * @param valueFactory Value factory used to create other event values
+     */
+    StringEventValue(const char* value, const EventValueFactory* valueFactory);
+
+    /**
+     * Builds a string value out of a string previously copied with
+     * EventValueFactory::copyDetachedString().
+     *
+     * @param detachedOffset Offset of the copied string
+     * @param valueFactory   Value factory used to create other event values
+     */
+    StringEventValue(std::size_t detachedOffset,
+                     const EventValueFactory* valueFactory);
+
     /**
      * Returns the in-place string value (must be copied by user).
      *
@@ -66,6 +86,9 @@ private:
 
 private:
     const ::bt_definition* _btDef;
+    bool _detached;
+    std::size_t _detachedOffset;
+    const char* _inPlaceValue;
 };
 
 }
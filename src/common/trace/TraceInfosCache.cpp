@@ -0,0 +1,381 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <common/trace/TraceInfosCache.hpp>
+#include <common/utils/MappedFile.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace common
+{
+
+namespace
+{
+
+const char MAGIC[] = {'T', 'B', 'T', 'I'};
+const std::uint32_t VERSION = 1;
+
+// bounds-checked reader of a cache entry
+class Reader
+{
+public:
+    Reader(const char* data, std::size_t size) :
+        _at {data},
+        _end {data + size}
+    {
+    }
+
+    template<typename T>
+    bool read(T& value)
+    {
+        if (static_cast<std::size_t>(_end - _at) < sizeof(value)) {
+            return false;
+        }
+
+        std::memcpy(&value, _at, sizeof(value));
+        _at += sizeof(value);
+
+        return true;
+    }
+
+    bool read(std::string& str)
+    {
+        std::uint32_t len;
+
+        if (!this->read(len) || static_cast<std::size_t>(_end - _at) < len) {
+            return false;
+        }
+
+        str.assign(_at, len);
+        _at += len;
+
+        return true;
+    }
+
+    bool isDone() const
+    {
+        return _at == _end;
+    }
+
+private:
+    const char* _at;
+    const char* _end;
+};
+
+template<typename T>
+void write(std::ostream& os, T value)
+{
+    os.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+void write(std::ostream& os, const std::string& str)
+{
+    write(os, static_cast<std::uint32_t>(str.size()));
+    os.write(str.data(), str.size());
+}
+
+void writeFieldMap(std::ostream& os, const FieldInfos::FieldMap& fieldMap);
+
+// null field infos are written as a single false byte
+void writeFieldInfos(std::ostream& os, const FieldInfos* fieldInfos)
+{
+    write(os, static_cast<std::uint8_t>(fieldInfos != nullptr));
+
+    if (!fieldInfos) {
+        return;
+    }
+
+    write(os, static_cast<std::uint64_t>(fieldInfos->getIndex()));
+    write(os, fieldInfos->getName());
+    write(os, static_cast<std::uint8_t>(fieldInfos->getFieldMap() != nullptr));
+
+    if (fieldInfos->getFieldMap()) {
+        writeFieldMap(os, *fieldInfos->getFieldMap());
+    }
+}
+
+void writeFieldMap(std::ostream& os, const FieldInfos::FieldMap& fieldMap)
+{
+    write(os, static_cast<std::uint32_t>(fieldMap.size()));
+
+    for (const auto& nameInfosPair : fieldMap) {
+        write(os, nameInfosPair.first);
+        writeFieldInfos(os, nameInfosPair.second.get());
+    }
+}
+
+std::unique_ptr<FieldInfos::FieldMap> readFieldMap(Reader& reader,
+                                                   unsigned int depth);
+
+bool readFieldInfos(Reader& reader, std::unique_ptr<FieldInfos>& fieldInfos,
+                    unsigned int depth)
+{
+    std::uint8_t present;
+
+    if (!reader.read(present)) {
+        return false;
+    }
+
+    if (!present) {
+        fieldInfos = nullptr;
+
+        return true;
+    }
+
+    std::uint64_t index;
+    std::string name;
+    std::uint8_t hasFieldMap;
+
+    if (!reader.read(index) || !reader.read(name) || !reader.read(hasFieldMap)) {
+        return false;
+    }
+
+    std::unique_ptr<FieldInfos::FieldMap> fieldMap;
+
+    if (hasFieldMap) {
+        fieldMap = readFieldMap(reader, depth + 1);
+
+        if (!fieldMap) {
+            return false;
+        }
+    }
+
+    fieldInfos = std::unique_ptr<FieldInfos> {
+        new FieldInfos {
+            static_cast<field_index_t>(index), name, std::move(fieldMap)
+        }
+    };
+
+    return true;
+}
+
+std::unique_ptr<FieldInfos::FieldMap> readFieldMap(Reader& reader,
+                                                   unsigned int depth)
+{
+    // corrupted entry: don't blow the stack
+    if (depth > 64) {
+        return nullptr;
+    }
+
+    std::uint32_t count;
+
+    if (!reader.read(count)) {
+        return nullptr;
+    }
+
+    std::unique_ptr<FieldInfos::FieldMap> fieldMap {new FieldInfos::FieldMap};
+
+    for (std::uint32_t x = 0; x < count; ++x) {
+        std::string name;
+        std::unique_ptr<FieldInfos> fieldInfos;
+
+        if (!reader.read(name) || !readFieldInfos(reader, fieldInfos, depth)) {
+            return nullptr;
+        }
+
+        (*fieldMap)[name] = std::move(fieldInfos);
+    }
+
+    return fieldMap;
+}
+
+}
+
+TraceInfosCache::TraceInfosCache(const bfs::path& dir) :
+    _dir {dir}
+{
+}
+
+bfs::path TraceInfosCache::getEntryPath(const bfs::path& tracePath) const
+{
+    MappedFile metadata {tracePath / "metadata"};
+
+    if (!metadata.getData()) {
+        return bfs::path {};
+    }
+
+    // hash of the whole metadata file
+    auto hash = metadata.getHash();
+    char name[32];
+
+    std::snprintf(name, sizeof(name), "%016llx-%llu",
+                  static_cast<unsigned long long>(hash),
+                  static_cast<unsigned long long>(metadata.getSize()));
+
+    return _dir / name;
+}
+
+std::unique_ptr<TraceInfos> TraceInfosCache::load(const bfs::path& tracePath,
+                                                  trace_id_t id) const
+{
+    auto entryPath = this->getEntryPath(tracePath);
+
+    if (entryPath.empty()) {
+        return nullptr;
+    }
+
+    MappedFile entry {entryPath};
+
+    if (!entry.getData()) {
+        return nullptr;
+    }
+
+    Reader reader {entry.getData(), entry.getSize()};
+    char magic[sizeof(MAGIC)];
+    std::uint32_t version;
+
+    for (auto& c : magic) {
+        if (!reader.read(c)) {
+            return nullptr;
+        }
+    }
+
+    if (std::memcmp(magic, MAGIC, sizeof(MAGIC)) != 0 ||
+            !reader.read(version) || version != VERSION) {
+        return nullptr;
+    }
+
+    // environment
+    std::unique_ptr<TraceInfos::Environment> env {new TraceInfos::Environment};
+    std::uint32_t envCount;
+
+    if (!reader.read(envCount)) {
+        return nullptr;
+    }
+
+    for (std::uint32_t x = 0; x < envCount; ++x) {
+        std::string key;
+        std::string value;
+
+        if (!reader.read(key) || !reader.read(value)) {
+            return nullptr;
+        }
+
+        (*env)[key] = value;
+    }
+
+    // event map
+    std::unique_ptr<TraceInfos::EventMap> eventMap {new TraceInfos::EventMap};
+    std::uint32_t eventCount;
+
+    if (!reader.read(eventCount)) {
+        return nullptr;
+    }
+
+    for (std::uint32_t x = 0; x < eventCount; ++x) {
+        std::uint64_t eventId;
+        std::string name;
+
+        if (!reader.read(eventId) || !reader.read(name)) {
+            return nullptr;
+        }
+
+        auto fieldMap = readFieldMap(reader, 0);
+
+        if (!fieldMap) {
+            return nullptr;
+        }
+
+        (*eventMap)[name] = std::unique_ptr<EventInfos> {
+            new EventInfos {
+                static_cast<event_id_t>(eventId), name, std::move(fieldMap)
+            }
+        };
+    }
+
+    if (!reader.isDone()) {
+        return nullptr;
+    }
+
+    return std::unique_ptr<TraceInfos> {
+        new TraceInfos {tracePath, id, std::move(env), std::move(eventMap)}
+    };
+}
+
+bool TraceInfosCache::save(const TraceInfos& traceInfos) const
+{
+    auto entryPath = this->getEntryPath(traceInfos.getPath());
+
+    if (entryPath.empty()) {
+        return false;
+    }
+
+    boost::system::error_code ec;
+
+    bfs::create_directories(_dir, ec);
+
+    if (ec) {
+        return false;
+    }
+
+    // write a temporary file first so that readers never see half an entry
+    auto tmpPath = entryPath;
+
+    tmpPath += ".tmp";
+
+    {
+        std::ofstream os {tmpPath.string(), std::ios::binary | std::ios::trunc};
+
+        if (!os) {
+            return false;
+        }
+
+        os.write(MAGIC, sizeof(MAGIC));
+        write(os, VERSION);
+
+        // environment
+        write(os, static_cast<std::uint32_t>(traceInfos.getEnv()->size()));
+
+        for (const auto& keyValuePair : *traceInfos.getEnv()) {
+            write(os, keyValuePair.first);
+            write(os, keyValuePair.second);
+        }
+
+        // event map
+        write(os, static_cast<std::uint32_t>(traceInfos.getEventMap()->size()));
+
+        for (const auto& nameInfosPair : *traceInfos.getEventMap()) {
+            const auto& eventInfos = *nameInfosPair.second;
+
+            write(os, static_cast<std::uint64_t>(eventInfos.getId()));
+            write(os, eventInfos.getName());
+
+            if (eventInfos.getFieldMap()) {
+                writeFieldMap(os, *eventInfos.getFieldMap());
+            } else {
+                write(os, static_cast<std::uint32_t>(0));
+            }
+        }
+
+        if (!os.good()) {
+            return false;
+        }
+    }
+
+    bfs::rename(tmpPath, entryPath, ec);
+
+    return !ec;
+}
+
+}
+}
@@ -0,0 +1,90 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_TRACEINFOSCACHE_HPP
+#define _TIBEE_COMMON_TRACEINFOSCACHE_HPP
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <boost/filesystem.hpp>
+
+#include <common/BasicTypes.hpp>
+#include <common/trace/TraceInfos.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * On-disk cache of trace informations.
+ *
+ * Building a TraceInfos object means walking all the event and field
+ * declarations of a trace. A trace informations cache saves the
+ * environment and the event map of a trace in a compact binary file
+ * named after a hash of the trace's metadata file, so that traces
+ * having the same metadata (same tracer, same session) reuse the same
+ * entry, and a changed metadata file never hits a stale entry.
+ *
+ * Failing to load or save an entry is never fatal: the caller only
+ * needs to build the trace informations the usual way.
+ *
+ * @author Philippe Proulx
+ */
+class TraceInfosCache
+{
+public:
+    /**
+     * Builds a trace informations cache using directory \p dir.
+     *
+     * @param dir Cache directory (created when saving)
+     */
+    explicit TraceInfosCache(const boost::filesystem::path& dir);
+
+    /**
+     * Loads the cached trace informations of the trace located at
+     * \p tracePath.
+     *
+     * @param tracePath Trace path
+     * @param id        Trace ID to give to the trace informations
+     * @returns         Trace informations or \a nullptr if not cached
+     */
+    std::unique_ptr<TraceInfos> load(const boost::filesystem::path& tracePath,
+                                     trace_id_t id) const;
+
+    /**
+     * Saves trace informations \p traceInfos, keyed by the hash of
+     * its trace's current metadata file.
+     *
+     * @param traceInfos Trace informations to save
+     * @returns          True if saved
+     */
+    bool save(const TraceInfos& traceInfos) const;
+
+private:
+    boost::filesystem::path getEntryPath(const boost::filesystem::path& tracePath) const;
+
+private:
+    // cache directory
+    boost::filesystem::path _dir;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_TRACEINFOSCACHE_HPP
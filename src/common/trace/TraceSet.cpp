@@ -15,12 +15,16 @@
  * You should have received a copy of the GNU General Public License
  * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+#include <limits>
+#include <string>
 #include <babeltrace/ctf/iterator.h>
 
 #include <common/trace/TraceSetIterator.hpp>
 #include <common/trace/Event.hpp>
 #include <common/trace/TraceSet.hpp>
 #include <common/trace/TraceUtils.hpp>
+#include <common/trace/NativeCtfTrace.hpp>
 #include <common/trace/babeltrace-internals.h>
 #include <common/ex/TraceSet.hpp>
 
@@ -31,7 +35,11 @@ namespace tibee
 namespace common
 {
 
-TraceSet::TraceSet()
+TraceSet::TraceSet() :
+    _streamGroupsCount {0},
+    _nativeDecoding {false},
+    _rangeBegin {0},
+    _rangeEnd {std::numeric_limits<timestamp_t>::max()}
 {
     _btCtx = ::bt_context_create();
 
@@ -69,6 +77,20 @@ void TraceSet::seekBegin() const
     ::bt_iter_set_pos(_btIter, &beginPos);
 }
 
+void TraceSet::seekTime(timestamp_t ts) const
+{
+    if (ts == 0) {
+        this->seekBegin();
+        return;
+    }
+
+    ::bt_iter_pos timePos;
+    timePos.type = ::BT_SEEK_TIME;
+    timePos.u.seek_time = ts;
+
+    ::bt_iter_set_pos(_btIter, &timePos);
+}
+
 std::unique_ptr<FieldInfos> TraceSet::getFieldInfos(const ::tibee_bt_declaration* tibeeBtDecl,
                                                     std::string name,
                                                     field_index_t index)
@@ -204,6 +226,18 @@ std::unique_ptr<TraceInfos::EventMap> TraceSet::getEventMap(::bt_ctf_event_decl*
 
 bool TraceSet::addTraceToSet(const bfs::path& path, int traceHandle)
 {
+    // cached informations for the same metadata?
+    if (_traceInfosCache) {
+        auto traceInfos = _traceInfosCache->load(path,
+                                                 static_cast<trace_id_t>(traceHandle));
+
+        if (traceInfos) {
+            _tracesInfos.insert(std::move(traceInfos));
+
+            return true;
+        }
+    }
+
     // get list of event declarations for this trace handle
     ::bt_ctf_event_decl* const* eventDeclList;
     unsigned int count;
@@ -273,6 +307,11 @@ bool TraceSet::addTraceToSet(const bfs::path& path, int traceHandle)
         }
     };
 
+    // cache them for next time (not fatal if it fails)
+    if (_traceInfosCache) {
+        _traceInfosCache->save(*traceInfos);
+    }
+
     // add to our set of trace infos
     _tracesInfos.insert(std::move(traceInfos));
 
@@ -302,6 +341,70 @@ bool TraceSet::addTrace(const boost::filesystem::path& path)
     return this->addTraceToSet(path, ret);
 }
 
+bool TraceSet::usePacketIndexes(const bfs::path& dir)
+{
+    _packetIndexes.clear();
+
+    if (_tracesInfos.empty()) {
+        return false;
+    }
+
+    try {
+        bfs::create_directories(dir);
+
+        for (const auto& traceInfos : _tracesInfos) {
+            auto trace = NativeCtfTrace::create(_btCtx, *traceInfos);
+
+            if (!trace) {
+                // not supported by the native decoder: no index at all
+                _packetIndexes.clear();
+
+                return false;
+            }
+
+            auto path = dir / std::to_string(traceInfos->getId());
+            auto packetIndex = PacketIndex::load(path, *trace);
+
+            if (!packetIndex) {
+                packetIndex = PacketIndex::build(*trace);
+
+                // not being able to cache it is not fatal
+                packetIndex->save(path);
+            }
+
+            _packetIndexes[traceInfos->getId()] = std::move(packetIndex);
+        }
+    } catch (const bfs::filesystem_error&) {
+        _packetIndexes.clear();
+
+        return false;
+    } catch (const ex::TraceSet&) {
+        _packetIndexes.clear();
+
+        return false;
+    }
+
+    return true;
+}
+
+std::uint64_t TraceSet::getEventCount() const
+{
+    return this->getEventCount(_rangeEnd);
+}
+
+std::uint64_t TraceSet::getEventCount(timestamp_t end) const
+{
+    std::uint64_t count = 0;
+
+    end = std::min(end, _rangeEnd);
+
+    for (const auto& packetIndex : _packetIndexes) {
+        count += packetIndex.second->getEventCount(_rangeBegin, end);
+    }
+
+    return count;
+}
+
 timestamp_t TraceSet::getBegin() const
 {
     // ignore if no trace is loaded
@@ -309,6 +412,20 @@ timestamp_t TraceSet::getBegin() const
         return -1;
     }
 
+    if (!_packetIndexes.empty()) {
+        timestamp_t begin = -1;
+
+        for (const auto& packetIndex : _packetIndexes) {
+            begin = std::min(begin, packetIndex.second->getBegin());
+        }
+
+        if (begin == static_cast<timestamp_t>(-1)) {
+            return -1;
+        }
+
+        return std::max(begin, _rangeBegin);
+    }
+
     // save position (iterator might be shared)
     auto savedPos = ::bt_iter_get_pos(_btIter);
 
@@ -331,7 +448,7 @@ timestamp_t TraceSet::getBegin() const
     ::bt_iter_set_pos(_btIter, savedPos);
     ::bt_iter_free_pos(savedPos);
 
-    return static_cast<timestamp_t>(ts);
+    return std::max(static_cast<timestamp_t>(ts), _rangeBegin);
 }
 
 timestamp_t TraceSet::getEnd() const
@@ -341,6 +458,26 @@ timestamp_t TraceSet::getEnd() const
         return -1;
     }
 
+    if (!_packetIndexes.empty()) {
+        timestamp_t end = 0;
+        bool found = false;
+
+        for (const auto& packetIndex : _packetIndexes) {
+            auto indexEnd = packetIndex.second->getEnd();
+
+            if (indexEnd != static_cast<timestamp_t>(-1)) {
+                end = std::max(end, indexEnd);
+                found = true;
+            }
+        }
+
+        if (!found) {
+            return -1;
+        }
+
+        return std::min(end, _rangeEnd);
+    }
+
     // save position (iterator might be shared)
     auto savedPos = ::bt_iter_get_pos(_btIter);
 
@@ -366,24 +503,84 @@ timestamp_t TraceSet::getEnd() const
     ::bt_iter_set_pos(_btIter, savedPos);
     ::bt_iter_free_pos(savedPos);
 
-    return static_cast<timestamp_t>(ts);
+    return std::min(static_cast<timestamp_t>(ts), _rangeEnd);
 }
 
 
 TraceSet::Iterator TraceSet::begin() const
 {
-    // go back to beginning (will also affect all existing iterators)
-    this->seekBegin();
+    return this->begin(nullptr);
+}
+
+TraceSet::Iterator TraceSet::begin(const EventFilter* filter) const
+{
+    return this->seek(_rangeBegin, filter);
+}
+
+TraceSet::Iterator TraceSet::seek(timestamp_t ts, const EventFilter* filter) const
+{
+    ts = std::max(ts, _rangeBegin);
+
+    /* The filter copy and the event source are owned by the returned
+     * iterator (and its copies): previous iterators keep theirs.
+     */
+    std::shared_ptr<const EventFilter> eventFilter;
+
+    if (filter) {
+        eventFilter = std::make_shared<EventFilter>(*filter);
+    }
+
+    if (!_eventCacheDir.empty()) {
+        // replay cached events
+        std::shared_ptr<EventCacheReader> eventCacheReader {
+            new EventCacheReader {
+                _eventCacheDir, *this, eventFilter.get(), ts, _rangeEnd
+            }
+        };
+
+        return TraceSet::Iterator {eventCacheReader, eventFilter};
+    }
+
+    if (_nativeDecoding && !_tracesInfos.empty()) {
+        // start over with a new native decoder
+        std::shared_ptr<NativeCtfDecoder> nativeDecoder {
+            new NativeCtfDecoder {
+                _btCtx, _tracesInfos, eventFilter.get(), ts, _rangeEnd,
+                _packetIndexes.empty() ? nullptr : &_packetIndexes
+            }
+        };
+
+        if (nativeDecoder->isSupported()) {
+            return TraceSet::Iterator {nativeDecoder, eventFilter};
+        }
+
+        // not supported: fall back to Babeltrace
+    }
+
+    if (_streamGroupsCount > 0 && !_tracesInfos.empty()) {
+        // start over with a new merger
+        std::shared_ptr<StreamGroupMerger> streamGroupMerger {
+            new StreamGroupMerger {
+                _tracesInfos, _streamGroupsCount, eventFilter.get(), ts,
+                _rangeEnd
+            }
+        };
+
+        return TraceSet::Iterator {streamGroupMerger, eventFilter};
+    }
+
+    // seek (will also affect all existing iterators)
+    this->seekTime(ts);
 
     // create new iterator
-    return TraceSet::Iterator {_btCtfIter};
+    return TraceSet::Iterator {_btCtfIter, eventFilter, _rangeEnd};
 }
 
 
 TraceSet::Iterator TraceSet::end() const
 {
     // "end" is just a null iterator
-    return TraceSet::Iterator {nullptr};
+    return TraceSet::Iterator {};
 }
 
 }
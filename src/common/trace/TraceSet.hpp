@@ -28,7 +28,13 @@
 
 #include <common/BasicTypes.hpp>
 #include <common/trace/TraceSetIterator.hpp>
+#include <common/trace/EventFilter.hpp>
 #include <common/trace/TraceInfos.hpp>
+#include <common/trace/TraceInfosCache.hpp>
+#include <common/trace/EventCacheReader.hpp>
+#include <common/trace/StreamGroupMerger.hpp>
+#include <common/trace/NativeCtfDecoder.hpp>
+#include <common/trace/PacketIndex.hpp>
 
 struct tibee_bt_ctf_event_decl;
 struct tibee_bt_declaration;
@@ -71,6 +77,136 @@ public:
      */
     bool addTrace(const boost::filesystem::path& path);
 
+    /**
+     * Enables parallel decoding for iterators returned by begin() from
+     * now on.
+     *
+     * When enabled, the streams of all traces are split into at most
+     * \p groupsCount groups of about the same size, each one decoded on
+     * its own thread, and the decoded events are merged by timestamp.
+     * The order of events returned by iterators is the same as with
+     * sequential decoding, except for events having the exact same
+     * timestamp.
+     *
+     * @param groupsCount Maximum number of stream groups (decoding
+     *                    threads), or 0 to decode sequentially
+     */
+    void setParallelDecoding(std::size_t groupsCount)
+    {
+        _streamGroupsCount = groupsCount;
+    }
+
+    /**
+     * Enables or disables native decoding for iterators returned by
+     * begin() from now on.
+     *
+     * When enabled, CTF stream files are mapped in memory and decoded
+     * without Babeltrace (which still parses the metadata), which is
+     * much faster. If any trace of the set has a layout which is not
+     * supported by the native decoder, begin() silently falls back to
+     * Babeltrace. Native decoding takes precedence over parallel
+     * decoding.
+     *
+     * @param enable True to enable native decoding
+     */
+    void setNativeDecoding(bool enable)
+    {
+        _nativeDecoding = enable;
+    }
+
+    /**
+     * Limits iterators returned by begin() and seek() from now on to
+     * the events within [\p begin, \p end].
+     *
+     * Decoders start directly at the first packet overlapping the
+     * range (using the stream indexes when available) and stop after
+     * the last event of the range. getBegin() and getEnd() also
+     * follow this range.
+     *
+     * @param begin Timestamp of the first event to read
+     * @param end   Timestamp of the last event to read
+     */
+    void setRange(timestamp_t begin, timestamp_t end)
+    {
+        _rangeBegin = begin;
+        _rangeEnd = end;
+    }
+
+    /**
+     * Replays events from the columnar event cache of directory
+     * \p dir (see EventCacheReader) instead of decoding the traces.
+     *
+     * The cache must have been written for the same traces, added in
+     * the same order; begin() and seek() throw ex::TraceSet otherwise.
+     * Only the cached events are replayed. Pass an empty path to
+     * decode the traces again.
+     *
+     * @param dir Event cache directory
+     */
+    void setEventCacheDir(const boost::filesystem::path& dir)
+    {
+        _eventCacheDir = dir;
+    }
+
+    /**
+     * Caches the informations of traces added from now on in
+     * directory \p dir (see TraceInfosCache).
+     *
+     * Babeltrace still parses the metadata of each added trace (it
+     * needs it to decode events), but the event and field maps of a
+     * trace are only built from its declarations the first time its
+     * metadata is seen.
+     *
+     * @param dir Trace informations cache directory
+     */
+    void setTraceInfosCacheDir(const boost::filesystem::path& dir)
+    {
+        _traceInfosCache = std::unique_ptr<TraceInfosCache> {
+            new TraceInfosCache {dir}
+        };
+    }
+
+    /**
+     * Loads (or builds and saves) the packet index of each trace of
+     * the set, using directory \p dir as a cache.
+     *
+     * Packet indexes make getBegin(), getEnd() and getEventCount()
+     * immediate and let the native decoder jump directly to the first
+     * packet of a range. They are only used if all the traces of the
+     * set are supported by the native decoder; stale index files
+     * (another trace, or stream files changed since) are rebuilt.
+     *
+     * Traces must not be added after calling this.
+     *
+     * @param dir Packet index cache directory (created if needed)
+     * @returns   True if all traces are now indexed
+     */
+    bool usePacketIndexes(const boost::filesystem::path& dir);
+
+    /**
+     * Returns the number of events of the set within the current
+     * range, as recorded by the packet indexes.
+     *
+     * Packets partially overlapping the range are counted entirely,
+     * so this is an upper bound meant for progress reporting.
+     *
+     * @returns Number of events, or 0 if unknown (no packet indexes)
+     */
+    std::uint64_t getEventCount() const;
+
+    /**
+     * Returns the number of events of the set from the beginning of
+     * the current range up to \p end, as recorded by the packet
+     * indexes, whether or not they are accepted by an event filter.
+     *
+     * Like getEventCount(), this is an upper bound. It is equal to
+     * getEventCount() when \p end is the range end.
+     *
+     * @param end Timestamp up to which to count events
+     * @returns   Number of events, or 0 if unknown (no packet indexes)
+     */
+    std::uint64_t getEventCount(timestamp_t end) const;
+
     /**
      * Returns whether a given file path points to a known trace format.
      *
@@ -81,6 +217,9 @@ public:
     /**
      * Returns the begin timestamp of the set.
      *
+     * If a range is set (see setRange()), the begin timestamp is not
+     * lesser than the range begin.
+     *
      * @returns Begin timestamp of the set
      */
     timestamp_t getBegin() const;
@@ -88,6 +227,9 @@ public:
     /**
      * Returns the end timestamp of the set.
      *
+     * If a range is set (see setRange()), the end timestamp is not
+     * greater than the range end.
+     *
      * @returns End timestamp of the set
      */
     timestamp_t getEnd() const;
@@ -99,6 +241,36 @@ public:
      */
     Iterator begin() const;
 
+    /**
+     * Returns an iterator pointing to the first event of the set
+     * accepted by \p filter.
+     *
+     * Events not accepted by \p filter are skipped as early as
+     * possible by the decoder, before any Event object or event value
+     * is built for them. \p filter is copied.
+     *
+     * @param filter Event filter, or \a nullptr to accept all events
+     * @returns      Iterator pointing to the first accepted event
+     */
+    Iterator begin(const EventFilter* filter) const;
+
+    /**
+     * Returns an iterator pointing to the first event of the set
+     * having a timestamp greater than or equal to \p ts, and accepted
+     * by \p filter.
+     *
+     * Seeking is done by time (Babeltrace's BT_SEEK_TIME), so that
+     * only the packets overlapping \p ts and what follows are
+     * decoded. Like begin(), this affects all existing iterators
+     * when decoding with the trace set's own Babeltrace iterator.
+     *
+     * @param ts     Timestamp to seek
+     * @param filter Event filter, or \a nullptr to accept all events
+     * @returns      Iterator pointing to the first event at or after
+     *               \p ts
+     */
+    Iterator seek(timestamp_t ts, const EventFilter* filter = nullptr) const;
+
     /**
      * Returns an iterator pointing after the last event of the set.
      *
@@ -118,6 +290,7 @@ public:
 
 private:
     void seekBegin() const;
+    void seekTime(timestamp_t ts) const;
     static std::unique_ptr<TraceInfos::EventMap> getEventMap(::bt_ctf_event_decl* const* eventDeclList,
                                                              unsigned int count);
     static std::unique_ptr<EventInfos> getEventInfos(const ::tibee_bt_ctf_event_decl* tibeeBtCtfEventDecl,
@@ -132,6 +305,25 @@ private:
     ::bt_context* _btCtx;
     ::bt_iter* _btIter;
     ::bt_ctf_iter* _btCtfIter;
+
+    // maximum number of stream groups (0: sequential decoding)
+    std::size_t _streamGroupsCount;
+
+    // true to try native decoding first
+    bool _nativeDecoding;
+
+    // range of events to read
+    timestamp_t _rangeBegin;
+    timestamp_t _rangeEnd;
+
+    // packet indexes of all traces (empty if not used)
+    PacketIndex::Map _packetIndexes;
+
+    // event cache directory (empty: decode the traces)
+    boost::filesystem::path _eventCacheDir;
+
+    // trace informations cache or null
+    std::unique_ptr<TraceInfosCache> _traceInfosCache;
 };
 
 }
@@ -18,6 +18,9 @@
 #include <babeltrace/ctf/iterator.h>
 
 #include <common/trace/TraceSetIterator.hpp>
+#include <common/trace/AbstractEventSource.hpp>
+#include <common/trace/EventBatch.hpp>
+#include <common/trace/EventFilter.hpp>
 #include <common/trace/Event.hpp>
 
 namespace tibee
@@ -25,9 +28,23 @@ namespace tibee
 namespace common
 {
 
-TraceSetIterator::TraceSetIterator(::bt_ctf_iter* btCtfIter) :
+TraceSetIterator::TraceSetIterator() :
+    _btCtfIter {nullptr},
+    _btIter {nullptr},
+    _filter {nullptr},
+    _endTs {0},
+    _eventSource {nullptr}
+{
+}
+
+TraceSetIterator::TraceSetIterator(::bt_ctf_iter* btCtfIter,
+                                   std::shared_ptr<const EventFilter> filter,
+                                   timestamp_t endTs) :
     _btCtfIter {btCtfIter},
-    _btIter {nullptr}
+    _btIter {nullptr},
+    _filter {std::move(filter)},
+    _endTs {endTs},
+    _eventSource {nullptr}
 {
     if (!_btCtfIter) {
         return;
@@ -35,11 +52,8 @@ TraceSetIterator::TraceSetIterator(::bt_ctf_iter* btCtfIter) :
 
     _btIter = ::bt_ctf_get_iter(_btCtfIter);
 
-    // read current event
-    _btEvent = ::bt_ctf_iter_read_event(_btCtfIter);
-
-    // end?
-    if (!_btEvent) {
+    // read current event (end?)
+    if (!this->readEvent()) {
         _btIter = nullptr;
         _btCtfIter = nullptr;
         return;
@@ -54,6 +68,20 @@ TraceSetIterator::TraceSetIterator(::bt_ctf_iter* btCtfIter) :
     _event->setPrivateEvent(_btEvent);
 }
 
+TraceSetIterator::TraceSetIterator(std::shared_ptr<AbstractEventSource> eventSource,
+                                   std::shared_ptr<const EventFilter> filter) :
+    _btCtfIter {nullptr},
+    _btIter {nullptr},
+    _filter {std::move(filter)},
+    _endTs {0},
+    _eventSource {std::move(eventSource)}
+{
+    // move to first event
+    if (!_eventSource->next()) {
+        _eventSource = nullptr;
+    }
+}
+
 TraceSetIterator::TraceSetIterator(const TraceSetIterator& it)
 {
     // invoke assignment operator
@@ -74,32 +102,53 @@ TraceSetIterator& TraceSetIterator::operator=(const TraceSetIterator& rhs)
     _btIter = rhs._btIter;
     _btCtfIter = rhs._btCtfIter;
     _btEvent = rhs._btEvent;
+    _filter = rhs._filter;
+    _endTs = rhs._endTs;
+    _eventSource = rhs._eventSource;
 
     return *this;
 }
 
 TraceSetIterator& TraceSetIterator::operator++()
 {
+    // the events of the last filled batch are not needed anymore
+    if (_eventSource) {
+        _eventSource->releaseKeptEvents();
+    }
+
+    this->advance();
+
+    return *this;
+}
+
+void TraceSetIterator::advance()
+{
+    if (_eventSource) {
+        if (!_eventSource->next()) {
+            // disable this iterator
+            _eventSource = nullptr;
+        }
+
+        return;
+    }
+
     if (!_btIter) {
         // disabled
-        return *this;
+        return;
     }
 
     if (::bt_iter_next(_btIter) < 0) {
         // disable this iterator
         _btIter = nullptr;
         _btCtfIter = nullptr;
-        return *this;
+        return;
     }
 
-    // read current event
-    _btEvent = ::bt_ctf_iter_read_event(_btCtfIter);
-
-    // end?
-    if (!_btEvent) {
+    // read current event (end?)
+    if (!this->readEvent()) {
         _btIter = nullptr;
         _btCtfIter = nullptr;
-        return *this;
+        return;
     }
 
     // reset value factory pools
@@ -107,13 +156,46 @@ TraceSetIterator& TraceSetIterator::operator++()
 
     // update event wrapper
     _event->setPrivateEvent(_btEvent);
+}
 
-    return *this;
+bool TraceSetIterator::readEvent()
+{
+    while (true) {
+        _btEvent = ::bt_ctf_iter_read_event(_btCtfIter);
+
+        if (!_btEvent) {
+            return false;
+        }
+
+        // past the range?
+        if (static_cast<timestamp_t>(::bt_ctf_get_timestamp(_btEvent)) > _endTs) {
+            return false;
+        }
+
+        if (!_filter) {
+            return true;
+        }
+
+        // skip filtered out events before wrapping them
+        event_id_t id;
+        trace_id_t traceId;
+
+        Event::getBtEventIds(_btEvent, id, traceId);
+
+        if (_filter->accepts(traceId, id)) {
+            return true;
+        }
+
+        if (::bt_iter_next(_btIter) < 0) {
+            return false;
+        }
+    }
 }
 
 bool TraceSetIterator::operator==(const TraceSetIterator& rhs)
 {
-    return _btIter == rhs._btIter;
+    return _btIter == rhs._btIter &&
+           _eventSource == rhs._eventSource;
 }
 
 bool TraceSetIterator::operator!=(const TraceSetIterator& rhs)
@@ -126,9 +208,50 @@ const Event& TraceSetIterator::operator*() const
     /* Behaviour is undefined (could crash) when we're at the end (should
      * be checked first by comparing to and end trace set iterator).
      */
+    if (_eventSource) {
+        return _eventSource->getCurrentEvent();
+    }
 
     return *_event;
 }
 
+std::size_t TraceSetIterator::fill(EventBatch& batch)
+{
+    batch.clear();
+
+    // the events of the previous batch are not needed anymore
+    if (_eventSource) {
+        _eventSource->releaseKeptEvents();
+    }
+
+    while (!batch.isFull()) {
+        if (_eventSource) {
+            if (!_eventSource->canKeepEvents()) {
+                // copy the event source's event, only valid until next()
+                batch.append().copy(_eventSource->getCurrentEvent());
+            } else if (_eventSource->keepCurrentEvent()) {
+                // already detached: use it in place
+                batch.appendKept(_eventSource->getCurrentEvent());
+            } else {
+                // the event source is full: stop here
+                break;
+            }
+        } else if (_btIter) {
+            // build the values directly into the batch's pools
+            auto& event = batch.append();
+
+            event.setPrivateEvent(_btEvent);
+            event.detach(event.getTraceId());
+        } else {
+            // end
+            break;
+        }
+
+        this->advance();
+    }
+
+    return batch.size();
+}
+
 }
 }
@@ -19,9 +19,11 @@
 #define _TIBEE_COMMON_TRACESETITERATOR_HPP
 
 #include <iterator>
+#include <memory>
 #include <babeltrace/ctf/events.h>
 #include <babeltrace/ctf/iterator.h>
 
+#include <common/BasicTypes.hpp>
 #include <common/trace/Event.hpp>
 
 namespace tibee
@@ -29,6 +31,10 @@ namespace tibee
 namespace common
 {
 
+class AbstractEventSource;
+class EventBatch;
+class EventFilter;
+
 /**
  * A trace set iterator; returns an Event.
  *
@@ -37,7 +43,7 @@ namespace common
  *
  * Because of a limitation in libbabeltrace, i.e. two BT iterators
  * cannot exist concurrently in a single BT context, a trace set
- * iterator doesn't own its BT iterator. This means:
+ * iterator doesn't own the trace set's BT iterator. This means:
  *
  *   * the internal BT iterator won't be destroyed in the trace
  *     set iterator's destructor
@@ -45,13 +51,23 @@ namespace common
  *     from a given trace set will always be synchronized (moved
  *     together)
  *
+ * When the trace set decodes with another event source (parallel or
+ * native decoding, event cache), the event source and the event
+ * filter are shared by the iterator and its copies: they live as long
+ * as one of them, even if the trace set starts another iteration.
+ *
  * @author Philippe Proulx
  */
 class TraceSetIterator :
     public std::iterator<std::input_iterator_tag, Event>
 {
 public:
-    TraceSetIterator(::bt_ctf_iter* btCtfIter);
+    TraceSetIterator();
+    TraceSetIterator(::bt_ctf_iter* btCtfIter,
+                     std::shared_ptr<const EventFilter> filter,
+                     timestamp_t endTs);
+    TraceSetIterator(std::shared_ptr<AbstractEventSource> eventSource,
+                     std::shared_ptr<const EventFilter> filter);
     TraceSetIterator(const TraceSetIterator& it);
 
     virtual ~TraceSetIterator();
@@ -72,6 +88,28 @@ public:
      */
     const Event& operator*() const;
 
+    /**
+     * Fills \p batch with the events starting at the event currently
+     * pointed to by this iterator, and moves this iterator past the
+     * last event of the batch.
+     *
+     * The previous content of \p batch is discarded. Contrary to the
+     * event returned by operator*(), all the events of \p batch remain
+     * valid until this iterator (or a copy) moves again.
+     *
+     * Events the event source can keep in place are not copied; the
+     * batch may then hold fewer events than its capacity when the
+     * event source cannot keep more.
+     *
+     * @param batch Batch to fill
+     * @returns     Number of events in \p batch (0 when at the end)
+     */
+    std::size_t fill(EventBatch& batch);
+
+private:
+    bool readEvent();
+    void advance();
+
 private:
     // libbabeltrace CTF iterator
     ::bt_ctf_iter* _btCtfIter;
@@ -88,6 +126,18 @@ private:
 
     // the value factory used by this iterator and its event
     EventValueFactory _valueFactory;
+
+    /* Event filter applied to BT events or by the event source, or
+     * null (declared before the event source, which refers to it, so
+     * that it's destroyed after it).
+     */
+    std::shared_ptr<const EventFilter> _filter;
+
+    // timestamp of the last BT event to return
+    timestamp_t _endTs;
+
+    // event source (parallel or native decoding, event cache) or null
+    std::shared_ptr<AbstractEventSource> _eventSource;
 };
 
 }
@@ -19,6 +19,7 @@
 #include <babeltrace/ctf/events.h>
 
 #include <common/trace/UintEventValue.hpp>
+#include <common/trace/EventValueFactory.hpp>
 #include <common/trace/SintEventValue.hpp>
 
 namespace tibee
@@ -32,6 +33,19 @@ UintEventValue::UintEventValue(const ::bt_definition* def,
         def,
         valueFactory
     }
+{
+    if (valueFactory->isDetached()) {
+        this->detach();
+    }
+}
+
+UintEventValue::UintEventValue(std::uint64_t value, int base,
+                               const EventValueFactory* valueFactory) :
+    AbstractIntegerEventValue<std::uint64_t, EventValueType::UINT> {
+        value,
+        base,
+        valueFactory
+    }
 {
 }
 
@@ -48,6 +48,16 @@ public:
     UintEventValue(const ::bt_definition* def,
                    const EventValueFactory* valueFactory);
 
+    /**
+     * Builds an unsigned integer value out of an already decoded integer.
+     *
+     * @param value        Integer value
+     * @param base         Expected display base or -1
+     * @param valueFactory Value factory used to create other event values
+     */
+    UintEventValue(std::uint64_t value, int base,
+                   const EventValueFactory* valueFactory);
+
     /**
      * Returns the result of a bitwise AND between this event value
      * and an unsigned integer.
@@ -68,6 +68,7 @@ struct tibee_bt_format;
 struct tibee_bt_stream_pos;
 struct tibee_ctf_stream_definition;
 struct tibee_bt_definition;
+struct tibee_trace_collection;
 
 struct tibee_bt_declaration {
 	enum ctf_type_id id;
@@ -100,6 +101,83 @@ struct tibee_declaration_struct {
 	GArray *fields;			/* Array of declaration_field */
 };
 
+struct tibee_bt_list_head {
+	struct tibee_bt_list_head *next, *prev;
+};
+
+struct tibee_declaration_integer {
+	struct tibee_bt_declaration p;
+	size_t len;		/* length, in bits. */
+	int byte_order;		/* byte order */
+	int signedness;
+	int base;		/* Base for pretty-printing: 2, 8, 10, 16 */
+	enum ctf_string_encoding encoding;
+	struct tibee_ctf_clock *clock;
+};
+
+struct tibee_declaration_float {
+	struct tibee_bt_declaration p;
+	struct tibee_declaration_integer *sign;
+	struct tibee_declaration_integer *mantissa;
+	struct tibee_declaration_integer *exp;
+	int byte_order;
+};
+
+struct tibee_enum_range {
+	union {
+		int64_t _signed;
+		uint64_t _unsigned;
+	} start;	/* lowest range value */
+	union {
+		int64_t _signed;
+		uint64_t _unsigned;
+	} end;		/* highest range value */
+};
+
+struct tibee_enum_table {
+	GHashTable *value_to_quark_set;		/* (value, GQuark GArray) */
+	struct tibee_bt_list_head range_to_quark;	/* (range, GQuark) */
+	GHashTable *quark_to_range_set;		/* (GQuark, range GArray) */
+};
+
+struct tibee_declaration_enum {
+	struct tibee_bt_declaration p;
+	struct tibee_declaration_integer *integer_declaration;
+	struct tibee_enum_table table;
+};
+
+struct tibee_declaration_string {
+	struct tibee_bt_declaration p;
+	enum ctf_string_encoding encoding;
+};
+
+struct tibee_declaration_untagged_variant {
+	struct tibee_bt_declaration p;
+	GHashTable *fields_by_tag;	/* Tuples (field tag, field index) */
+	struct tibee_declaration_scope *scope;
+	GArray *fields;			/* Array of declaration_field */
+};
+
+struct tibee_declaration_variant {
+	struct tibee_bt_declaration p;
+	struct tibee_declaration_untagged_variant *untagged_variant;
+	GArray *tag_name;		/* Array of GQuark */
+};
+
+struct tibee_declaration_array {
+	struct tibee_bt_declaration p;
+	size_t len;
+	struct tibee_bt_declaration *elem;
+	struct tibee_declaration_scope *scope;
+};
+
+struct tibee_declaration_sequence {
+	struct tibee_bt_declaration p;
+	GArray *length_name;		/* Array of GQuark */
+	struct tibee_bt_declaration *elem;
+	struct tibee_declaration_scope *scope;
+};
+
 /*
  * trace_handle : unique identifier of a trace
  *
@@ -117,12 +195,23 @@ struct tibee_bt_trace_handle {
 	uint64_t cycles_timestamp_end;
 };
 
+struct tibee_trace_collection {
+	GPtrArray *array;	/* struct bt_trace_descriptor */
+	GHashTable *clocks;	/* struct ctf_clock_match */
+
+	uint64_t single_clock_offset_avg;
+	uint64_t offset_first;
+	int64_t delta_offset_first_sum;
+	int offset_nr;
+	int clock_use_offset_avg;
+};
+
 /* Parent trace descriptor */
 struct tibee_bt_trace_descriptor {
 	char path[PATH_MAX];		/* trace path */
 	struct tibee_bt_context *ctx;
 	struct tibee_bt_trace_handle *handle;
-	struct trace_collection *collection;	/* Container of this trace */
+	struct tibee_trace_collection *collection;	/* Container of this trace */
 	GHashTable *clocks;
 	struct tibee_ctf_clock *single_clock;		/* currently supports only one clock */
 };
@@ -0,0 +1,175 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <yajl_parse.h>
+#include <memory>
+#include <utility>
+
+#include <common/utils/JsonParser.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+const JsonValue* JsonValue::find(const std::string& key) const
+{
+    for (std::size_t x = 0; x < keys.size(); ++x) {
+        if (keys[x] == key) {
+            return items[x].get();
+        }
+    }
+
+    return nullptr;
+}
+
+std::unique_ptr<JsonValue> JsonParser::parse(const std::string& json)
+{
+    static const ::yajl_callbacks callbacks = {
+        JsonParser::processNullCb,
+        JsonParser::processBooleanCb,
+        JsonParser::processIntegerCb,
+        JsonParser::processDoubleCb,
+        nullptr,
+        JsonParser::processStringCb,
+        JsonParser::processStartMapCb,
+        JsonParser::processMapKeyCb,
+        JsonParser::processEndCb,
+        JsonParser::processStartArrayCb,
+        JsonParser::processEndCb,
+    };
+
+    _root.reset();
+    _stack.clear();
+
+    auto yajlHandle = ::yajl_alloc(std::addressof(callbacks), nullptr,
+                                   static_cast<void*>(this));
+
+    if (!yajlHandle) {
+        return nullptr;
+    }
+
+    auto ret = ::yajl_parse(yajlHandle,
+                            reinterpret_cast<const unsigned char*>(json.c_str()),
+                            json.size());
+
+    if (ret == ::yajl_status_ok) {
+        ret = ::yajl_complete_parse(yajlHandle);
+    }
+
+    ::yajl_free(yajlHandle);
+
+    if (ret != ::yajl_status_ok) {
+        _root.reset();
+
+        return nullptr;
+    }
+
+    return std::move(_root);
+}
+
+JsonValue& JsonParser::push(JsonValue::Type type)
+{
+    std::unique_ptr<JsonValue> value {new JsonValue()};
+    auto rawValue = value.get();
+
+    value->type = type;
+
+    if (_stack.empty()) {
+        _root = std::move(value);
+    } else {
+        _stack.back()->items.push_back(std::move(value));
+    }
+
+    return *rawValue;
+}
+
+int JsonParser::processNullCb(void* ctx)
+{
+    static_cast<JsonParser*>(ctx)->push(JsonValue::Type::NUL);
+
+    return 1;
+}
+
+int JsonParser::processBooleanCb(void* ctx, int value)
+{
+    static_cast<JsonParser*>(ctx)->push(JsonValue::Type::BOOL).boolValue = (value != 0);
+
+    return 1;
+}
+
+int JsonParser::processIntegerCb(void* ctx, long long value)
+{
+    static_cast<JsonParser*>(ctx)->push(JsonValue::Type::INT).intValue = value;
+
+    return 1;
+}
+
+int JsonParser::processDoubleCb(void* ctx, double value)
+{
+    static_cast<JsonParser*>(ctx)->push(JsonValue::Type::DOUBLE).doubleValue = value;
+
+    return 1;
+}
+
+int JsonParser::processStringCb(void* ctx, const unsigned char* value,
+                                std::size_t len)
+{
+    auto parser = static_cast<JsonParser*>(ctx);
+
+    parser->push(JsonValue::Type::STRING).stringValue.assign(reinterpret_cast<const char*>(value), len);
+
+    return 1;
+}
+
+int JsonParser::processStartMapCb(void* ctx)
+{
+    auto parser = static_cast<JsonParser*>(ctx);
+
+    parser->_stack.push_back(&parser->push(JsonValue::Type::MAP));
+
+    return 1;
+}
+
+int JsonParser::processMapKeyCb(void* ctx, const unsigned char* key,
+                                std::size_t len)
+{
+    auto parser = static_cast<JsonParser*>(ctx);
+
+    parser->_stack.back()->keys.push_back(std::string {reinterpret_cast<const char*>(key), len});
+
+    return 1;
+}
+
+int JsonParser::processStartArrayCb(void* ctx)
+{
+    auto parser = static_cast<JsonParser*>(ctx);
+
+    parser->_stack.push_back(&parser->push(JsonValue::Type::ARRAY));
+
+    return 1;
+}
+
+int JsonParser::processEndCb(void* ctx)
+{
+    static_cast<JsonParser*>(ctx)->_stack.pop_back();
+
+    return 1;
+}
+
+}
+}
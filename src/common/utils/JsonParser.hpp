@@ -0,0 +1,127 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_JSONPARSER_HPP
+#define _TIBEE_COMMON_JSONPARSER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/utility.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Generic JSON value, as built by JsonParser.
+ *
+ * Only the members matching the value type are meaningful: items of
+ * arrays and maps, and keys of maps (same order as items).
+ *
+ * @author Philippe Proulx
+ */
+struct JsonValue
+{
+    /// JSON value type
+    enum class Type
+    {
+        NUL,
+        BOOL,
+        INT,
+        DOUBLE,
+        STRING,
+        ARRAY,
+        MAP,
+    };
+
+    /**
+     * Returns the item of key \p key of this map.
+     *
+     * @param key Key of item to find
+     * @returns   Item or \a nullptr if not found
+     */
+    const JsonValue* find(const std::string& key) const;
+
+    /// Value type
+    Type type;
+
+    /// Boolean value
+    bool boolValue;
+
+    /// Integer value
+    std::int64_t intValue;
+
+    /// Floating point number value
+    double doubleValue;
+
+    /// String value
+    std::string stringValue;
+
+    /// Items of an array or of a map
+    std::vector<std::unique_ptr<JsonValue>> items;
+
+    /// Keys of a map
+    std::vector<std::string> keys;
+};
+
+/**
+ * Parser of a whole JSON document into a JsonValue tree.
+ *
+ * @author Philippe Proulx
+ */
+class JsonParser :
+    boost::noncopyable
+{
+public:
+    /**
+     * Parses the JSON document \p json.
+     *
+     * @param json JSON document
+     * @returns    Root value or \a nullptr if \p json is not valid JSON
+     */
+    std::unique_ptr<JsonValue> parse(const std::string& json);
+
+private:
+    JsonValue& push(JsonValue::Type type);
+    static int processNullCb(void* ctx);
+    static int processBooleanCb(void* ctx, int value);
+    static int processIntegerCb(void* ctx, long long value);
+    static int processDoubleCb(void* ctx, double value);
+    static int processStringCb(void* ctx, const unsigned char* value,
+                               std::size_t len);
+    static int processStartMapCb(void* ctx);
+    static int processMapKeyCb(void* ctx, const unsigned char* key,
+                               std::size_t len);
+    static int processStartArrayCb(void* ctx);
+    static int processEndCb(void* ctx);
+
+private:
+    // root value being parsed
+    std::unique_ptr<JsonValue> _root;
+
+    // maps and arrays being parsed
+    std::vector<JsonValue*> _stack;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_JSONPARSER_HPP
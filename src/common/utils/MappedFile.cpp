@@ -0,0 +1,75 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <common/utils/MappedFile.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+MappedFile::MappedFile(const boost::filesystem::path& path) :
+    _data {nullptr},
+    _size {0}
+{
+    auto fd = ::open(path.string().c_str(), O_RDONLY);
+
+    if (fd < 0) {
+        return;
+    }
+
+    struct ::stat st;
+
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        auto addr = ::mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+
+        if (addr != MAP_FAILED) {
+            _data = static_cast<const char*>(addr);
+            _size = static_cast<std::size_t>(st.st_size);
+        }
+    }
+
+    // the mapping stays valid after closing
+    ::close(fd);
+}
+
+MappedFile::~MappedFile()
+{
+    if (_data) {
+        ::munmap(const_cast<char*>(_data), _size);
+    }
+}
+
+std::uint64_t MappedFile::getHash() const
+{
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+
+    for (std::size_t x = 0; x < _size; ++x) {
+        hash ^= static_cast<std::uint8_t>(_data[x]);
+        hash *= 0x100000001b3ULL;
+    }
+
+    return hash;
+}
+
+}
+}
@@ -0,0 +1,92 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_MAPPEDFILE_HPP
+#define _TIBEE_COMMON_MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <boost/utility.hpp>
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Read-only memory mapping of a whole file.
+ *
+ * A mapped file is empty (null data) if the file cannot be opened or
+ * mapped, or if it's empty: callers using it for optional data (caches,
+ * indexes) only need to check getData().
+ *
+ * @author Philippe Proulx
+ */
+class MappedFile :
+    boost::noncopyable
+{
+public:
+    /**
+     * Maps file \p path.
+     *
+     * @param path Path of file to map
+     */
+    explicit MappedFile(const boost::filesystem::path& path);
+
+    /**
+     * Unmaps the file.
+     */
+    ~MappedFile();
+
+    /**
+     * Returns the mapped data.
+     *
+     * @returns Mapped data or \a nullptr if the file is not mapped
+     */
+    const char* getData() const
+    {
+        return _data;
+    }
+
+    /**
+     * Returns the size of the mapped data.
+     *
+     * @returns Mapped data size (bytes)
+     */
+    std::size_t getSize() const
+    {
+        return _size;
+    }
+
+    /**
+     * Returns the 64-bit FNV-1a hash of the mapped data, to tell
+     * whether or not a file changed.
+     *
+     * @returns Hash of the mapped data
+     */
+    std::uint64_t getHash() const;
+
+private:
+    const char* _data;
+    std::size_t _size;
+};
+
+}
+}
+
+#endif // _TIBEE_COMMON_MAPPEDFILE_HPP
@@ -0,0 +1,57 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_COMMON_TSC_HPP
+#define _TIBEE_COMMON_TSC_HPP
+
+#include <chrono>
+#include <cstdint>
+
+#if defined(__x86_64__) || defined(__i386__)
+# include <x86intrin.h>
+#endif
+
+namespace tibee
+{
+namespace common
+{
+
+/**
+ * Reads the time stamp counter, a cheap way of measuring short
+ * durations (in cycles; see the caller for how to convert them to
+ * time).
+ *
+ * On architectures without a time stamp counter, returns the current
+ * time of a monotonic clock in nanoseconds instead.
+ *
+ * @returns Current time stamp counter value
+ */
+inline std::uint64_t readTsc()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    auto now = std::chrono::steady_clock::now().time_since_epoch();
+
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(now).count();
+#endif
+}
+
+}
+}
+
+#endif // _TIBEE_COMMON_TSC_HPP
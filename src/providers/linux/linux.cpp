@@ -26,11 +26,16 @@
 #include <iostream>
 #include <cassert>
 #include <cstring>
+#include <memory>
+#include <string>
+#include <vector>
 
 #include <common/state/CurrentState.hpp>
 #include <common/state/StateNode.hpp>
+#include <common/state/StatePathHandle.hpp>
 #include <common/stateprov/DynamicLibraryStateProvider.hpp>
 #include <common/trace/Event.hpp>
+#include <common/trace/FieldHandle.hpp>
 #include <common/trace/TraceSet.hpp>
 
 using namespace tibee;
@@ -39,43 +44,55 @@ using namespace tibee::common;
 namespace
 {
 
-// constant quarks
-Quark Q_LINUX;
-Quark Q_THREADS;
-Quark Q_CPUS;
-Quark Q_CUR_CPU;
-Quark Q_CUR_THREAD;
-Quark Q_RESOURCES;
-Quark Q_IRQS;
-Quark Q_SOFT_IRQS;
-Quark Q_SYSCALL;
-Quark Q_STATUS;
-Quark Q_PPID;
-Quark Q_EXEC_NAME;
-Quark Q_IDLE;
-Quark Q_RUN_USERMODE;
-Quark Q_RUN_SYSCALL;
-Quark Q_IRQ;
-Quark Q_SOFT_IRQ;
-Quark Q_UNKNOWN;
-Quark Q_WAIT_BLOCKED;
-Quark Q_INTERRUPTED;
-Quark Q_WAIT_FOR_CPU;
-Quark Q_RAISED;
-Quark Q_SYS_CLONE;
-
-// 0 to 65535 integers
-Quark Q_INT[65536];
-
-Quark getIntQ(const CurrentState& state, std::int64_t x)
+/* Per-instance context: the same library may run as more than one
+ * provider instance, each one with its own quarks and handles.
+ */
+struct Context
 {
-    // optimization for pretty much all integers used in this provider
-    if (x >= 0 && x < 65536) {
-        return Q_INT[x];
-    }
-
-    return state.getQuark(std::to_string(x));
-}
+    // constant quarks
+    Quark Q_CUR_CPU;
+    Quark Q_CUR_THREAD;
+    Quark Q_SYSCALL;
+    Quark Q_STATUS;
+    Quark Q_PPID;
+    Quark Q_EXEC_NAME;
+    Quark Q_IDLE;
+    Quark Q_RUN_USERMODE;
+    Quark Q_RUN_SYSCALL;
+    Quark Q_IRQ;
+    Quark Q_SOFT_IRQ;
+    Quark Q_UNKNOWN;
+    Quark Q_WAIT_BLOCKED;
+    Quark Q_INTERRUPTED;
+    Quark Q_WAIT_FOR_CPU;
+    Quark Q_RAISED;
+    Quark Q_SYS_CLONE;
+
+    // state path handles
+    StatePathHandle H_CPU;
+    StatePathHandle H_CPU_CUR_THREAD;
+    StatePathHandle H_THREAD;
+    StatePathHandle H_THREAD_STATUS;
+    StatePathHandle H_IRQ;
+    StatePathHandle H_SOFT_IRQ;
+
+    // event field handles
+    FieldHandle F_IRQ;
+    FieldHandle F_VEC;
+    FieldHandle F_SCHED_SWITCH_PREV_STATE;
+    FieldHandle F_SCHED_SWITCH_PREV_TID;
+    FieldHandle F_SCHED_SWITCH_NEXT_TID;
+    FieldHandle F_SCHED_SWITCH_NEXT_COMM;
+    FieldHandle F_SCHED_PROCESS_FORK_CHILD_TID;
+    FieldHandle F_SCHED_PROCESS_FORK_PARENT_TID;
+    FieldHandle F_SCHED_PROCESS_FORK_CHILD_COMM;
+    FieldHandle F_SCHED_PROCESS_FREE_TID;
+    FieldHandle F_STATEDUMP_PROCESS_STATE_TID;
+    FieldHandle F_STATEDUMP_PROCESS_STATE_PPID;
+    FieldHandle F_STATEDUMP_PROCESS_STATE_STATUS;
+    FieldHandle F_STATEDUMP_PROCESS_STATE_NAME;
+    FieldHandle F_SCHED_WAKEUP_TID;
+};
 
 const UintEventValue& getEventCpu(const Event& event)
 {
@@ -84,13 +101,6 @@ const UintEventValue& getEventCpu(const Event& event)
     return event.getStreamPacketContext()["cpu_id"].asUintValue();
 }
 
-Quark getEventCpuQuark(const CurrentState& state, const Event& event)
-{
-    const auto& cpu = getEventCpu(event);
-
-    return getIntQ(state, cpu.asUint());
-}
-
 std::int32_t asSint32(const SintEventValue& event)
 {
     return static_cast<std::int32_t>(event.getValue());
@@ -101,296 +111,281 @@ std::uint32_t asUint32(const UintEventValue& event)
     return static_cast<std::uint32_t>(event.getValue());
 }
 
-StateNode& getLinuxNode(CurrentState& state)
+StateNode& getCurrentCpuNode(Context& ctx, CurrentState& state, const Event& event)
 {
-    return state.getRoot()[Q_LINUX];
-}
-
-StateNode& getCurrentCpuNode(CurrentState& state, const Event& event)
-{
-    auto qCpu = getEventCpuQuark(state, event);
+    const auto& cpu = getEventCpu(event);
 
-    return getLinuxNode(state)[Q_CPUS][qCpu];
+    return ctx.H_CPU.getNode(cpu.asUint());
 }
 
-StateNode& getCpuCurrentThreadNode(CurrentState& state, const Event& event)
+StateNode& getCpuCurrentThreadNode(Context& ctx, CurrentState& state, const Event& event)
 {
-    return getCurrentCpuNode(state, event)[Q_CUR_THREAD];
+    const auto& cpu = getEventCpu(event);
+
+    return ctx.H_CPU_CUR_THREAD.getNode(cpu.asUint());
 }
 
-StateNode& getThreadsCurrentThreadNode(CurrentState& state, const Event& event)
+StateNode& getThreadsCurrentThreadNode(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& cpuCurrentThreadNode = getCpuCurrentThreadNode(state, event);
+    auto& cpuCurrentThreadNode = getCpuCurrentThreadNode(ctx, state, event);
 
     if (!cpuCurrentThreadNode) {
         return state.getRoot();
     }
 
-    auto qCurrentThread = getIntQ(state, cpuCurrentThreadNode.asSint32());
-
-    return getLinuxNode(state)[Q_THREADS][qCurrentThread];
+    return ctx.H_THREAD.getNode(cpuCurrentThreadNode.asSint32());
 }
 
-StateNode& getCurrentIrqNode(CurrentState& state, const Event& event)
+StateNode& getCurrentIrqNode(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& irq = event["irq"];
-    auto qIrq = getIntQ(state, irq.asSint());
+    auto& irq = event[ctx.F_IRQ];
 
-    return getLinuxNode(state)[Q_RESOURCES][Q_IRQS][qIrq];
+    return ctx.H_IRQ.getNode(irq.asSint());
 }
 
-StateNode& getCurrentSoftIrqNode(CurrentState& state, const Event& event)
+StateNode& getCurrentSoftIrqNode(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& vec = event["vec"];
-    auto qVec = getIntQ(state, vec.asUint());
+    auto& vec = event[ctx.F_VEC];
 
-    return getLinuxNode(state)[Q_RESOURCES][Q_SOFT_IRQS][qVec];
+    return ctx.H_SOFT_IRQ.getNode(vec.asUint());
 }
 
-bool onExitSyscall(CurrentState& state, const Event& event)
+bool onExitSyscall(Context& ctx, CurrentState& state, const Event& event)
 {
     auto& root = state.getRoot();
-    auto& currentThreadNode = getThreadsCurrentThreadNode(state, event);
-    auto& currentCpuNode = getCurrentCpuNode(state, event);
+    auto& currentThreadNode = getThreadsCurrentThreadNode(ctx, state, event);
+    auto& currentCpuNode = getCurrentCpuNode(ctx, state, event);
 
     if (currentThreadNode != root) {
         // reset current thread's syscall
-        currentThreadNode[Q_SYSCALL].setNull();
+        currentThreadNode[ctx.Q_SYSCALL].setNull();
 
         // current thread's status
-        currentThreadNode[Q_STATUS] = Q_RUN_USERMODE;
+        currentThreadNode[ctx.Q_STATUS] = ctx.Q_RUN_USERMODE;
     }
 
     // current CPU status
-    currentCpuNode[Q_STATUS] = Q_RUN_USERMODE;
+    currentCpuNode[ctx.Q_STATUS] = ctx.Q_RUN_USERMODE;
 
     return true;
 }
 
-bool onIrqHandlerEntry(CurrentState& state, const Event& event)
+bool onIrqHandlerEntry(Context& ctx, CurrentState& state, const Event& event)
 {
     auto& root = state.getRoot();
-    auto& currentThreadNode = getThreadsCurrentThreadNode(state, event);
-    auto& currentCpuNode = getCurrentCpuNode(state, event);
-    auto& currentIrqNode = getCurrentIrqNode(state, event);
+    auto& currentThreadNode = getThreadsCurrentThreadNode(ctx, state, event);
+    auto& currentCpuNode = getCurrentCpuNode(ctx, state, event);
+    auto& currentIrqNode = getCurrentIrqNode(ctx, state, event);
     auto& cpu = getEventCpu(event);
 
     // current IRQ's CPU
-    currentIrqNode[Q_CUR_CPU] = asUint32(cpu);
+    currentIrqNode[ctx.Q_CUR_CPU] = asUint32(cpu);
 
     if (currentThreadNode != root) {
         // current thread's status
-        currentThreadNode[Q_STATUS] = Q_INTERRUPTED;
+        currentThreadNode[ctx.Q_STATUS] = ctx.Q_INTERRUPTED;
     }
 
     // current CPU's status
-    currentCpuNode[Q_STATUS] = Q_IRQ;
+    currentCpuNode[ctx.Q_STATUS] = ctx.Q_IRQ;
 
     return true;
 }
 
-bool onIrqHandlerExit(CurrentState& state, const Event& event)
+bool onIrqHandlerExit(Context& ctx, CurrentState& state, const Event& event)
 {
     auto& root = state.getRoot();
-    auto& currentThreadNode = getThreadsCurrentThreadNode(state, event);
-    auto& currentCpuNode = getCurrentCpuNode(state, event);
-    auto& cpuCurrentThreadNode = getCpuCurrentThreadNode(state, event);
-    auto& currentIrqNode = getCurrentIrqNode(state, event);
+    auto& currentThreadNode = getThreadsCurrentThreadNode(ctx, state, event);
+    auto& currentCpuNode = getCurrentCpuNode(ctx, state, event);
+    auto& cpuCurrentThreadNode = getCpuCurrentThreadNode(ctx, state, event);
+    auto& currentIrqNode = getCurrentIrqNode(ctx, state, event);
 
     // reset current IRQ's CPU
-    currentIrqNode[Q_CUR_CPU].setNull();
+    currentIrqNode[ctx.Q_CUR_CPU].setNull();
 
     if (currentThreadNode != root) {
-        if (!currentThreadNode[Q_SYSCALL]) {
+        if (!currentThreadNode[ctx.Q_SYSCALL]) {
             // syscall not set for current thread: running in usermode
-            currentThreadNode[Q_STATUS] = Q_RUN_USERMODE;
-            currentCpuNode[Q_STATUS] = Q_RUN_USERMODE;
+            currentThreadNode[ctx.Q_STATUS] = ctx.Q_RUN_USERMODE;
+            currentCpuNode[ctx.Q_STATUS] = ctx.Q_RUN_USERMODE;
         } else {
             // syscall set for current thread: running a syscall
-            currentThreadNode[Q_STATUS] = Q_RUN_SYSCALL;
-            currentCpuNode[Q_STATUS] = Q_RUN_SYSCALL;
+            currentThreadNode[ctx.Q_STATUS] = ctx.Q_RUN_SYSCALL;
+            currentCpuNode[ctx.Q_STATUS] = ctx.Q_RUN_SYSCALL;
         }
     }
 
     if (!cpuCurrentThreadNode) {
         // no current thread for this CPU: CPU is idle
-        currentCpuNode[Q_STATUS] = Q_IDLE;
+        currentCpuNode[ctx.Q_STATUS] = ctx.Q_IDLE;
     } else if (cpuCurrentThreadNode.asSint32() == 0) {
-        currentCpuNode[Q_STATUS] = Q_IDLE;
+        currentCpuNode[ctx.Q_STATUS] = ctx.Q_IDLE;
     }
 
     return true;
 }
 
-bool onSoftIrqEntry(CurrentState& state, const Event& event)
+bool onSoftIrqEntry(Context& ctx, CurrentState& state, const Event& event)
 {
     auto& root = state.getRoot();
-    auto& currentThreadNode = getThreadsCurrentThreadNode(state, event);
-    auto& currentCpuNode = getCurrentCpuNode(state, event);
-    auto& currentSoftIrqNode = getCurrentSoftIrqNode(state, event);
+    auto& currentThreadNode = getThreadsCurrentThreadNode(ctx, state, event);
+    auto& currentCpuNode = getCurrentCpuNode(ctx, state, event);
+    auto& currentSoftIrqNode = getCurrentSoftIrqNode(ctx, state, event);
     auto& cpu = getEventCpu(event);
 
     // current soft IRQ's CPU
-    currentSoftIrqNode[Q_CUR_CPU] = asUint32(cpu);
+    currentSoftIrqNode[ctx.Q_CUR_CPU] = asUint32(cpu);
 
     // reset current soft IRQ's status
-    currentSoftIrqNode[Q_STATUS].setNull();
+    currentSoftIrqNode[ctx.Q_STATUS].setNull();
 
     if (currentThreadNode != root) {
         // current thread's status
-        currentThreadNode[Q_STATUS] = Q_INTERRUPTED;
+        currentThreadNode[ctx.Q_STATUS] = ctx.Q_INTERRUPTED;
     }
 
     // current CPU's status
-    currentCpuNode[Q_STATUS] = Q_SOFT_IRQ;
+    currentCpuNode[ctx.Q_STATUS] = ctx.Q_SOFT_IRQ;
 
     return true;
 }
 
-bool onSoftIrqExit(CurrentState& state, const Event& event)
+bool onSoftIrqExit(Context& ctx, CurrentState& state, const Event& event)
 {
     auto& root = state.getRoot();
-    auto& currentThreadNode = getThreadsCurrentThreadNode(state, event);
-    auto& currentCpuNode = getCurrentCpuNode(state, event);
-    auto& cpuCurrentThreadNode = getCpuCurrentThreadNode(state, event);
-    auto& currentSoftIrqNode = getCurrentSoftIrqNode(state, event);
+    auto& currentThreadNode = getThreadsCurrentThreadNode(ctx, state, event);
+    auto& currentCpuNode = getCurrentCpuNode(ctx, state, event);
+    auto& cpuCurrentThreadNode = getCpuCurrentThreadNode(ctx, state, event);
+    auto& currentSoftIrqNode = getCurrentSoftIrqNode(ctx, state, event);
 
     // reset current soft IRQ's CPU
-    currentSoftIrqNode[Q_CUR_CPU].setNull();
+    currentSoftIrqNode[ctx.Q_CUR_CPU].setNull();
 
     // reset current soft IRQ's status
-    currentSoftIrqNode[Q_STATUS].setNull();
+    currentSoftIrqNode[ctx.Q_STATUS].setNull();
 
     if (currentThreadNode != root) {
-        if (!currentThreadNode[Q_SYSCALL]) {
+        if (!currentThreadNode[ctx.Q_SYSCALL]) {
             // syscall not set for current thread: running in usermode
-            currentThreadNode[Q_STATUS] = Q_RUN_USERMODE;
-            currentCpuNode[Q_STATUS] = Q_RUN_USERMODE;
+            currentThreadNode[ctx.Q_STATUS] = ctx.Q_RUN_USERMODE;
+            currentCpuNode[ctx.Q_STATUS] = ctx.Q_RUN_USERMODE;
         } else {
             // syscall set for current thread: running a syscall
-            currentThreadNode[Q_STATUS] = Q_RUN_SYSCALL;
-            currentCpuNode[Q_STATUS] = Q_RUN_SYSCALL;
+            currentThreadNode[ctx.Q_STATUS] = ctx.Q_RUN_SYSCALL;
+            currentCpuNode[ctx.Q_STATUS] = ctx.Q_RUN_SYSCALL;
         }
     }
 
     if (!cpuCurrentThreadNode) {
         // no current thread for this CPU: CPU is idle
-        currentCpuNode[Q_STATUS] = Q_IDLE;
+        currentCpuNode[ctx.Q_STATUS] = ctx.Q_IDLE;
     } else if (cpuCurrentThreadNode.asSint32() == 0) {
-        currentCpuNode[Q_STATUS] = Q_IDLE;
+        currentCpuNode[ctx.Q_STATUS] = ctx.Q_IDLE;
     }
 
     return true;
 }
 
-bool onSoftIrqRaise(CurrentState& state, const Event& event)
+bool onSoftIrqRaise(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& currentSoftIrqNode = getCurrentSoftIrqNode(state, event);
+    auto& currentSoftIrqNode = getCurrentSoftIrqNode(ctx, state, event);
 
     // current soft IRQ's status: raised
-    currentSoftIrqNode[Q_STATUS] = Q_RAISED;
+    currentSoftIrqNode[ctx.Q_STATUS] = ctx.Q_RAISED;
 
     return true;
 }
 
-bool onSchedSwitch(CurrentState& state, const Event& event)
+bool onSchedSwitch(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& root = state.getRoot();
-    auto& linuxNode = getLinuxNode(state);
-    auto& prevState = event["prev_state"];
-    auto& prevTid = event["prev_tid"];
-    auto qPrevTid = getIntQ(state, prevTid.asSint());
-    auto& nextTid = event["next_tid"].asSintValue();
-    auto& nextComm = event["next_comm"];
-    auto& currentCpuNode = getCurrentCpuNode(state, event);
-    auto& threadsPrevTidStatusNode = linuxNode[Q_THREADS][qPrevTid][Q_STATUS];
+    auto& prevState = event[ctx.F_SCHED_SWITCH_PREV_STATE];
+    auto& prevTid = event[ctx.F_SCHED_SWITCH_PREV_TID];
+    auto& nextTid = event[ctx.F_SCHED_SWITCH_NEXT_TID].asSintValue();
+    auto& nextComm = event[ctx.F_SCHED_SWITCH_NEXT_COMM];
+    auto& currentCpuNode = getCurrentCpuNode(ctx, state, event);
+    auto& threadsPrevTidStatusNode = ctx.H_THREAD_STATUS.getNode(prevTid.asSint());
 
     if (prevState.asSint() == 0) {
-        threadsPrevTidStatusNode = Q_WAIT_FOR_CPU;
+        threadsPrevTidStatusNode = ctx.Q_WAIT_FOR_CPU;
     } else {
-        threadsPrevTidStatusNode = Q_WAIT_BLOCKED;
+        threadsPrevTidStatusNode = ctx.Q_WAIT_BLOCKED;
     }
 
-    auto& newCurrentThread = linuxNode[Q_THREADS][nextTid];
+    auto& newCurrentThread = ctx.H_THREAD.getNode(nextTid.getValue());
 
     // new current thread's run mode
-    if (!newCurrentThread[Q_SYSCALL]) {
-        newCurrentThread[Q_STATUS] = Q_RUN_USERMODE;
+    if (!newCurrentThread[ctx.Q_SYSCALL]) {
+        newCurrentThread[ctx.Q_STATUS] = ctx.Q_RUN_USERMODE;
     } else {
-        newCurrentThread[Q_STATUS] = Q_RUN_SYSCALL;
+        newCurrentThread[ctx.Q_STATUS] = ctx.Q_RUN_SYSCALL;
     }
 
     // thread's exec name
-    newCurrentThread[Q_EXEC_NAME] = nextComm.asArray().getString();
+    newCurrentThread[ctx.Q_EXEC_NAME] = nextComm.asArray().getString();
 
     // current CPU's current thread
-    currentCpuNode[Q_CUR_THREAD] = asSint32(nextTid);
+    currentCpuNode[ctx.Q_CUR_THREAD] = asSint32(nextTid);
 
     // current CPU's status
     if (nextTid != 0L) {
-        if (newCurrentThread[Q_SYSCALL]) {
-            currentCpuNode[Q_STATUS] = Q_RUN_SYSCALL;
+        if (newCurrentThread[ctx.Q_SYSCALL]) {
+            currentCpuNode[ctx.Q_STATUS] = ctx.Q_RUN_SYSCALL;
         } else {
-            currentCpuNode[Q_STATUS] = Q_RUN_USERMODE;
+            currentCpuNode[ctx.Q_STATUS] = ctx.Q_RUN_USERMODE;
         }
     } else {
-        currentCpuNode[Q_STATUS] = Q_IDLE;
+        currentCpuNode[ctx.Q_STATUS] = ctx.Q_IDLE;
     }
 
     return true;
 }
 
-bool onSchedProcessFork(CurrentState& state, const Event& event)
+bool onSchedProcessFork(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& linuxNode = getLinuxNode(state);
-    auto& childTid = event["child_tid"];
-    auto qChildTid = getIntQ(state, childTid.asSint());
-    auto& parentTid = event["parent_tid"].asSintValue();
-    auto qParentTid = getIntQ(state, parentTid.asSint());
-    auto& childComm = event["child_comm"].asArray();
-    auto& threadsChildTidNode = linuxNode[Q_THREADS][qChildTid];
+    auto& childTid = event[ctx.F_SCHED_PROCESS_FORK_CHILD_TID];
+    auto& parentTid = event[ctx.F_SCHED_PROCESS_FORK_PARENT_TID].asSintValue();
+    auto& childComm = event[ctx.F_SCHED_PROCESS_FORK_CHILD_COMM].asArray();
+    auto& threadsChildTidNode = ctx.H_THREAD.getNode(childTid.asSint());
 
     // child thread's parent TID
-    threadsChildTidNode[Q_PPID] = asSint32(parentTid);
+    threadsChildTidNode[ctx.Q_PPID] = asSint32(parentTid);
 
     // child thread's exec name
-    threadsChildTidNode[Q_EXEC_NAME] = childComm.getString();
+    threadsChildTidNode[ctx.Q_EXEC_NAME] = childComm.getString();
 
     // child thread's status
-    threadsChildTidNode[Q_STATUS] = Q_WAIT_FOR_CPU;
+    threadsChildTidNode[ctx.Q_STATUS] = ctx.Q_WAIT_FOR_CPU;
 
     // child thread's syscall
-    threadsChildTidNode[Q_SYSCALL] = linuxNode[Q_THREADS][qParentTid][Q_SYSCALL];
+    threadsChildTidNode[ctx.Q_SYSCALL] = ctx.H_THREAD.getNode(parentTid.getValue())[ctx.Q_SYSCALL];
 
-    if (!threadsChildTidNode[Q_SYSCALL]) {
-        threadsChildTidNode[Q_SYSCALL] = Q_SYS_CLONE;
+    if (!threadsChildTidNode[ctx.Q_SYSCALL]) {
+        threadsChildTidNode[ctx.Q_SYSCALL] = ctx.Q_SYS_CLONE;
     }
 
     return true;
 }
 
-bool onSchedProcessFree(CurrentState& state, const Event& event)
+bool onSchedProcessFree(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& linuxNode = getLinuxNode(state);
-    auto qTid = getIntQ(state, event["tid"].asSint());
+    auto& tid = event[ctx.F_SCHED_PROCESS_FREE_TID];
 
     // nullify thread subtree
-    linuxNode[Q_THREADS][qTid].setNullRecursive();
+    ctx.H_THREAD.getNode(tid.asSint()).setNullRecursive();
 
     return true;
 }
 
-bool onLttngStatedumpProcessState(CurrentState& state, const Event& event)
+bool onLttngStatedumpProcessState(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& linuxNode = getLinuxNode(state);
-    auto qTid = getIntQ(state, event["tid"].asSint());
-    auto& ppid = event["ppid"].asSintValue();
-    auto& status = event["status"].asSintValue();
-    auto& name = event["name"].asArray();
-    auto& threadsTidNode = linuxNode[Q_THREADS][qTid];
-    auto& threadsTidExecNameNode = threadsTidNode[Q_EXEC_NAME];
-    auto& threadsTidPpidNode = threadsTidNode[Q_PPID];
-    auto& threadsTidStatusNode = threadsTidNode[Q_STATUS];
+    auto& tid = event[ctx.F_STATEDUMP_PROCESS_STATE_TID];
+    auto& ppid = event[ctx.F_STATEDUMP_PROCESS_STATE_PPID].asSintValue();
+    auto& status = event[ctx.F_STATEDUMP_PROCESS_STATE_STATUS].asSintValue();
+    auto& name = event[ctx.F_STATEDUMP_PROCESS_STATE_NAME].asArray();
+    auto& threadsTidNode = ctx.H_THREAD.getNode(tid.asSint());
+    auto& threadsTidExecNameNode = threadsTidNode[ctx.Q_EXEC_NAME];
+    auto& threadsTidPpidNode = threadsTidNode[ctx.Q_PPID];
+    auto& threadsTidStatusNode = threadsTidNode[ctx.Q_STATUS];
 
     // initialize thread's exec name
     if (!threadsTidExecNameNode) {
@@ -405,106 +400,142 @@ bool onLttngStatedumpProcessState(CurrentState& state, const Event& event)
     // initialize thread's status
     if (!threadsTidStatusNode) {
         if (status == 2L) {
-            threadsTidStatusNode = Q_WAIT_FOR_CPU;
+            threadsTidStatusNode = ctx.Q_WAIT_FOR_CPU;
         } else if (status == 5L) {
-            threadsTidStatusNode = Q_WAIT_BLOCKED;
+            threadsTidStatusNode = ctx.Q_WAIT_BLOCKED;
         } else {
-            threadsTidStatusNode = Q_UNKNOWN;
+            threadsTidStatusNode = ctx.Q_UNKNOWN;
         }
     }
 
     return true;
 }
 
-bool onSchedWakeupEvent(CurrentState& state, const Event& event)
+bool onSchedWakeupEvent(Context& ctx, CurrentState& state, const Event& event)
 {
-    auto& linuxNode = getLinuxNode(state);
-    auto qTid = getIntQ(state, event["tid"].asSint());
-    auto& threadsTidStatusNode = linuxNode[Q_THREADS][qTid][Q_STATUS];
+    auto& tid = event[ctx.F_SCHED_WAKEUP_TID];
+    auto& threadsTidStatusNode = ctx.H_THREAD_STATUS.getNode(tid.asSint());
 
     if (threadsTidStatusNode.isQuark()) {
-        if (threadsTidStatusNode.asQuark() != Q_RUN_USERMODE &&
-                threadsTidStatusNode.asQuark() != Q_RUN_SYSCALL) {
-            threadsTidStatusNode = Q_WAIT_FOR_CPU;
+        if (threadsTidStatusNode.asQuark() != ctx.Q_RUN_USERMODE &&
+                threadsTidStatusNode.asQuark() != ctx.Q_RUN_SYSCALL) {
+            threadsTidStatusNode = ctx.Q_WAIT_FOR_CPU;
         }
     } else {
         // TODO: is this right?
-        threadsTidStatusNode = Q_WAIT_FOR_CPU;
+        threadsTidStatusNode = ctx.Q_WAIT_FOR_CPU;
     }
 
     return true;
 }
 
-bool onSysEvent(CurrentState& state, const Event& event)
+bool onSysEvent(Context& ctx, CurrentState& state, const Event& event)
 {
     auto& root = state.getRoot();
-    auto& currentThreadNode = getThreadsCurrentThreadNode(state, event);
-    auto& currentCpuNode = getCurrentCpuNode(state, event);
+    auto& currentThreadNode = getThreadsCurrentThreadNode(ctx, state, event);
+    auto& currentCpuNode = getCurrentCpuNode(ctx, state, event);
 
     if (currentThreadNode != root) {
-        currentThreadNode[Q_SYSCALL] = event.getName();
-        currentThreadNode[Q_STATUS] = Q_RUN_SYSCALL;
+        currentThreadNode[ctx.Q_SYSCALL] = event.getName();
+        currentThreadNode[ctx.Q_STATUS] = ctx.Q_RUN_SYSCALL;
     }
 
-    currentCpuNode[Q_STATUS] = Q_RUN_SYSCALL;
+    currentCpuNode[ctx.Q_STATUS] = ctx.Q_RUN_SYSCALL;
 
     return true;
 }
 
+// adapts an event callback to DynamicLibraryStateProvider::Adapter::OnEventContextFunc
+template<bool (*Func)(Context&, CurrentState&, const Event&)>
+bool withContext(void* context, CurrentState& state, const Event& event)
+{
+    return Func(*static_cast<Context*>(context), state, event);
+}
+
 void registerSimpleEventCallback(DynamicLibraryStateProvider::Adapter& adapter,
                                  const char* name,
-                                 const AbstractStateProvider::OnEventFunc& func)
+                                 DynamicLibraryStateProvider::Adapter::OnEventContextFunc func)
 {
     adapter.registerEventCallback("lttng-kernel", name, func);
 }
 
 void registerEventCallbacks(DynamicLibraryStateProvider::Adapter& adapter)
 {
-    registerSimpleEventCallback(adapter, "exit_syscall", onExitSyscall);
-    registerSimpleEventCallback(adapter, "irq_handler_entry", onIrqHandlerEntry);
-    registerSimpleEventCallback(adapter, "irq_handler_exit", onIrqHandlerExit);
-    registerSimpleEventCallback(adapter, "softirq_entry", onSoftIrqEntry);
-    registerSimpleEventCallback(adapter, "softirq_exit", onSoftIrqExit);
-    registerSimpleEventCallback(adapter, "softirq_raise", onSoftIrqRaise);
-    registerSimpleEventCallback(adapter, "sched_switch", onSchedSwitch);
-    registerSimpleEventCallback(adapter, "sched_process_fork", onSchedProcessFork);
-    registerSimpleEventCallback(adapter, "sched_process_free", onSchedProcessFree);
-    registerSimpleEventCallback(adapter, "lttng_statedump_process_state", onLttngStatedumpProcessState);
-    adapter.registerEventCallbackRegex("^lttng-kernel$", "^sched_wakeup", onSchedWakeupEvent);
-    adapter.registerEventCallbackRegex("^lttng-kernel$", "^sys_", onSysEvent);
-    adapter.registerEventCallbackRegex("^lttng-kernel$", "^compat_sys_", onSysEvent);
+    registerSimpleEventCallback(adapter, "exit_syscall", withContext<onExitSyscall>);
+    registerSimpleEventCallback(adapter, "irq_handler_entry", withContext<onIrqHandlerEntry>);
+    registerSimpleEventCallback(adapter, "irq_handler_exit", withContext<onIrqHandlerExit>);
+    registerSimpleEventCallback(adapter, "softirq_entry", withContext<onSoftIrqEntry>);
+    registerSimpleEventCallback(adapter, "softirq_exit", withContext<onSoftIrqExit>);
+    registerSimpleEventCallback(adapter, "softirq_raise", withContext<onSoftIrqRaise>);
+    registerSimpleEventCallback(adapter, "sched_switch", withContext<onSchedSwitch>);
+    registerSimpleEventCallback(adapter, "sched_process_fork", withContext<onSchedProcessFork>);
+    registerSimpleEventCallback(adapter, "sched_process_free", withContext<onSchedProcessFree>);
+    registerSimpleEventCallback(adapter, "lttng_statedump_process_state", withContext<onLttngStatedumpProcessState>);
+    adapter.registerEventCallbackRegex("^lttng-kernel$", "^sched_wakeup", withContext<onSchedWakeupEvent>);
+    adapter.registerEventCallbackRegex("^lttng-kernel$", "^sys_", withContext<onSysEvent>);
+    adapter.registerEventCallbackRegex("^lttng-kernel$", "^compat_sys_", withContext<onSysEvent>);
 }
 
-void getConstantQuarks(CurrentState& state)
+void getConstantQuarks(Context& ctx, CurrentState& state)
 {
-    Q_LINUX = state.getQuark("linux");
-    Q_THREADS = state.getQuark("threads");
-    Q_CPUS = state.getQuark("cpus");
-    Q_CUR_CPU = state.getQuark("cur-cpu");
-    Q_CUR_THREAD = state.getQuark("cur-thread");
-    Q_RESOURCES = state.getQuark("resources");
-    Q_IRQS = state.getQuark("irqs");
-    Q_SOFT_IRQS = state.getQuark("soft-irqs");
-    Q_SYSCALL = state.getQuark("syscall");
-    Q_STATUS = state.getQuark("status");
-    Q_PPID = state.getQuark("ppid");
-    Q_EXEC_NAME = state.getQuark("exec-name");
-    Q_IDLE = state.getQuark("idle");
-    Q_RUN_USERMODE = state.getQuark("usermode");
-    Q_RUN_SYSCALL = state.getQuark("syscall");
-    Q_IRQ = state.getQuark("irq");
-    Q_SOFT_IRQ = state.getQuark("soft-irq");
-    Q_UNKNOWN = state.getQuark("unknown");
-    Q_WAIT_BLOCKED = state.getQuark("wait-blocked");
-    Q_INTERRUPTED = state.getQuark("interrupted");
-    Q_WAIT_FOR_CPU = state.getQuark("wait-for-cpu");
-    Q_RAISED = state.getQuark("raised");
-    Q_SYS_CLONE = state.getQuark("sys_clone");
-
-    // 0 to 65535 integers
-    for (int x = 0; x < 65536; ++x) {
-        Q_INT[x] = state.getQuark(std::to_string(x));
-    }
+    ctx.Q_CUR_CPU = state.getQuark("cur-cpu");
+    ctx.Q_CUR_THREAD = state.getQuark("cur-thread");
+    ctx.Q_SYSCALL = state.getQuark("syscall");
+    ctx.Q_STATUS = state.getQuark("status");
+    ctx.Q_PPID = state.getQuark("ppid");
+    ctx.Q_EXEC_NAME = state.getQuark("exec-name");
+    ctx.Q_IDLE = state.getQuark("idle");
+    ctx.Q_RUN_USERMODE = state.getQuark("usermode");
+    ctx.Q_RUN_SYSCALL = state.getQuark("syscall");
+    ctx.Q_IRQ = state.getQuark("irq");
+    ctx.Q_SOFT_IRQ = state.getQuark("soft-irq");
+    ctx.Q_UNKNOWN = state.getQuark("unknown");
+    ctx.Q_WAIT_BLOCKED = state.getQuark("wait-blocked");
+    ctx.Q_INTERRUPTED = state.getQuark("interrupted");
+    ctx.Q_WAIT_FOR_CPU = state.getQuark("wait-for-cpu");
+    ctx.Q_RAISED = state.getQuark("raised");
+    ctx.Q_SYS_CLONE = state.getQuark("sys_clone");
+}
+
+void compilePathHandles(Context& ctx, CurrentState& state)
+{
+    ctx.H_CPU = state.compilePath("linux/cpus/{int}");
+    ctx.H_CPU_CUR_THREAD = state.compilePath("linux/cpus/{int}/cur-thread");
+    ctx.H_THREAD = state.compilePath("linux/threads/{int}");
+    ctx.H_THREAD_STATUS = state.compilePath("linux/threads/{int}/status");
+    ctx.H_IRQ = state.compilePath("linux/resources/irqs/{int}");
+    ctx.H_SOFT_IRQ = state.compilePath("linux/resources/soft-irqs/{int}");
+}
+
+void getFieldHandles(Context& ctx, const TraceSet* traceSet)
+{
+    ctx.F_IRQ = FieldHandle {
+        traceSet,
+        std::vector<std::string> {"irq_handler_entry", "irq_handler_exit"},
+        "irq"
+    };
+    ctx.F_VEC = FieldHandle {
+        traceSet,
+        std::vector<std::string> {"softirq_entry", "softirq_exit", "softirq_raise"},
+        "vec"
+    };
+    ctx.F_SCHED_SWITCH_PREV_STATE = FieldHandle {traceSet, "sched_switch", "prev_state"};
+    ctx.F_SCHED_SWITCH_PREV_TID = FieldHandle {traceSet, "sched_switch", "prev_tid"};
+    ctx.F_SCHED_SWITCH_NEXT_TID = FieldHandle {traceSet, "sched_switch", "next_tid"};
+    ctx.F_SCHED_SWITCH_NEXT_COMM = FieldHandle {traceSet, "sched_switch", "next_comm"};
+    ctx.F_SCHED_PROCESS_FORK_CHILD_TID = FieldHandle {traceSet, "sched_process_fork", "child_tid"};
+    ctx.F_SCHED_PROCESS_FORK_PARENT_TID = FieldHandle {traceSet, "sched_process_fork", "parent_tid"};
+    ctx.F_SCHED_PROCESS_FORK_CHILD_COMM = FieldHandle {traceSet, "sched_process_fork", "child_comm"};
+    ctx.F_SCHED_PROCESS_FREE_TID = FieldHandle {traceSet, "sched_process_free", "tid"};
+    ctx.F_STATEDUMP_PROCESS_STATE_TID = FieldHandle {traceSet, "lttng_statedump_process_state", "tid"};
+    ctx.F_STATEDUMP_PROCESS_STATE_PPID = FieldHandle {traceSet, "lttng_statedump_process_state", "ppid"};
+    ctx.F_STATEDUMP_PROCESS_STATE_STATUS = FieldHandle {traceSet, "lttng_statedump_process_state", "status"};
+    ctx.F_STATEDUMP_PROCESS_STATE_NAME = FieldHandle {traceSet, "lttng_statedump_process_state", "name"};
+    ctx.F_SCHED_WAKEUP_TID = FieldHandle {
+        traceSet,
+        std::vector<std::string> {"sched_wakeup", "sched_wakeup_new"},
+        "tid"
+    };
 }
 
 }
@@ -524,12 +555,24 @@ extern "C" void onInit(CurrentState& state,
         std::cout << "    " << keyValuePair.first << " = " << keyValuePair.second << std::endl;
     }
 
-    // register events callbacks
-    registerEventCallbacks(adapter);
+    // this instance's context (freed by onFiniContext())
+    std::unique_ptr<Context> ctx {new Context};
 
     // get a few known quarks
-    getConstantQuarks(state);
+    getConstantQuarks(*ctx, state);
+
+    // compile paths of frequently accessed nodes
+    compilePathHandles(*ctx, state);
 
     // get indexes of interesting event fields
-    // TODO
+    getFieldHandles(*ctx, traceSet);
+
+    // hand the context over to the provider, then register events callbacks
+    adapter.setContext(ctx.release());
+    registerEventCallbacks(adapter);
+}
+
+extern "C" void onFiniContext(CurrentState& state, void* context)
+{
+    delete static_cast<Context*>(context);
 }
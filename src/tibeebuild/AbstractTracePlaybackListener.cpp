@@ -24,4 +24,17 @@ AbstractTracePlaybackListener::~AbstractTracePlaybackListener()
 {
 }
 
+bool AbstractTracePlaybackListener::addSubscribedEventsImpl(common::EventFilter& filter) const
+{
+    // all events by default
+    return false;
+}
+
+void AbstractTracePlaybackListener::onEventsImpl(const common::EventBatch& batch)
+{
+    for (std::size_t x = 0; x < batch.size(); ++x) {
+        this->onEventImpl(batch[x]);
+    }
+}
+
 }
@@ -22,6 +22,8 @@
 
 #include <common/trace/TraceSet.hpp>
 #include <common/trace/Event.hpp>
+#include <common/trace/EventBatch.hpp>
+#include <common/trace/EventFilter.hpp>
 
 namespace tibee
 {
@@ -32,6 +34,11 @@ namespace tibee
  * This is a simple interface which gets notified when beginning the
  * playback of a trace, on each event, and at the end.
  *
+ * Events are delivered in batches (see onEvents()). Simple listeners
+ * only need to implement onEventImpl(), which is called for each
+ * event of a batch by default; listeners which need to process many
+ * events in a tight loop may override onEventsImpl().
+ *
  * @author Philippe Proulx
  */
 class AbstractTracePlaybackListener
@@ -57,6 +64,22 @@ public:
         return this->onStartImpl(traceSet);
     }
 
+    /**
+     * Adds the events this listener needs to \p filter.
+     *
+     * Called after onStart(). If all listeners of a playback return
+     * true, other events are skipped by the trace set decoder and never
+     * notified.
+     *
+     * @param filter Event filter to which to add needed events
+     * @returns      True if \p filter was updated, or false if this
+     *               listener needs all events
+     */
+    bool addSubscribedEvents(common::EventFilter& filter) const
+    {
+        return this->addSubscribedEventsImpl(filter);
+    }
+
     /**
      * New event notification.
      *
@@ -67,6 +90,19 @@ public:
         this->onEventImpl(event);
     }
 
+    /**
+     * New event batch notification.
+     *
+     * The events of \p batch are in playback order and remain valid
+     * until this method returns.
+     *
+     * @param batch New event batch
+     */
+    void onEvents(const common::EventBatch& batch)
+    {
+        this->onEventsImpl(batch);
+    }
+
     /**
      * Playback stop notification.
      *
@@ -80,7 +116,9 @@ public:
 private:
     virtual bool onStartImpl(const common::TraceSet* traceSet) = 0;
     virtual void onEventImpl(const common::Event& event) = 0;
+    virtual void onEventsImpl(const common::EventBatch& batch);
     virtual bool onStopImpl() = 0;
+    virtual bool addSubscribedEventsImpl(common::EventFilter& filter) const;
 };
 
 }
@@ -20,6 +20,9 @@
 
 #include <vector>
 #include <string>
+#include <cstddef>
+
+#include <common/BasicTypes.hpp>
 
 namespace tibee
 {
@@ -36,6 +39,19 @@ struct Arguments
     std::vector<std::string> stateProvidersParams;
     std::string bindProgress;
     std::string dbDir;
+    std::vector<std::string> cacheEvents;
+    std::size_t jobs;
+    common::timestamp_t begin;
+    common::timestamp_t end;
+    bool native;
+    bool replay;
+    bool coalesce;
+    bool queryable;
+    std::size_t checkpointEvents;
+    common::timestamp_t checkpointPeriod;
+    bool resume;
+    std::size_t resumePointEvents;
+    bool profile;
     bool verbose;
     bool force;
 };
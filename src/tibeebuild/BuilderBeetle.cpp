@@ -15,6 +15,10 @@
  * You should have received a copy of the GNU General Public License
  * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <limits>
 #include <memory>
 #include <string>
 #include <set>
@@ -24,10 +28,14 @@
 #include <boost/regex.hpp>
 
 #include <common/trace/TraceSet.hpp>
+#include <common/trace/EventCacheReader.hpp>
+#include <common/state/StateResumePoint.hpp>
 #include <common/stateprov/StateProviderConfig.hpp>
 #include <common/utils/print.hpp>
+#include <common/ex/TraceSet.hpp>
 #include <common/ex/WrongStateProvider.hpp>
 #include "StateHistoryBuilder.hpp"
+#include "EventCacheBuilder.hpp"
 #include "ProgressPublisher.hpp"
 #include "TraceDeck.hpp"
 #include "Arguments.hpp"
@@ -80,16 +88,24 @@ void BuilderBeetle::validateSaveArguments(const Arguments& args)
         _dbDir = args.dbDir;
     }
 
-    // make sure the database directory doesn't exist, unless force is enabled
-    if (!args.force && bfs::exists(_dbDir)) {
+    /* An existing database directory is fine when replaying or resuming
+     * it, or when it only holds caches (trace informations, packet
+     * indexes, events) to reuse: only overwriting an existing state
+     * history needs force.
+     */
+    bool reuseDbDir = args.resume || args.replay ||
+                      (bfs::is_directory(_dbDir) &&
+                       !bfs::exists(_dbDir / "state-nodes.json"));
+
+    if (!args.force && !reuseDbDir && bfs::exists(_dbDir)) {
         std::stringstream ss;
 
         ss << "the specified database directory " <<
-              _dbDir << " exists already" << std::endl <<
+              _dbDir << " holds a state history already" << std::endl <<
               "  (use -f to overwrite files)";
 
         throw ex::InvalidArgument {ss.str()};
-    } else if (args.force && bfs::exists(_dbDir) && !bfs::is_directory(_dbDir)) {
+    } else if (bfs::exists(_dbDir) && !bfs::is_directory(_dbDir)) {
         std::stringstream ss;
 
         ss << "the specified database directory " <<
@@ -199,6 +215,97 @@ void BuilderBeetle::validateSaveArguments(const Arguments& args)
     // bind address for progress publishing
     _bindProgress = args.bindProgress;
 
+    // number of decoding threads
+    _jobs = args.jobs;
+
+    // time range
+    _begin = args.begin;
+    _end = args.end;
+
+    // native decoding
+    _native = args.native;
+
+    // state history options
+    _stateHistoryOptions.coalesce = args.coalesce;
+    _stateHistoryOptions.queryable = args.queryable;
+    _stateHistoryOptions.checkpointEvents = args.checkpointEvents;
+    _stateHistoryOptions.checkpointPeriod = args.checkpointPeriod;
+    _stateHistoryOptions.resumePointEvents = args.resumePointEvents;
+    _stateHistoryOptions.resume = args.resume;
+
+    /* Profiling slows down state providers (no direct context
+     * callbacks): only when asked for or reported verbosely.
+     */
+    _stateHistoryOptions.profile = args.verbose || args.profile;
+
+    if (args.resume) {
+        if (_stateProviders.empty()) {
+            throw ex::InvalidArgument {
+                "cannot resume a build without state providers"
+            };
+        }
+
+        if (!args.cacheEvents.empty()) {
+            throw ex::InvalidArgument {
+                "cannot write an event cache while resuming a build"
+            };
+        }
+
+        // all the events up to the resume point were already processed
+        auto resumePointPath = StateHistoryBuilder::getResumePointPath(_dbDir);
+        common::timestamp_t resumeTs;
+        std::uint64_t fingerprint;
+
+        if (!common::StateResumePoint::readHeader(resumePointPath, resumeTs,
+                                                  fingerprint)) {
+            std::stringstream ss;
+
+            ss << "no resume point in " << resumePointPath << std::endl <<
+                  "  (build with --resume-events first)";
+
+            throw ex::InvalidArgument {ss.str()};
+        }
+
+        // same providers, same parameters, same options
+        if (fingerprint != StateHistoryBuilder::getFingerprint(_stateProviders,
+                                                               _stateHistoryOptions)) {
+            throw ex::InvalidArgument {
+                "state providers or options differ from the resumed build"
+            };
+        }
+
+        if (resumeTs >= _end) {
+            throw ex::InvalidArgument {
+                "resume point is past the end timestamp"
+            };
+        }
+
+        _begin = std::max(_begin, resumeTs + 1);
+    }
+
+    // event cache
+    _cacheEvents = args.cacheEvents;
+    _replay = args.replay;
+
+    if (_replay) {
+        if (!_cacheEvents.empty()) {
+            throw ex::InvalidArgument {
+                "cannot write an event cache while replaying one"
+            };
+        }
+
+        auto eventCacheDir = EventCacheBuilder::getEventCacheDir(_dbDir);
+
+        if (!common::EventCacheReader::exists(eventCacheDir)) {
+            std::stringstream ss;
+
+            ss << "no complete event cache in " << eventCacheDir << std::endl <<
+                  "  (build one first using -e)";
+
+            throw ex::InvalidArgument {ss.str()};
+        }
+    }
+
     // verbose
     _verbose = args.verbose;
 }
@@ -272,6 +379,38 @@ bool BuilderBeetle::run()
     // create a trace set
     std::unique_ptr<common::TraceSet> traceSet {new common::TraceSet};
 
+    // decode trace streams in parallel if asked to
+    if (_jobs > 1) {
+        if (_verbose) {
+            tbmsg(THIS_MODULE) << "decoding with up to " << _jobs <<
+                                  " threads" << tbendl();
+        }
+
+        traceSet->setParallelDecoding(_jobs);
+    }
+
+    // decode CTF streams without Babeltrace if asked to
+    if (_native) {
+        if (_verbose) {
+            tbmsg(THIS_MODULE) << "decoding natively when possible" << tbendl();
+        }
+
+        traceSet->setNativeDecoding(true);
+    }
+
+    // only play the asked time range
+    if (_begin > 0 || _end < std::numeric_limits<common::timestamp_t>::max()) {
+        if (_verbose) {
+            tbmsg(THIS_MODULE) << "limiting build to [" << _begin << ", " <<
+                                  _end << "]" << tbendl();
+        }
+
+        traceSet->setRange(_begin, _end);
+    }
+
+    // reuse trace informations of already seen metadata
+    traceSet->setTraceInfosCacheDir(_dbDir / "trace-infos");
+
     // add traces to trace set
     for (const auto& tracePath : _tracesPaths) {
         if (_verbose) {
@@ -287,6 +426,46 @@ bool BuilderBeetle::run()
         }
     }
 
+    // replay cached events instead of decoding
+    if (_replay) {
+        auto eventCacheDir = EventCacheBuilder::getEventCacheDir(_dbDir);
+
+        if (_verbose) {
+            tbmsg(THIS_MODULE) << "replaying events of " << eventCacheDir <<
+                                  tbendl();
+        }
+
+        traceSet->setEventCacheDir(eventCacheDir);
+    }
+
+    /* Load or build packet indexes (bounds, seeking and event count).
+     *
+     * Building them visits the whole trace set once before the
+     * playback, so only do it when they pay off: to let the native
+     * decoder jump to the first packet of the range, or to publish the
+     * total number of events with the progress. Replayed events never
+     * come from packets.
+     */
+    auto packetIndexDir = _dbDir / "packet-index";
+
+    if (!_replay && (_native || !_bindProgress.empty())) {
+        auto beginTime = std::chrono::steady_clock::now();
+        bool hasPacketIndexes = traceSet->usePacketIndexes(packetIndexDir);
+        auto elapsedTime = std::chrono::steady_clock::now() - beginTime;
+        auto elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(elapsedTime).count();
+
+        if (_verbose && hasPacketIndexes) {
+            tbmsg(THIS_MODULE) << "using packet indexes in " <<
+                                  packetIndexDir << " (" <<
+                                  traceSet->getEventCount() << " events, " <<
+                                  elapsedMs << " ms)" << tbendl();
+        } else if (_verbose) {
+            tbmsg(THIS_MODULE) << "packet indexes not available" << tbendl();
+        }
+    } else if (_verbose) {
+        tbmsg(THIS_MODULE) << "not using packet indexes" << tbendl();
+    }
+
     // create a list of trace listeners
     std::vector<AbstractTracePlaybackListener::UP> listeners;
 
@@ -301,7 +480,8 @@ bool BuilderBeetle::run()
             stateHistoryBuilder = std::unique_ptr<StateHistoryBuilder> {
                 new StateHistoryBuilder {
                     _dbDir,
-                    _stateProviders
+                    _stateProviders,
+                    _stateHistoryOptions
                 }
             };
         } catch (const common::ex::WrongStateProvider& ex) {
@@ -333,6 +513,19 @@ bool BuilderBeetle::run()
         listeners.push_back(std::move(stateHistoryBuilder));
     }
 
+    // create an event cache builder
+    if (!_cacheEvents.empty()) {
+        if (_verbose) {
+            tbmsg(THIS_MODULE) << "writing event cache in " <<
+                                  EventCacheBuilder::getEventCacheDir(_dbDir) <<
+                                  tbendl();
+        }
+
+        listeners.push_back(AbstractTracePlaybackListener::UP {
+            new EventCacheBuilder {_dbDir, _cacheEvents}
+        });
+    }
+
     // create a progress publisher
     if (!_bindProgress.empty()) {
         std::unique_ptr<ProgressPublisher> progressPublisher;
@@ -343,6 +536,7 @@ bool BuilderBeetle::run()
                     _bindProgress,
                     traceSet->getBegin(),
                     traceSet->getEnd(),
+                    traceSet->getEventCount(),
                     _tracesPaths,
                     _stateProviders,
                     shbPtr,
@@ -366,7 +560,28 @@ bool BuilderBeetle::run()
         tbmsg(THIS_MODULE) << "starting trace playback" << tbendl();
     }
 
-    return _traceDeck.play(traceSet.get(), listeners);
+    bool ret;
+
+    try {
+        ret = _traceDeck.play(traceSet.get(), listeners);
+    } catch (const common::ex::TraceSet& ex) {
+        // e.g. replaying events which were not cached
+        throw ex::BuilderBeetleError {ex.what()};
+    }
+
+    // report where state providers spent their time
+    if (_verbose && shbPtr) {
+        for (const auto& profile : shbPtr->getCallbackProfiles()) {
+            tbmsg(THIS_MODULE) << profile.provider << ": " <<
+                                  profile.eventName << ": " <<
+                                  profile.calls << " calls, " <<
+                                  profile.timeNs / 1000 << " us, " <<
+                                  profile.stateChanges << " state changes" <<
+                                  tbendl();
+        }
+    }
+
+    return ret;
 }
 
 void BuilderBeetle::stop()
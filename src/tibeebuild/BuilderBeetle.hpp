@@ -65,6 +65,13 @@ private:
     std::vector<common::StateProviderConfig> _stateProviders;
     std::string _bindProgress;
     boost::filesystem::path _dbDir;
+    std::size_t _jobs;
+    common::timestamp_t _begin;
+    common::timestamp_t _end;
+    bool _native;
+    std::vector<std::string> _cacheEvents;
+    bool _replay;
+    StateHistoryBuilder::Options _stateHistoryOptions;
     bool _verbose;
 };
 
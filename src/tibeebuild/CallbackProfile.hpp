@@ -0,0 +1,53 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _CALLBACKPROFILE_HPP
+#define _CALLBACKPROFILE_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace tibee
+{
+
+/**
+ * Profile of the event callback of a state provider for one event
+ * type, as measured during a state history build.
+ *
+ * @author Philippe Proulx
+ */
+struct CallbackProfile
+{
+    // state provider instance name, or state provider name if none
+    std::string provider;
+
+    // event name
+    std::string eventName;
+
+    // number of calls
+    std::uint64_t calls;
+
+    // cumulative time spent in the callback (ns)
+    std::uint64_t timeNs;
+
+    // number of state changes made by the callback
+    std::uint64_t stateChanges;
+};
+
+}
+
+#endif // _CALLBACKPROFILE_HPP
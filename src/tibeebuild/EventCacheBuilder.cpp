@@ -0,0 +1,128 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <algorithm>
+#include <memory>
+#include <boost/filesystem/path.hpp>
+
+#include <common/trace/EventBatch.hpp>
+#include "EventCacheBuilder.hpp"
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+
+const char* const EventCacheBuilder::ALL_EVENTS = "*";
+
+EventCacheBuilder::EventCacheBuilder(const bfs::path& dbDir,
+                                     const std::vector<std::string>& eventNames) :
+    AbstractCacheBuilder {dbDir},
+    _eventNames {eventNames}
+{
+}
+
+EventCacheBuilder::~EventCacheBuilder()
+{
+}
+
+bfs::path EventCacheBuilder::getEventCacheDir(const bfs::path& dbDir)
+{
+    return dbDir / "event-cache";
+}
+
+std::uint64_t EventCacheBuilder::getEventCount() const
+{
+    if (_writer) {
+        return _writer->getEventCount();
+    }
+
+    return 0;
+}
+
+bool EventCacheBuilder::onStartImpl(const common::TraceSet* traceSet)
+{
+    // resolve event names for all traces
+    auto allEvents = std::find(_eventNames.begin(), _eventNames.end(),
+                               ALL_EVENTS) != _eventNames.end();
+
+    _filter = nullptr;
+
+    if (!allEvents) {
+        _filter = std::unique_ptr<common::EventFilter> {new common::EventFilter};
+
+        for (const auto& traceInfos : traceSet->getTracesInfos()) {
+            for (const auto& eventName : _eventNames) {
+                auto it = traceInfos->getEventMap()->find(eventName);
+
+                if (it != traceInfos->getEventMap()->end()) {
+                    _filter->add(traceInfos->getId(), it->second->getId());
+                }
+            }
+        }
+    }
+
+    // create new writer (removing the previous cache)
+    _writer = std::unique_ptr<common::EventCacheWriter> {
+        new common::EventCacheWriter {
+            EventCacheBuilder::getEventCacheDir(this->getCacheDir()),
+            *traceSet,
+            _filter.get()
+        }
+    };
+
+    return true;
+}
+
+void EventCacheBuilder::onEventImpl(const common::Event& event)
+{
+    // other listeners may need more events than we do
+    if (_filter && !_filter->accepts(event.getTraceId(), event.getId())) {
+        return;
+    }
+
+    _writer->append(event);
+}
+
+void EventCacheBuilder::onEventsImpl(const common::EventBatch& batch)
+{
+    for (std::size_t x = 0; x < batch.size(); ++x) {
+        this->onEventImpl(batch[x]);
+    }
+}
+
+bool EventCacheBuilder::onStopImpl()
+{
+    // complete the cache
+    _writer->close();
+
+    return true;
+}
+
+bool EventCacheBuilder::addSubscribedEventsImpl(common::EventFilter& filter) const
+{
+    if (!_filter) {
+        // we need all events
+        return false;
+    }
+
+    filter.merge(*_filter);
+
+    return true;
+}
+
+}
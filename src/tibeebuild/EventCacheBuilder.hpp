@@ -0,0 +1,98 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _EVENTCACHEBUILDER_HPP
+#define _EVENTCACHEBUILDER_HPP
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/EventCacheWriter.hpp>
+#include "AbstractCacheBuilder.hpp"
+
+namespace tibee
+{
+
+/**
+ * Event cache builder.
+ *
+ * An instance of this class writes selected events to a columnar
+ * event cache (see common::EventCacheWriter) during a trace playback,
+ * so that they may be replayed later without decoding the traces.
+ *
+ * @author Philippe Proulx
+ */
+class EventCacheBuilder :
+    public AbstractCacheBuilder
+{
+public:
+    /// Event name selecting all events
+    static const char* const ALL_EVENTS;
+
+    /**
+     * Builds an event cache builder.
+     *
+     * @param dbDir      Database directory (the cache is written in
+     *                   its "event-cache" subdirectory)
+     * @param eventNames Names of the events to cache, or
+     *                   EventCacheBuilder::ALL_EVENTS
+     */
+    EventCacheBuilder(const boost::filesystem::path& dbDir,
+                      const std::vector<std::string>& eventNames);
+
+    ~EventCacheBuilder();
+
+    /**
+     * Returns the directory of the event cache of database directory
+     * \p dbDir.
+     *
+     * @param dbDir Database directory
+     * @returns     Event cache directory
+     */
+    static boost::filesystem::path getEventCacheDir(const boost::filesystem::path& dbDir);
+
+    /**
+     * Returns the number of cached events so far.
+     *
+     * @returns Number of cached events
+     */
+    std::uint64_t getEventCount() const;
+
+private:
+    bool onStartImpl(const common::TraceSet* traceSet);
+    void onEventImpl(const common::Event& event);
+    void onEventsImpl(const common::EventBatch& batch);
+    bool onStopImpl();
+    bool addSubscribedEventsImpl(common::EventFilter& filter) const;
+
+private:
+    std::vector<std::string> _eventNames;
+
+    // cached events (null: all events)
+    std::unique_ptr<common::EventFilter> _filter;
+
+    std::unique_ptr<common::EventCacheWriter> _writer;
+};
+
+}
+
+#endif // _EVENTCACHEBUILDER_HPP
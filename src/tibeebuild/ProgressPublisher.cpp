@@ -32,6 +32,7 @@ namespace tibee
 
 ProgressPublisher::ProgressPublisher(const std::string& bindAddr,
                                      common::timestamp_t beginTs, common::timestamp_t endTs,
+                                     std::uint64_t totalEvents,
                                      const std::vector<boost::filesystem::path>& tracesPaths,
                                      const std::vector<common::StateProviderConfig>& stateProviders,
                                      const StateHistoryBuilder* stateHistoryBuilder,
@@ -39,6 +40,7 @@ ProgressPublisher::ProgressPublisher(const std::string& bindAddr,
                                      std::size_t updatePeriodMs) :
     _bindAddr {bindAddr},
     _evCount {0},
+    _traceSet {nullptr},
     _rpcMessageEncoder {new BuilderJsonRpcMessageEncoder},
     _rpcNotification {new ProgressUpdateRpcNotification},
     _stateHistoryBuilder {stateHistoryBuilder},
@@ -51,6 +53,7 @@ ProgressPublisher::ProgressPublisher(const std::string& bindAddr,
     _rpcNotification->setBeginTs(beginTs);
     _rpcNotification->setCurTs(beginTs);
     _rpcNotification->setEndTs(endTs);
+    _rpcNotification->setTotalEvents(totalEvents);
     _rpcNotification->setTracesPaths(tracesPaths);
     _rpcNotification->setStateProviders(stateProviders);
     _rpcNotification->setStateChanges(0);
@@ -84,6 +87,7 @@ bool ProgressPublisher::onStartImpl(const common::TraceSet* traceSet)
     _startTime = _lastTime;
 
     // initial publication
+    _traceSet = traceSet;
     _evCount = 0;
     _tmpEvCounter = 0;
     _lastTs = _rpcNotification->getBeginTs();
@@ -117,14 +121,69 @@ void ProgressPublisher::onEventImpl(const common::Event& event)
     }
 }
 
+void ProgressPublisher::onEventsImpl(const common::EventBatch& batch)
+{
+    if (batch.empty()) {
+        return;
+    }
+
+    // increase event count
+    _evCount += batch.size();
+
+    // update?
+    _tmpEvCounter += batch.size();
+
+    if (_tmpEvCounter > _updatePeriodEvents) {
+        // reset temporary counter
+        _tmpEvCounter = 0;
+
+        // really update?
+        bptime::ptime curTime {bptime::microsec_clock::local_time()};
+
+        if (curTime - _lastTime > bptime::milliseconds(_updatePeriodMs)) {
+            // publish now
+            _lastTs = batch.back().getTimestamp();
+            this->publish();
+
+            // update last time
+            _lastTime = curTime;
+        }
+    }
+}
+
+bool ProgressPublisher::addSubscribedEventsImpl(common::EventFilter& filter) const
+{
+    /* We only count delivered events and follow their timestamps: we
+     * don't need any specific one.
+     */
+    return true;
+}
+
 void ProgressPublisher::publish()
 {
     // update RPC notification object
     _rpcNotification->setCurTs(_lastTs);
-    _rpcNotification->setProcessedEvents(_evCount);
+
+    /* The total number of events counts all the events of the trace
+     * set, while we only get the ones some listener subscribed to: when
+     * the total is known, also count the events the decoders skipped
+     * so far, so that both numbers meet at the end.
+     */
+    std::uint64_t processedEvents = _evCount;
+
+    if (_traceSet && _evCount > 0 && _rpcNotification->getTotalEvents() > 0) {
+        processedEvents = _traceSet->getEventCount(_lastTs);
+    }
+
+    _rpcNotification->setProcessedEvents(processedEvents);
 
     if (_stateHistoryBuilder) {
         _rpcNotification->setStateChanges(_stateHistoryBuilder->getStateChanges());
+
+        // collecting and sorting profiles is not free
+        if (_stateHistoryBuilder->isProfiling()) {
+            _rpcNotification->setCallbackProfiles(_stateHistoryBuilder->getCallbackProfiles());
+        }
     }
 
     bptime::ptime curTime {bptime::microsec_clock::local_time()};
@@ -148,6 +207,7 @@ bool ProgressPublisher::onStopImpl()
     // publish one last time
     _lastTs = _rpcNotification->getEndTs();
     this->publish();
+    _traceSet = nullptr;
 
     return true;
 }
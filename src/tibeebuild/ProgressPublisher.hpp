@@ -18,6 +18,7 @@
 #ifndef _PROGRESSPUBLISHER_HPP
 #define _PROGRESSPUBLISHER_HPP
 
+#include <cstdint>
 #include <memory>
 #include <string>
 #include <boost/filesystem/path.hpp>
@@ -56,6 +57,8 @@ public:
      * @param bindAddr            Bind address for publishing progress
      * @param beginTs             Begin timestamp of trace set
      * @param endTs               End timestamp of trace set
+     * @param totalEvents         Total number of events to process, or
+     *                            0 if unknown
      * @param tracesPaths         Paths of all traces
      * @param stateProviders      Descriptors of all state providers
      * @param stateHistoryBuilder State history builder reference
@@ -64,6 +67,7 @@ public:
      */
     ProgressPublisher(const std::string& bindAddr,
                       common::timestamp_t beginTs, common::timestamp_t endTs,
+                      std::uint64_t totalEvents,
                       const std::vector<boost::filesystem::path>& tracesPaths,
                       const std::vector<common::StateProviderConfig>& stateProviders,
                       const StateHistoryBuilder* stateHistoryBuilder,
@@ -75,7 +79,9 @@ public:
 protected:
     bool onStartImpl(const common::TraceSet* traceSet);
     void onEventImpl(const common::Event& event);
+    void onEventsImpl(const common::EventBatch& batch);
     bool onStopImpl();
+    bool addSubscribedEventsImpl(common::EventFilter& filter) const;
     void publish();
 
 private:
@@ -85,6 +91,9 @@ private:
     // number of processed events so far
     std::size_t _evCount;
 
+    // played trace set (between onStart() and onStop())
+    const common::TraceSet* _traceSet;
+
     // RPC message encoder
     std::unique_ptr<BuilderJsonRpcMessageEncoder> _rpcMessageEncoder;
 
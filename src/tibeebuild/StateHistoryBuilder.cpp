@@ -15,17 +15,28 @@
  * You should have received a copy of the GNU General Public License
  * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
  */
+#include <algorithm>
+#include <chrono>
 #include <iostream>
 #include <memory>
-#include <boost/filesystem/path.hpp>
+#include <string>
+#include <utility>
+#include <boost/filesystem.hpp>
 
 #include <common/trace/EventValueType.hpp>
 #include <common/trace/AbstractEventValue.hpp>
 #include <common/stateprov/AbstractStateProvider.hpp>
 #include <common/stateprov/DynamicLibraryStateProvider.hpp>
+#ifdef TIBEE_WITH_PYTHON
 #include <common/stateprov/PythonStateProvider.hpp>
+#endif
+#include <common/stateprov/RuleStateProvider.hpp>
 #include <common/stateprov/StateProviderConfig.hpp>
+#include <common/state/StateResumePoint.hpp>
 #include <common/ex/WrongStateProvider.hpp>
+#include <common/ex/ResumePoint.hpp>
+#include <common/utils/MappedFile.hpp>
+#include <common/utils/Tsc.hpp>
 #include "AbstractCacheBuilder.hpp"
 #include "StateHistoryBuilder.hpp"
 #include "ex/UnknownStateProviderType.hpp"
@@ -37,9 +48,14 @@ namespace tibee
 {
 
 StateHistoryBuilder::StateHistoryBuilder(const bfs::path& dbDir,
-                                         const std::vector<common::StateProviderConfig>& providers) :
+                                         const std::vector<common::StateProviderConfig>& providers,
+                                         const Options& options) :
     AbstractCacheBuilder {dbDir},
-    _providersConfigs {providers}
+    _providersConfigs {providers},
+    _options (options),
+    _eventsUntilResumePoint {0},
+    _fingerprint {StateHistoryBuilder::getFingerprint(providers, options)},
+    _profileBeginTsc {0}
 {
     for (const auto& providerConfig : _providersConfigs) {
         auto providerPath = bfs::path {providerConfig.getName()};
@@ -67,13 +83,25 @@ StateHistoryBuilder::StateHistoryBuilder(const bfs::path& dbDir,
                 new common::DynamicLibraryStateProvider {providerPath, providerConfig}
             };
         } else if (extension == ".py") {
+#ifdef TIBEE_WITH_PYTHON
             stateProvider = common::AbstractStateProvider::UP {
                 new common::PythonStateProvider {providerPath, providerConfig}
             };
+#else
+            throw common::ex::WrongStateProvider {
+                "Python state providers are not supported by this build (build with python=yes)",
+                providerConfig.getName()
+            };
+#endif
+        } else if (extension == ".json") {
+            stateProvider = common::AbstractStateProvider::UP {
+                new common::RuleStateProvider {providerPath, providerConfig}
+            };
         } else {
             throw ex::UnknownStateProviderType {providerConfig.getName()};
         }
 
+        stateProvider->setProfiling(_options.profile);
         _providers.push_back(std::move(stateProvider));
     }
 }
@@ -84,32 +112,104 @@ StateHistoryBuilder::~StateHistoryBuilder()
 
 bool StateHistoryBuilder::onStartImpl(const common::TraceSet* traceSet)
 {
+    // go on from the previous resume point?
+    common::StateResumePoint::UP resumePoint;
+
+    if (_options.resume) {
+        resumePoint = common::StateResumePoint::load(StateHistoryBuilder::getResumePointPath(this->getCacheDir()));
+
+        if (resumePoint->getFingerprint() != _fingerprint) {
+            throw common::ex::ResumePoint {
+                "resume point was saved with other state providers or options"
+            };
+        }
+    }
+
     // create new state history sink (destroying the previous one)
     _stateHistorySink = std::unique_ptr<common::StateHistorySink> {
         new common::StateHistorySink {
             this->getCacheDir() / "state-strings.db",
             this->getCacheDir() / "state-nodes.json",
             this->getCacheDir() / "state-history.delo",
-            traceSet->getBegin()
+            traceSet->getBegin(),
+            resumePoint.get()
         }
     };
 
+    resumePoint = nullptr;
+    _stateHistorySink->setCoalescing(_options.coalesce);
+
+    // state change log for state history queries
+    if (_options.queryable) {
+        _stateHistorySink->enableChangeLog(this->getCacheDir() / "state-changes.dat");
+    }
+
+    // full state checkpoints for fast point-in-time queries
+    if (_options.queryable &&
+            (_options.checkpointEvents > 0 || _options.checkpointPeriod > 0)) {
+        _stateHistorySink->enableCheckpoints(this->getCacheDir() / "state-checkpoints.dat",
+                                             this->getCacheDir() / "state-checkpoints.idx",
+                                             _options.checkpointEvents,
+                                             _options.checkpointPeriod);
+    }
+
+    this->restartResumePointCountdown();
+
     // also notify each state provider
     for (auto& provider : _providers) {
         provider->onInit(_stateHistorySink->getCurrentState(), traceSet);
     }
 
+    /* Compile the callbacks of all providers into a single table.
+     * Clear it first: addEventCallbacks() resets the profiles which
+     * the callbacks of a previous run refer to.
+     */
+    _dispatchTable.clear();
+
+    for (const auto& provider : _providers) {
+        provider->addEventCallbacks(_dispatchTable);
+    }
+
+    _dispatchTable.compile();
+
+    // calibrate the time stamp counter against the whole playback
+    _profileBeginTsc = common::readTsc();
+    _profileBeginTime = std::chrono::steady_clock::now();
+
     return true;
 }
 
 void StateHistoryBuilder::onEventImpl(const common::Event& event)
 {
+    this->checkResumePoint(event.getTimestamp());
+
     // update state history sink's current timestamp
     _stateHistorySink->setCurrentTimestamp(event.getTimestamp());
 
-    // also notify each state provider
+    // also notify each state provider (in provider order)
+    _dispatchTable.dispatch(_stateHistorySink->getCurrentState(), event);
+}
+
+void StateHistoryBuilder::onEventsImpl(const common::EventBatch& batch)
+{
+    auto& sink = *_stateHistorySink;
+    auto& state = sink.getCurrentState();
+
+    // let providers prepare the whole batch
     for (auto& provider : _providers) {
-        provider->onEvent(_stateHistorySink->getCurrentState(), event);
+        provider->onBatch(state, batch);
+    }
+
+    /* Keep the event-major order of onEventImpl(): providers may read
+     * the state set by other providers for the same event.
+     */
+    for (std::size_t x = 0; x < batch.size(); ++x) {
+        const auto& event = batch[x];
+
+        this->checkResumePoint(event.getTimestamp());
+        sink.setCurrentTimestamp(event.getTimestamp());
+
+        _dispatchTable.dispatch(state, event);
     }
 }
 
@@ -120,12 +220,100 @@ bool StateHistoryBuilder::onStopImpl()
         provider->onFini(_stateHistorySink->getCurrentState());
     }
 
+    _dispatchTable.clear();
+
+    // to go on later with more trace data
+    if (_options.resumePointEvents > 0) {
+        this->saveResumePoint();
+    }
+
     // close history file sink
     _stateHistorySink->close();
 
     return true;
 }
 
+bool StateHistoryBuilder::addSubscribedEventsImpl(common::EventFilter& filter) const
+{
+    // providers only get the events they registered a callback for
+    for (const auto& provider : _providers) {
+        provider->addSubscribedEvents(filter);
+    }
+
+    return true;
+}
+
+void StateHistoryBuilder::saveResumePoint()
+{
+    _stateHistorySink->saveResumePoint(StateHistoryBuilder::getResumePointPath(this->getCacheDir()),
+                                       _fingerprint);
+    this->restartResumePointCountdown();
+}
+
+void StateHistoryBuilder::restartResumePointCountdown()
+{
+    _eventsUntilResumePoint = _options.resumePointEvents;
+}
+
+bfs::path StateHistoryBuilder::getResumePointPath(const bfs::path& dbDir)
+{
+    return dbDir / "state-resume.dat";
+}
+
+std::uint64_t StateHistoryBuilder::getFingerprint(const std::vector<common::StateProviderConfig>& providers,
+                                                  const Options& options)
+{
+    // 64-bit FNV-1a
+    std::uint64_t hash = 0xcbf29ce484222325ULL;
+
+    auto addBytes = [&hash] (const char* data, std::size_t size) {
+        for (std::size_t x = 0; x < size; ++x) {
+            hash ^= static_cast<std::uint8_t>(data[x]);
+            hash *= 0x100000001b3ULL;
+        }
+    };
+
+    // strings end with their null character to keep them apart
+    auto addString = [&addBytes] (const std::string& str) {
+        addBytes(str.c_str(), str.size() + 1);
+    };
+
+    addString(options.coalesce ? "coalesce" : "no-coalesce");
+    addString(options.queryable ? "queryable" : "not-queryable");
+
+    for (const auto& providerConfig : providers) {
+        addString(providerConfig.getName());
+        addString(providerConfig.getInstanceName());
+
+        // parameters in name order
+        std::vector<std::pair<std::string, std::string>> params;
+
+        for (const auto& param : providerConfig.getParams()) {
+            params.push_back({param.first, param.second.asString()});
+        }
+
+        std::sort(params.begin(), params.end());
+
+        for (const auto& param : params) {
+            addString(param.first);
+            addString(param.second);
+        }
+
+        // provider contents
+        auto providerPath = bfs::path {providerConfig.getName()};
+
+        if (bfs::is_regular_file(providerPath)) {
+            common::MappedFile file {providerPath};
+
+            if (file.getData()) {
+                addBytes(file.getData(), file.getSize());
+            }
+        }
+    }
+
+    return hash;
+}
+
 std::size_t StateHistoryBuilder::getStateChanges() const
 {
     if (_stateHistorySink) {
@@ -135,4 +323,51 @@ std::size_t StateHistoryBuilder::getStateChanges() const
     return 0;
 }
 
+bool StateHistoryBuilder::isProfiling() const
+{
+    return _options.profile;
+}
+
+std::vector<CallbackProfile> StateHistoryBuilder::getCallbackProfiles() const
+{
+    std::vector<CallbackProfile> profiles;
+
+    if (!_options.profile) {
+        return profiles;
+    }
+
+    // time stamp counter cycles to nanoseconds
+    auto elapsedTsc = common::readTsc() - _profileBeginTsc;
+    auto elapsedTime = std::chrono::steady_clock::now() - _profileBeginTime;
+    auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(elapsedTime).count();
+    double nsPerCycle = 1.;
+
+    if (elapsedTsc > 0) {
+        nsPerCycle = static_cast<double>(elapsedNs) / elapsedTsc;
+    }
+
+    for (const auto& provider : _providers) {
+        const auto& config = provider->getConfig();
+        const auto& name = config.getInstanceName().empty() ?
+                           config.getName() : config.getInstanceName();
+
+        for (const auto& profile : provider->getCallbackProfiles()) {
+            profiles.push_back({
+                name,
+                profile.eventName,
+                profile.calls,
+                static_cast<std::uint64_t>(profile.cycles * nsPerCycle),
+                profile.stateChanges
+            });
+        }
+    }
+
+    std::stable_sort(profiles.begin(), profiles.end(),
+                     [] (const CallbackProfile& a, const CallbackProfile& b) {
+        return a.timeNs > b.timeNs;
+    });
+
+    return profiles;
+}
+
 }
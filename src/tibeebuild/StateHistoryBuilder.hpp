@@ -18,6 +18,10 @@
 #ifndef _STATEHISTORYBUILDER_HPP
 #define _STATEHISTORYBUILDER_HPP
 
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
 #include <vector>
 #include <memory>
 #include <boost/filesystem.hpp>
@@ -26,7 +30,9 @@
 #include <common/trace/TraceSet.hpp>
 #include <common/trace/Event.hpp>
 #include "AbstractCacheBuilder.hpp"
+#include "CallbackProfile.hpp"
 #include <common/stateprov/AbstractStateProvider.hpp>
+#include <common/stateprov/EventDispatchTable.hpp>
 #include <common/stateprov/StateProviderConfig.hpp>
 
 namespace tibee
@@ -43,15 +49,45 @@ namespace tibee
 class StateHistoryBuilder :
     public AbstractCacheBuilder
 {
+public:
+    // state history options
+    struct Options
+    {
+        // coalesce same-value state assignments
+        bool coalesce;
+
+        // write the state change log and checkpoints for queries
+        bool queryable;
+
+        // maximum number of events between state checkpoints (0 to disable)
+        std::size_t checkpointEvents;
+
+        // maximum time between state checkpoints (ns, 0 to disable)
+        common::timestamp_t checkpointPeriod;
+
+        /* Minimum number of events between resume points, also saved
+         * at the end of the build (0 to disable).
+         */
+        std::size_t resumePointEvents;
+
+        // go on from the resume point of the cache directory
+        bool resume;
+
+        // profile the event callbacks of state providers
+        bool profile;
+    };
+
 public:
     /**
      * Builds a state history builder.
      *
      * @param dbDir     Cache directory
      * @param providers List of state providers configurations
+     * @param options   State history options
      */
     StateHistoryBuilder(const boost::filesystem::path& dbDir,
-                        const std::vector<common::StateProviderConfig>& providers);
+                        const std::vector<common::StateProviderConfig>& providers,
+                        const Options& options);
 
     ~StateHistoryBuilder();
 
@@ -62,15 +98,95 @@ public:
      */
     std::size_t getStateChanges() const;
 
+    /**
+     * Returns whether or not the event callbacks of state providers
+     * are profiled.
+     *
+     * @returns True if profiling
+     */
+    bool isProfiling() const;
+
+    /**
+     * Returns the profiles of all the event callbacks of all the
+     * state providers so far, slowest first.
+     *
+     * Empty unless profiling is enabled (see Options).
+     *
+     * @returns Event callback profiles
+     */
+    std::vector<CallbackProfile> getCallbackProfiles() const;
+
+    /**
+     * Returns the path of the resume point file of database directory
+     * \p dbDir.
+     *
+     * @param dbDir Database directory
+     * @returns     Resume point file path
+     */
+    static boost::filesystem::path getResumePointPath(const boost::filesystem::path& dbDir);
+
+    /**
+     * Returns the fingerprint of a build with state providers
+     * \p providers and options \p options: a hash of what the built
+     * state history depends on (providers, their contents and their
+     * parameters, coalescing, and queryability), saved in resume
+     * points.
+     *
+     * @param providers List of state providers configurations
+     * @param options   State history options
+     * @returns         Build configuration fingerprint
+     */
+    static std::uint64_t getFingerprint(const std::vector<common::StateProviderConfig>& providers,
+                                        const Options& options);
+
 private:
     bool onStartImpl(const common::TraceSet* traceSet);
     void onEventImpl(const common::Event& event);
+    void onEventsImpl(const common::EventBatch& batch);
     bool onStopImpl();
+    bool addSubscribedEventsImpl(common::EventFilter& filter) const;
+    void saveResumePoint();
+    void restartResumePointCountdown();
+
+    /**
+     * Counts the next event and saves a resume point if one is due
+     * and if \p ts starts a new timestamp (resume points are always
+     * between two timestamps).
+     *
+     * @param ts Timestamp of the next event
+     */
+    void checkResumePoint(common::timestamp_t ts)
+    {
+        if (_options.resumePointEvents == 0) {
+            return;
+        }
+
+        if (_eventsUntilResumePoint > 0) {
+            _eventsUntilResumePoint--;
+        } else if (ts > _stateHistorySink->getCurrentTimestamp()) {
+            this->saveResumePoint();
+        }
+    }
 
 private:
     std::vector<common::StateProviderConfig> _providersConfigs;
     std::vector<common::AbstractStateProvider::UP> _providers;
+
+    // event callbacks of all providers
+    common::EventDispatchTable _dispatchTable;
+
+    Options _options;
     std::unique_ptr<common::StateHistorySink> _stateHistorySink;
+
+    // number of events until a resume point is due
+    std::size_t _eventsUntilResumePoint;
+
+    // build configuration fingerprint, saved in resume points
+    std::uint64_t _fingerprint;
+
+    // time stamp counter and time when profiling started
+    std::uint64_t _profileBeginTsc;
+    std::chrono::steady_clock::time_point _profileBeginTime;
 };
 
 }
@@ -21,6 +21,8 @@
 
 #include <common/trace/TraceSet.hpp>
 #include <common/trace/Event.hpp>
+#include <common/trace/EventBatch.hpp>
+#include <common/trace/EventFilter.hpp>
 #include "TraceDeck.hpp"
 
 namespace bfs = boost::filesystem;
@@ -28,6 +30,8 @@ namespace bfs = boost::filesystem;
 namespace tibee
 {
 
+const std::size_t TraceDeck::BATCH_SIZE;
+
 TraceDeck::TraceDeck() :
     _playing {false}
 {
@@ -44,15 +48,33 @@ bool TraceDeck::play(const common::TraceSet* traceSet,
         listener->onStart(traceSet);
     }
 
-    // go through all events
-    for (auto& event : *traceSet) {
+    /* Skip the events no listener needs, unless at least one of them
+     * needs all events.
+     */
+    common::EventFilter filter;
+    bool filtering = true;
+
+    for (auto& listener : listeners) {
+        if (!listener->addSubscribedEvents(filter)) {
+            filtering = false;
+        }
+    }
+
+    // go through all events, one batch at a time
+    common::EventBatch batch {TraceDeck::BATCH_SIZE};
+    auto it = traceSet->begin(filtering ? &filter : nullptr);
+    auto endIt = traceSet->end();
+
+    while (it != endIt) {
         if (!_playing) {
             return false;
         }
 
-        // play this event to all listeners
+        it.fill(batch);
+
+        // play this batch to all listeners
         for (auto& listener : listeners) {
-            listener->onEvent(event);
+            listener->onEvents(batch);
         }
     }
 
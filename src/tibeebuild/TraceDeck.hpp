@@ -18,6 +18,7 @@
 #ifndef _TRACEDECK_HPP
 #define _TRACEDECK_HPP
 
+#include <cstddef>
 #include <memory>
 #include <string>
 #include <boost/filesystem/path.hpp>
@@ -36,6 +37,10 @@ namespace tibee
  */
 class TraceDeck
 {
+public:
+    /// Number of events delivered at once to listeners
+    static const std::size_t BATCH_SIZE = 256;
+
 public:
     /**
      * Builds a trace deck.
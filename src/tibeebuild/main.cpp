@@ -17,6 +17,7 @@
  */
 #include <iostream>
 #include <cstdio>
+#include <limits>
 #include <vector>
 #include <string>
 #include <boost/program_options.hpp>
@@ -57,6 +58,19 @@ int parseOptions(int argc, char* argv[], tibee::Arguments& args)
         ("param,p", bpo::value<std::vector<std::string>>())
         ("bind-progress,b", bpo::value<std::string>())
         ("db-dir,d", bpo::value<std::string>())
+        ("jobs,j", bpo::value<std::size_t>()->default_value(1))
+        ("native,n", bpo::bool_switch()->default_value(false))
+        ("cache-event,e", bpo::value<std::vector<std::string>>())
+        ("replay,r", bpo::bool_switch()->default_value(false))
+        ("no-coalesce", bpo::bool_switch()->default_value(false))
+        ("queryable,q", bpo::bool_switch()->default_value(false))
+        ("checkpoint-events", bpo::value<std::size_t>()->default_value(1000000))
+        ("checkpoint-period", bpo::value<tibee::common::timestamp_t>()->default_value(0))
+        ("resume", bpo::bool_switch()->default_value(false))
+        ("resume-events", bpo::value<std::size_t>()->default_value(0))
+        ("profile", bpo::bool_switch()->default_value(false))
+        ("begin", bpo::value<tibee::common::timestamp_t>())
+        ("end", bpo::value<tibee::common::timestamp_t>())
         ("force,f", bpo::bool_switch()->default_value(false))
     ;
 
@@ -84,11 +98,36 @@ int parseOptions(int argc, char* argv[], tibee::Arguments& args)
             std::endl <<
             "  -h, --help                  print this help message" << std::endl <<
             "  -b, --bind-progress <addr>  bind address for build progress (default: none)" << std::endl <<
+            "  --begin <ts>                only build the state from timestamp <ts> (ns)" << std::endl <<
+            "  --checkpoint-events <n>     with -q, write a full state checkpoint at least" << std::endl <<
+            "                              every <n> events (default: 1000000, 0: never)" << std::endl <<
+            "  --checkpoint-period <ns>    with -q, write a full state checkpoint at least" << std::endl <<
+            "                              every <ns> ns of trace time (default: 0, never)" << std::endl <<
             "  -d, --db-dir <path>         write database in this directory" << std::endl <<
             "                              (default: \"./tibee\")" << std::endl <<
+            "  -e, --cache-event <name>    write events named <name> to the event cache" << std::endl <<
+            "                              of the database (\"*\" for all events)" << std::endl <<
+            "  --end <ts>                  only build the state up to timestamp <ts> (ns)" << std::endl <<
             "  -f, --force                 force database writing, even if the output" << std::endl <<
-            "                              directory already exists" << std::endl <<
+            "                              directory already holds a state history" << std::endl <<
+            "  -j, --jobs <n>              decode trace streams using up to <n> threads" << std::endl <<
+            "                              (default: 1)" << std::endl <<
+            "  -n, --native                decode CTF streams without Babeltrace when" << std::endl <<
+            "                              possible (faster)" << std::endl <<
+            "  --no-coalesce               write an interval for each state assignment," << std::endl <<
+            "                              even when the value does not change" << std::endl <<
             "  -p [<inst>:]<key>=<val>     state provider parameter" << std::endl <<
+            "  --profile                   profile state provider callbacks and publish" << std::endl <<
+            "                              their profiles with progress (implied by -v)" << std::endl <<
+            "  -q, --queryable             write the state change log and checkpoints" << std::endl <<
+            "                              needed to query the state history (tibeecore)" << std::endl <<
+            "  -r, --replay                replay the event cache of the database" << std::endl <<
+            "                              instead of decoding traces" << std::endl <<
+            "  --resume                    go on building the existing database from its" << std::endl <<
+            "                              last resume point (interrupted build or new" << std::endl <<
+            "                              trace data)" << std::endl <<
+            "  --resume-events <n>         save a resume point at least every <n> events" << std::endl <<
+            "                              and at the end (default: 0, never)" << std::endl <<
             "  -s [<inst>:]<name>          state provider name with optional unique" << std::endl <<
             "                              instance name <inst>; <name> may be a path" << std::endl <<
             "  -v, --verbose               verbose" << std::endl;
@@ -131,6 +170,53 @@ int parseOptions(int argc, char* argv[], tibee::Arguments& args)
         args.bindProgress = vm["bind-progress"].as<std::string>();
     }
 
+    // decoding threads
+    args.jobs = vm["jobs"].as<std::size_t>();
+
+    // native decoding
+    args.native = vm["native"].as<bool>();
+
+    // event cache
+    if (!vm["cache-event"].empty()) {
+        args.cacheEvents = vm["cache-event"].as<std::vector<std::string>>();
+    }
+
+    args.replay = vm["replay"].as<bool>();
+
+    // same-value state assignments coalescing
+    args.coalesce = !vm["no-coalesce"].as<bool>();
+
+    // state change log and checkpoints for queries
+    args.queryable = vm["queryable"].as<bool>();
+
+    // state checkpoints
+    args.checkpointEvents = vm["checkpoint-events"].as<std::size_t>();
+    args.checkpointPeriod = vm["checkpoint-period"].as<tibee::common::timestamp_t>();
+
+    // resume points
+    args.resume = vm["resume"].as<bool>();
+    args.resumePointEvents = vm["resume-events"].as<std::size_t>();
+
+    // state provider callback profiles
+    args.profile = vm["profile"].as<bool>();
+
+    // time range
+    args.begin = 0;
+    args.end = std::numeric_limits<tibee::common::timestamp_t>::max();
+
+    if (!vm["begin"].empty()) {
+        args.begin = vm["begin"].as<tibee::common::timestamp_t>();
+    }
+
+    if (!vm["end"].empty()) {
+        args.end = vm["end"].as<tibee::common::timestamp_t>();
+    }
+
+    if (args.begin > args.end) {
+        tberror() << "command line error: begin timestamp is greater than end timestamp" << tbendl();
+        return 1;
+    }
+
     // verbose
     args.verbose = vm["verbose"].as<bool>();
 
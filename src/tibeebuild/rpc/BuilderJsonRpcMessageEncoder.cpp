@@ -38,6 +38,7 @@ bool BuilderJsonRpcMessageEncoder::encodeProgressUpdateRpcNotificationParams(con
 
     // keys
     TIBEE_DEF_YAJL_STR(PROCESSED_EVENTS, "processed-events");
+    TIBEE_DEF_YAJL_STR(TOTAL_EVENTS, "total-events");
     TIBEE_DEF_YAJL_STR(TRACES_BEGIN_TS, "traces-begin-ts");
     TIBEE_DEF_YAJL_STR(TRACES_END_TS, "traces-end-ts");
     TIBEE_DEF_YAJL_STR(TRACES_CUR_TS, "traces-cur-ts");
@@ -45,13 +46,22 @@ bool BuilderJsonRpcMessageEncoder::encodeProgressUpdateRpcNotificationParams(con
     TIBEE_DEF_YAJL_STR(TRACES_PATHS, "traces-paths");
     TIBEE_DEF_YAJL_STR(STATE_PROVIDERS, "state-providers");
     TIBEE_DEF_YAJL_STR(ELAPSED_TIME, "elapsed-time");
+    TIBEE_DEF_YAJL_STR(CALLBACKS, "callbacks");
+    TIBEE_DEF_YAJL_STR(PROVIDER, "provider");
+    TIBEE_DEF_YAJL_STR(EVENT, "event");
+    TIBEE_DEF_YAJL_STR(CALLS, "calls");
+    TIBEE_DEF_YAJL_STR(TIME_NS, "time-ns");
 
     // open object
     ::yajl_gen_map_open(yajlGen);
 
     // processed events
     ::yajl_gen_string(yajlGen, PROCESSED_EVENTS, PROCESSED_EVENTS_LEN);
-    ::yajl_gen_integer(yajlGen, pu.getProcessedEvents());
+    ::yajl_gen_integer(yajlGen, static_cast<long long int>(pu.getProcessedEvents()));
+
+    // total events (0 if unknown)
+    ::yajl_gen_string(yajlGen, TOTAL_EVENTS, TOTAL_EVENTS_LEN);
+    ::yajl_gen_integer(yajlGen, static_cast<long long int>(pu.getTotalEvents()));
 
     // trace set begin timestamp
     ::yajl_gen_string(yajlGen, TRACES_BEGIN_TS, TRACES_BEGIN_TS_LEN);
@@ -104,6 +114,35 @@ bool BuilderJsonRpcMessageEncoder::encodeProgressUpdateRpcNotificationParams(con
 
     ::yajl_gen_array_close(yajlGen);
 
+    // state provider callback profiles (only when profiling)
+    const auto& callbackProfiles = pu.getCallbackProfiles();
+
+    if (!callbackProfiles.empty()) {
+        ::yajl_gen_string(yajlGen, CALLBACKS, CALLBACKS_LEN);
+        ::yajl_gen_array_open(yajlGen);
+
+        for (const auto& profile : callbackProfiles) {
+            ::yajl_gen_map_open(yajlGen);
+            ::yajl_gen_string(yajlGen, PROVIDER, PROVIDER_LEN);
+            ::yajl_gen_string(yajlGen,
+                              reinterpret_cast<const unsigned char*>(profile.provider.c_str()),
+                              profile.provider.size());
+            ::yajl_gen_string(yajlGen, EVENT, EVENT_LEN);
+            ::yajl_gen_string(yajlGen,
+                              reinterpret_cast<const unsigned char*>(profile.eventName.c_str()),
+                              profile.eventName.size());
+            ::yajl_gen_string(yajlGen, CALLS, CALLS_LEN);
+            ::yajl_gen_integer(yajlGen, static_cast<long long int>(profile.calls));
+            ::yajl_gen_string(yajlGen, TIME_NS, TIME_NS_LEN);
+            ::yajl_gen_integer(yajlGen, static_cast<long long int>(profile.timeNs));
+            ::yajl_gen_string(yajlGen, STATE_CHANGES, STATE_CHANGES_LEN);
+            ::yajl_gen_integer(yajlGen, static_cast<long long int>(profile.stateChanges));
+            ::yajl_gen_map_close(yajlGen);
+        }
+
+        ::yajl_gen_array_close(yajlGen);
+    }
+
     // close object
     ::yajl_gen_map_close(yajlGen);
 
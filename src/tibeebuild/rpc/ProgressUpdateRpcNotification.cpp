@@ -23,6 +23,7 @@ namespace tibee
 ProgressUpdateRpcNotification::ProgressUpdateRpcNotification() :
     AbstractRpcNotification {"progress-update"},
     _processedEvents {0},
+    _totalEvents {0},
     _beginTs {0},
     _endTs {0},
     _curTs {0},
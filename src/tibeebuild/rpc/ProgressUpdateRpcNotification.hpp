@@ -19,11 +19,14 @@
 #define _PROGRESSUPDATERPCNOTIFICATION_HPP
 
 #include <cstddef>
+#include <cstdint>
+#include <vector>
 #include <boost/filesystem/path.hpp>
 
 #include <common/BasicTypes.hpp>
 #include <common/rpc/AbstractRpcNotification.hpp>
 #include <common/stateprov/StateProviderConfig.hpp>
+#include "../CallbackProfile.hpp"
 
 namespace tibee
 {
@@ -53,7 +56,7 @@ public:
      *
      * @param processedEvents Number of processed events so far
      */
-    void setProcessedEvents(unsigned int processedEvents)
+    void setProcessedEvents(std::uint64_t processedEvents)
     {
         _processedEvents = processedEvents;
     }
@@ -63,11 +66,31 @@ public:
      *
      * @returns Processed events so far
      */
-    std::size_t getProcessedEvents() const
+    std::uint64_t getProcessedEvents() const
     {
         return _processedEvents;
     }
 
+    /**
+     * Sets the total number of events to process.
+     *
+     * @param totalEvents Total number of events, or 0 if unknown
+     */
+    void setTotalEvents(std::uint64_t totalEvents)
+    {
+        _totalEvents = totalEvents;
+    }
+
+    /**
+     * Returns the total number of events to process.
+     *
+     * @returns Total number of events, or 0 if unknown
+     */
+    std::uint64_t getTotalEvents() const
+    {
+        return _totalEvents;
+    }
+
     /**
      * Sets the trace set begin timestamp.
      *
@@ -209,8 +232,29 @@ public:
         return _stateProviders;
     }
 
+    /**
+     * Sets the profiles of the event callbacks of state providers.
+     *
+     * @param callbackProfiles Event callback profiles
+     */
+    void setCallbackProfiles(const std::vector<CallbackProfile>& callbackProfiles)
+    {
+        _callbackProfiles = callbackProfiles;
+    }
+
+    /**
+     * Returns the profiles of the event callbacks of state providers.
+     *
+     * @returns Event callback profiles
+     */
+    const std::vector<CallbackProfile>& getCallbackProfiles() const
+    {
+        return _callbackProfiles;
+    }
+
 private:
-    unsigned int _processedEvents;
+    std::uint64_t _processedEvents;
+    std::uint64_t _totalEvents;
     common::timestamp_t _beginTs;
     common::timestamp_t _endTs;
     common::timestamp_t _curTs;
@@ -218,6 +262,7 @@ private:
     std::size_t _stateChanges;
     std::vector<boost::filesystem::path> _tracesPaths;
     std::vector<common::StateProviderConfig> _stateProviders;
+    std::vector<CallbackProfile> _callbackProfiles;
 };
 
 }
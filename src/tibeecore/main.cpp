@@ -1,9 +1,336 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
 #include <iostream>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/program_options.hpp>
 
-int main(int argc, char* argv[])
+#include <common/BasicTypes.hpp>
+#include <common/state/StateHistory.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/utils/print.hpp>
+#include <common/ex/StateHistory.hpp>
+
+using tibee::common::tberror;
+using tibee::common::tbendl;
+
+namespace
+{
+
+struct Arguments
 {
-    std::cout << "Hello, tiger beetle!" << std::endl <<
-                         "I'm the analysis core." << std::endl;
+    std::string dbDir;
+    std::string command;
+    std::vector<std::string> commandArgs;
+};
+
+/**
+ * Parses the command line arguments passed to the program.
+ *
+ * @param argc Number of arguments in \p argv
+ * @param argv Command line arguments
+ * @param args Arguments values to fill
+ *
+ * @returns    0 to continue, 1 if there's a command line error
+ */
+int parseOptions(int argc, char* argv[], Arguments& args)
+{
+    namespace bpo = boost::program_options;
+
+    bpo::options_description desc;
+
+    desc.add_options()
+        ("help,h", "help")
+        ("db-dir,d", bpo::value<std::string>()->default_value("tibee"))
+        ("command", bpo::value<std::vector<std::string>>())
+    ;
+
+    bpo::positional_options_description pos;
+
+    pos.add("command", -1);
+
+    bpo::variables_map vm;
+
+    try {
+        auto cliParser = bpo::command_line_parser(argc, argv);
+        auto parsedOptions = cliParser.options(desc).positional(pos).run();
+
+        bpo::store(parsedOptions, vm);
+    } catch (const std::exception& ex) {
+        tberror() << "command line error: " << ex.what() << tbendl();
+        return 1;
+    }
+
+    if (!vm["help"].empty()) {
+        std::cout <<
+            "usage: " << argv[0] << " [options] <command> <arg>..." << std::endl <<
+            std::endl <<
+            "commands:" << std::endl <<
+            std::endl <<
+            "  value <node> <ts>           value of node <node> at timestamp <ts>" << std::endl <<
+            "  subtree <node> <ts>         values of all the nodes of the subtree of" << std::endl <<
+            "                              node <node> at timestamp <ts>" << std::endl <<
+            "  intervals <node> <b> <e>    intervals of node <node> between timestamps" << std::endl <<
+            "                              <b> and <e>" << std::endl <<
+            "  resolve <node>              path and ID of node <node>" << std::endl <<
+            std::endl <<
+            "<node> is a state path (subpaths separated by \"/\") or \"#\" followed" << std::endl <<
+            "by a node ID." << std::endl <<
+            std::endl <<
+            "options:" << std::endl <<
+            std::endl <<
+            "  -h, --help                  print this help message" << std::endl <<
+            "  -d, --db-dir <path>         read database in this directory" << std::endl <<
+            "                              (default: \"./tibee\")" << std::endl;
+
+        return -1;
+    }
+
+    try {
+        vm.notify();
+    } catch (const std::exception& ex) {
+        tberror() << "command line error: " << ex.what() << tbendl();
+        return 1;
+    }
+
+    // command and its arguments
+    if (vm["command"].empty()) {
+        tberror() << "command line error: need a command" << tbendl();
+        return 1;
+    }
+
+    auto command = vm["command"].as<std::vector<std::string>>();
+
+    args.command = command.front();
+    args.commandArgs.assign(command.begin() + 1, command.end());
+
+    // database directory
+    args.dbDir = vm["db-dir"].as<std::string>();
 
     return 0;
 }
+
+/**
+ * Parses a timestamp.
+ *
+ * @param str String to parse
+ * @param ts  Parsed timestamp (set on success)
+ * @returns   True on success
+ */
+bool parseTimestamp(const std::string& str, tibee::common::timestamp_t& ts)
+{
+    char* end;
+
+    if (str.empty() || str[0] == '-') {
+        return false;
+    }
+
+    ts = std::strtoull(str.c_str(), &end, 10);
+
+    return *end == '\0';
+}
+
+/**
+ * Resolves a node given as a state path or as <code>#</code> followed
+ * by a node ID.
+ *
+ * @param history State history
+ * @param node    Node path or ID
+ * @param id      Node ID (set on success)
+ * @returns       True if node exists
+ */
+bool resolveNode(const tibee::common::StateHistory& history,
+                 const std::string& node, tibee::common::state_node_id_t& id)
+{
+    if (!node.empty() && node[0] == '#') {
+        tibee::common::timestamp_t rawId;
+
+        if (!parseTimestamp(node.substr(1), rawId) ||
+                rawId >= history.getNodesCount()) {
+            return false;
+        }
+
+        id = static_cast<tibee::common::state_node_id_t>(rawId);
+
+        return true;
+    }
+
+    return history.getNodeId(node, id);
+}
+
+/**
+ * Formats a state value, quarks being resolved to strings.
+ *
+ * @param history State history
+ * @param value   State value
+ * @returns       Formatted state value
+ */
+std::string formatValue(const tibee::common::StateHistory& history,
+                        const tibee::common::StateValue& value)
+{
+    switch (value.getType()) {
+    case tibee::common::StateValueType::SINT32:
+        return std::to_string(value.asSint32());
+
+    case tibee::common::StateValueType::UINT32:
+        return std::to_string(value.asUint32());
+
+    case tibee::common::StateValueType::SINT64:
+        return std::to_string(value.asSint64());
+
+    case tibee::common::StateValueType::UINT64:
+        return std::to_string(value.asUint64());
+
+    case tibee::common::StateValueType::FLOAT32:
+        return std::to_string(value.asFloat32());
+
+    case tibee::common::StateValueType::QUARK:
+    {
+        auto quark = value.asQuark();
+
+        if (quark.isInt()) {
+            return std::to_string(quark.getInt());
+        }
+
+        return "\"" + history.getString(quark) + "\"";
+    }
+
+    default:
+        return "null";
+    }
+}
+
+/**
+ * Runs a query command.
+ *
+ * @param args Arguments values
+ * @returns    True on success
+ */
+bool runCommand(const Arguments& args)
+{
+    tibee::common::StateHistory history {args.dbDir};
+    const auto& cmdArgs = args.commandArgs;
+    std::size_t expectedArgs;
+
+    if (args.command == "value" || args.command == "subtree") {
+        expectedArgs = 2;
+    } else if (args.command == "intervals") {
+        expectedArgs = 3;
+    } else if (args.command == "resolve") {
+        expectedArgs = 1;
+    } else {
+        tberror() << "unknown command \"" << args.command << "\"" << tbendl();
+        return false;
+    }
+
+    if (cmdArgs.size() != expectedArgs) {
+        tberror() << "command \"" << args.command << "\" takes " <<
+                     expectedArgs << " argument(s)" << tbendl();
+        return false;
+    }
+
+    // node
+    tibee::common::state_node_id_t id;
+
+    if (!resolveNode(history, cmdArgs[0], id)) {
+        tberror() << "no such state node: \"" << cmdArgs[0] << "\"" << tbendl();
+        return false;
+    }
+
+    // timestamps
+    std::vector<tibee::common::timestamp_t> ts;
+
+    for (std::size_t x = 1; x < cmdArgs.size(); ++x) {
+        tibee::common::timestamp_t argTs;
+
+        if (!parseTimestamp(cmdArgs[x], argTs)) {
+            tberror() << "invalid timestamp: \"" << cmdArgs[x] << "\"" << tbendl();
+            return false;
+        }
+
+        ts.push_back(argTs);
+    }
+
+    if (args.command == "resolve") {
+        std::cout << "#" << id << " " << history.getNodePath(id) << std::endl;
+    } else if (args.command == "value") {
+        tibee::common::timestamp_t beginTs;
+        auto value = history.getValue(id, ts[0], beginTs);
+
+        std::cout << history.getNodePath(id) << " = " << formatValue(history, value);
+
+        if (value) {
+            std::cout << " (since " << beginTs << ")";
+        }
+
+        std::cout << std::endl;
+    } else if (args.command == "subtree") {
+        std::vector<tibee::common::StateHistory::NodeValue> values;
+
+        history.getSubtree(id, ts[0], values);
+
+        for (const auto& nodeValue : values) {
+            std::cout << history.getNodePath(nodeValue.id) << " = " <<
+                         formatValue(history, nodeValue.value) <<
+                         " (since " << nodeValue.beginTs << ")" << std::endl;
+        }
+    } else {
+        if (ts[0] > ts[1]) {
+            tberror() << "begin timestamp is greater than end timestamp" << tbendl();
+            return false;
+        }
+
+        std::vector<tibee::common::StateHistory::Interval> intervals;
+
+        history.getIntervals(id, ts[0], ts[1], intervals);
+
+        for (const auto& interval : intervals) {
+            std::cout << "[" << interval.beginTs << ", " << interval.endTs <<
+                         "] " << formatValue(history, interval.value) << std::endl;
+        }
+    }
+
+    return true;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    Arguments args;
+
+    int ret = parseOptions(argc, argv, args);
+
+    if (ret < 0) {
+        return 0;
+    } else if (ret > 0) {
+        return ret;
+    }
+
+    try {
+        return runCommand(args) ? 0 : 1;
+    } catch (const tibee::common::ex::StateHistory& ex) {
+        tberror() << "state history error: " << ex.what() << tbendl();
+    } catch (const std::exception& ex) {
+        tberror() << "unknown error: " << ex.what() << tbendl();
+    }
+
+    return 1;
+}
@@ -0,0 +1,230 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <chrono>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <type_traits>
+
+#include <common/trace/EventValueArena.hpp>
+#include <common/trace/EventValueFactory.hpp>
+
+/* Microbenchmark comparing the event value arena with the former
+ * std::list-backed event value pools, for the number of event values
+ * built for a few typical LTTng kernel events.
+ */
+
+namespace
+{
+
+using namespace tibee::common;
+
+// former EventValuePool implementation, kept here for comparison
+template<typename T>
+class ListPool
+{
+public:
+    ListPool(std::size_t initCapacity)
+    {
+        _pool.resize(initCapacity);
+        this->reset();
+    }
+
+    T* get()
+    {
+        auto ret = static_cast<T*>(static_cast<void*>(std::addressof(*_nextIt)));
+
+        _size++;
+
+        if (_size > _pool.size()) {
+            _pool.resize(_pool.size() * 2);
+        }
+
+        _nextIt++;
+
+        return ret;
+    }
+
+    void reset()
+    {
+        _size = 1;
+        _nextIt = _pool.begin();
+    }
+
+private:
+    typedef typename std::aligned_storage<sizeof(T), alignof(T)>::type alignedT;
+
+private:
+    std::list<alignedT> _pool;
+    std::size_t _size;
+    typename std::list<alignedT>::iterator _nextIt;
+};
+
+// pools of the former EventValueFactory, with the same capacities
+struct ListPools
+{
+    ListPools() :
+        arrayPool {128},
+        dictPool {32},
+        sintPool {128},
+        stringPool {64},
+        uintPool {128}
+    {
+    }
+
+    void reset()
+    {
+        arrayPool.reset();
+        dictPool.reset();
+        sintPool.reset();
+        stringPool.reset();
+        uintPool.reset();
+    }
+
+    template<typename T>
+    T* get();
+
+    ListPool<ArrayEventValue> arrayPool;
+    ListPool<DictEventValue> dictPool;
+    ListPool<SintEventValue> sintPool;
+    ListPool<StringEventValue> stringPool;
+    ListPool<UintEventValue> uintPool;
+};
+
+template<>
+ArrayEventValue* ListPools::get<ArrayEventValue>()
+{
+    return arrayPool.get();
+}
+
+template<>
+DictEventValue* ListPools::get<DictEventValue>()
+{
+    return dictPool.get();
+}
+
+template<>
+SintEventValue* ListPools::get<SintEventValue>()
+{
+    return sintPool.get();
+}
+
+template<>
+StringEventValue* ListPools::get<StringEventValue>()
+{
+    return stringPool.get();
+}
+
+template<>
+UintEventValue* ListPools::get<UintEventValue>()
+{
+    return uintPool.get();
+}
+
+// number of event values of each type built for one event
+struct EventProfile
+{
+    const char* name;
+    std::size_t dicts;
+    std::size_t arrays;
+    std::size_t sints;
+    std::size_t uints;
+    std::size_t strings;
+};
+
+const EventProfile PROFILES[] = {
+    // fields and context dictionaries, a few integers
+    {"syscall_entry_read", 2, 0, 1, 4, 0},
+
+    // two 16-character arrays (one integer child per character)
+    {"sched_switch", 2, 2, 36, 2, 0},
+
+    // file name, many integers
+    {"lttng_statedump_file_descriptor", 2, 0, 3, 6, 1},
+
+    // 64-byte array
+    {"net_if_receive_skb", 2, 1, 66, 4, 0},
+};
+
+template<typename T, typename Allocator>
+void touch(Allocator& allocator, std::size_t count, std::size_t& checksum)
+{
+    for (std::size_t x = 0; x < count; ++x) {
+        auto obj = allocator.template get<T>();
+
+        // write the whole object, like a constructor would
+        std::memset(static_cast<void*>(obj), static_cast<int>(x), sizeof(T));
+        checksum += reinterpret_cast<const unsigned char*>(obj)[sizeof(T) - 1];
+    }
+}
+
+template<typename Allocator>
+double run(Allocator& allocator, const EventProfile& profile,
+           std::size_t eventsCount, std::size_t& checksum)
+{
+    auto begin = std::chrono::steady_clock::now();
+
+    for (std::size_t x = 0; x < eventsCount; ++x) {
+        allocator.reset();
+        touch<DictEventValue>(allocator, profile.dicts, checksum);
+        touch<ArrayEventValue>(allocator, profile.arrays, checksum);
+        touch<SintEventValue>(allocator, profile.sints, checksum);
+        touch<UintEventValue>(allocator, profile.uints, checksum);
+        touch<StringEventValue>(allocator, profile.strings, checksum);
+    }
+
+    auto end = std::chrono::steady_clock::now();
+    std::chrono::duration<double, std::nano> elapsed = end - begin;
+
+    return elapsed.count() / eventsCount;
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    const std::size_t eventsCount = 2000000;
+    std::size_t checksum = 0;
+
+    std::cout << "event                              list pools (ns)   arena (ns)" <<
+                 std::endl;
+
+    for (const auto& profile : PROFILES) {
+        ListPools listPools;
+        EventValueArena arena;
+
+        // warm up (let both grow to their steady state)
+        run(listPools, profile, 1000, checksum);
+        run(arena, profile, 1000, checksum);
+
+        auto listNs = run(listPools, profile, eventsCount, checksum);
+        auto arenaNs = run(arena, profile, eventsCount, checksum);
+
+        std::cout.width(35);
+        std::cout << std::left << profile.name;
+        std::cout.width(18);
+        std::cout << listNs << arenaNs << std::endl;
+    }
+
+    // make sure nothing is optimized away
+    std::cout << "(checksum: " << checksum << ")" << std::endl;
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StateChange.hpp>
+#include <common/state/StateChangeWriter.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/utils/MappedFile.hpp>
+#include <common/ex/StateHistory.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class StateChangeWriterTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StateChangeWriterTest);
+        CPPUNIT_TEST(testWrite);
+        CPPUNIT_TEST(testReopen);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testWrite();
+    void testReopen();
+
+private:
+    void writeChanges();
+
+private:
+    bfs::path _dir;
+    bfs::path _path;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StateChangeWriterTest);
+
+void StateChangeWriterTest::setUp()
+{
+    _dir = createTempDir();
+    _path = _dir / "changes.dat";
+}
+
+void StateChangeWriterTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void StateChangeWriterTest::writeChanges()
+{
+    StateChangeWriter writer;
+
+    writer.open(_path);
+    CPPUNIT_ASSERT(writer.isOpen());
+    writer.write(100, 1, StateValue {std::int32_t {-5}});
+    writer.write(100, 2, StateValue {Quark {12}});
+    writer.write(200, 1, StateValue {});
+    writer.write(300, 3, StateValue {std::uint64_t {1} << 40});
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(4), writer.getCount());
+    writer.close();
+    CPPUNIT_ASSERT(!writer.isOpen());
+}
+
+void StateChangeWriterTest::testWrite()
+{
+    this->writeChanges();
+
+    MappedFile file {_path};
+    auto changes = reinterpret_cast<const StateChange*>(file.getData());
+
+    CPPUNIT_ASSERT_EQUAL(4 * sizeof(StateChange), file.getSize());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(100), changes[1].ts);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(2), changes[1].id);
+
+    auto value = StateValue::fromRaw(static_cast<StateValueType>(changes[1].type),
+                                     changes[1].value);
+
+    CPPUNIT_ASSERT(value.isQuark());
+    CPPUNIT_ASSERT_EQUAL(static_cast<quark_t>(12), value.asQuark().get());
+    CPPUNIT_ASSERT(StateValue::fromRaw(static_cast<StateValueType>(changes[2].type),
+                                       changes[2].value).isNull());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(1) << 40, changes[3].value);
+}
+
+void StateChangeWriterTest::testReopen()
+{
+    this->writeChanges();
+
+    // changes after the first 3 are removed, new ones are appended
+    {
+        StateChangeWriter writer;
+
+        writer.reopen(_path, 3);
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), writer.getCount());
+        writer.write(250, 4, StateValue {std::int32_t {7}});
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(4), writer.getCount());
+        writer.close();
+    }
+
+    // cannot keep more changes than the log has
+    {
+        StateChangeWriter writer;
+
+        CPPUNIT_ASSERT_THROW(writer.reopen(_path, 5), ex::StateHistory);
+        CPPUNIT_ASSERT(!writer.isOpen());
+    }
+
+    MappedFile file {_path};
+    auto changes = reinterpret_cast<const StateChange*>(file.getData());
+
+    CPPUNIT_ASSERT_EQUAL(4 * sizeof(StateChange), file.getSize());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(200), changes[2].ts);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(250), changes[3].ts);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint32_t>(4), changes[3].id);
+}
@@ -0,0 +1,148 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StateCheckpointReader.hpp>
+#include <common/state/StateCheckpointWriter.hpp>
+#include <common/state/StateValue.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class StateCheckpointTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StateCheckpointTest);
+        CPPUNIT_TEST(testMissing);
+        CPPUNIT_TEST(testRoundTrip);
+        CPPUNIT_TEST(testTruncated);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testMissing();
+    void testRoundTrip();
+    void testTruncated();
+
+private:
+    void writeCheckpoints();
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StateCheckpointTest);
+
+void StateCheckpointTest::setUp()
+{
+    _dir = createTempDir();
+}
+
+void StateCheckpointTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void StateCheckpointTest::writeCheckpoints()
+{
+    StateCheckpointWriter writer;
+
+    writer.open(_dir / "cp.dat", _dir / "cp.idx");
+
+    // empty state at 100
+    writer.commit(100);
+
+    // two nodes at 200
+    writer.addNode(150, 1, StateValue {std::int32_t {-5}});
+    writer.addNode(180, 4, StateValue {Quark {12}});
+    writer.commit(200);
+
+    // one node at 300
+    writer.addNode(250, 2, StateValue {std::uint64_t {1} << 40});
+    writer.commit(300);
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), writer.getCount());
+    writer.close();
+}
+
+void StateCheckpointTest::testMissing()
+{
+    StateCheckpointReader reader {_dir / "nope.dat", _dir / "nope.idx"};
+    std::size_t index;
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), reader.getCount());
+    CPPUNIT_ASSERT(!reader.findNearest(1000, index));
+}
+
+void StateCheckpointTest::testRoundTrip()
+{
+    this->writeCheckpoints();
+
+    StateCheckpointReader reader {_dir / "cp.dat", _dir / "cp.idx"};
+    StateCheckpointReader::State state;
+    std::size_t index;
+    timestamp_t checkpointTs;
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), reader.getCount());
+
+    // nearest checkpoint
+    CPPUNIT_ASSERT(!reader.findNearest(99, index));
+    CPPUNIT_ASSERT(reader.findNearest(100, index));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), index);
+    CPPUNIT_ASSERT(reader.findNearest(299, index));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), index);
+    CPPUNIT_ASSERT(reader.findNearest(5000, index));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), index);
+
+    // full state
+    CPPUNIT_ASSERT(reader.getStateAt(100, state, checkpointTs));
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(100), checkpointTs);
+    CPPUNIT_ASSERT(state.empty());
+
+    CPPUNIT_ASSERT(reader.getStateAt(250, state, checkpointTs));
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(200), checkpointTs);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(5), state.size());
+    CPPUNIT_ASSERT(state[0].value.isNull());
+    CPPUNIT_ASSERT(state[1].value == StateValue {std::int32_t {-5}});
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(150), state[1].beginTs);
+    CPPUNIT_ASSERT(state[2].value.isNull());
+    CPPUNIT_ASSERT(state[4].value == StateValue {Quark {12}});
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(180), state[4].beginTs);
+
+    reader.getState(2, state);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), state.size());
+    CPPUNIT_ASSERT(state[2].value == StateValue {std::uint64_t {1} << 40});
+}
+
+void StateCheckpointTest::testTruncated()
+{
+    this->writeCheckpoints();
+
+    // build killed while writing the last checkpoint
+    bfs::resize_file(_dir / "cp.dat", 2 * sizeof(StateCheckpoint::Node));
+
+    StateCheckpointReader reader {_dir / "cp.dat", _dir / "cp.idx"};
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), reader.getCount());
+}
@@ -0,0 +1,269 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StateHistorySink.hpp>
+#include <common/state/StateHistory.hpp>
+#include <common/state/CurrentState.hpp>
+#include <common/state/StateNode.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/ex/StateHistory.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class StateHistoryTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StateHistoryTest);
+        CPPUNIT_TEST(testPaths);
+        CPPUNIT_TEST(testGetValue);
+        CPPUNIT_TEST(testGetSubtree);
+        CPPUNIT_TEST(testGetIntervals);
+        CPPUNIT_TEST(testNoChangeLog);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testPaths();
+    void testGetValue();
+    void testGetSubtree();
+    void testGetIntervals();
+    void testNoChangeLog();
+
+private:
+    void buildHistory(bool changeLog);
+    state_node_id_t getNodeId(const StateHistory& history,
+                              const std::string& path) const;
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StateHistoryTest);
+
+void StateHistoryTest::setUp()
+{
+    _dir = createTempDir();
+}
+
+void StateHistoryTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void StateHistoryTest::buildHistory(bool changeLog)
+{
+    StateHistorySink sink {
+        _dir / "state-strings.db",
+        _dir / "state-nodes.json",
+        _dir / "state-history.delo",
+        0
+    };
+
+    if (changeLog) {
+        sink.enableChangeLog(_dir / "state-changes.dat");
+
+        // checkpoint every 2 events: queries start from most of them
+        sink.enableCheckpoints(_dir / "state-checkpoints.dat",
+                               _dir / "state-checkpoints.idx", 2, 0);
+    }
+
+    auto& root = sink.getCurrentState().getRoot();
+
+    sink.setCurrentTimestamp(10);
+    root["a"]["x"] = std::int32_t {1};
+    root["a"]["y"] = std::int32_t {10};
+    root["a"][23] = std::int32_t {100};
+    root["a"]["23"] = std::int32_t {200};
+
+    sink.setCurrentTimestamp(20);
+    root["a"]["x"] = std::int32_t {2};
+
+    // same value: coalesced, no change
+    sink.setCurrentTimestamp(25);
+    root["a"]["x"] = std::int32_t {2};
+
+    sink.setCurrentTimestamp(30);
+    root["a"]["y"].setNull();
+
+    sink.setCurrentTimestamp(40);
+    root["a"]["x"] = std::int32_t {3};
+
+    sink.setCurrentTimestamp(45);
+    sink.setCurrentTimestamp(50);
+    sink.close();
+}
+
+state_node_id_t StateHistoryTest::getNodeId(const StateHistory& history,
+                                            const std::string& path) const
+{
+    state_node_id_t id;
+
+    CPPUNIT_ASSERT(history.getNodeId(path, id));
+
+    return id;
+}
+
+void StateHistoryTest::testPaths()
+{
+    this->buildHistory(true);
+
+    StateHistory history {_dir};
+    state_node_id_t id;
+
+    CPPUNIT_ASSERT(history.getNodeId("", id));
+    CPPUNIT_ASSERT_EQUAL(static_cast<state_node_id_t>(0), id);
+    CPPUNIT_ASSERT(history.getNodePath(0) == "/");
+    CPPUNIT_ASSERT(history.getNodePath(this->getNodeId(history, "/a/x/")) == "/a/x");
+    CPPUNIT_ASSERT(!history.getNodeId("a/z", id));
+    CPPUNIT_ASSERT_THROW(history.getNodePath(1000), ex::StateHistory);
+
+    // integer and string keys are distinct children
+    auto aId = this->getNodeId(history, "a");
+    state_node_id_t intId;
+    state_node_id_t strId;
+
+    CPPUNIT_ASSERT(history.getChildId(aId, std::int64_t {23}, intId));
+    CPPUNIT_ASSERT(history.getChildId(aId, std::string {"23"}, strId));
+    CPPUNIT_ASSERT(intId != strId);
+    CPPUNIT_ASSERT_EQUAL(intId, this->getNodeId(history, "a/23"));
+}
+
+void StateHistoryTest::testGetValue()
+{
+    this->buildHistory(true);
+
+    StateHistory history {_dir};
+    auto xId = this->getNodeId(history, "a/x");
+    auto yId = this->getNodeId(history, "a/y");
+    timestamp_t beginTs = 1234;
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(50), history.getEnd());
+
+    // before any change: null since the beginning
+    CPPUNIT_ASSERT(history.getValue(xId, 5, beginTs).isNull());
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(0), beginTs);
+
+    CPPUNIT_ASSERT(history.getValue(xId, 10, beginTs) == StateValue {std::int32_t {1}});
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(10), beginTs);
+
+    // coalesced assignment at 25 doesn't restart the value
+    CPPUNIT_ASSERT(history.getValue(xId, 35, beginTs) == StateValue {std::int32_t {2}});
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(20), beginTs);
+
+    CPPUNIT_ASSERT(history.getValue(xId, 45, beginTs) == StateValue {std::int32_t {3}});
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(40), beginTs);
+
+    CPPUNIT_ASSERT(history.getValue(yId, 29, beginTs) == StateValue {std::int32_t {10}});
+    CPPUNIT_ASSERT(history.getValue(yId, 30, beginTs).isNull());
+    CPPUNIT_ASSERT_THROW(history.getValue(1000, 10, beginTs), ex::StateHistory);
+}
+
+void StateHistoryTest::testGetSubtree()
+{
+    this->buildHistory(true);
+
+    StateHistory history {_dir};
+    auto aId = this->getNodeId(history, "a");
+    auto xId = this->getNodeId(history, "a/x");
+    auto yId = this->getNodeId(history, "a/y");
+    std::vector<StateHistory::NodeValue> values;
+
+    // nothing yet
+    history.getSubtree(0, 5, values);
+    CPPUNIT_ASSERT(values.empty());
+
+    // x, y, 23 and "23" (in node ID order)
+    history.getSubtree(aId, 25, values);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(4), values.size());
+    CPPUNIT_ASSERT_EQUAL(xId, values[0].id);
+    CPPUNIT_ASSERT(values[0].value == StateValue {std::int32_t {2}});
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(20), values[0].beginTs);
+    CPPUNIT_ASSERT_EQUAL(yId, values[1].id);
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(10), values[1].beginTs);
+
+    // y is null now
+    values.clear();
+    history.getSubtree(aId, 45, values);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), values.size());
+    CPPUNIT_ASSERT_EQUAL(xId, values[0].id);
+    CPPUNIT_ASSERT(values[0].value == StateValue {std::int32_t {3}});
+
+    // subtree of a leaf
+    values.clear();
+    history.getSubtree(xId, 15, values);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), values.size());
+    CPPUNIT_ASSERT(values[0].value == StateValue {std::int32_t {1}});
+}
+
+void StateHistoryTest::testGetIntervals()
+{
+    this->buildHistory(true);
+
+    StateHistory history {_dir};
+    auto xId = this->getNodeId(history, "a/x");
+    auto yId = this->getNodeId(history, "a/y");
+    std::vector<StateHistory::Interval> intervals;
+
+    // whole history (closing the sink ends values at 50)
+    history.getIntervals(xId, 0, 100, intervals);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), intervals.size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(10), intervals[0].beginTs);
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(20), intervals[0].endTs);
+    CPPUNIT_ASSERT(intervals[0].value == StateValue {std::int32_t {1}});
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(20), intervals[1].beginTs);
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(40), intervals[1].endTs);
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(40), intervals[2].beginTs);
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(50), intervals[2].endTs);
+    CPPUNIT_ASSERT(intervals[2].value == StateValue {std::int32_t {3}});
+
+    // only intervals intersecting the range
+    intervals.clear();
+    history.getIntervals(xId, 15, 25, intervals);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), intervals.size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(10), intervals[0].beginTs);
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(40), intervals[1].endTs);
+
+    // null after 30
+    intervals.clear();
+    history.getIntervals(yId, 0, 100, intervals);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), intervals.size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(10), intervals[0].beginTs);
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(30), intervals[0].endTs);
+
+    intervals.clear();
+    history.getIntervals(yId, 31, 100, intervals);
+    CPPUNIT_ASSERT(intervals.empty());
+}
+
+void StateHistoryTest::testNoChangeLog()
+{
+    // the change log is opt-in
+    this->buildHistory(false);
+
+    CPPUNIT_ASSERT(!bfs::exists(_dir / "state-changes.dat"));
+    CPPUNIT_ASSERT_THROW(StateHistory {_dir}, ex::StateHistory);
+}
@@ -0,0 +1,169 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StateIntervalWriter.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/ex/StateHistory.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class StateIntervalWriterTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StateIntervalWriterTest);
+        CPPUNIT_TEST(testHandoff);
+        CPPUNIT_TEST(testErrorOnHandoff);
+        CPPUNIT_TEST(testErrorOnClose);
+        CPPUNIT_TEST(testHandoffErrorOnClose);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testHandoff();
+    void testErrorOnHandoff();
+    void testErrorOnClose();
+    void testHandoffErrorOnClose();
+
+private:
+    static void writeValid(StateIntervalWriter& writer, std::size_t count);
+    static void writeInvalid(StateIntervalWriter& writer);
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StateIntervalWriterTest);
+
+void StateIntervalWriterTest::setUp()
+{
+    _dir = createTempDir();
+}
+
+void StateIntervalWriterTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void StateIntervalWriterTest::writeValid(StateIntervalWriter& writer,
+                                         std::size_t count)
+{
+    for (std::size_t x = 0; x < count; ++x) {
+        auto ts = static_cast<timestamp_t>(x) * 10;
+
+        writer.write(ts, ts + 10, static_cast<state_node_id_t>(x % 64),
+                     StateValue {static_cast<std::uint32_t>(x)});
+    }
+}
+
+void StateIntervalWriterTest::writeInvalid(StateIntervalWriter& writer)
+{
+    // ends before it begins
+    writer.write(100, 50, 0, StateValue {std::int32_t {-1}});
+}
+
+void StateIntervalWriterTest::testHandoff()
+{
+    const auto bufSize = StateIntervalWriter::BUFFER_SIZE;
+    StateIntervalWriter writer;
+
+    // many buffers, last one partially filled, over reopened files
+    for (std::size_t run = 0; run < 3; ++run) {
+        writer.open(_dir / ("history-" + std::to_string(run) + ".delo"));
+        writeValid(writer, bufSize * 5 + run * 7 + 1);
+        writer.close();
+    }
+
+    // exactly full buffers leave nothing pending at close
+    writer.open(_dir / "history-full.delo");
+    writeValid(writer, bufSize * 2);
+    writer.close();
+
+    // closing twice is harmless
+    writer.close();
+}
+
+void StateIntervalWriterTest::testErrorOnHandoff()
+{
+    const auto bufSize = StateIntervalWriter::BUFFER_SIZE;
+    StateIntervalWriter writer;
+
+    writer.open(_dir / "history.delo");
+
+    // first buffer (handed over by its last record) fails
+    writeInvalid(writer);
+    writeValid(writer, bufSize - 1);
+
+    /* The second handover waits for the writer thread to be done with
+     * the first buffer, so it reports the error.
+     */
+    writeValid(writer, bufSize - 1);
+    CPPUNIT_ASSERT_THROW(writeValid(writer, 1), tibee::common::ex::StateHistory);
+
+    // reported once: following writes and closing don't throw
+    writeValid(writer, bufSize * 2);
+    writer.close();
+
+    // a reopened writer works again
+    writer.open(_dir / "history-2.delo");
+    writeValid(writer, bufSize + 1);
+    writer.close();
+}
+
+void StateIntervalWriterTest::testErrorOnClose()
+{
+    StateIntervalWriter writer;
+
+    // failing partial buffer is only written at close
+    writer.open(_dir / "history.delo");
+    writeValid(writer, 10);
+    writeInvalid(writer);
+    CPPUNIT_ASSERT_THROW(writer.close(), tibee::common::ex::StateHistory);
+
+    // closed anyway
+    writer.close();
+}
+
+void StateIntervalWriterTest::testHandoffErrorOnClose()
+{
+    const auto bufSize = StateIntervalWriter::BUFFER_SIZE;
+    StateIntervalWriter writer;
+
+    writer.open(_dir / "history.delo");
+
+    // full first buffer fails, then a partial buffer is left at close
+    writeInvalid(writer);
+    writeValid(writer, bufSize - 1);
+    writeValid(writer, 10);
+
+    // reported by close(), which still stops the writer thread
+    CPPUNIT_ASSERT_THROW(writer.close(), tibee::common::ex::StateHistory);
+    writer.close();
+
+    // a reopened writer works again
+    writer.open(_dir / "history-2.delo");
+    writeValid(writer, bufSize + 1);
+    writer.close();
+}
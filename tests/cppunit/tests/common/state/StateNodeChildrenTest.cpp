@@ -0,0 +1,102 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StateNodeChildren.hpp>
+
+using namespace tibee::common;
+
+class StateNodeChildrenTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StateNodeChildrenTest);
+        CPPUNIT_TEST(testEmpty);
+        CPPUNIT_TEST(testLinear);
+        CPPUNIT_TEST(testHashed);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testEmpty();
+    void testLinear();
+    void testHashed();
+
+private:
+    static std::size_t countSlots(const StateNodeChildren& children);
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StateNodeChildrenTest);
+
+std::size_t StateNodeChildrenTest::countSlots(const StateNodeChildren& children)
+{
+    std::size_t count = 0;
+
+    for (const auto& entry : children) {
+        if (entry.id != StateNodeChildren::NO_NODE) {
+            count++;
+        }
+    }
+
+    return count;
+}
+
+void StateNodeChildrenTest::testEmpty()
+{
+    const StateNodeChildren children;
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), children.size());
+    CPPUNIT_ASSERT(children.begin() == children.end());
+    CPPUNIT_ASSERT(StateNodeChildren::NO_NODE == children.find(0));
+}
+
+void StateNodeChildrenTest::testLinear()
+{
+    StateNodeChildren children;
+
+    for (quark_t q = 0; q < StateNodeChildren::LINEAR_MAX; ++q) {
+        children.insert(q * 3, q + 100);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(StateNodeChildren::LINEAR_MAX),
+                         children.size());
+    CPPUNIT_ASSERT_EQUAL(children.size(), countSlots(children));
+
+    for (quark_t q = 0; q < StateNodeChildren::LINEAR_MAX; ++q) {
+        CPPUNIT_ASSERT_EQUAL(q + 100, children.find(q * 3));
+        CPPUNIT_ASSERT(StateNodeChildren::NO_NODE == children.find(q * 3 + 1));
+    }
+}
+
+void StateNodeChildrenTest::testHashed()
+{
+    StateNodeChildren children;
+    const quark_t count = 100000;
+
+    for (quark_t q = 0; q < count; ++q) {
+        children.insert(q * 7, count - q);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(count), children.size());
+    CPPUNIT_ASSERT_EQUAL(children.size(), countSlots(children));
+
+    for (quark_t q = 0; q < count; ++q) {
+        CPPUNIT_ASSERT_EQUAL(count - q, children.find(q * 7));
+    }
+
+    CPPUNIT_ASSERT(StateNodeChildren::NO_NODE == children.find(1));
+    CPPUNIT_ASSERT(StateNodeChildren::NO_NODE == children.find(count * 7));
+}
@@ -0,0 +1,219 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <memory>
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StateHistorySink.hpp>
+#include <common/state/CurrentState.hpp>
+#include <common/state/StateNode.hpp>
+#include <common/state/StatePathHandle.hpp>
+#include <common/ex/WrongStatePath.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class StatePathHandleTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StatePathHandleTest);
+        CPPUNIT_TEST(testConstant);
+        CPPUNIT_TEST(testOneVariable);
+        CPPUNIT_TEST(testTwoVariables);
+        CPPUNIT_TEST(testIntKeyFallback);
+        CPPUNIT_TEST(testStringKeys);
+        CPPUNIT_TEST(testInvalidTemplates);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testConstant();
+    void testOneVariable();
+    void testTwoVariables();
+    void testIntKeyFallback();
+    void testStringKeys();
+    void testInvalidTemplates();
+
+private:
+    bfs::path _dir;
+    std::unique_ptr<StateHistorySink> _sink;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StatePathHandleTest);
+
+void StatePathHandleTest::setUp()
+{
+    _dir = createTempDir();
+    _sink = std::unique_ptr<StateHistorySink> {
+        new StateHistorySink {
+            _dir / "state-strings.db",
+            _dir / "state-nodes.json",
+            _dir / "state-history.delo",
+            0
+        }
+    };
+}
+
+void StatePathHandleTest::tearDown()
+{
+    _sink.reset();
+    removeTempDir(_dir);
+}
+
+void StatePathHandleTest::testConstant()
+{
+    auto& state = _sink->getCurrentState();
+    auto& root = state.getRoot();
+
+    // empty template is the root itself
+    StatePathHandle rootHandle {state, ""};
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0),
+                         rootHandle.getVariablesCount());
+    CPPUNIT_ASSERT(&root == &rootHandle.getNode());
+
+    StatePathHandle handle {state, "linux/cpus/count"};
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0),
+                         handle.getVariablesCount());
+    CPPUNIT_ASSERT(&root["linux"]["cpus"]["count"] == &handle.getNode());
+}
+
+void StatePathHandleTest::testOneVariable()
+{
+    auto& state = _sink->getCurrentState();
+    auto& root = state.getRoot();
+    StatePathHandle handle {state, "linux/threads/{int}/status"};
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1),
+                         handle.getVariablesCount());
+
+    // resolved nodes are the ones a chain of operator[]() returns
+    auto& node23 = handle.getNode(23);
+    auto& node42 = handle.getNode(42);
+
+    CPPUNIT_ASSERT(&root["linux"]["threads"][23]["status"] == &node23);
+    CPPUNIT_ASSERT(&root["linux"]["threads"][42]["status"] == &node42);
+    CPPUNIT_ASSERT(&node23 != &node42);
+
+    // cached nodes remain the same
+    CPPUNIT_ASSERT(&handle.getNode(23) == &node23);
+    CPPUNIT_ASSERT(&handle.getNode(23) == &node23);
+    CPPUNIT_ASSERT(&handle.getNode(42) == &node42);
+
+    // integer keys are not string keys
+    CPPUNIT_ASSERT(&root["linux"]["threads"]["23"]["status"] != &node23);
+}
+
+void StatePathHandleTest::testTwoVariables()
+{
+    auto& state = _sink->getCurrentState();
+    auto& root = state.getRoot();
+    StatePathHandle handle {state, "linux/cpus/{int}/irqs/{int}"};
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2),
+                         handle.getVariablesCount());
+
+    auto& node12 = handle.getNode(1, 2);
+    auto& node21 = handle.getNode(2, 1);
+
+    CPPUNIT_ASSERT(&root["linux"]["cpus"][1]["irqs"][2] == &node12);
+    CPPUNIT_ASSERT(&root["linux"]["cpus"][2]["irqs"][1] == &node21);
+    CPPUNIT_ASSERT(&node12 != &node21);
+    CPPUNIT_ASSERT(&handle.getNode(1, 2) == &node12);
+}
+
+void StatePathHandleTest::testIntKeyFallback()
+{
+    auto& state = _sink->getCurrentState();
+    auto& root = state.getRoot();
+    StatePathHandle handle {state, "ust/{int}"};
+
+    // keys which don't fit an integer quark use their string
+    auto& negNode = handle.getNode(-5);
+    auto& bigNode = handle.getNode(std::int64_t {1} << 40);
+
+    CPPUNIT_ASSERT(&root["ust"]["-5"] == &negNode);
+    CPPUNIT_ASSERT(&root["ust"][std::to_string(std::int64_t {1} << 40)] ==
+                   &bigNode);
+
+    // ...while small ones don't
+    CPPUNIT_ASSERT(&root["ust"][std::int64_t {5}] == &handle.getNode(5));
+    CPPUNIT_ASSERT(&root["ust"]["5"] != &handle.getNode(5));
+}
+
+void StatePathHandleTest::testStringKeys()
+{
+    typedef StatePathHandle::VariableKey VariableKey;
+
+    auto& state = _sink->getCurrentState();
+    auto& root = state.getRoot();
+    StatePathHandle handle {state, "procs/{int}/files/{int}"};
+    auto bash = static_cast<std::int64_t>(state.getQuark("bash").get());
+    auto five = static_cast<std::int64_t>(state.getQuark("5").get());
+
+    // string, integer and mixed keys
+    auto& bash3 = handle.getNode(VariableKey {bash, true},
+                                 VariableKey {3, false});
+    auto& fiveStr = handle.getNode(VariableKey {five, true},
+                                   VariableKey {five, true});
+    auto& fiveInt = handle.getNode(VariableKey {5, false},
+                                   VariableKey {5, false});
+
+    CPPUNIT_ASSERT(&root["procs"]["bash"]["files"][3] == &bash3);
+    CPPUNIT_ASSERT(&root["procs"]["5"]["files"]["5"] == &fiveStr);
+    CPPUNIT_ASSERT(&root["procs"][5]["files"][5] == &fiveInt);
+    CPPUNIT_ASSERT(&handle.getNode(5, 5) == &fiveInt);
+
+    // a quark and an integer of the same value are different keys
+    auto& fiveQuarkInt = handle.getNode(VariableKey {five, false},
+                                        VariableKey {five, true});
+
+    CPPUNIT_ASSERT(&root["procs"][five]["files"]["5"] == &fiveQuarkInt);
+    CPPUNIT_ASSERT(&fiveQuarkInt != &fiveStr);
+    CPPUNIT_ASSERT(&handle.getNode(VariableKey {five, true},
+                                   VariableKey {five, true}) == &fiveStr);
+}
+
+void StatePathHandleTest::testInvalidTemplates()
+{
+    auto& state = _sink->getCurrentState();
+
+    CPPUNIT_ASSERT_THROW(StatePathHandle(state, "linux//threads"),
+                         ex::WrongStatePath);
+    CPPUNIT_ASSERT_THROW(StatePathHandle(state, "/linux"),
+                         ex::WrongStatePath);
+    CPPUNIT_ASSERT_THROW(StatePathHandle(state, "linux/"),
+                         ex::WrongStatePath);
+    CPPUNIT_ASSERT_THROW(StatePathHandle(state, "linux/{str}"),
+                         ex::WrongStatePath);
+    CPPUNIT_ASSERT_THROW(StatePathHandle(state, "linux/thr{int}"),
+                         ex::WrongStatePath);
+    CPPUNIT_ASSERT_THROW(StatePathHandle(state, "a/{int}/{int}/{int}"),
+                         ex::WrongStatePath);
+
+    try {
+        StatePathHandle handle {state, "linux/{uint}"};
+        CPPUNIT_FAIL("expecting ex::WrongStatePath");
+    } catch (const ex::WrongStatePath& ex) {
+        CPPUNIT_ASSERT_EQUAL(std::string {"linux/{uint}"}, ex.getPath());
+    }
+}
@@ -0,0 +1,143 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstdint>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StateResumePoint.hpp>
+#include <common/state/StateValue.hpp>
+#include <common/ex/ResumePoint.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class StateResumePointTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StateResumePointTest);
+        CPPUNIT_TEST(testRoundTrip);
+        CPPUNIT_TEST(testMissing);
+        CPPUNIT_TEST(testCorrupted);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testRoundTrip();
+    void testMissing();
+    void testCorrupted();
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StateResumePointTest);
+
+void StateResumePointTest::setUp()
+{
+    _dir = createTempDir();
+}
+
+void StateResumePointTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void StateResumePointTest::testRoundTrip()
+{
+    StateResumePoint resumePoint {1234, 3, 77, 0xfeedbeef12345678ULL};
+
+    resumePoint.addString("linux", 5);
+    resumePoint.addString("", 0);
+    resumePoint.addNode(StateResumePoint::NO_PARENT, 0, StateValue {}, 0);
+    resumePoint.addNode(0, 0, StateValue {}, 0);
+    resumePoint.addNode(1, Quark::fromInt(42).get(), StateValue {std::int64_t {-7}}, 1000);
+    resumePoint.save(_dir / "rp");
+
+    CPPUNIT_ASSERT(!bfs::exists(_dir / "rp.tmp"));
+
+    timestamp_t ts;
+    std::uint64_t fingerprint;
+
+    CPPUNIT_ASSERT(StateResumePoint::readHeader(_dir / "rp", ts, fingerprint));
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(1234), ts);
+    CPPUNIT_ASSERT_EQUAL(0xfeedbeef12345678ULL,
+                         static_cast<unsigned long long>(fingerprint));
+
+    auto loaded = StateResumePoint::load(_dir / "rp");
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(1234), loaded->getTimestamp());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), loaded->getSegment());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(77), loaded->getChangesCount());
+    CPPUNIT_ASSERT(loaded->getFingerprint() == 0xfeedbeef12345678ULL);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), loaded->getStrings().size());
+    CPPUNIT_ASSERT(loaded->getStrings()[0] == "linux");
+    CPPUNIT_ASSERT(loaded->getStrings()[1].empty());
+
+    const auto& nodes = loaded->getNodes();
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), nodes.size());
+    CPPUNIT_ASSERT(nodes[0].parentId == StateResumePoint::NO_PARENT);
+    CPPUNIT_ASSERT(nodes[1].value.isNull());
+    CPPUNIT_ASSERT_EQUAL(1u, nodes[2].parentId);
+    CPPUNIT_ASSERT_EQUAL(Quark::fromInt(42).get(), nodes[2].key);
+    CPPUNIT_ASSERT(nodes[2].value == StateValue {std::int64_t {-7}});
+    CPPUNIT_ASSERT_EQUAL(static_cast<timestamp_t>(1000), nodes[2].beginTs);
+}
+
+void StateResumePointTest::testMissing()
+{
+    timestamp_t ts;
+    std::uint64_t fingerprint;
+    bool thrown = false;
+
+    CPPUNIT_ASSERT(!StateResumePoint::readHeader(_dir / "nope", ts, fingerprint));
+
+    try {
+        StateResumePoint::load(_dir / "nope");
+    } catch (const ex::ResumePoint&) {
+        thrown = true;
+    }
+
+    CPPUNIT_ASSERT(thrown);
+}
+
+void StateResumePointTest::testCorrupted()
+{
+    StateResumePoint resumePoint {10, 1, 0, 0};
+
+    resumePoint.addNode(StateResumePoint::NO_PARENT, 0, StateValue {}, 0);
+    resumePoint.addNode(0, 0, StateValue {std::uint32_t {1}}, 5);
+    resumePoint.save(_dir / "rp");
+
+    // cut last node
+    bfs::resize_file(_dir / "rp", bfs::file_size(_dir / "rp") - 1);
+
+    bool thrown = false;
+
+    try {
+        StateResumePoint::load(_dir / "rp");
+    } catch (const ex::ResumePoint&) {
+        thrown = true;
+    }
+
+    CPPUNIT_ASSERT(thrown);
+}
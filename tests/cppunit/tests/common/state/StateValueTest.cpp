@@ -0,0 +1,122 @@
+/* Copyright (c) 2014 Francois Doray <francois.pierre-doray@polymtl.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StateValue.hpp>
+#include <common/state/Sint64StateValue.hpp>
+#include <common/state/QuarkStateValue.hpp>
+#include <common/state/NullStateValue.hpp>
+
+using namespace tibee::common;
+
+class StateValueTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StateValueTest);
+        CPPUNIT_TEST(testNull);
+        CPPUNIT_TEST(testConstructorsAndGetters);
+        CPPUNIT_TEST(testFromAbstract);
+        CPPUNIT_TEST(testCopy);
+        CPPUNIT_TEST(testEquality);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testNull();
+    void testConstructorsAndGetters();
+    void testFromAbstract();
+    void testCopy();
+    void testEquality();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StateValueTest);
+
+void StateValueTest::testNull()
+{
+    const StateValue value;
+    CPPUNIT_ASSERT(StateValueType::NUL == value.getType());
+    CPPUNIT_ASSERT(value.isNull());
+    CPPUNIT_ASSERT(!static_cast<bool>(value));
+}
+
+void StateValueTest::testConstructorsAndGetters()
+{
+    const StateValue sint32 {static_cast<std::int32_t>(-42)};
+    CPPUNIT_ASSERT(sint32.isSint32());
+    CPPUNIT_ASSERT(!sint32.isUint32());
+    CPPUNIT_ASSERT_EQUAL(-42, sint32.asSint32());
+
+    const StateValue uint32 {42u};
+    CPPUNIT_ASSERT(uint32.isUint32());
+    CPPUNIT_ASSERT_EQUAL(42u, uint32.asUint32());
+
+    const StateValue sint64 {static_cast<std::int64_t>(-1) << 40};
+    CPPUNIT_ASSERT(sint64.isSint64());
+    CPPUNIT_ASSERT(static_cast<std::int64_t>(-1) << 40 == sint64.asSint64());
+
+    const StateValue uint64 {static_cast<std::uint64_t>(1) << 40};
+    CPPUNIT_ASSERT(uint64.isUint64());
+    CPPUNIT_ASSERT(static_cast<std::uint64_t>(1) << 40 == uint64.asUint64());
+
+    const StateValue float32 {1.5f};
+    CPPUNIT_ASSERT(float32.isFloat32());
+    CPPUNIT_ASSERT_EQUAL(1.5f, float32.asFloat32());
+
+    const StateValue quark {Quark {23}};
+    CPPUNIT_ASSERT(quark.isQuark());
+    CPPUNIT_ASSERT(!quark.isNull());
+    CPPUNIT_ASSERT(static_cast<bool>(quark));
+    CPPUNIT_ASSERT_EQUAL(23u, quark.asQuark().get());
+}
+
+void StateValueTest::testFromAbstract()
+{
+    const StateValue sint64 {Sint64StateValue {-7}};
+    CPPUNIT_ASSERT(sint64.isSint64());
+    CPPUNIT_ASSERT(-7 == sint64.asSint64());
+
+    const StateValue quark {QuarkStateValue {Quark {5}}};
+    CPPUNIT_ASSERT(quark.isQuark());
+    CPPUNIT_ASSERT_EQUAL(5u, quark.asQuark().get());
+
+    const StateValue null {NullStateValue {}};
+    CPPUNIT_ASSERT(null.isNull());
+}
+
+void StateValueTest::testCopy()
+{
+    StateValue value {42u};
+    const StateValue copy = value;
+
+    value = StateValue {Quark {3}};
+    CPPUNIT_ASSERT(copy.isUint32());
+    CPPUNIT_ASSERT_EQUAL(42u, copy.asUint32());
+    CPPUNIT_ASSERT(value.isQuark());
+}
+
+void StateValueTest::testEquality()
+{
+    CPPUNIT_ASSERT(StateValue {} == StateValue {});
+    CPPUNIT_ASSERT(StateValue {std::int32_t {23}} == StateValue {std::int32_t {23}});
+    CPPUNIT_ASSERT(StateValue {std::int32_t {23}} != StateValue {std::int32_t {24}});
+    CPPUNIT_ASSERT(StateValue {std::int32_t {23}} != StateValue {std::uint32_t {23}});
+    CPPUNIT_ASSERT(StateValue {std::int32_t {0}} != StateValue {});
+    CPPUNIT_ASSERT(StateValue {Quark {7}} == StateValue {Quark {7}});
+    CPPUNIT_ASSERT(StateValue {Quark {7}} != StateValue {std::uint32_t {7}});
+    CPPUNIT_ASSERT(StateValue {std::int64_t {-1}} != StateValue {std::int32_t {-1}});
+}
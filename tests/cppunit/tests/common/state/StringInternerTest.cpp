@@ -0,0 +1,110 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cstring>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/state/StringInterner.hpp>
+
+using namespace tibee::common;
+
+class StringInternerTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StringInternerTest);
+        CPPUNIT_TEST(testIntern);
+        CPPUNIT_TEST(testNotNullTerminated);
+        CPPUNIT_TEST(testMany);
+        CPPUNIT_TEST(testLarge);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testIntern();
+    void testNotNullTerminated();
+    void testMany();
+    void testLarge();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StringInternerTest);
+
+void StringInternerTest::testIntern()
+{
+    StringInterner interner;
+
+    auto a = interner.intern("linux", 5);
+    auto b = interner.intern("threads", 7);
+    auto empty = interner.intern("", 0);
+
+    CPPUNIT_ASSERT_EQUAL(0u, a);
+    CPPUNIT_ASSERT_EQUAL(1u, b);
+    CPPUNIT_ASSERT_EQUAL(2u, empty);
+    CPPUNIT_ASSERT_EQUAL(a, interner.intern("linux", 5));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3), interner.size());
+    CPPUNIT_ASSERT(std::strcmp(interner.getString(b), "threads") == 0);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(7), interner.getLength(b));
+    CPPUNIT_ASSERT(interner.hasQuark(2));
+    CPPUNIT_ASSERT(!interner.hasQuark(3));
+
+    interner.clear();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), interner.size());
+    CPPUNIT_ASSERT_EQUAL(0u, interner.intern("threads", 7));
+}
+
+void StringInternerTest::testNotNullTerminated()
+{
+    StringInterner interner;
+    const char buf[] = "statusstatus";
+
+    auto quark = interner.intern(buf, 6);
+
+    CPPUNIT_ASSERT_EQUAL(quark, interner.intern(buf + 6, 6));
+    CPPUNIT_ASSERT(std::strcmp(interner.getString(quark), "status") == 0);
+    CPPUNIT_ASSERT(quark != interner.intern(buf, 5));
+}
+
+void StringInternerTest::testMany()
+{
+    StringInterner interner;
+
+    for (unsigned int x = 0; x < 100000; ++x) {
+        auto str = std::to_string(x);
+
+        CPPUNIT_ASSERT_EQUAL(x, interner.intern(str.c_str(), str.size()));
+    }
+
+    for (unsigned int x = 0; x < 100000; ++x) {
+        auto str = std::to_string(x);
+
+        CPPUNIT_ASSERT_EQUAL(x, interner.intern(str.c_str(), str.size()));
+        CPPUNIT_ASSERT(str == interner.getString(x));
+    }
+}
+
+void StringInternerTest::testLarge()
+{
+    StringInterner interner;
+    const std::string large(100000, 'x');
+
+    auto small = interner.intern("a", 1);
+    auto quark = interner.intern(large.c_str(), large.size());
+
+    CPPUNIT_ASSERT(large == interner.getString(quark));
+    CPPUNIT_ASSERT_EQUAL(small, interner.intern("a", 1));
+    CPPUNIT_ASSERT(std::strcmp(interner.getString(small), "a") == 0);
+}
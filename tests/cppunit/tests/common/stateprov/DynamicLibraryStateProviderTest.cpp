@@ -0,0 +1,290 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <dlfcn.h>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/stateprov/DynamicLibraryStateProvider.hpp>
+#include <common/stateprov/StateProviderConfig.hpp>
+#include <common/state/StateHistorySink.hpp>
+#include <common/trace/TraceSet.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+/* Both test provider libraries (testprovider.cpp) are built next to
+ * testall; SConscript passes their paths.
+ */
+class DynamicLibraryStateProviderTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(DynamicLibraryStateProviderTest);
+        CPPUNIT_TEST(testContexts);
+        CPPUNIT_TEST(testReinit);
+        CPPUNIT_TEST(testLegacyFini);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testContexts();
+    void testReinit();
+    void testLegacyFini();
+
+private:
+    // test hooks exported by the test provider library
+    struct Hooks
+    {
+        void (*reset)();
+        std::size_t (*getInitCount)();
+        void* (*getInitContext)(std::size_t);
+        const char* (*getInstanceName)(std::size_t);
+        std::size_t (*getFiniContextCount)();
+        void* (*getFiniContext)(std::size_t);
+        std::size_t (*getFiniEvents)();
+        std::size_t (*getFiniCalls)();
+    };
+
+private:
+    void writeTrace();
+    void* openHooks(const char* path, Hooks& hooks);
+    void dispatchAll(AbstractStateProvider& provider);
+
+private:
+    static const std::size_t EVENT_COUNT = 3;
+
+    bfs::path _dir;
+    std::unique_ptr<TraceSet> _traceSet;
+    std::unique_ptr<StateHistorySink> _sink;
+    void* _dlHandle;
+    Hooks _hooks;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(DynamicLibraryStateProviderTest);
+
+void DynamicLibraryStateProviderTest::setUp()
+{
+    _dir = createTempDir();
+    this->writeTrace();
+
+    _traceSet = std::unique_ptr<TraceSet> {new TraceSet};
+    CPPUNIT_ASSERT(_traceSet->addTrace(_dir / "trace"));
+
+    _sink = std::unique_ptr<StateHistorySink> {
+        new StateHistorySink {
+            _dir / "state-strings.db",
+            _dir / "state-nodes.json",
+            _dir / "state-history.delo",
+            0
+        }
+    };
+
+    // keeps the library loaded between provider instances
+    _dlHandle = this->openHooks(TIBEE_TESTPROVIDER_PATH, _hooks);
+    _hooks.reset();
+}
+
+void DynamicLibraryStateProviderTest::tearDown()
+{
+    _sink->close();
+    _sink.reset();
+    _traceSet.reset();
+    ::dlclose(_dlHandle);
+    removeTempDir(_dir);
+}
+
+void DynamicLibraryStateProviderTest::writeTrace()
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "stream {\n"
+        "    id = 0;\n"
+        "    event.header := struct {\n"
+        "        uint8_t id;\n"
+        "        uint32_clock_t timestamp;\n"
+        "    };\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint64_clock_t timestamp_begin;\n"
+        "        uint64_clock_t timestamp_end;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event { name = \"a\"; id = 0; stream_id = 0; fields := struct { uint32_t x; }; };\n"
+        "event { name = \"b\"; id = 1; stream_id = 0; fields := struct { uint32_t x; }; };\n";
+
+    // a@100, b@200, a@300
+    std::string events;
+
+    for (std::size_t x = 0; x < EVENT_COUNT; ++x) {
+        appendUint(events, x % 2, 1);
+        appendUint(events, 100 + x * 100, 4);
+        appendUint(events, x, 4);
+    }
+
+    std::string stream;
+
+    appendPacket(stream, 0, 100, 100 + (EVENT_COUNT - 1) * 100, events, true);
+    writeCtfTrace(_dir / "trace", metadata, {stream});
+}
+
+void* DynamicLibraryStateProviderTest::openHooks(const char* path, Hooks& hooks)
+{
+    auto handle = ::dlopen(path, RTLD_NOW);
+
+    CPPUNIT_ASSERT_MESSAGE(path, handle);
+
+    auto sym = [handle] (const char* name) {
+        auto addr = ::dlsym(handle, name);
+
+        CPPUNIT_ASSERT_MESSAGE(name, addr);
+
+        return addr;
+    };
+
+    hooks.reset = reinterpret_cast<decltype(hooks.reset)>(sym("testReset"));
+    hooks.getInitCount = reinterpret_cast<decltype(hooks.getInitCount)>(sym("testGetInitCount"));
+    hooks.getInitContext = reinterpret_cast<decltype(hooks.getInitContext)>(sym("testGetInitContext"));
+    hooks.getInstanceName = reinterpret_cast<decltype(hooks.getInstanceName)>(sym("testGetInstanceName"));
+    hooks.getFiniContextCount = reinterpret_cast<decltype(hooks.getFiniContextCount)>(sym("testGetFiniContextCount"));
+    hooks.getFiniContext = reinterpret_cast<decltype(hooks.getFiniContext)>(sym("testGetFiniContext"));
+    hooks.getFiniEvents = reinterpret_cast<decltype(hooks.getFiniEvents)>(sym("testGetFiniEvents"));
+    hooks.getFiniCalls = reinterpret_cast<decltype(hooks.getFiniCalls)>(sym("testGetFiniCalls"));
+
+    return handle;
+}
+
+void DynamicLibraryStateProviderTest::dispatchAll(AbstractStateProvider& provider)
+{
+    for (auto it = _traceSet->begin(); it != _traceSet->end(); ++it) {
+        provider.onEvent(_sink->getCurrentState(), *it);
+    }
+}
+
+void DynamicLibraryStateProviderTest::testContexts()
+{
+    // two instances of the same library share its globals, not contexts
+    DynamicLibraryStateProvider a {
+        TIBEE_TESTPROVIDER_PATH,
+        StateProviderConfig {"testprovider", "a"}
+    };
+    DynamicLibraryStateProvider b {
+        TIBEE_TESTPROVIDER_PATH,
+        StateProviderConfig {"testprovider", "b"}
+    };
+    auto& state = _sink->getCurrentState();
+
+    a.onInit(state, _traceSet.get());
+    b.onInit(state, _traceSet.get());
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), _hooks.getInitCount());
+
+    auto ctxA = _hooks.getInitContext(0);
+    auto ctxB = _hooks.getInitContext(1);
+
+    CPPUNIT_ASSERT(ctxA);
+    CPPUNIT_ASSERT(ctxB);
+    CPPUNIT_ASSERT(ctxA != ctxB);
+    CPPUNIT_ASSERT_EQUAL(std::string {"a"}, std::string {_hooks.getInstanceName(0)});
+    CPPUNIT_ASSERT_EQUAL(std::string {"b"}, std::string {_hooks.getInstanceName(1)});
+
+    // "a" sees all the events twice, "b" once
+    this->dispatchAll(a);
+    this->dispatchAll(a);
+    this->dispatchAll(b);
+
+    // onFiniContext() receives each instance's own context
+    b.onFini(state);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), _hooks.getFiniContextCount());
+    CPPUNIT_ASSERT(_hooks.getFiniContext(0) == ctxB);
+    CPPUNIT_ASSERT_EQUAL(EVENT_COUNT, _hooks.getFiniEvents());
+
+    a.onFini(state);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), _hooks.getFiniContextCount());
+    CPPUNIT_ASSERT(_hooks.getFiniContext(1) == ctxA);
+    CPPUNIT_ASSERT_EQUAL(2 * EVENT_COUNT, _hooks.getFiniEvents());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), _hooks.getFiniCalls());
+}
+
+void DynamicLibraryStateProviderTest::testReinit()
+{
+    DynamicLibraryStateProvider provider {
+        TIBEE_TESTPROVIDER_PATH,
+        StateProviderConfig {"testprovider", ""}
+    };
+    auto& state = _sink->getCurrentState();
+
+    // interrupted run: no onFini()
+    provider.onInit(state, _traceSet.get());
+    this->dispatchAll(provider);
+
+    auto first = _hooks.getInitContext(0);
+
+    // the leftover context is freed before the library sets a new one
+    provider.onInit(state, _traceSet.get());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), _hooks.getFiniContextCount());
+    CPPUNIT_ASSERT(_hooks.getFiniContext(0) == first);
+    CPPUNIT_ASSERT_EQUAL(EVENT_COUNT, _hooks.getFiniEvents());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), _hooks.getInitCount());
+
+    // callbacks use the new context
+    this->dispatchAll(provider);
+    provider.onFini(state);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), _hooks.getFiniContextCount());
+    CPPUNIT_ASSERT(_hooks.getFiniContext(1) == _hooks.getInitContext(1));
+    CPPUNIT_ASSERT_EQUAL(EVENT_COUNT, _hooks.getFiniEvents());
+}
+
+void DynamicLibraryStateProviderTest::testLegacyFini()
+{
+    Hooks hooks;
+    auto handle = this->openHooks(TIBEE_TESTPROVIDER_LEGACY_PATH, hooks);
+
+    CPPUNIT_ASSERT(!::dlsym(handle, "onFiniContext"));
+    hooks.reset();
+
+    {
+        DynamicLibraryStateProvider provider {
+            TIBEE_TESTPROVIDER_LEGACY_PATH,
+            StateProviderConfig {"testprovider-legacy", ""}
+        };
+        auto& state = _sink->getCurrentState();
+
+        provider.onInit(state, _traceSet.get());
+        this->dispatchAll(provider);
+
+        // a second init must not call onFini(CurrentState&) (no context)
+        provider.onInit(state, _traceSet.get());
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), hooks.getFiniCalls());
+
+        provider.onFini(state);
+    }
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), hooks.getFiniCalls());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), hooks.getFiniContextCount());
+    ::dlclose(handle);
+}
@@ -0,0 +1,359 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/stateprov/EventDispatchTable.hpp>
+#include <common/state/StateHistorySink.hpp>
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/TraceInfos.hpp>
+#include <common/trace/EventInfos.hpp>
+#include <common/trace/TraceUtils.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class EventDispatchTableTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(EventDispatchTableTest);
+        CPPUNIT_TEST(testEventIds);
+        CPPUNIT_TEST(testEmpty);
+        CPPUNIT_TEST(testDispatch);
+        CPPUNIT_TEST(testMissingEvents);
+        CPPUNIT_TEST(testClear);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testEventIds();
+    void testEmpty();
+    void testDispatch();
+    void testMissingEvents();
+    void testClear();
+
+private:
+    typedef EventDispatchTable::OnEventFunc OnEventFunc;
+
+private:
+    void writeTrace(const std::string& name, std::uint64_t tsOffset);
+    event_id_t getEventId(const std::string& traceName,
+                          const std::string& eventName) const;
+    trace_id_t getTraceId(const std::string& traceName) const;
+    void add(const std::string& traceName, const std::string& eventName,
+             const OnEventFunc& onEvent);
+    OnEventFunc logger(const std::string& provider);
+    std::vector<std::string> dispatchAll();
+
+private:
+    bfs::path _dir;
+    std::unique_ptr<TraceSet> _traceSet;
+    EventDispatchTable _table;
+    std::vector<std::string> _log;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EventDispatchTableTest);
+
+namespace
+{
+
+// number of calls of countEvent()
+std::size_t countEventCalls = 0;
+
+bool countEvent(CurrentState&, const Event&)
+{
+    countEventCalls++;
+
+    return true;
+}
+
+// context: number of calls
+bool countContextEvent(void* context, CurrentState&, const Event&)
+{
+    (*static_cast<std::size_t*>(context))++;
+
+    return true;
+}
+
+}
+
+void EventDispatchTableTest::setUp()
+{
+    _dir = createTempDir();
+
+    /* Traces "t0" and "t1" both have stream 0 (events "a" and "b")
+     * and stream 1 (events "c" and "d"). Events of "t1" happen 50 ns
+     * after their "t0" counterparts.
+     */
+    this->writeTrace("t0", 0);
+    this->writeTrace("t1", 50);
+
+    _traceSet = std::unique_ptr<TraceSet> {new TraceSet};
+    CPPUNIT_ASSERT(_traceSet->addTrace(_dir / "t0"));
+    CPPUNIT_ASSERT(_traceSet->addTrace(_dir / "t1"));
+
+    countEventCalls = 0;
+}
+
+void EventDispatchTableTest::tearDown()
+{
+    _traceSet.reset();
+    removeTempDir(_dir);
+}
+
+void EventDispatchTableTest::writeTrace(const std::string& name,
+                                        std::uint64_t tsOffset)
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+
+    for (int streamId = 0; streamId < 2; ++streamId) {
+        metadata +=
+            "stream {\n"
+            "    id = " + std::to_string(streamId) + ";\n"
+            "    event.header := struct {\n"
+            "        uint8_t id;\n"
+            "        uint32_clock_t timestamp;\n"
+            "    };\n"
+            "    packet.context := struct {\n"
+            "        uint64_t packet_size;\n"
+            "        uint64_t content_size;\n"
+            "        uint64_clock_t timestamp_begin;\n"
+            "        uint64_clock_t timestamp_end;\n"
+            "        uint32_t cpu_id;\n"
+            "    };\n"
+            "};\n";
+    }
+
+    // CTF event ID 3 for "d": stream 1 event IDs are sparse
+    metadata +=
+        "event { name = \"a\"; id = 0; stream_id = 0; fields := struct { uint32_t x; }; };\n"
+        "event { name = \"b\"; id = 1; stream_id = 0; fields := struct { uint32_t x; }; };\n"
+        "event { name = \"c\"; id = 0; stream_id = 1; fields := struct { uint32_t x; }; };\n"
+        "event { name = \"d\"; id = 3; stream_id = 1; fields := struct { uint32_t x; }; };\n";
+
+    // stream 0: a@100, b@300; stream 1: d@200, c@400
+    std::string events0;
+    std::string events1;
+
+    appendUint(events0, 0, 1);
+    appendUint(events0, 100 + tsOffset, 4);
+    appendUint(events0, 1, 4);
+    appendUint(events0, 1, 1);
+    appendUint(events0, 300 + tsOffset, 4);
+    appendUint(events0, 2, 4);
+    appendUint(events1, 3, 1);
+    appendUint(events1, 200 + tsOffset, 4);
+    appendUint(events1, 3, 4);
+    appendUint(events1, 0, 1);
+    appendUint(events1, 400 + tsOffset, 4);
+    appendUint(events1, 4, 4);
+
+    std::string stream0;
+    std::string stream1;
+
+    appendPacket(stream0, 0, 100 + tsOffset, 300 + tsOffset, events0, true);
+    appendPacket(stream1, 1, 200 + tsOffset, 400 + tsOffset, events1, true);
+    writeCtfTrace(_dir / name, metadata, {stream0, stream1});
+}
+
+trace_id_t EventDispatchTableTest::getTraceId(const std::string& traceName) const
+{
+    for (const auto& traceInfos : _traceSet->getTracesInfos()) {
+        if (traceInfos->getPath().filename() == traceName) {
+            return traceInfos->getId();
+        }
+    }
+
+    CPPUNIT_FAIL("no trace named " + traceName);
+
+    return -1;
+}
+
+event_id_t EventDispatchTableTest::getEventId(const std::string& traceName,
+                                              const std::string& eventName) const
+{
+    for (const auto& traceInfos : _traceSet->getTracesInfos()) {
+        if (traceInfos->getPath().filename() == traceName) {
+            const auto& eventMap = *traceInfos->getEventMap();
+            auto it = eventMap.find(eventName);
+
+            CPPUNIT_ASSERT(it != eventMap.end());
+
+            return it->second->getId();
+        }
+    }
+
+    CPPUNIT_FAIL("no trace named " + traceName);
+
+    return 0;
+}
+
+void EventDispatchTableTest::add(const std::string& traceName,
+                                 const std::string& eventName,
+                                 const OnEventFunc& onEvent)
+{
+    _table.add(this->getTraceId(traceName),
+               this->getEventId(traceName, eventName), onEvent);
+}
+
+EventDispatchTableTest::OnEventFunc EventDispatchTableTest::logger(const std::string& provider)
+{
+    return [this, provider] (CurrentState&, const Event& event) {
+        auto traceName = event.getTraceId() == this->getTraceId("t0") ?
+                         "t0" : "t1";
+
+        _log.push_back(provider + ":" + traceName + ":" + event.getNameStr());
+
+        return true;
+    };
+}
+
+std::vector<std::string> EventDispatchTableTest::dispatchAll()
+{
+    // fresh state history for each dispatch
+    auto stateDir = _dir / bfs::unique_path("state-%%%%-%%%%");
+
+    bfs::create_directories(stateDir);
+
+    StateHistorySink sink {
+        stateDir / "state-strings.db",
+        stateDir / "state-nodes.json",
+        stateDir / "state-history.delo",
+        0
+    };
+
+    _log.clear();
+
+    for (auto it = _traceSet->begin(); it != _traceSet->end(); ++it) {
+        _table.dispatch(sink.getCurrentState(), *it);
+    }
+
+    sink.close();
+
+    return _log;
+}
+
+void EventDispatchTableTest::testEventIds()
+{
+    // tibee event ID: stream ID in the 12 high bits, CTF event ID below
+    CPPUNIT_ASSERT_EQUAL(TraceUtils::tibeeEventIdFromCtf(0, 0),
+                         this->getEventId("t0", "a"));
+    CPPUNIT_ASSERT_EQUAL(TraceUtils::tibeeEventIdFromCtf(0, 1),
+                         this->getEventId("t0", "b"));
+    CPPUNIT_ASSERT_EQUAL(TraceUtils::tibeeEventIdFromCtf(1, 0),
+                         this->getEventId("t1", "c"));
+    CPPUNIT_ASSERT_EQUAL(TraceUtils::tibeeEventIdFromCtf(1, 3),
+                         this->getEventId("t1", "d"));
+    CPPUNIT_ASSERT_EQUAL(static_cast<event_id_t>((1 << 20) | 3),
+                         this->getEventId("t0", "d"));
+    CPPUNIT_ASSERT(this->getTraceId("t0") != this->getTraceId("t1"));
+}
+
+void EventDispatchTableTest::testEmpty()
+{
+    _table.compile();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), _table.size());
+    CPPUNIT_ASSERT(this->dispatchAll().empty());
+}
+
+void EventDispatchTableTest::testDispatch()
+{
+    // provider 0, then provider 1, as the state history builder does
+    this->add("t0", "a", this->logger("p0"));
+    this->add("t0", "d", this->logger("p0"));
+    this->add("t1", "d", this->logger("p0"));
+    this->add("t1", "d", this->logger("p1"));
+    this->add("t0", "a", this->logger("p1"));
+    this->add("t1", "c", this->logger("p1"));
+    this->add("t0", "a", countEvent);
+
+    std::size_t contextCalls = 0;
+
+    this->add("t1", "d", AbstractStateProvider::ContextEventCallback {
+        countContextEvent,
+        &contextCalls
+    });
+    _table.compile();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(8), _table.size());
+
+    // events in time order; callbacks of an event in order of addition
+    std::vector<std::string> expected {
+        "p0:t0:a", "p1:t0:a",
+        "p0:t0:d",
+        "p0:t1:d", "p1:t1:d",
+        "p1:t1:c",
+    };
+
+    CPPUNIT_ASSERT(this->dispatchAll() == expected);
+
+    // plain function and context callbacks
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), countEventCalls);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), contextCalls);
+}
+
+void EventDispatchTableTest::testMissingEvents()
+{
+    /* Only "t1" has callbacks, and none for events of stream 0: "t0"
+     * events and stream 0 events of "t1" all fall outside the table.
+     */
+    this->add("t1", "d", this->logger("p0"));
+
+    // unknown trace, stream and event: never dispatched
+    auto t1 = this->getTraceId("t1");
+
+    _table.add(t1 + 5, this->getEventId("t1", "a"), this->logger("x"));
+    _table.add(t1, TraceUtils::tibeeEventIdFromCtf(9, 0), this->logger("x"));
+    _table.add(t1, TraceUtils::tibeeEventIdFromCtf(1, 2), this->logger("x"));
+
+    // ignored: invalid trace ID and empty callback
+    _table.add(-1, this->getEventId("t1", "a"), this->logger("x"));
+    _table.add(t1, this->getEventId("t1", "c"), OnEventFunc {});
+    _table.compile();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(4), _table.size());
+
+    std::vector<std::string> expected {"p0:t1:d"};
+
+    CPPUNIT_ASSERT(this->dispatchAll() == expected);
+}
+
+void EventDispatchTableTest::testClear()
+{
+    this->add("t0", "a", this->logger("p0"));
+    _table.compile();
+    _table.clear();
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), _table.size());
+    CPPUNIT_ASSERT(this->dispatchAll().empty());
+
+    // compiling again after clear() only keeps new callbacks
+    this->add("t0", "b", this->logger("p0"));
+    _table.compile();
+
+    std::vector<std::string> expected {"p0:t0:b"};
+
+    CPPUNIT_ASSERT(this->dispatchAll() == expected);
+}
@@ -0,0 +1,406 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/stateprov/PythonStateProvider.hpp>
+#include <common/stateprov/EventDispatchTable.hpp>
+#include <common/stateprov/StateProviderConfig.hpp>
+#include <common/state/StateHistorySink.hpp>
+#include <common/state/CurrentState.hpp>
+#include <common/state/StateNode.hpp>
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/EventBatch.hpp>
+#include <common/ex/WrongStateProvider.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class PythonStateProviderTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(PythonStateProviderTest);
+        CPPUNIT_TEST(testHandlers);
+        CPPUNIT_TEST(testGet);
+        CPPUNIT_TEST(testOneBatch);
+        CPPUNIT_TEST(testSmallBatches);
+        CPPUNIT_TEST(testErrors);
+        CPPUNIT_TEST(testProfiling);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testHandlers();
+    void testGet();
+    void testOneBatch();
+    void testSmallBatches();
+    void testErrors();
+    void testProfiling();
+
+private:
+    void writeTrace();
+    void run(const std::string& script, std::size_t batchSize,
+             bool profiling = false);
+    StateNode& getRoot();
+    std::string getString(const StateNode& node);
+
+private:
+    bfs::path _dir;
+    std::unique_ptr<TraceSet> _traceSet;
+    std::unique_ptr<StateHistorySink> _sink;
+    std::vector<AbstractStateProvider::CallbackProfile> _profiles;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PythonStateProviderTest);
+
+namespace
+{
+
+/* Handlers of "a" and "b" events both set "last" to the x field of
+ * each event, and count their calls and events.
+ */
+const char* const BATCH_SCRIPT =
+    "def on_init(ctx):\n"
+    "    ctx.register('', 'a', on_a)\n"
+    "    ctx.register_regex('.*', 'b', on_b)\n"
+    "\n"
+    "def count(state, name, events):\n"
+    "    calls = state.get(['calls', name], 0)\n"
+    "    state.set(None, ['calls', name], calls + 1)\n"
+    "    total = state.get(['events', name], 0)\n"
+    "    state.set(None, ['events', name], total + len(events))\n"
+    "\n"
+    "def on_a(events, state):\n"
+    "    count(state, 'a', events)\n"
+    "    for ev in events:\n"
+    "        state.set(ev, ['last'], ev['x'])\n"
+    "\n"
+    "def on_b(events, state):\n"
+    "    count(state, 'b', events)\n"
+    "\n"
+    "    # buffered changes of this batch are not visible yet\n"
+    "    state.set(None, ['seen'], state.get('last', -1))\n"
+    "    for ev in events:\n"
+    "        state.set(ev, ['last'], ev['x'])\n";
+
+}
+
+void PythonStateProviderTest::setUp()
+{
+    _dir = createTempDir();
+    this->writeTrace();
+}
+
+void PythonStateProviderTest::tearDown()
+{
+    _sink.reset();
+    _traceSet.reset();
+    removeTempDir(_dir);
+}
+
+void PythonStateProviderTest::writeTrace()
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "stream {\n"
+        "    id = 0;\n"
+        "    event.header := struct {\n"
+        "        uint8_t id;\n"
+        "        uint32_clock_t timestamp;\n"
+        "    };\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint64_clock_t timestamp_begin;\n"
+        "        uint64_clock_t timestamp_end;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event { name = \"a\"; id = 0; stream_id = 0; fields := struct { uint32_t x; }; };\n"
+        "event { name = \"b\"; id = 1; stream_id = 0; fields := struct { uint32_t x; }; };\n";
+
+    // a@100 (x = 1), b@200 (2), a@300 (3), a@400 (4), b@500 (5)
+    const unsigned int ids[] = {0, 1, 0, 0, 1};
+    std::string events;
+
+    for (unsigned int x = 0; x < 5; ++x) {
+        appendUint(events, ids[x], 1);
+        appendUint(events, (x + 1) * 100, 4);
+        appendUint(events, x + 1, 4);
+    }
+
+    std::string stream;
+
+    appendPacket(stream, 0, 100, 500, events, true);
+    writeCtfTrace(_dir / "trace", metadata, {stream});
+}
+
+void PythonStateProviderTest::run(const std::string& script,
+                                  std::size_t batchSize, bool profiling)
+{
+    {
+        std::ofstream os {(_dir / "provider.py").string()};
+
+        os << script;
+    }
+
+    StateProviderConfig config {"provider.py", ""};
+
+    config.getParams()["greeting"] = StateProviderParamValue {"hello"};
+
+    PythonStateProvider provider {_dir / "provider.py", config};
+
+    provider.setProfiling(profiling);
+
+    _traceSet = std::unique_ptr<TraceSet> {new TraceSet};
+    CPPUNIT_ASSERT(_traceSet->addTrace(_dir / "trace"));
+
+    // fresh state history for each run
+    auto dbDir = _dir / bfs::unique_path("db-%%%%-%%%%");
+
+    _sink.reset();
+    bfs::create_directories(dbDir);
+    _sink = std::unique_ptr<StateHistorySink> {
+        new StateHistorySink {
+            dbDir / "state-strings.db",
+            dbDir / "state-nodes.json",
+            dbDir / "state-history.delo",
+            0
+        }
+    };
+
+    // same sequence as the state history builder
+    auto& state = _sink->getCurrentState();
+    EventDispatchTable table;
+
+    provider.onInit(state, _traceSet.get());
+    provider.addEventCallbacks(table);
+    table.compile();
+
+    EventBatch batch {batchSize};
+    auto it = _traceSet->begin();
+    auto endIt = _traceSet->end();
+
+    while (it != endIt) {
+        it.fill(batch);
+        provider.onBatch(state, batch);
+
+        for (std::size_t x = 0; x < batch.size(); ++x) {
+            _sink->setCurrentTimestamp(batch[x].getTimestamp());
+            table.dispatch(state, batch[x]);
+        }
+    }
+
+    provider.onFini(state);
+    _profiles = provider.getCallbackProfiles();
+}
+
+StateNode& PythonStateProviderTest::getRoot()
+{
+    return _sink->getCurrentState().getRoot();
+}
+
+std::string PythonStateProviderTest::getString(const StateNode& node)
+{
+    CPPUNIT_ASSERT(node.isQuark());
+
+    return _sink->getCurrentState().getString(node.asQuark());
+}
+
+void PythonStateProviderTest::testHandlers()
+{
+    this->run(
+        "def on_init(ctx):\n"
+        "    ctx.register('', 'a', on_a)\n"
+        "    ctx.state.set(None, 'init', ctx.params['greeting'])\n"
+        "\n"
+        "def on_a(events, state):\n"
+        "    for ev in events:\n"
+        "        path = ['a', ev['x']]\n"
+        "        state.set(ev, path + ['name'], ev.name)\n"
+        "        state.set(ev, path + ['ts'], ev.timestamp)\n"
+        "        state.set(ev, path + ['y'], ev.get('y', 1.5))\n"
+        "\n"
+        "def on_fini(state):\n"
+        "    state.set(None, 'fini/count', 3)\n",
+        64
+    );
+
+    auto& root = this->getRoot();
+
+    CPPUNIT_ASSERT_EQUAL(std::string {"hello"}, this->getString(root["init"]));
+    CPPUNIT_ASSERT_EQUAL(3, root["fini"]["count"].asSint32());
+
+    // only "a" events, with integer keys
+    CPPUNIT_ASSERT(root["a"][std::int64_t {1}].hasChild("name"));
+    CPPUNIT_ASSERT(!root["a"][std::int64_t {2}].hasChild("name"));
+    CPPUNIT_ASSERT(root["a"][std::int64_t {3}].hasChild("name"));
+    CPPUNIT_ASSERT(root["a"][std::int64_t {4}].hasChild("name"));
+    CPPUNIT_ASSERT_EQUAL(std::string {"a"},
+                         this->getString(root["a"][std::int64_t {3}]["name"]));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::int64_t>(CLOCK_OFFSET + 300),
+                         root["a"][std::int64_t {3}]["ts"].asSint64());
+    CPPUNIT_ASSERT_EQUAL(1.5f, root["a"][std::int64_t {4}]["y"].asFloat32());
+}
+
+void PythonStateProviderTest::testGet()
+{
+    this->run(
+        "def on_init(ctx):\n"
+        "    s = ctx.state\n"
+        "    s.set(None, 'a/b', 7)\n"
+        "    s.set(None, ['n', 12], 'twelve')\n"
+        "    s.set(None, 'gone', 1)\n"
+        "    s.set(None, 'gone', None)\n"
+        "    s.set(None, 'r/get', s.get('a/b'))\n"
+        "    s.set(None, 'r/item', s[['a', 'b']])\n"
+        "    s.set(None, 'r/int', s[['n', 12]])\n"
+        "    s.set(None, 'r/default', s.get('nope', 'dflt'))\n"
+        "    s.set(None, 'r/gone', s.get('gone', 'dflt'))\n"
+        "    try:\n"
+        "        s['a/nope']\n"
+        "    except KeyError:\n"
+        "        s.set(None, 'r/keyerror', 1)\n",
+        64
+    );
+
+    auto& r = this->getRoot()["r"];
+
+    CPPUNIT_ASSERT_EQUAL(7, r["get"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(7, r["item"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(std::string {"twelve"}, this->getString(r["int"]));
+    CPPUNIT_ASSERT_EQUAL(std::string {"dflt"}, this->getString(r["default"]));
+    CPPUNIT_ASSERT_EQUAL(std::string {"dflt"}, this->getString(r["gone"]));
+    CPPUNIT_ASSERT_EQUAL(1, r["keyerror"].asSint32());
+}
+
+void PythonStateProviderTest::testOneBatch()
+{
+    this->run(BATCH_SCRIPT, 64);
+
+    auto& root = this->getRoot();
+
+    // one call per handler, with all its events
+    CPPUNIT_ASSERT_EQUAL(1, root["calls"]["a"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(1, root["calls"]["b"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(3, root["events"]["a"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(2, root["events"]["b"].asSint32());
+
+    // on_b() saw the state before the batch
+    CPPUNIT_ASSERT_EQUAL(-1, root["seen"].asSint32());
+
+    // changes applied in event order, not in handler order
+    CPPUNIT_ASSERT_EQUAL(5, root["last"].asSint32());
+}
+
+void PythonStateProviderTest::testSmallBatches()
+{
+    this->run(BATCH_SCRIPT, 1);
+
+    auto& root = this->getRoot();
+
+    // one call per event
+    CPPUNIT_ASSERT_EQUAL(3, root["calls"]["a"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(2, root["calls"]["b"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(3, root["events"]["a"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(2, root["events"]["b"].asSint32());
+
+    // last on_b() call saw the change of a@400
+    CPPUNIT_ASSERT_EQUAL(4, root["seen"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(5, root["last"].asSint32());
+}
+
+void PythonStateProviderTest::testErrors()
+{
+    // syntax error
+    CPPUNIT_ASSERT_THROW(this->run("def on_init(ctx)\n", 64),
+                         ex::WrongStateProvider);
+
+    // exception in a handler
+    CPPUNIT_ASSERT_THROW(this->run(
+        "def on_init(ctx):\n"
+        "    ctx.register('', 'b', on_b)\n"
+        "\n"
+        "def on_b(events, state):\n"
+        "    raise ValueError('nope')\n",
+        64
+    ), ex::WrongStateProvider);
+
+    // event kept after its handler call
+    CPPUNIT_ASSERT_THROW(this->run(
+        "kept = []\n"
+        "\n"
+        "def on_init(ctx):\n"
+        "    ctx.register('', 'a', on_a)\n"
+        "\n"
+        "def on_a(events, state):\n"
+        "    if kept:\n"
+        "        kept[0].name\n"
+        "    kept.extend(events)\n",
+        1
+    ), ex::WrongStateProvider);
+}
+
+void PythonStateProviderTest::testProfiling()
+{
+    this->run(
+        "import time\n"
+        "\n"
+        "def on_init(ctx):\n"
+        "    ctx.register('', 'a', on_a)\n"
+        "    ctx.register('', 'b', on_b)\n"
+        "\n"
+        "def on_a(events, state):\n"
+        "    time.sleep(0.05)\n"
+        "\n"
+        "def on_b(events, state):\n"
+        "    pass\n",
+        64, true
+    );
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), _profiles.size());
+
+    const AbstractStateProvider::CallbackProfile* profileA = nullptr;
+    const AbstractStateProvider::CallbackProfile* profileB = nullptr;
+
+    for (const auto& profile : _profiles) {
+        if (profile.eventName == "a") {
+            profileA = &profile;
+        } else if (profile.eventName == "b") {
+            profileB = &profile;
+        }
+    }
+
+    CPPUNIT_ASSERT(profileA && profileB);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(3), profileA->calls);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(2), profileB->calls);
+
+    // the handlers run with the batch, before the events are dispatched
+    CPPUNIT_ASSERT(profileA->cycles > 10 * profileB->cycles);
+}
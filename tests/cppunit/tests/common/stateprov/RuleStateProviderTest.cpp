@@ -0,0 +1,460 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/stateprov/RuleStateProvider.hpp>
+#include <common/stateprov/EventDispatchTable.hpp>
+#include <common/stateprov/StateProviderConfig.hpp>
+#include <common/state/StateHistorySink.hpp>
+#include <common/state/CurrentState.hpp>
+#include <common/state/StateNode.hpp>
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/EventBatch.hpp>
+#include <common/ex/WrongStateProvider.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class RuleStateProviderTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(RuleStateProviderTest);
+        CPPUNIT_TEST(testPredicates);
+        CPPUNIT_TEST(testOrder);
+        CPPUNIT_TEST(testKeys);
+        CPPUNIT_TEST(testFieldTypes);
+        CPPUNIT_TEST(testConstants);
+        CPPUNIT_TEST(testMissingFields);
+        CPPUNIT_TEST(testInvalidRules);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testPredicates();
+    void testOrder();
+    void testKeys();
+    void testFieldTypes();
+    void testConstants();
+    void testMissingFields();
+    void testInvalidRules();
+
+private:
+    void writeTrace();
+    void writeRules(const std::string& rules);
+    void run(const std::string& rules);
+    StateNode& getRoot();
+    std::string getString(const StateNode& node);
+
+private:
+    bfs::path _dir;
+    std::unique_ptr<TraceSet> _traceSet;
+    std::unique_ptr<StateHistorySink> _sink;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(RuleStateProviderTest);
+
+namespace
+{
+
+const char* const SCHED_RULES =
+    "{\"rules\": [\n"
+    "  {\"event\": \"sched_switch\",\n"
+    "   \"set\": [[\"cpus/{packet_context.cpu_id}/cur\", {\"field\": \"next_tid\"}],\n"
+    "           [\"threads/{next_tid}/name\", {\"field\": \"next_comm\"}],\n"
+    "           [\"threads/{next_tid}/status\", \"run\"],\n"
+    "           [\"comms/{next_comm}/{prev_tid}\", {\"field\": \"next_tid\"}]]},\n"
+    "  {\"event\": \"sched_switch\", \"if\": [[\"prev_state\", \"==\", 0]],\n"
+    "   \"set\": [[\"prev/{prev_tid}\", \"wait\"]]},\n"
+    "  {\"event\": \"sched_switch\",\n"
+    "   \"if\": [[\"prev_state\", \">\", 0], [\"prev_state\", \"<\", 100]],\n"
+    "   \"set\": [[\"prev/{prev_tid}\", \"blocked\"]]},\n"
+    "  {\"event\": \"sched_switch\", \"if\": [[\"prev_state\", \">=\", 100]],\n"
+    "   \"set\": [[\"prev/{prev_tid}\", \"dead\"]]},\n"
+    "  {\"event\": \"sched_switch\", \"if\": [[\"next_comm\", \"==\", \"swapper\"]],\n"
+    "   \"set\": [[\"idle\", 1], [\"threads/{next_tid}/status\", \"idle\"]]},\n"
+    "  {\"event\": \"sched_switch\", \"if\": [[\"next_comm\", \"!=\", \"bash\"]],\n"
+    "   \"set\": [[\"not-bash\", {\"field\": \"next_comm\"}]]},\n"
+    "  {\"event\": \"sample\", \"if\": [[\"kind\", \"==\", \"BUSY\"]],\n"
+    "   \"set\": [[\"kind-busy\", 1]]},\n"
+    "  {\"event\": \"sample\", \"if\": [[\"kind\", \"<=\", 0]],\n"
+    "   \"set\": [[\"kind-idle\", 1]]},\n"
+    "  {\"event\": \"sample\", \"set\": [[\"order\", 1], [\"order\", 2]]},\n"
+    "  {\"event\": \"sample\", \"set\": [[\"order\", 3]]},\n"
+    "  {\"trace-type\": \".*\", \"event\": \"^sched_|^samp\", \"regex\": true,\n"
+    "   \"set\": [[\"count\", \"seen\"]]}\n"
+    "]}\n";
+
+}
+
+void RuleStateProviderTest::setUp()
+{
+    _dir = createTempDir();
+    this->writeTrace();
+}
+
+void RuleStateProviderTest::tearDown()
+{
+    _sink.reset();
+    _traceSet.reset();
+    removeTempDir(_dir);
+}
+
+void RuleStateProviderTest::writeTrace()
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "typealias integer { size = 32; align = 8; signed = true; } := int32_t;\n"
+        "typealias integer { size = 64; align = 8; signed = true; } := int64_t;\n"
+        "typealias floating_point {\n"
+        "    exp_dig = 8; mant_dig = 24; align = 8; byte_order = le;\n"
+        "} := float;\n"
+        "stream {\n"
+        "    id = 0;\n"
+        "    event.header := struct {\n"
+        "        uint8_t id;\n"
+        "        uint32_clock_t timestamp;\n"
+        "    };\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint64_clock_t timestamp_begin;\n"
+        "        uint64_clock_t timestamp_end;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"sched_switch\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct {\n"
+        "        int32_t prev_tid;\n"
+        "        uint32_t next_tid;\n"
+        "        string next_comm;\n"
+        "        int64_t prev_state;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"sample\";\n"
+        "    id = 1;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct {\n"
+        "        uint64_t big;\n"
+        "        int64_t large;\n"
+        "        int32_t neg;\n"
+        "        float ratio;\n"
+        "        string name;\n"
+        "        enum : uint8_t { IDLE = 0, BUSY = 1 } kind;\n"
+        "    };\n"
+        "};\n";
+
+    std::string events;
+    auto appendSwitch = [&events] (std::uint64_t ts, std::int32_t prevTid,
+                                   std::uint32_t nextTid,
+                                   const std::string& nextComm,
+                                   std::int64_t prevState) {
+        appendUint(events, 0, 1);
+        appendUint(events, ts, 4);
+        appendUint(events, static_cast<std::uint32_t>(prevTid), 4);
+        appendUint(events, nextTid, 4);
+        events += nextComm + '\0';
+        appendUint(events, static_cast<std::uint64_t>(prevState), 8);
+    };
+
+    // 1 -> bash (2), 2 -> swapper (0), 0 -> bash (2)
+    appendSwitch(100, 1, 2, "bash", 0);
+    appendSwitch(200, 2, 0, "swapper", 1);
+    appendSwitch(300, 0, 2, "bash", 200);
+
+    // sample
+    appendUint(events, 1, 1);
+    appendUint(events, 400, 4);
+    appendUint(events, std::uint64_t {1} << 40, 8);
+    appendUint(events, static_cast<std::uint64_t>(-(std::int64_t {1} << 40)), 8);
+    appendUint(events, static_cast<std::uint32_t>(-7), 4);
+
+    // 0.5f
+    appendUint(events, 0x3f000000, 4);
+    events += std::string {"tiger"} + '\0';
+    appendUint(events, 1, 1);
+
+    std::string stream;
+
+    appendPacket(stream, 0, 100, 400, events, true);
+    writeCtfTrace(_dir / "trace", metadata, {stream});
+}
+
+void RuleStateProviderTest::writeRules(const std::string& rules)
+{
+    std::ofstream os {(_dir / "rules.json").string()};
+
+    os << rules;
+}
+
+void RuleStateProviderTest::run(const std::string& rules)
+{
+    this->writeRules(rules);
+
+    StateProviderConfig config {"rules.json", ""};
+    RuleStateProvider provider {_dir / "rules.json", config};
+
+    _traceSet = std::unique_ptr<TraceSet> {new TraceSet};
+    CPPUNIT_ASSERT(_traceSet->addTrace(_dir / "trace"));
+
+    // fresh state history for each run
+    auto dbDir = _dir / bfs::unique_path("db-%%%%-%%%%");
+
+    _sink.reset();
+    bfs::create_directories(dbDir);
+    _sink = std::unique_ptr<StateHistorySink> {
+        new StateHistorySink {
+            dbDir / "state-strings.db",
+            dbDir / "state-nodes.json",
+            dbDir / "state-history.delo",
+            0
+        }
+    };
+
+    // same sequence as the state history builder
+    auto& state = _sink->getCurrentState();
+    EventDispatchTable table;
+
+    provider.onInit(state, _traceSet.get());
+    provider.addEventCallbacks(table);
+    table.compile();
+
+    EventBatch batch {2};
+    auto it = _traceSet->begin();
+    auto endIt = _traceSet->end();
+
+    while (it != endIt) {
+        it.fill(batch);
+        provider.onBatch(state, batch);
+
+        for (std::size_t x = 0; x < batch.size(); ++x) {
+            _sink->setCurrentTimestamp(batch[x].getTimestamp());
+            table.dispatch(state, batch[x]);
+        }
+    }
+
+    provider.onFini(state);
+}
+
+StateNode& RuleStateProviderTest::getRoot()
+{
+    return _sink->getCurrentState().getRoot();
+}
+
+std::string RuleStateProviderTest::getString(const StateNode& node)
+{
+    CPPUNIT_ASSERT(node.isQuark());
+
+    return _sink->getCurrentState().getString(node.asQuark());
+}
+
+void RuleStateProviderTest::testPredicates()
+{
+    this->run(SCHED_RULES);
+
+    auto& root = this->getRoot();
+    auto& prev = root["prev"];
+
+    // prev_state: 0 (== 0), 1 (> 0 and < 100), 200 (>= 100)
+    CPPUNIT_ASSERT_EQUAL(std::string {"wait"}, this->getString(prev[1]));
+    CPPUNIT_ASSERT_EQUAL(std::string {"blocked"}, this->getString(prev[2]));
+    CPPUNIT_ASSERT_EQUAL(std::string {"dead"}, this->getString(prev[0]));
+
+    // string == and !=
+    CPPUNIT_ASSERT_EQUAL(1, root["idle"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(std::string {"swapper"},
+                         this->getString(root["not-bash"]));
+
+    // enumeration label and integer value
+    CPPUNIT_ASSERT_EQUAL(1, root["kind-busy"].asSint32());
+    CPPUNIT_ASSERT(!root.hasChild("kind-idle"));
+}
+
+void RuleStateProviderTest::testOrder()
+{
+    this->run(SCHED_RULES);
+
+    auto& root = this->getRoot();
+    auto& threads = root["threads"];
+
+    // "idle" (fifth rule) overrides "run" (first rule)
+    CPPUNIT_ASSERT_EQUAL(std::string {"idle"},
+                         this->getString(threads[0]["status"]));
+    CPPUNIT_ASSERT_EQUAL(std::string {"run"},
+                         this->getString(threads[2]["status"]));
+
+    // state changes of a rule, then rules, in file order
+    CPPUNIT_ASSERT_EQUAL(3, root["order"].asSint32());
+
+    // regular expression rule
+    CPPUNIT_ASSERT_EQUAL(std::string {"seen"}, this->getString(root["count"]));
+}
+
+void RuleStateProviderTest::testKeys()
+{
+    this->run(SCHED_RULES);
+
+    auto& root = this->getRoot();
+
+    // packet context field key
+    CPPUNIT_ASSERT(root["cpus"].getChild(std::int64_t {2}));
+    CPPUNIT_ASSERT_EQUAL(2U, root["cpus"][2]["cur"].asUint32());
+
+    // integer field keys
+    CPPUNIT_ASSERT_EQUAL(std::string {"swapper"},
+                         this->getString(root["threads"][0]["name"]));
+    CPPUNIT_ASSERT_EQUAL(std::string {"bash"},
+                         this->getString(root["threads"][2]["name"]));
+
+    // string field key, then integer field key
+    auto& comms = root["comms"];
+
+    CPPUNIT_ASSERT_EQUAL(2U, comms["bash"][1].asUint32());
+    CPPUNIT_ASSERT_EQUAL(0U, comms["swapper"][2].asUint32());
+    CPPUNIT_ASSERT_EQUAL(2U, comms["bash"][0].asUint32());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), comms.getAllChildrenCount());
+}
+
+void RuleStateProviderTest::testFieldTypes()
+{
+    this->run(
+        "{\"rules\": [{\"event\": \"sample\", \"set\": [\n"
+        "  [\"big\", {\"field\": \"big\"}],\n"
+        "  [\"large\", {\"field\": \"large\"}],\n"
+        "  [\"neg\", {\"field\": \"neg\"}],\n"
+        "  [\"ratio\", {\"field\": \"ratio\"}],\n"
+        "  [\"name\", {\"field\": \"name\"}],\n"
+        "  [\"kind\", {\"field\": \"kind\"}],\n"
+        "  [\"cpu\", {\"field\": \"packet_context.cpu_id\"}]\n"
+        "]}]}\n"
+    );
+
+    auto& root = this->getRoot();
+
+    // the smallest state value type holding the field value
+    CPPUNIT_ASSERT(root["big"].isUint64());
+    CPPUNIT_ASSERT_EQUAL(std::uint64_t {1} << 40, root["big"].asUint64());
+    CPPUNIT_ASSERT(root["large"].isSint64());
+    CPPUNIT_ASSERT_EQUAL(-(std::int64_t {1} << 40), root["large"].asSint64());
+    CPPUNIT_ASSERT(root["neg"].isSint32());
+    CPPUNIT_ASSERT_EQUAL(-7, root["neg"].asSint32());
+    CPPUNIT_ASSERT(root["ratio"].isFloat32());
+    CPPUNIT_ASSERT_EQUAL(0.5f, root["ratio"].asFloat32());
+    CPPUNIT_ASSERT_EQUAL(std::string {"tiger"}, this->getString(root["name"]));
+    CPPUNIT_ASSERT_EQUAL(std::string {"BUSY"}, this->getString(root["kind"]));
+    CPPUNIT_ASSERT(root["cpu"].isUint32());
+    CPPUNIT_ASSERT_EQUAL(2U, root["cpu"].asUint32());
+}
+
+void RuleStateProviderTest::testConstants()
+{
+    this->run(
+        "{\"rules\": [{\"event\": \"sample\", \"set\": [\n"
+        "  [\"int\", 7],\n"
+        "  [\"big\", 9999999999],\n"
+        "  [\"float\", 2.5],\n"
+        "  [\"bool\", true],\n"
+        "  [\"string\", \"beetle\"],\n"
+        "  [\"null\", 1],\n"
+        "  [\"null\", null]\n"
+        "]}]}\n"
+    );
+
+    auto& root = this->getRoot();
+
+    CPPUNIT_ASSERT(root["int"].isSint32());
+    CPPUNIT_ASSERT_EQUAL(7, root["int"].asSint32());
+    CPPUNIT_ASSERT(root["big"].isSint64());
+    CPPUNIT_ASSERT_EQUAL(std::int64_t {9999999999LL}, root["big"].asSint64());
+    CPPUNIT_ASSERT_EQUAL(2.5f, root["float"].asFloat32());
+    CPPUNIT_ASSERT_EQUAL(1, root["bool"].asSint32());
+    CPPUNIT_ASSERT_EQUAL(std::string {"beetle"}, this->getString(root["string"]));
+    CPPUNIT_ASSERT(root["null"].isNull());
+}
+
+void RuleStateProviderTest::testMissingFields()
+{
+    this->run(
+        "{\"rules\": [\n"
+        "  {\"event\": \"sample\", \"if\": [[\"nope\", \"==\", 1]],\n"
+        "   \"set\": [[\"tested\", 1]]},\n"
+        "  {\"event\": \"sample\",\n"
+        "   \"set\": [[\"before\", 1], [\"after\", {\"field\": \"nope\"}], [\"skipped\", 1]]},\n"
+        "  {\"event\": \"sample\",\n"
+        "   \"set\": [[\"keys/{nope}\", 1], [\"skipped-key\", 1]]},\n"
+        "  {\"event\": \"sample\",\n"
+        "   \"set\": [[\"context\", {\"field\": \"context.nope\"}]]},\n"
+        "  {\"event\": \"sample\", \"set\": [[\"last\", 1]]},\n"
+        "  {\"event\": \"nope\", \"set\": [[\"nope\", 1]]}\n"
+        "]}\n"
+    );
+
+    auto& root = this->getRoot();
+
+    // rest of the rule skipped, not the next rules
+    CPPUNIT_ASSERT(!root.hasChild("tested"));
+    CPPUNIT_ASSERT_EQUAL(1, root["before"].asSint32());
+    CPPUNIT_ASSERT(!root.hasChild("after"));
+    CPPUNIT_ASSERT(!root.hasChild("skipped"));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0),
+                         root["keys"].getAllChildrenCount());
+    CPPUNIT_ASSERT(!root.hasChild("skipped-key"));
+    CPPUNIT_ASSERT(!root.hasChild("context"));
+    CPPUNIT_ASSERT_EQUAL(1, root["last"].asSint32());
+    CPPUNIT_ASSERT(!root.hasChild("nope"));
+}
+
+void RuleStateProviderTest::testInvalidRules()
+{
+    const char* invalidRules[] = {
+        "nope",
+        "{}",
+        "{\"rules\": {}}",
+        "{\"rules\": [{\"set\": []}]}",
+        "{\"rules\": [{\"event\": \"a\"}]}",
+        "{\"rules\": [{\"event\": \"a\", \"if\": [[\"f\", \"=~\", 1]], \"set\": []}]}",
+        "{\"rules\": [{\"event\": \"a\", \"if\": [[\"f\", \"<\", \"s\"]], \"set\": []}]}",
+        "{\"rules\": [{\"event\": \"a\", \"if\": [[\"f\", \"==\", 1.5]], \"set\": []}]}",
+        "{\"rules\": [{\"event\": \"(\", \"regex\": true, \"set\": []}]}",
+        "{\"rules\": [{\"event\": \"a\", \"set\": [[\"{a}/{b}/{c}\", 1]]}]}",
+        "{\"rules\": [{\"event\": \"a\", \"set\": [[\"a\", [1]]]}]}",
+    };
+
+    for (auto rules : invalidRules) {
+        this->writeRules(rules);
+
+        StateProviderConfig config {"rules.json", ""};
+
+        CPPUNIT_ASSERT_THROW(RuleStateProvider(_dir / "rules.json", config),
+                             ex::WrongStateProvider);
+    }
+}
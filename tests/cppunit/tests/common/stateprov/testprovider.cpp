@@ -0,0 +1,140 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include <common/state/CurrentState.hpp>
+#include <common/stateprov/DynamicLibraryStateProvider.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/TraceSet.hpp>
+
+using namespace tibee::common;
+
+/* State provider library loaded by DynamicLibraryStateProviderTest.
+ *
+ * Built twice: testprovider.so exports onFiniContext(), while
+ * testprovider-legacy.so (TIBEE_TESTPROVIDER_LEGACY defined) only
+ * exports the original onFini(CurrentState&) and sets no context.
+ *
+ * Global variables are shared by all the instances of the library:
+ * they log the calls, and the test reads them through the exported
+ * test*() functions.
+ */
+
+namespace
+{
+
+// per-instance context
+struct Context
+{
+    std::string instanceName;
+    std::size_t events;
+};
+
+// contexts given to onInit() and received by onFiniContext(), in order
+std::vector<void*> initContexts;
+std::vector<void*> finiContexts;
+
+// number of onFini() calls
+std::size_t finiCalls = 0;
+
+// events counted by the last context freed by onFiniContext()
+std::size_t finiEvents = 0;
+
+bool onEvent(void* context, CurrentState& state, const Event& event)
+{
+    static_cast<Context*>(context)->events++;
+
+    return true;
+}
+
+}
+
+extern "C" void onInit(CurrentState& state,
+                       const TraceSet* traceSet,
+                       DynamicLibraryStateProvider::Adapter& adapter)
+{
+#ifndef TIBEE_TESTPROVIDER_LEGACY
+    auto ctx = new Context {adapter.getConfig().getInstanceName(), 0};
+
+    adapter.setContext(ctx);
+    adapter.registerEventCallback("", "", onEvent);
+    initContexts.push_back(ctx);
+#endif
+}
+
+#ifdef TIBEE_TESTPROVIDER_LEGACY
+extern "C" void onFini(CurrentState& state)
+{
+    finiCalls++;
+}
+#else
+extern "C" void onFiniContext(CurrentState& state, void* context)
+{
+    auto ctx = static_cast<Context*>(context);
+
+    finiContexts.push_back(context);
+    finiEvents = ctx->events;
+    delete ctx;
+}
+#endif
+
+extern "C" void testReset()
+{
+    initContexts.clear();
+    finiContexts.clear();
+    finiCalls = 0;
+    finiEvents = 0;
+}
+
+extern "C" std::size_t testGetInitCount()
+{
+    return initContexts.size();
+}
+
+extern "C" void* testGetInitContext(std::size_t index)
+{
+    return initContexts[index];
+}
+
+extern "C" const char* testGetInstanceName(std::size_t index)
+{
+    // only valid until the context is freed
+    return static_cast<Context*>(initContexts[index])->instanceName.c_str();
+}
+
+extern "C" std::size_t testGetFiniContextCount()
+{
+    return finiContexts.size();
+}
+
+extern "C" void* testGetFiniContext(std::size_t index)
+{
+    return finiContexts[index];
+}
+
+extern "C" std::size_t testGetFiniEvents()
+{
+    return finiEvents;
+}
+
+extern "C" std::size_t testGetFiniCalls()
+{
+    return finiCalls;
+}
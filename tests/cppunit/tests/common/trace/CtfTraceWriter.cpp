@@ -0,0 +1,121 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <fstream>
+#include <sstream>
+#include <boost/filesystem.hpp>
+
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace tests
+{
+
+const common::timestamp_t CLOCK_OFFSET = 1000000000500ULL;
+
+const char* const PACKET_HEADER_LAYOUT =
+    "typealias integer { size = 8; align = 8; signed = false; } := uint8_t;\n"
+    "typealias integer { size = 32; align = 8; signed = false; } := uint32_t;\n"
+    "typealias integer { size = 64; align = 8; signed = false; } := uint64_t;\n"
+    "trace {\n"
+    "    major = 1;\n"
+    "    minor = 8;\n"
+    "    byte_order = le;\n"
+    "    packet.header := struct {\n"
+    "        uint32_t magic;\n"
+    "        uint32_t stream_id;\n"
+    "    };\n"
+    "};\n"
+    "clock {\n"
+    "    name = monotonic;\n"
+    "    freq = 1000000000;\n"
+    "    offset_s = 1000;\n"
+    "    offset = 500;\n"
+    "};\n"
+    "typealias integer {\n"
+    "    size = 32; align = 8; signed = false;\n"
+    "    map = clock.monotonic.value;\n"
+    "} := uint32_clock_t;\n"
+    "typealias integer {\n"
+    "    size = 64; align = 8; signed = false;\n"
+    "    map = clock.monotonic.value;\n"
+    "} := uint64_clock_t;\n";
+
+void appendUint(std::string& data, std::uint64_t value, unsigned int size)
+{
+    for (unsigned int x = 0; x < size; ++x) {
+        data.push_back(static_cast<char>((value >> (x * 8)) & 0xff));
+    }
+}
+
+void appendPacket(std::string& data, std::uint32_t streamId,
+                  std::uint64_t tsBegin, std::uint64_t tsEnd,
+                  const std::string& events, bool hasTimestamps)
+{
+    std::string packet;
+    const std::uint64_t packetSize = 256;
+
+    appendUint(packet, 0xc1fc1fc1, 4);
+    appendUint(packet, streamId, 4);
+
+    std::size_t contextSize = hasTimestamps ? 36 : 20;
+
+    appendUint(packet, packetSize * 8, 8);
+    appendUint(packet, (8 + contextSize + events.size()) * 8, 8);
+
+    if (hasTimestamps) {
+        appendUint(packet, tsBegin, 8);
+        appendUint(packet, tsEnd, 8);
+    }
+
+    appendUint(packet, 2, 4);
+    packet += events;
+    packet.resize(packetSize, '\0');
+    data += packet;
+}
+
+namespace
+{
+
+void writeFile(const bfs::path& path, const std::string& data)
+{
+    std::ofstream os {path.string(), std::ios::binary};
+
+    os.write(data.data(), data.size());
+}
+
+}
+
+void writeCtfTrace(const bfs::path& dir, const std::string& metadata,
+                   const std::vector<std::string>& streams)
+{
+    bfs::create_directories(dir);
+    writeFile(dir / "metadata", metadata);
+
+    for (std::size_t x = 0; x < streams.size(); ++x) {
+        std::ostringstream name;
+
+        name << "channel_" << x;
+        writeFile(dir / name.str(), streams[x]);
+    }
+}
+
+}
+}
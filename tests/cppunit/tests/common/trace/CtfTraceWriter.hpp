@@ -0,0 +1,89 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_TESTS_CTFTRACEWRITER_HPP
+#define _TIBEE_TESTS_CTFTRACEWRITER_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/filesystem/path.hpp>
+
+#include <common/BasicTypes.hpp>
+
+namespace tibee
+{
+namespace tests
+{
+
+/* Helpers writing small CTF traces for unit tests.
+ *
+ * Metadata must start with PACKET_HEADER_LAYOUT, which defines the
+ * packet header read by appendPacket() and a 1 GHz clock offset by
+ * CLOCK_OFFSET.
+ */
+
+// clock offset of the fixture traces: 1000 s + 500 cycles at 1 GHz
+extern const common::timestamp_t CLOCK_OFFSET;
+
+// trace block, packet header and clock of the fixture traces
+extern const char* const PACKET_HEADER_LAYOUT;
+
+/**
+ * Appends the \p size least significant bytes of \p value to
+ * \p data, little endian.
+ *
+ * @param data  Data to append to
+ * @param value Value to append
+ * @param size  Size of value (bytes)
+ */
+void appendUint(std::string& data, std::uint64_t value, unsigned int size);
+
+/**
+ * Appends a packet of stream \p streamId made of the packet header
+ * and context, followed by the \p events bytes, padded to 256 bytes.
+ *
+ * The packet context holds the packet and content sizes, the begin
+ * and end timestamps if \p hasTimestamps is true, and a CPU ID.
+ *
+ * @param data          Data to append to
+ * @param streamId      Stream ID
+ * @param tsBegin       Packet begin timestamp
+ * @param tsEnd         Packet end timestamp
+ * @param events        Event bytes
+ * @param hasTimestamps True if the packet context has timestamps
+ */
+void appendPacket(std::string& data, std::uint32_t streamId,
+                  std::uint64_t tsBegin, std::uint64_t tsEnd,
+                  const std::string& events, bool hasTimestamps);
+
+/**
+ * Writes a trace in directory \p dir (created if needed): the
+ * metadata file and one stream file per element of \p streams.
+ *
+ * @param dir      Trace directory
+ * @param metadata Metadata text
+ * @param streams  Stream files data
+ */
+void writeCtfTrace(const boost::filesystem::path& dir,
+                   const std::string& metadata,
+                   const std::vector<std::string>& streams);
+
+}
+}
+
+#endif // _TIBEE_TESTS_CTFTRACEWRITER_HPP
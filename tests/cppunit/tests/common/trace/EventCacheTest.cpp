@@ -0,0 +1,345 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventCacheWriter.hpp>
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/AbstractEventValue.hpp>
+#include <common/ex/TraceSet.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class EventCacheTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(EventCacheTest);
+        CPPUNIT_TEST(testReplayAll);
+        CPPUNIT_TEST(testReplayValues);
+        CPPUNIT_TEST(testReplayFilterAndBegin);
+        CPPUNIT_TEST(testReplayNotCached);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testReplayAll();
+    void testReplayValues();
+    void testReplayFilterAndBegin();
+    void testReplayNotCached();
+
+private:
+    struct DecodedEvent
+    {
+        std::string name;
+        trace_cycles_t cycles;
+        timestamp_t ts;
+        std::string fields;
+        std::string packetContext;
+    };
+
+private:
+    void writeTrace();
+    void writeCache(const std::vector<std::string>& eventNames) const;
+    EventFilter getFilter(const TraceSet& traceSet,
+                          const std::vector<std::string>& eventNames) const;
+    std::vector<DecodedEvent> decode() const;
+    std::vector<DecodedEvent> replay(const std::vector<std::string>& eventNames,
+                                     timestamp_t beginTs) const;
+    static DecodedEvent getDecodedEvent(const Event& event);
+    static void assertSameEvents(const std::vector<DecodedEvent>& expected,
+                                 const std::vector<DecodedEvent>& events);
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EventCacheTest);
+
+void EventCacheTest::setUp()
+{
+    _dir = createTempDir();
+    this->writeTrace();
+}
+
+void EventCacheTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void EventCacheTest::writeTrace()
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "typealias integer {\n"
+        "    size = 8; align = 8; signed = false; encoding = UTF8;\n"
+        "} := char_t;\n"
+        "stream {\n"
+        "    id = 0;\n"
+        "    event.header := struct {\n"
+        "        uint8_t id;\n"
+        "        uint32_clock_t timestamp;\n"
+        "    };\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint64_clock_t timestamp_begin;\n"
+        "        uint64_clock_t timestamp_end;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_a\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct {\n"
+        "        uint32_t x;\n"
+        "        enum : uint8_t { ZERO, ONE, TWO } e;\n"
+        "        string s;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_b\";\n"
+        "    id = 1;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct {\n"
+        "        uint64_t y;\n"
+        "        char_t text[4];\n"
+        "    };\n"
+        "};\n";
+
+    // alternating events, with an empty string and short texts
+    std::string events;
+
+    auto appendA = [&events] (std::uint64_t ts, std::uint64_t x,
+                              std::uint64_t e, const std::string& s) {
+        appendUint(events, 0, 1);
+        appendUint(events, ts, 4);
+        appendUint(events, x, 4);
+        appendUint(events, e, 1);
+        events += s + '\0';
+    };
+
+    auto appendB = [&events] (std::uint64_t ts, std::uint64_t y,
+                              const std::string& text) {
+        appendUint(events, 1, 1);
+        appendUint(events, ts, 4);
+        appendUint(events, y, 8);
+        events += text;
+        events.resize(events.size() + 4 - text.size(), '\0');
+    };
+
+    appendA(100, 1, 0, "one");
+    appendB(110, 10, "ab");
+    appendA(120, 2, 2, "");
+    appendB(130, 20, "wxyz");
+    appendA(140, 3, 1, "three");
+    appendB(150, 30, "c");
+
+    std::string stream;
+
+    appendPacket(stream, 0, 100, 150, events, true);
+
+    writeCtfTrace(_dir / "trace", metadata, {stream});
+}
+
+EventFilter EventCacheTest::getFilter(const TraceSet& traceSet,
+                                      const std::vector<std::string>& eventNames) const
+{
+    EventFilter filter;
+
+    for (const auto& traceInfos : traceSet.getTracesInfos()) {
+        for (const auto& eventName : eventNames) {
+            auto it = traceInfos->getEventMap()->find(eventName);
+
+            CPPUNIT_ASSERT(it != traceInfos->getEventMap()->end());
+            filter.add(traceInfos->getId(), it->second->getId());
+        }
+    }
+
+    return filter;
+}
+
+void EventCacheTest::writeCache(const std::vector<std::string>& eventNames) const
+{
+    TraceSet traceSet;
+
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+
+    auto filter = this->getFilter(traceSet, eventNames);
+    EventCacheWriter writer {_dir / "cache", traceSet, &filter};
+
+    for (auto it = traceSet.begin(&filter); it != traceSet.end(); ++it) {
+        writer.append(*it);
+    }
+
+    writer.close();
+}
+
+EventCacheTest::DecodedEvent EventCacheTest::getDecodedEvent(const Event& event)
+{
+    return {
+        event.getNameStr(),
+        event.getCycles(),
+        event.getTimestamp(),
+        event.getFields().toString(),
+        event.getStreamPacketContext().toString()
+    };
+}
+
+std::vector<EventCacheTest::DecodedEvent> EventCacheTest::decode() const
+{
+    TraceSet traceSet;
+    std::vector<DecodedEvent> events;
+
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+
+    for (auto it = traceSet.begin(); it != traceSet.end(); ++it) {
+        events.push_back(EventCacheTest::getDecodedEvent(*it));
+    }
+
+    return events;
+}
+
+std::vector<EventCacheTest::DecodedEvent> EventCacheTest::replay(const std::vector<std::string>& eventNames,
+                                                                 timestamp_t beginTs) const
+{
+    TraceSet traceSet;
+    std::vector<DecodedEvent> events;
+
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+    traceSet.setEventCacheDir(_dir / "cache");
+
+    auto filter = this->getFilter(traceSet, eventNames);
+
+    for (auto it = traceSet.seek(beginTs, &filter); it != traceSet.end(); ++it) {
+        events.push_back(EventCacheTest::getDecodedEvent(*it));
+    }
+
+    return events;
+}
+
+void EventCacheTest::assertSameEvents(const std::vector<DecodedEvent>& expected,
+                                      const std::vector<DecodedEvent>& events)
+{
+    CPPUNIT_ASSERT_EQUAL(expected.size(), events.size());
+
+    for (std::size_t x = 0; x < expected.size(); ++x) {
+        CPPUNIT_ASSERT_EQUAL(expected[x].name, events[x].name);
+        CPPUNIT_ASSERT_EQUAL(expected[x].cycles, events[x].cycles);
+        CPPUNIT_ASSERT_EQUAL(expected[x].ts, events[x].ts);
+        CPPUNIT_ASSERT_EQUAL(expected[x].fields, events[x].fields);
+        CPPUNIT_ASSERT_EQUAL(expected[x].packetContext, events[x].packetContext);
+    }
+}
+
+void EventCacheTest::testReplayAll()
+{
+    this->writeCache({"ev_a", "ev_b"});
+
+    auto events = this->decode();
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(6), events.size());
+    EventCacheTest::assertSameEvents(events, this->replay({"ev_a", "ev_b"}, 0));
+}
+
+void EventCacheTest::testReplayValues()
+{
+    this->writeCache({"ev_a", "ev_b"});
+
+    TraceSet traceSet;
+
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+    traceSet.setEventCacheDir(_dir / "cache");
+
+    auto filter = this->getFilter(traceSet, {"ev_a", "ev_b"});
+    std::vector<std::string> strings;
+    std::vector<std::string> labels;
+    std::vector<std::string> texts;
+
+    for (auto it = traceSet.begin(&filter); it != traceSet.end(); ++it) {
+        const auto& event = *it;
+
+        if (event.getNameStr() == "ev_a") {
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(strings.size() + 1),
+                                 event["x"].asUint());
+            strings.push_back(event["s"].asString());
+            labels.push_back(event["e"].asEnumLabel());
+        } else {
+            const auto& text = event["text"].asArray();
+
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>((texts.size() + 1) * 10),
+                                 event["y"].asUint());
+            CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(4), text.size());
+            texts.push_back(text.getString());
+        }
+    }
+
+    // (integer, label) pairs and strings of each row
+    CPPUNIT_ASSERT((strings == std::vector<std::string> {"one", "", "three"}));
+    CPPUNIT_ASSERT((labels == std::vector<std::string> {"ZERO", "TWO", "ONE"}));
+    CPPUNIT_ASSERT((texts == std::vector<std::string> {"ab", "wxyz", "c"}));
+}
+
+void EventCacheTest::testReplayFilterAndBegin()
+{
+    this->writeCache({"ev_a", "ev_b"});
+
+    auto events = this->decode();
+
+    /* Rows skipped before the begin timestamp must still count for
+     * their type, whether or not it's replayed.
+     */
+    for (std::size_t begin = 0; begin < events.size(); ++begin) {
+        auto beginTs = events[begin].ts;
+
+        for (const auto& name : {"ev_a", "ev_b"}) {
+            std::vector<DecodedEvent> expected;
+
+            for (std::size_t x = begin; x < events.size(); ++x) {
+                if (events[x].name == name) {
+                    expected.push_back(events[x]);
+                }
+            }
+
+            EventCacheTest::assertSameEvents(expected, this->replay({name}, beginTs));
+        }
+    }
+}
+
+void EventCacheTest::testReplayNotCached()
+{
+    this->writeCache({"ev_a"});
+
+    // only ev_a events were cached
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(3),
+                         this->replay({"ev_a"}, 0).size());
+    CPPUNIT_ASSERT_THROW(this->replay({"ev_b"}, 0), ex::TraceSet);
+    CPPUNIT_ASSERT_THROW(this->replay({"ev_a", "ev_b"}, 0), ex::TraceSet);
+}
@@ -0,0 +1,79 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/trace/EventFilter.hpp>
+#include <common/trace/TraceUtils.hpp>
+
+using namespace tibee::common;
+
+class EventFilterTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(EventFilterTest);
+        CPPUNIT_TEST(testEmpty);
+        CPPUNIT_TEST(testAdd);
+        CPPUNIT_TEST(testMerge);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testEmpty();
+    void testAdd();
+    void testMerge();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(EventFilterTest);
+
+void EventFilterTest::testEmpty()
+{
+    const EventFilter filter;
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), filter.size());
+    CPPUNIT_ASSERT(!filter.accepts(0, 0));
+    CPPUNIT_ASSERT(!filter.accepts(3, TraceUtils::tibeeEventIdFromCtf(2, 17)));
+}
+
+void EventFilterTest::testAdd()
+{
+    EventFilter filter;
+    auto eventId = TraceUtils::tibeeEventIdFromCtf(1, 130);
+
+    filter.add(2, eventId);
+    filter.add(2, eventId);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(1), filter.size());
+    CPPUNIT_ASSERT(filter.accepts(2, eventId));
+    CPPUNIT_ASSERT(!filter.accepts(1, eventId));
+    CPPUNIT_ASSERT(!filter.accepts(2, TraceUtils::tibeeEventIdFromCtf(0, 130)));
+    CPPUNIT_ASSERT(!filter.accepts(2, TraceUtils::tibeeEventIdFromCtf(1, 129)));
+    CPPUNIT_ASSERT(!filter.accepts(2, TraceUtils::tibeeEventIdFromCtf(1, 131)));
+}
+
+void EventFilterTest::testMerge()
+{
+    EventFilter a;
+    EventFilter b;
+
+    a.add(0, TraceUtils::tibeeEventIdFromCtf(0, 5));
+    b.add(0, TraceUtils::tibeeEventIdFromCtf(0, 5));
+    b.add(1, TraceUtils::tibeeEventIdFromCtf(3, 64));
+    a.merge(b);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), a.size());
+    CPPUNIT_ASSERT(a.accepts(0, TraceUtils::tibeeEventIdFromCtf(0, 5)));
+    CPPUNIT_ASSERT(a.accepts(1, TraceUtils::tibeeEventIdFromCtf(3, 64)));
+    CPPUNIT_ASSERT(!a.accepts(1, TraceUtils::tibeeEventIdFromCtf(3, 63)));
+}
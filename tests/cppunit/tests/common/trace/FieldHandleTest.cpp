@@ -0,0 +1,266 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/FieldHandle.hpp>
+#include <common/trace/AbstractEventValue.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class FieldHandleTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(FieldHandleTest);
+        CPPUNIT_TEST(testFields);
+        CPPUNIT_TEST(testContext);
+        CPPUNIT_TEST(testUnresolved);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testFields();
+    void testContext();
+    void testUnresolved();
+
+private:
+    void writeTraces();
+
+private:
+    bfs::path _dir;
+    TraceSet* _traceSet;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(FieldHandleTest);
+
+namespace
+{
+
+const char* const STREAM_LAYOUT =
+    "stream {\n"
+    "    id = 0;\n"
+    "    event.header := struct {\n"
+    "        uint8_t id;\n"
+    "        uint32_clock_t timestamp;\n"
+    "    };\n"
+    "    packet.context := struct {\n"
+    "        uint64_t packet_size;\n"
+    "        uint64_t content_size;\n"
+    "        uint64_clock_t timestamp_begin;\n"
+    "        uint64_clock_t timestamp_end;\n"
+    "        uint32_t cpu_id;\n"
+    "    };\n"
+    "};\n";
+
+}
+
+void FieldHandleTest::setUp()
+{
+    _dir = createTempDir();
+    this->writeTraces();
+    _traceSet = new TraceSet;
+    CPPUNIT_ASSERT(_traceSet->addTrace(_dir / "a"));
+    CPPUNIT_ASSERT(_traceSet->addTrace(_dir / "b"));
+}
+
+void FieldHandleTest::tearDown()
+{
+    delete _traceSet;
+    removeTempDir(_dir);
+}
+
+void FieldHandleTest::writeTraces()
+{
+    /* The same events have other IDs, and their "tid" and "prio"
+     * fields other indexes, in both traces. Each event has
+     * tid = 1000 + x and prio = 50 + x, where x is its timestamp / 10,
+     * other fields being 7.
+     */
+    std::string metadataA {"/* CTF 1.8 */\n"};
+
+    metadataA += PACKET_HEADER_LAYOUT;
+    metadataA += STREAM_LAYOUT;
+    metadataA +=
+        "event {\n"
+        "    name = \"ev_a\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    context := struct { uint32_t prio; uint32_t other; };\n"
+        "    fields := struct { uint32_t tid; uint32_t other; };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_b\";\n"
+        "    id = 1;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t other; uint32_t tid; };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_c\";\n"
+        "    id = 2;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t tid; };\n"
+        "};\n";
+
+    std::string metadataB {"/* CTF 1.8 */\n"};
+
+    metadataB += PACKET_HEADER_LAYOUT;
+    metadataB += STREAM_LAYOUT;
+    metadataB +=
+        "event {\n"
+        "    name = \"ev_b\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t tid; };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_a\";\n"
+        "    id = 1;\n"
+        "    stream_id = 0;\n"
+        "    context := struct { uint32_t other; uint32_t prio; };\n"
+        "    fields := struct { uint32_t other; uint32_t other2; uint32_t tid; };\n"
+        "};\n";
+
+    // trace A: ev_a (x = 1), ev_b (x = 3), ev_c (x = 5)
+    std::string eventsA;
+
+    appendUint(eventsA, 0, 1);
+    appendUint(eventsA, 10, 4);
+    appendUint(eventsA, 51, 4);
+    appendUint(eventsA, 7, 4);
+    appendUint(eventsA, 1001, 4);
+    appendUint(eventsA, 7, 4);
+    appendUint(eventsA, 1, 1);
+    appendUint(eventsA, 30, 4);
+    appendUint(eventsA, 7, 4);
+    appendUint(eventsA, 1003, 4);
+    appendUint(eventsA, 2, 1);
+    appendUint(eventsA, 50, 4);
+    appendUint(eventsA, 1005, 4);
+
+    // trace B: ev_b (x = 2), ev_a (x = 4)
+    std::string eventsB;
+
+    appendUint(eventsB, 0, 1);
+    appendUint(eventsB, 20, 4);
+    appendUint(eventsB, 1002, 4);
+    appendUint(eventsB, 1, 1);
+    appendUint(eventsB, 40, 4);
+    appendUint(eventsB, 7, 4);
+    appendUint(eventsB, 54, 4);
+    appendUint(eventsB, 7, 4);
+    appendUint(eventsB, 7, 4);
+    appendUint(eventsB, 1004, 4);
+
+    std::string streamA;
+    std::string streamB;
+
+    appendPacket(streamA, 0, 10, 50, eventsA, true);
+    appendPacket(streamB, 0, 20, 40, eventsB, true);
+
+    writeCtfTrace(_dir / "a", metadataA, {streamA});
+    writeCtfTrace(_dir / "b", metadataB, {streamB});
+}
+
+void FieldHandleTest::testFields()
+{
+    FieldHandle tid {_traceSet, std::vector<std::string> {"ev_a", "ev_b"}, "tid"};
+    std::size_t count = 0;
+
+    CPPUNIT_ASSERT(tid.isValid());
+    CPPUNIT_ASSERT(tid.getScope() == FieldHandle::Scope::FIELDS);
+
+    for (auto it = _traceSet->begin(); it != _traceSet->end(); ++it) {
+        const auto& event = *it;
+        auto x = (event.getTimestamp() - CLOCK_OFFSET) / 10;
+
+        if (event.getNameStr() == "ev_c") {
+            // has a "tid" field, but not one of the handle's events
+            CPPUNIT_ASSERT_EQUAL(FieldHandle::NO_INDEX, tid.getIndex(event));
+            CPPUNIT_ASSERT(event[tid].isNull());
+            continue;
+        }
+
+        CPPUNIT_ASSERT(tid.getIndex(event) != FieldHandle::NO_INDEX);
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(1000 + x),
+                             event[tid].asUint());
+        CPPUNIT_ASSERT_EQUAL(event["tid"].asUint(), event[tid].asUint());
+        ++count;
+    }
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(4), count);
+}
+
+void FieldHandleTest::testContext()
+{
+    FieldHandle prio {_traceSet, "ev_a", "prio", FieldHandle::Scope::CONTEXT};
+    std::size_t count = 0;
+
+    CPPUNIT_ASSERT(prio.isValid());
+    CPPUNIT_ASSERT(prio.getScope() == FieldHandle::Scope::CONTEXT);
+
+    for (auto it = _traceSet->begin(); it != _traceSet->end(); ++it) {
+        const auto& event = *it;
+        auto x = (event.getTimestamp() - CLOCK_OFFSET) / 10;
+
+        if (event.getNameStr() != "ev_a") {
+            CPPUNIT_ASSERT(event[prio].isNull());
+            continue;
+        }
+
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(50 + x),
+                             event[prio].asUint());
+        CPPUNIT_ASSERT_EQUAL(event.getContext()["prio"].asUint(),
+                             event[prio].asUint());
+        ++count;
+    }
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), count);
+}
+
+void FieldHandleTest::testUnresolved()
+{
+    // no such field, no such event, not in this scope, empty handle
+    FieldHandle noField {_traceSet, "ev_a", "pid"};
+    FieldHandle noEvent {_traceSet, "ev_z", "tid"};
+    FieldHandle noContext {_traceSet, "ev_b", "prio", FieldHandle::Scope::CONTEXT};
+    FieldHandle empty;
+
+    CPPUNIT_ASSERT(!noField.isValid());
+    CPPUNIT_ASSERT(!noEvent.isValid());
+    CPPUNIT_ASSERT(!noContext.isValid());
+    CPPUNIT_ASSERT(!empty.isValid());
+
+    for (auto it = _traceSet->begin(); it != _traceSet->end(); ++it) {
+        const auto& event = *it;
+
+        CPPUNIT_ASSERT(event[noField].isNull());
+        CPPUNIT_ASSERT(event[noEvent].isNull());
+        CPPUNIT_ASSERT(event[noContext].isNull());
+        CPPUNIT_ASSERT(event[empty].isNull());
+    }
+}
@@ -0,0 +1,245 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/AbstractEventValue.hpp>
+#include <common/ex/TraceSet.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class NativeCtfDecoderTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(NativeCtfDecoderTest);
+        CPPUNIT_TEST(testSameAsBabeltrace);
+        CPPUNIT_TEST(testClockOffset);
+        CPPUNIT_TEST(testEmptyEvent);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testSameAsBabeltrace();
+    void testClockOffset();
+    void testEmptyEvent();
+
+private:
+    struct DecodedEvent
+    {
+        std::string name;
+        event_id_t id;
+        trace_cycles_t cycles;
+        timestamp_t ts;
+        std::string fields;
+        std::string packetContext;
+    };
+
+private:
+    void writeTrace();
+    void writeEmptyEventTrace();
+    std::vector<DecodedEvent> decode(bool native) const;
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(NativeCtfDecoderTest);
+
+void NativeCtfDecoderTest::setUp()
+{
+    _dir = createTempDir();
+}
+
+void NativeCtfDecoderTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void NativeCtfDecoderTest::writeTrace()
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "stream {\n"
+        "    id = 0;\n"
+        "    event.header := struct {\n"
+        "        uint8_t id;\n"
+        "        uint32_clock_t timestamp;\n"
+        "    };\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint64_clock_t timestamp_begin;\n"
+        "        uint64_clock_t timestamp_end;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_a\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t x; };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_b\";\n"
+        "    id = 1;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint64_t y; string s; };\n"
+        "};\n";
+
+    // two packets, the event timestamp wrapping in the second one
+    std::string events1;
+
+    appendUint(events1, 0, 1);
+    appendUint(events1, 100, 4);
+    appendUint(events1, 7, 4);
+    appendUint(events1, 1, 1);
+    appendUint(events1, 200, 4);
+    appendUint(events1, 123456789012ULL, 8);
+    events1 += std::string {"beetle"} + '\0';
+
+    std::string events2;
+    const std::uint64_t base2 = 0xfffffff0ULL;
+
+    appendUint(events2, 1, 1);
+    appendUint(events2, base2 + 4, 4);
+    appendUint(events2, 42, 8);
+    events2 += std::string {"tiger"} + '\0';
+    appendUint(events2, 0, 1);
+    appendUint(events2, 0x10, 4);
+    appendUint(events2, 9, 4);
+
+    std::string stream;
+
+    appendPacket(stream, 0, 100, 200, events1, true);
+    appendPacket(stream, 0, base2, base2 + 0x20, events2, true);
+
+    writeCtfTrace(_dir / "trace", metadata, {stream});
+}
+
+void NativeCtfDecoderTest::writeEmptyEventTrace()
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    // no event header and no event fields: events take 0 bits
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "stream {\n"
+        "    id = 0;\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"empty\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { };\n"
+        "};\n";
+
+    std::string stream;
+
+    appendPacket(stream, 0, 0, 0, std::string(4, '\0'), false);
+
+    writeCtfTrace(_dir / "trace", metadata, {stream});
+}
+
+std::vector<NativeCtfDecoderTest::DecodedEvent> NativeCtfDecoderTest::decode(bool native) const
+{
+    TraceSet traceSet;
+    std::vector<DecodedEvent> events;
+
+    traceSet.setNativeDecoding(native);
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+
+    for (auto it = traceSet.begin(); it != traceSet.end(); ++it) {
+        const auto& event = *it;
+
+        events.push_back({
+            event.getNameStr(),
+            event.getId(),
+            event.getCycles(),
+            event.getTimestamp(),
+            event.getFields().toString(),
+            event.getStreamPacketContext().toString()
+        });
+    }
+
+    return events;
+}
+
+void NativeCtfDecoderTest::testSameAsBabeltrace()
+{
+    this->writeTrace();
+
+    auto btEvents = this->decode(false);
+    auto nativeEvents = this->decode(true);
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(4), btEvents.size());
+    CPPUNIT_ASSERT_EQUAL(btEvents.size(), nativeEvents.size());
+
+    for (std::size_t x = 0; x < btEvents.size(); ++x) {
+        const auto& btEvent = btEvents[x];
+        const auto& nativeEvent = nativeEvents[x];
+
+        CPPUNIT_ASSERT_EQUAL(btEvent.name, nativeEvent.name);
+        CPPUNIT_ASSERT_EQUAL(btEvent.id, nativeEvent.id);
+        CPPUNIT_ASSERT_EQUAL(btEvent.cycles, nativeEvent.cycles);
+        CPPUNIT_ASSERT_EQUAL(btEvent.ts, nativeEvent.ts);
+        CPPUNIT_ASSERT_EQUAL(btEvent.fields, nativeEvent.fields);
+        CPPUNIT_ASSERT_EQUAL(btEvent.packetContext, nativeEvent.packetContext);
+    }
+}
+
+void NativeCtfDecoderTest::testClockOffset()
+{
+    this->writeTrace();
+
+    auto events = this->decode(true);
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(4), events.size());
+    CPPUNIT_ASSERT_EQUAL(std::string {"ev_a"}, events[0].name);
+    CPPUNIT_ASSERT_EQUAL(static_cast<trace_cycles_t>(100), events[0].cycles);
+    CPPUNIT_ASSERT_EQUAL(CLOCK_OFFSET + 100, events[0].ts);
+
+    // 32-bit timestamp wrapped within the second packet
+    CPPUNIT_ASSERT_EQUAL(static_cast<trace_cycles_t>(0x100000010ULL),
+                         events[3].cycles);
+    CPPUNIT_ASSERT_EQUAL(CLOCK_OFFSET + 0x100000010ULL, events[3].ts);
+}
+
+void NativeCtfDecoderTest::testEmptyEvent()
+{
+    this->writeEmptyEventTrace();
+
+    // must give up instead of decoding the same empty event forever
+    CPPUNIT_ASSERT_THROW(this->decode(true), ex::TraceSet);
+}
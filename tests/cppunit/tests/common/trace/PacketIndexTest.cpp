@@ -0,0 +1,198 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/trace/TraceSet.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class PacketIndexTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(PacketIndexTest);
+        CPPUNIT_TEST(testBuild);
+        CPPUNIT_TEST(testLoad);
+        CPPUNIT_TEST(testOtherTrace);
+        CPPUNIT_TEST(testModifiedStream);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testBuild();
+    void testLoad();
+    void testOtherTrace();
+    void testModifiedStream();
+
+private:
+    void writeTrace(const bfs::path& dir, unsigned int firstPacketEvents);
+    std::uint64_t getEventCount(const bfs::path& dir) const;
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(PacketIndexTest);
+
+void PacketIndexTest::setUp()
+{
+    _dir = createTempDir();
+}
+
+void PacketIndexTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void PacketIndexTest::writeTrace(const bfs::path& dir,
+                                 unsigned int firstPacketEvents)
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "stream {\n"
+        "    id = 0;\n"
+        "    event.header := struct {\n"
+        "        uint8_t id;\n"
+        "        uint32_clock_t timestamp;\n"
+        "    };\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint64_clock_t timestamp_begin;\n"
+        "        uint64_clock_t timestamp_end;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t x; };\n"
+        "};\n";
+
+    /* Whatever the number of events, packets are always 256 bytes:
+     * traces only differing by this number have stream files of the
+     * same name and size.
+     */
+    std::string events1;
+
+    for (unsigned int x = 0; x < firstPacketEvents; ++x) {
+        appendUint(events1, 0, 1);
+        appendUint(events1, 100 + x * 10, 4);
+        appendUint(events1, x, 4);
+    }
+
+    std::string events2;
+
+    appendUint(events2, 0, 1);
+    appendUint(events2, 500, 4);
+    appendUint(events2, 7, 4);
+    appendUint(events2, 0, 1);
+    appendUint(events2, 600, 4);
+    appendUint(events2, 8, 4);
+
+    std::string stream;
+
+    appendPacket(stream, 0, 100, 200, events1, true);
+    appendPacket(stream, 0, 500, 600, events2, true);
+
+    writeCtfTrace(dir, metadata, {stream});
+}
+
+std::uint64_t PacketIndexTest::getEventCount(const bfs::path& dir) const
+{
+    TraceSet traceSet;
+
+    CPPUNIT_ASSERT(traceSet.addTrace(dir));
+    CPPUNIT_ASSERT(traceSet.usePacketIndexes(_dir / "indexes"));
+
+    return traceSet.getEventCount();
+}
+
+void PacketIndexTest::testBuild()
+{
+    this->writeTrace(_dir / "trace", 3);
+
+    TraceSet traceSet;
+
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+    CPPUNIT_ASSERT(traceSet.usePacketIndexes(_dir / "indexes"));
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(5),
+                         traceSet.getEventCount());
+    CPPUNIT_ASSERT_EQUAL(CLOCK_OFFSET + 100, traceSet.getBegin());
+    CPPUNIT_ASSERT_EQUAL(CLOCK_OFFSET + 600, traceSet.getEnd());
+    CPPUNIT_ASSERT(bfs::exists(_dir / "indexes" / "0"));
+}
+
+void PacketIndexTest::testLoad()
+{
+    this->writeTrace(_dir / "trace", 3);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(5),
+                         this->getEventCount(_dir / "trace"));
+
+    // an index file which is loaded is not saved again
+    auto indexPath = _dir / "indexes" / "0";
+    std::time_t past = bfs::last_write_time(indexPath) - 100;
+
+    bfs::last_write_time(indexPath, past);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(5),
+                         this->getEventCount(_dir / "trace"));
+    CPPUNIT_ASSERT_EQUAL(past, bfs::last_write_time(indexPath));
+}
+
+void PacketIndexTest::testOtherTrace()
+{
+    // same trace ID, stream names and sizes: only the trace path differs
+    this->writeTrace(_dir / "a", 3);
+    this->writeTrace(_dir / "b", 1);
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(5),
+                         this->getEventCount(_dir / "a"));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(3),
+                         this->getEventCount(_dir / "b"));
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(5),
+                         this->getEventCount(_dir / "a"));
+}
+
+void PacketIndexTest::testModifiedStream()
+{
+    auto streamPath = _dir / "trace" / "channel_0";
+
+    this->writeTrace(_dir / "trace", 3);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(5),
+                         this->getEventCount(_dir / "trace"));
+
+    // rewritten with the same size: only the modification time differs
+    std::time_t mtime = bfs::last_write_time(streamPath);
+
+    this->writeTrace(_dir / "trace", 1);
+    bfs::last_write_time(streamPath, mtime + 10);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(3),
+                         this->getEventCount(_dir / "trace"));
+}
@@ -0,0 +1,236 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventBatch.hpp>
+#include <common/trace/AbstractEventValue.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class StreamGroupMergerTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(StreamGroupMergerTest);
+        CPPUNIT_TEST(testGroups);
+        CPPUNIT_TEST(testLongBatch);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testGroups();
+    void testLongBatch();
+
+private:
+    struct DecodedEvent
+    {
+        std::string name;
+        timestamp_t ts;
+        std::uint64_t x;
+    };
+
+private:
+    void writeTrace();
+    std::vector<DecodedEvent> decode(std::size_t groupsCount) const;
+    static void assertOrdered(const std::vector<DecodedEvent>& events);
+
+private:
+    // streams, packets per stream and events per packet
+    static const unsigned int STREAMS = 4;
+    static const unsigned int PACKETS = 30;
+    static const unsigned int EVENTS = 20;
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(StreamGroupMergerTest);
+
+const unsigned int StreamGroupMergerTest::STREAMS;
+const unsigned int StreamGroupMergerTest::PACKETS;
+const unsigned int StreamGroupMergerTest::EVENTS;
+
+void StreamGroupMergerTest::setUp()
+{
+    _dir = createTempDir();
+    this->writeTrace();
+}
+
+void StreamGroupMergerTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void StreamGroupMergerTest::writeTrace()
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "stream {\n"
+        "    id = 0;\n"
+        "    event.header := struct {\n"
+        "        uint8_t id;\n"
+        "        uint32_clock_t timestamp;\n"
+        "    };\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint64_clock_t timestamp_begin;\n"
+        "        uint64_clock_t timestamp_end;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_a\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t x; };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_b\";\n"
+        "    id = 1;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t x; };\n"
+        "};\n";
+
+    /* Events of all streams interleave, with distinct timestamps: the
+     * field of each event is its index in the merged sequence.
+     */
+    std::vector<std::string> streams;
+
+    for (unsigned int s = 0; s < STREAMS; ++s) {
+        std::string stream;
+
+        for (unsigned int p = 0; p < PACKETS; ++p) {
+            std::string events;
+            std::uint64_t firstX = (p * EVENTS) * STREAMS + s;
+            std::uint64_t lastX = (p * EVENTS + EVENTS - 1) * STREAMS + s;
+
+            for (unsigned int e = 0; e < EVENTS; ++e) {
+                std::uint64_t x = (p * EVENTS + e) * STREAMS + s;
+
+                appendUint(events, x % 2, 1);
+                appendUint(events, 100 + x * 10, 4);
+                appendUint(events, x, 4);
+            }
+
+            appendPacket(stream, 0, 100 + firstX * 10, 100 + lastX * 10,
+                         events, true);
+        }
+
+        streams.push_back(stream);
+    }
+
+    writeCtfTrace(_dir / "trace", metadata, streams);
+}
+
+std::vector<StreamGroupMergerTest::DecodedEvent> StreamGroupMergerTest::decode(std::size_t groupsCount) const
+{
+    TraceSet traceSet;
+    std::vector<DecodedEvent> events;
+
+    traceSet.setParallelDecoding(groupsCount);
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+
+    for (auto it = traceSet.begin(); it != traceSet.end(); ++it) {
+        const auto& event = *it;
+
+        events.push_back({
+            event.getNameStr(),
+            event.getTimestamp(),
+            event["x"].asUint()
+        });
+    }
+
+    return events;
+}
+
+void StreamGroupMergerTest::assertOrdered(const std::vector<DecodedEvent>& events)
+{
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(STREAMS * PACKETS * EVENTS),
+                         events.size());
+
+    for (std::size_t x = 0; x < events.size(); ++x) {
+        const auto& event = events[x];
+
+        CPPUNIT_ASSERT_EQUAL(static_cast<std::uint64_t>(x), event.x);
+        CPPUNIT_ASSERT_EQUAL(CLOCK_OFFSET + 100 + x * 10, event.ts);
+        CPPUNIT_ASSERT_EQUAL(std::string {(x % 2) ? "ev_b" : "ev_a"}, event.name);
+    }
+}
+
+void StreamGroupMergerTest::testGroups()
+{
+    // sequential decoding, then 1 to more groups than streams
+    for (std::size_t groupsCount = 0; groupsCount <= STREAMS + 1; ++groupsCount) {
+        StreamGroupMergerTest::assertOrdered(this->decode(groupsCount));
+    }
+}
+
+void StreamGroupMergerTest::testLongBatch()
+{
+    TraceSet traceSet;
+    std::vector<DecodedEvent> events;
+
+    traceSet.setParallelDecoding(1);
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+
+    /* The batch is longer than the ring of the only decoder (512
+     * slots): it cannot keep all the events of a batch, so batches
+     * stop before being full.
+     */
+    EventBatch batch {STREAMS * PACKETS * EVENTS};
+    auto it = traceSet.begin();
+    bool partialBatch = false;
+
+    while (it != traceSet.end()) {
+        auto count = it.fill(batch);
+
+        CPPUNIT_ASSERT(count > 0);
+        CPPUNIT_ASSERT(count <= 512);
+
+        if (it != traceSet.end()) {
+            partialBatch = true;
+        }
+
+        // all the events of the batch are still valid
+        for (std::size_t x = 0; x < batch.size(); ++x) {
+            const auto& event = batch[x];
+
+            events.push_back({
+                event.getNameStr(),
+                event.getTimestamp(),
+                event["x"].asUint()
+            });
+        }
+    }
+
+    CPPUNIT_ASSERT(partialBatch);
+    StreamGroupMergerTest::assertOrdered(events);
+}
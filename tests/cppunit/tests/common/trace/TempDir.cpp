@@ -0,0 +1,47 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <boost/filesystem.hpp>
+
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+namespace bfs = boost::filesystem;
+
+namespace tibee
+{
+namespace tests
+{
+
+bfs::path createTempDir()
+{
+    auto dir = bfs::temp_directory_path() /
+               bfs::unique_path("tibee-test-%%%%-%%%%-%%%%-%%%%");
+
+    bfs::create_directories(dir);
+
+    return dir;
+}
+
+void removeTempDir(const bfs::path& dir)
+{
+    boost::system::error_code ec;
+
+    bfs::remove_all(dir, ec);
+}
+
+}
+}
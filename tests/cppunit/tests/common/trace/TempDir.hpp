@@ -0,0 +1,46 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#ifndef _TIBEE_TESTS_TEMPDIR_HPP
+#define _TIBEE_TESTS_TEMPDIR_HPP
+
+#include <boost/filesystem/path.hpp>
+
+namespace tibee
+{
+namespace tests
+{
+
+/**
+ * Creates a new, empty, uniquely named directory within the system's
+ * temporary directory, for the files of one unit test.
+ *
+ * @returns Path of the created directory
+ */
+boost::filesystem::path createTempDir();
+
+/**
+ * Removes directory \p dir and all its content, ignoring errors.
+ *
+ * @param dir Directory created by createTempDir()
+ */
+void removeTempDir(const boost::filesystem::path& dir);
+
+}
+}
+
+#endif // _TIBEE_TESTS_TEMPDIR_HPP
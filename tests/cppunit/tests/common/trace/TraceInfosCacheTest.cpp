@@ -0,0 +1,156 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <fstream>
+#include <memory>
+#include <string>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/trace/TraceInfosCache.hpp>
+#include <common/trace/TraceInfos.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class TraceInfosCacheTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TraceInfosCacheTest);
+        CPPUNIT_TEST(testMiss);
+        CPPUNIT_TEST(testRoundTrip);
+        CPPUNIT_TEST(testMetadataChange);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testMiss();
+    void testRoundTrip();
+    void testMetadataChange();
+
+private:
+    void writeMetadata(const std::string& content);
+    std::unique_ptr<TraceInfos> buildTraceInfos() const;
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TraceInfosCacheTest);
+
+void TraceInfosCacheTest::setUp()
+{
+    _dir = createTempDir();
+    bfs::create_directories(_dir / "trace");
+    this->writeMetadata("/* CTF 1.8 */ trace { major = 1; minor = 8; };");
+}
+
+void TraceInfosCacheTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void TraceInfosCacheTest::writeMetadata(const std::string& content)
+{
+    std::ofstream os {(_dir / "trace" / "metadata").string()};
+
+    os << content;
+}
+
+std::unique_ptr<TraceInfos> TraceInfosCacheTest::buildTraceInfos() const
+{
+    std::unique_ptr<TraceInfos::Environment> env {new TraceInfos::Environment};
+
+    (*env)["domain"] = "kernel";
+    (*env)["hostname"] = "beetle";
+
+    std::unique_ptr<FieldInfos::FieldMap> fieldsMap {new FieldInfos::FieldMap};
+
+    fieldsMap->emplace("prev_tid", std::unique_ptr<FieldInfos> {
+        new FieldInfos {0, "prev_tid", nullptr}
+    });
+    fieldsMap->emplace("_next_tid", std::unique_ptr<FieldInfos> {
+        new FieldInfos {1, "next_tid", nullptr}
+    });
+
+    std::unique_ptr<FieldInfos::FieldMap> fieldMap {new FieldInfos::FieldMap};
+
+    fieldMap->emplace("fields", std::unique_ptr<FieldInfos> {
+        new FieldInfos {0, "fields", std::move(fieldsMap)}
+    });
+    fieldMap->emplace("context", nullptr);
+
+    std::unique_ptr<TraceInfos::EventMap> eventMap {new TraceInfos::EventMap};
+
+    eventMap->emplace("sched_switch", std::unique_ptr<EventInfos> {
+        new EventInfos {(1 << 20) | 42, "sched_switch", std::move(fieldMap)}
+    });
+
+    return std::unique_ptr<TraceInfos> {
+        new TraceInfos {_dir / "trace", 3, std::move(env), std::move(eventMap)}
+    };
+}
+
+void TraceInfosCacheTest::testMiss()
+{
+    TraceInfosCache cache {_dir / "cache"};
+
+    CPPUNIT_ASSERT(!cache.load(_dir / "trace", 0));
+    CPPUNIT_ASSERT(!cache.load(_dir / "nope", 0));
+}
+
+void TraceInfosCacheTest::testRoundTrip()
+{
+    TraceInfosCache cache {_dir / "cache"};
+
+    CPPUNIT_ASSERT(cache.save(*this->buildTraceInfos()));
+
+    auto traceInfos = cache.load(_dir / "trace", 7);
+
+    CPPUNIT_ASSERT(traceInfos);
+    CPPUNIT_ASSERT_EQUAL(7, traceInfos->getId());
+    CPPUNIT_ASSERT_EQUAL(std::string {"lttng-kernel"}, traceInfos->getTraceType());
+    CPPUNIT_ASSERT_EQUAL(std::string {"beetle"}, traceInfos->getEnv()->at("hostname"));
+
+    const auto& eventInfos = traceInfos->getEventMap()->at("sched_switch");
+
+    CPPUNIT_ASSERT_EQUAL((1 << 20) | 42, eventInfos->getId());
+    CPPUNIT_ASSERT(!eventInfos->getFieldMap()->at("context"));
+
+    const auto& fields = eventInfos->getFieldMap()->at("fields");
+
+    CPPUNIT_ASSERT(fields->getFieldMap());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), fields->getFieldMap()->size());
+
+    const auto& nextTid = fields->getFieldMap()->at("_next_tid");
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<field_index_t>(1), nextTid->getIndex());
+    CPPUNIT_ASSERT_EQUAL(std::string {"next_tid"}, nextTid->getName());
+    CPPUNIT_ASSERT(!nextTid->getFieldMap());
+}
+
+void TraceInfosCacheTest::testMetadataChange()
+{
+    TraceInfosCache cache {_dir / "cache"};
+
+    CPPUNIT_ASSERT(cache.save(*this->buildTraceInfos()));
+    this->writeMetadata("/* CTF 1.8 */ trace { major = 1; minor = 8; }; ");
+    CPPUNIT_ASSERT(!cache.load(_dir / "trace", 0));
+}
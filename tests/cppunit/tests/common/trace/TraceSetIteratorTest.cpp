@@ -0,0 +1,238 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/trace/TraceSet.hpp>
+#include <common/trace/Event.hpp>
+#include <common/trace/EventBatch.hpp>
+#include <common/trace/AbstractEventValue.hpp>
+#include <cppunit/tests/common/trace/CtfTraceWriter.hpp>
+#include <cppunit/tests/common/trace/TempDir.hpp>
+
+using namespace tibee::common;
+using namespace tibee::tests;
+namespace bfs = boost::filesystem;
+
+class TraceSetIteratorTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(TraceSetIteratorTest);
+        CPPUNIT_TEST(testFillDetached);
+        CPPUNIT_TEST(testFillCopied);
+        CPPUNIT_TEST(testFillKept);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void setUp();
+    void tearDown();
+    void testFillDetached();
+    void testFillCopied();
+    void testFillKept();
+
+private:
+    struct DecodedEvent
+    {
+        std::string name;
+        timestamp_t ts;
+        std::uint64_t x;
+        std::string s;
+        std::uint64_t cpu;
+    };
+
+private:
+    void writeTrace();
+    void assertSameBatches(TraceSet& traceSet) const;
+    static DecodedEvent getDecodedEvent(const Event& event);
+    static void assertSameEvent(const DecodedEvent& expected,
+                                const DecodedEvent& event);
+
+private:
+    // packets and events per packet
+    static const unsigned int PACKETS = 12;
+    static const unsigned int EVENTS = 12;
+
+private:
+    bfs::path _dir;
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(TraceSetIteratorTest);
+
+const unsigned int TraceSetIteratorTest::PACKETS;
+const unsigned int TraceSetIteratorTest::EVENTS;
+
+void TraceSetIteratorTest::setUp()
+{
+    _dir = createTempDir();
+    this->writeTrace();
+}
+
+void TraceSetIteratorTest::tearDown()
+{
+    removeTempDir(_dir);
+}
+
+void TraceSetIteratorTest::writeTrace()
+{
+    std::string metadata {"/* CTF 1.8 */\n"};
+
+    metadata += PACKET_HEADER_LAYOUT;
+    metadata +=
+        "stream {\n"
+        "    id = 0;\n"
+        "    event.header := struct {\n"
+        "        uint8_t id;\n"
+        "        uint32_clock_t timestamp;\n"
+        "    };\n"
+        "    packet.context := struct {\n"
+        "        uint64_t packet_size;\n"
+        "        uint64_t content_size;\n"
+        "        uint64_clock_t timestamp_begin;\n"
+        "        uint64_clock_t timestamp_end;\n"
+        "        uint32_t cpu_id;\n"
+        "    };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_a\";\n"
+        "    id = 0;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t x; string s; };\n"
+        "};\n"
+        "event {\n"
+        "    name = \"ev_b\";\n"
+        "    id = 1;\n"
+        "    stream_id = 0;\n"
+        "    fields := struct { uint32_t x; string s; };\n"
+        "};\n";
+
+    // a string per event: shallow copies would not survive
+    std::string stream;
+
+    for (unsigned int p = 0; p < PACKETS; ++p) {
+        std::string events;
+
+        for (unsigned int e = 0; e < EVENTS; ++e) {
+            std::uint64_t x = p * EVENTS + e;
+
+            appendUint(events, x % 2, 1);
+            appendUint(events, 100 + x * 10, 4);
+            appendUint(events, x, 4);
+            events += "s" + std::to_string(x) + '\0';
+        }
+
+        appendPacket(stream, 0, 100 + p * EVENTS * 10,
+                     100 + (p * EVENTS + EVENTS - 1) * 10, events, true);
+    }
+
+    writeCtfTrace(_dir / "trace", metadata, {stream});
+}
+
+TraceSetIteratorTest::DecodedEvent TraceSetIteratorTest::getDecodedEvent(const Event& event)
+{
+    return {
+        event.getNameStr(),
+        event.getTimestamp(),
+        event["x"].asUint(),
+        event["s"].asString(),
+        event.getStreamPacketContext()["cpu_id"].asUint()
+    };
+}
+
+void TraceSetIteratorTest::assertSameEvent(const DecodedEvent& expected,
+                                           const DecodedEvent& event)
+{
+    CPPUNIT_ASSERT_EQUAL(expected.name, event.name);
+    CPPUNIT_ASSERT_EQUAL(expected.ts, event.ts);
+    CPPUNIT_ASSERT_EQUAL(expected.x, event.x);
+    CPPUNIT_ASSERT_EQUAL(expected.s, event.s);
+    CPPUNIT_ASSERT_EQUAL(expected.cpu, event.cpu);
+}
+
+void TraceSetIteratorTest::assertSameBatches(TraceSet& traceSet) const
+{
+    // reference: one event at a time
+    std::vector<DecodedEvent> expected;
+
+    for (auto it = traceSet.begin(); it != traceSet.end(); ++it) {
+        expected.push_back(TraceSetIteratorTest::getDecodedEvent(*it));
+    }
+
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(PACKETS * EVENTS),
+                         expected.size());
+
+    // batches not aligned on packets
+    EventBatch batch {50};
+    auto it = traceSet.begin();
+    std::size_t index = 0;
+
+    while (it != traceSet.end()) {
+        auto count = it.fill(batch);
+
+        CPPUNIT_ASSERT(count > 0);
+        CPPUNIT_ASSERT_EQUAL(count, batch.size());
+        CPPUNIT_ASSERT(index + count <= expected.size());
+
+        /* The iterator is past the last event of the batch: all the
+         * events of the batch are still valid, until the next fill().
+         */
+        for (std::size_t x = 0; x < batch.size(); ++x) {
+            TraceSetIteratorTest::assertSameEvent(expected[index + x],
+                                                  TraceSetIteratorTest::getDecodedEvent(batch[x]));
+        }
+
+        index += count;
+    }
+
+    CPPUNIT_ASSERT_EQUAL(expected.size(), index);
+
+    // at the end
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(0), it.fill(batch));
+    CPPUNIT_ASSERT(batch.empty());
+}
+
+void TraceSetIteratorTest::testFillDetached()
+{
+    TraceSet traceSet;
+
+    // Babeltrace events: built and detached into the batch
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+    this->assertSameBatches(traceSet);
+}
+
+void TraceSetIteratorTest::testFillCopied()
+{
+    TraceSet traceSet;
+
+    // the native decoder can't keep its events: copied into the batch
+    traceSet.setNativeDecoding(true);
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+    this->assertSameBatches(traceSet);
+}
+
+void TraceSetIteratorTest::testFillKept()
+{
+    TraceSet traceSet;
+
+    // stream group decoders keep their events in place
+    traceSet.setParallelDecoding(2);
+    CPPUNIT_ASSERT(traceSet.addTrace(_dir / "trace"));
+    this->assertSameBatches(traceSet);
+}
@@ -0,0 +1,107 @@
+/* Copyright (c) 2014 Philippe Proulx <eepp.ca>
+ *
+ * This file is part of tigerbeetle.
+ *
+ * tigerbeetle is free software: you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation, either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * tigerbeetle is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with tigerbeetle.  If not, see <http://www.gnu.org/licenses/>.
+ */
+#include <cstdint>
+#include <string>
+#include <cppunit/extensions/HelperMacros.h>
+
+#include <common/utils/JsonParser.hpp>
+
+using namespace tibee::common;
+
+class JsonParserTest :
+    public CppUnit::TestFixture
+{
+    CPPUNIT_TEST_SUITE(JsonParserTest);
+        CPPUNIT_TEST(testScalars);
+        CPPUNIT_TEST(testNested);
+        CPPUNIT_TEST(testInvalid);
+    CPPUNIT_TEST_SUITE_END();
+
+public:
+    void testScalars();
+    void testNested();
+    void testInvalid();
+};
+
+CPPUNIT_TEST_SUITE_REGISTRATION(JsonParserTest);
+
+void JsonParserTest::testScalars()
+{
+    JsonParser parser;
+    auto root = parser.parse("[null, true, -42, 1.5, \"beetle\", 9999999999]");
+
+    CPPUNIT_ASSERT(root);
+    CPPUNIT_ASSERT(root->type == JsonValue::Type::ARRAY);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(6), root->items.size());
+    CPPUNIT_ASSERT(root->items[0]->type == JsonValue::Type::NUL);
+    CPPUNIT_ASSERT(root->items[1]->type == JsonValue::Type::BOOL);
+    CPPUNIT_ASSERT(root->items[1]->boolValue);
+    CPPUNIT_ASSERT(root->items[2]->type == JsonValue::Type::INT);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::int64_t>(-42), root->items[2]->intValue);
+    CPPUNIT_ASSERT(root->items[3]->type == JsonValue::Type::DOUBLE);
+    CPPUNIT_ASSERT_EQUAL(1.5, root->items[3]->doubleValue);
+    CPPUNIT_ASSERT(root->items[4]->type == JsonValue::Type::STRING);
+    CPPUNIT_ASSERT_EQUAL(std::string {"beetle"}, root->items[4]->stringValue);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::int64_t>(9999999999LL),
+                         root->items[5]->intValue);
+}
+
+void JsonParserTest::testNested()
+{
+    JsonParser parser;
+    auto root = parser.parse("{\"a\": {\"b\": [1, {\"c\": []}]}, \"d\": {}}");
+
+    CPPUNIT_ASSERT(root);
+    CPPUNIT_ASSERT(root->type == JsonValue::Type::MAP);
+    CPPUNIT_ASSERT(!root->find("b"));
+
+    auto a = root->find("a");
+
+    CPPUNIT_ASSERT(a && a->type == JsonValue::Type::MAP);
+
+    auto b = a->find("b");
+
+    CPPUNIT_ASSERT(b && b->type == JsonValue::Type::ARRAY);
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::size_t>(2), b->items.size());
+    CPPUNIT_ASSERT_EQUAL(static_cast<std::int64_t>(1), b->items[0]->intValue);
+
+    auto c = b->items[1]->find("c");
+
+    CPPUNIT_ASSERT(c && c->type == JsonValue::Type::ARRAY);
+    CPPUNIT_ASSERT(c->items.empty());
+
+    auto d = root->find("d");
+
+    CPPUNIT_ASSERT(d && d->type == JsonValue::Type::MAP);
+    CPPUNIT_ASSERT(d->items.empty());
+}
+
+void JsonParserTest::testInvalid()
+{
+    JsonParser parser;
+
+    CPPUNIT_ASSERT(!parser.parse(""));
+    CPPUNIT_ASSERT(!parser.parse("{\"a\": "));
+    CPPUNIT_ASSERT(!parser.parse("[1, 2,, 3]"));
+    CPPUNIT_ASSERT(!parser.parse("{\"a\": 1} {\"b\": 2}"));
+
+    // the parser is reusable after an error
+    auto root = parser.parse("{\"a\": 1}");
+
+    CPPUNIT_ASSERT(root && root->find("a"));
+}